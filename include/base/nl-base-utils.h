@@ -778,6 +778,25 @@ struct trans_tbl {
 
 /*****************************************************************************/
 
+/* Reference counters of objects which may be shared between threads */
+static inline int _nl_refcnt_inc(int *refcnt)
+{
+	return __atomic_add_fetch(refcnt, 1, __ATOMIC_RELAXED);
+}
+
+static inline int _nl_refcnt_dec(int *refcnt)
+{
+	return __atomic_sub_fetch(refcnt, 1, __ATOMIC_ACQ_REL);
+}
+
+/* Pairs with _nl_refcnt_dec(), an unshared object may be modified */
+static inline int _nl_refcnt_read(const int *refcnt)
+{
+	return __atomic_load_n(refcnt, __ATOMIC_ACQUIRE);
+}
+
+/*****************************************************************************/
+
 #ifndef DISABLE_PTHREADS
 #define NL_LOCK(NAME) pthread_mutex_t(NAME) = PTHREAD_MUTEX_INITIALIZER
 #define NL_RW_LOCK(NAME) pthread_rwlock_t(NAME) = PTHREAD_RWLOCK_INITIALIZER
@@ -31,6 +31,8 @@ struct nl_cache;
 typedef void (*change_func_t)(struct nl_cache *, struct nl_object *, int, void *);
 typedef void (*change_func_v2_t)(struct nl_cache *, struct nl_object *old_obj,
 	      struct nl_object *new_obj, uint64_t, int, void *);
+typedef int (*nl_cache_filter_func_t)(struct nl_object *, void *);
+typedef int (*nl_cache_stream_func_t)(struct nl_object *, void *);
 
 /**
  * @ingroup cache
@@ -38,6 +40,19 @@ typedef void (*change_func_v2_t)(struct nl_cache *, struct nl_object *old_obj,
  */
 #define NL_CACHE_AF_ITER	0x0001
 
+/**
+ * @ingroup cache
+ * Do not copy cached objects before updating them in place, v2 change
+ * callbacks are called without the old object for such changes
+ */
+#define NL_CACHE_NO_CHANGE_CLONE	0x0002
+
+/**
+ * @ingroup cache
+ * Allow lookups from other threads while the cache is being updated
+ */
+#define NL_CACHE_THREAD_SAFE	0x0004
+
 /* Access Functions */
 extern int			nl_cache_nitems(struct nl_cache *);
 extern int			nl_cache_nitems_filter(struct nl_cache *,
@@ -58,6 +73,7 @@ extern struct nl_cache *	nl_cache_subset(struct nl_cache *,
 						struct nl_object *);
 extern struct nl_cache *	nl_cache_clone(struct nl_cache *);
 extern void			nl_cache_clear(struct nl_cache *);
+
 extern void			nl_cache_get(struct nl_cache *);
 extern void			nl_cache_free(struct nl_cache *);
 extern void			nl_cache_put(struct nl_cache *cache);
@@ -72,6 +88,12 @@ extern int			nl_cache_move(struct nl_cache *,
 extern void			nl_cache_remove(struct nl_object *);
 extern int			nl_cache_refill(struct nl_sock *,
 						struct nl_cache *);
+extern int			nl_cache_refill_parallel(struct nl_sock **, int,
+							 struct nl_cache **, int);
+extern int			nl_cache_stream(struct nl_sock *,
+						struct nl_cache *,
+						nl_cache_stream_func_t,
+						void *);
 extern int			nl_cache_pickup(struct nl_sock *,
 						struct nl_cache *);
 extern int			nl_cache_pickup_checkdup(struct nl_sock *,
@@ -91,6 +113,14 @@ extern int			nl_cache_include_v2(struct nl_cache *,
 extern void			nl_cache_set_arg1(struct nl_cache *, int);
 extern void			nl_cache_set_arg2(struct nl_cache *, int);
 extern void			nl_cache_set_flags(struct nl_cache *, unsigned int);
+extern int			nl_cache_set_dump_filter(struct nl_cache *,
+							 struct nl_object *);
+extern int			nl_cache_set_filter(struct nl_cache *,
+						    struct nl_object *);
+extern void			nl_cache_set_filter_func(struct nl_cache *,
+							 nl_cache_filter_func_t,
+							 void *);
+extern int			nl_cache_presize(struct nl_cache *, unsigned int);
 
 /* General */
 extern int			nl_cache_is_empty(struct nl_cache *);
@@ -119,6 +149,15 @@ extern void			nl_cache_foreach_filter(struct nl_cache *,
 								   void *),
 							void *arg);
 
+/* Snapshots */
+struct nl_cache_snapshot;
+
+extern struct nl_cache_snapshot *nl_cache_snapshot(struct nl_cache *);
+extern void			nl_cache_snapshot_put(struct nl_cache_snapshot *);
+extern int			nl_cache_snapshot_nitems(struct nl_cache_snapshot *);
+extern struct nl_object *	nl_cache_snapshot_item(struct nl_cache_snapshot *,
+						       int);
+
 /* --- cache management --- */
 
 /* Cache type management */
@@ -142,6 +181,7 @@ struct nl_cache_mngr;
 
 #define NL_AUTO_PROVIDE		    1
 #define NL_ALLOCATED_SOCK	    2  /* For internal use only, do not use */
+#define NL_AUTO_RESYNC		    8
 
 extern int			nl_cache_mngr_alloc(struct nl_sock *,
 						    int, int,
@@ -162,9 +202,12 @@ extern int			nl_cache_mngr_add_cache_v2(struct nl_cache_mngr *mngr,
 							   struct nl_cache *cache,
 							   change_func_v2_t cb, void *data);
 extern int			nl_cache_mngr_get_fd(struct nl_cache_mngr *);
+extern int			nl_cache_mngr_set_recv_batch(struct nl_cache_mngr *,
+							     unsigned int);
 extern int			nl_cache_mngr_poll(struct nl_cache_mngr *,
 						   int);
 extern int			nl_cache_mngr_data_ready(struct nl_cache_mngr *);
+extern uint64_t			nl_cache_mngr_get_overruns(struct nl_cache_mngr *);
 extern void			nl_cache_mngr_info(struct nl_cache_mngr *,
 						   struct nl_dump_params *);
 extern void			nl_cache_mngr_free(struct nl_cache_mngr *);
@@ -39,6 +39,8 @@ extern int			nl_hash_table_del(nl_hash_table_t *ht,
 
 extern struct nl_object *	nl_hash_table_lookup(nl_hash_table_t *ht,
 						     struct nl_object *obj);
+extern int			nl_hash_table_presize(nl_hash_table_t *ht,
+						      int nobjs);
 extern uint32_t 		nl_hash(void *k, size_t length,
 					uint32_t initval);
 
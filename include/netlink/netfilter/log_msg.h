@@ -17,14 +17,19 @@ extern "C" {
 
 struct nlmsghdr;
 struct nfnl_log_msg;
+struct nfnl_log_collector;
 struct nfnl_ct;
 
+typedef void (*nfnl_log_collector_func_t)(struct nfnl_log_msg *, void *);
+
 extern struct nl_object_ops log_msg_obj_ops;
 
 /* General */
 extern struct nfnl_log_msg *nfnl_log_msg_alloc(void);
 extern int		nfnlmsg_log_msg_parse(struct nlmsghdr *,
 					      struct nfnl_log_msg **);
+extern int		nfnlmsg_log_msg_parse_zerocopy(struct nl_msg *,
+						       struct nfnl_log_msg **);
 
 extern void		nfnl_log_msg_get(struct nfnl_log_msg *);
 extern void		nfnl_log_msg_put(struct nfnl_log_msg *);
@@ -115,6 +120,16 @@ extern void		nfnl_log_msg_set_ct(struct nfnl_log_msg *, struct nfnl_ct *);
 extern int		nfnl_log_msg_test_ct(const struct nfnl_log_msg *);
 extern struct nfnl_ct * nfnl_log_msg_get_ct(const struct nfnl_log_msg *);
 
+/* Collector */
+extern struct nfnl_log_collector *nfnl_log_collector_alloc(struct nl_sock *,
+							   nfnl_log_collector_func_t,
+							   void *);
+extern void		nfnl_log_collector_free(struct nfnl_log_collector *);
+extern int		nfnl_log_collector_recv(struct nfnl_log_collector *);
+extern uint64_t		nfnl_log_collector_get_received(const struct nfnl_log_collector *);
+extern uint64_t		nfnl_log_collector_get_lost(const struct nfnl_log_collector *);
+extern uint64_t		nfnl_log_collector_get_lost_global(const struct nfnl_log_collector *);
+
 #ifdef __cplusplus
 }
 #endif
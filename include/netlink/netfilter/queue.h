@@ -15,6 +15,8 @@ extern "C" {
 struct nl_sock;
 struct nlmsghdr;
 struct nfnl_queue;
+struct nfnl_queue_msg;
+struct nfnl_queue_pool;
 
 extern struct nl_object_ops queue_obj_ops;
 
@@ -24,6 +26,12 @@ enum nfnl_queue_copy_mode {
 	NFNL_QUEUE_COPY_PACKET,
 };
 
+enum nfnl_queue_flags {
+	NFNL_QUEUE_FLAG_FAIL_OPEN	= 0x1,
+	NFNL_QUEUE_FLAG_CONNTRACK	= 0x2,
+	NFNL_QUEUE_FLAG_GSO		= 0x4,
+};
+
 /* General */
 extern struct nl_sock *		nfnl_queue_socket_alloc(void);
 
@@ -55,6 +63,15 @@ extern void			nfnl_queue_set_copy_range(struct nfnl_queue *,
 extern int			nfnl_queue_test_copy_range(const struct nfnl_queue *);
 extern uint32_t			nfnl_queue_get_copy_range(const struct nfnl_queue *);
 
+extern void			nfnl_queue_set_flags(struct nfnl_queue *, unsigned int);
+extern void			nfnl_queue_unset_flags(struct nfnl_queue *, unsigned int);
+extern int			nfnl_queue_test_flags(const struct nfnl_queue *);
+extern unsigned int		nfnl_queue_get_flags(const struct nfnl_queue *);
+extern unsigned int		nfnl_queue_get_flag_mask(const struct nfnl_queue *);
+
+extern char *			nfnl_queue_flags2str(unsigned int, char *, size_t);
+extern unsigned int		nfnl_queue_str2flags(const char *);
+
 extern int	nfnl_queue_build_pf_bind(uint8_t, struct nl_msg **);
 extern int	nfnl_queue_pf_bind(struct nl_sock *, uint8_t);
 
@@ -76,6 +93,28 @@ extern int	nfnl_queue_build_delete_request(const struct nfnl_queue *,
 extern int	nfnl_queue_delete(struct nl_sock *,
 				  const struct nfnl_queue *);
 
+/* Queue Pools */
+typedef int (*nfnl_queue_pool_func_t)(struct nfnl_queue_msg *, void *);
+
+extern struct nfnl_queue_pool *	nfnl_queue_pool_alloc(const struct nfnl_queue *,
+						      unsigned int);
+extern void			nfnl_queue_pool_free(struct nfnl_queue_pool *);
+extern int			nfnl_queue_pool_set_cpu(struct nfnl_queue_pool *,
+							unsigned int, int);
+extern int			nfnl_queue_pool_start(struct nfnl_queue_pool *,
+						      nfnl_queue_pool_func_t,
+						      void *);
+extern void			nfnl_queue_pool_stop(struct nfnl_queue_pool *);
+extern unsigned int		nfnl_queue_pool_get_nqueues(const struct nfnl_queue_pool *);
+extern uint64_t			nfnl_queue_pool_get_packets(const struct nfnl_queue_pool *,
+							    unsigned int);
+extern uint64_t			nfnl_queue_pool_get_lost(const struct nfnl_queue_pool *,
+							 unsigned int);
+extern uint64_t			nfnl_queue_pool_get_overruns(const struct nfnl_queue_pool *,
+							     unsigned int);
+extern uint64_t			nfnl_queue_pool_get_verdict_errors(const struct nfnl_queue_pool *,
+								   unsigned int);
+
 #ifdef __cplusplus
 }
 #endif
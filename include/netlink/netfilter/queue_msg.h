@@ -15,6 +15,7 @@ extern "C" {
 struct nl_sock;
 struct nlmsghdr;
 struct nfnl_queue_msg;
+struct nfnl_queue_verdict_buf;
 
 extern struct nl_object_ops queue_msg_obj_ops;
 
@@ -22,6 +23,8 @@ extern struct nl_object_ops queue_msg_obj_ops;
 extern struct nfnl_queue_msg *	nfnl_queue_msg_alloc(void);
 extern int			nfnlmsg_queue_msg_parse(struct nlmsghdr *,
 						struct nfnl_queue_msg **);
+extern int			nfnlmsg_queue_msg_parse_zerocopy(struct nl_msg *,
+						struct nfnl_queue_msg **);
 
 extern void			nfnl_queue_msg_get(struct nfnl_queue_msg *);
 extern void			nfnl_queue_msg_put(struct nfnl_queue_msg *);
@@ -94,6 +97,21 @@ extern int			nfnl_queue_msg_send_verdict_batch(struct nl_sock *,
 extern int			nfnl_queue_msg_send_verdict_payload(struct nl_sock *,
 						const struct nfnl_queue_msg *,
 						const void *, unsigned );
+
+/* Verdict Buffers */
+extern struct nfnl_queue_verdict_buf *
+				nfnl_queue_verdict_buf_alloc(struct nl_sock *,
+							     uint8_t, uint16_t);
+extern void			nfnl_queue_verdict_buf_free(struct nfnl_queue_verdict_buf *);
+extern int			nfnl_queue_verdict_buf_set_limits(struct nfnl_queue_verdict_buf *,
+								  unsigned int,
+								  unsigned int);
+extern int			nfnl_queue_verdict_buf_add(struct nfnl_queue_verdict_buf *,
+							   uint32_t, unsigned int);
+extern int			nfnl_queue_verdict_buf_add_msg(struct nfnl_queue_verdict_buf *,
+							       const struct nfnl_queue_msg *);
+extern int			nfnl_queue_verdict_buf_flush(struct nfnl_queue_verdict_buf *);
+extern int			nfnl_queue_verdict_buf_timeout(const struct nfnl_queue_verdict_buf *);
 #ifdef __cplusplus
 }
 #endif
@@ -64,6 +64,30 @@ extern int			nl_send_sync(struct nl_sock *, struct nl_msg *);
 extern int			nl_send_simple(struct nl_sock *, int, int,
 					       void *, size_t);
 
+/* Batched Send */
+struct nl_send_batch;
+
+typedef void (*nl_send_batch_err_cb_t)(struct nl_msg *, int, void *);
+
+extern struct nl_send_batch *	nl_send_batch_alloc(struct nl_sock *);
+extern void			nl_send_batch_free(struct nl_send_batch *);
+extern int			nl_send_batch_add(struct nl_send_batch *,
+						  struct nl_msg *);
+extern int			nl_send_batch_flush(struct nl_send_batch *);
+extern int			nl_send_batch_wait(struct nl_send_batch *,
+						   nl_send_batch_err_cb_t,
+						   void *);
+extern struct nl_msg *		nl_send_batch_find(struct nl_send_batch *,
+						   uint32_t);
+
+/* Asynchronous Requests */
+typedef void (*nl_async_cb_t)(struct nl_msg *, int, void *);
+
+extern int			nl_send_async(struct nl_sock *, struct nl_msg *,
+					      nl_async_cb_t, void *);
+extern int			nl_async_process(struct nl_sock *);
+extern int			nl_async_wait(struct nl_sock *);
+
 /* Receive */
 extern int			nl_recv(struct nl_sock *,
 					struct sockaddr_nl *, unsigned char **,
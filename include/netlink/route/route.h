@@ -54,6 +54,9 @@ extern int	rtnl_route_build_msg(struct nl_msg *, struct rtnl_route *);
 
 extern int	rtnl_route_lookup(struct nl_sock *sk, struct nl_addr *dst,
 				  struct rtnl_route **result);
+extern struct rtnl_route *rtnl_route_cache_lookup(struct nl_cache *, uint32_t,
+						  struct nl_addr *,
+						  struct rtnl_nexthop **);
 
 extern int	rtnl_route_build_add_request(struct rtnl_route *, int,
 					     struct nl_msg **);
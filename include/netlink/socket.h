@@ -45,8 +45,19 @@ extern int nl_socket_modify_err_cb(struct nl_sock *, enum nl_cb_kind,
 extern int		nl_socket_set_buffer_size(struct nl_sock *, int, int);
 extern int		nl_socket_set_msg_buf_size(struct nl_sock *, size_t);
 extern size_t		nl_socket_get_msg_buf_size(struct nl_sock *);
+extern void		nl_socket_enable_recv_buf(struct nl_sock *);
+extern void		nl_socket_disable_recv_buf(struct nl_sock *);
+extern size_t		nl_socket_get_recv_buf_size(const struct nl_sock *);
+extern unsigned int	nl_socket_get_recv_buf_grows(const struct nl_sock *);
+extern int		nl_socket_set_recv_batch(struct nl_sock *, unsigned int);
+extern unsigned int	nl_socket_get_recv_batch(const struct nl_sock *);
+extern uint64_t		nl_socket_get_recv_batch_saved(const struct nl_sock *);
+extern int		nl_socket_set_async_window(struct nl_sock *, unsigned int);
+extern unsigned int	nl_socket_get_async_window(const struct nl_sock *);
+extern unsigned int	nl_socket_get_async_pending(const struct nl_sock *);
 extern int		nl_socket_set_passcred(struct nl_sock *, int);
 extern int		nl_socket_recv_pktinfo(struct nl_sock *, int);
+extern int		nl_socket_set_strict_check(struct nl_sock *, int);
 
 extern void		nl_socket_disable_seq_check(struct nl_sock *);
 extern unsigned int	nl_socket_use_seq(struct nl_sock *);
@@ -58,6 +69,8 @@ extern int              nl_socket_set_fd(struct nl_sock *sk, int protocol, int f
 extern int		nl_socket_set_nonblocking(const struct nl_sock *);
 extern void		nl_socket_enable_msg_peek(struct nl_sock *);
 extern void		nl_socket_disable_msg_peek(struct nl_sock *);
+extern void		nl_socket_enable_msg_zerocopy(struct nl_sock *);
+extern void		nl_socket_disable_msg_zerocopy(struct nl_sock *);
 
 #ifdef __cplusplus
 }
@@ -143,6 +143,12 @@ struct nl_parser_param
 
 	/** Arbitary argument to be passed to the parser */
 	void *            pp_arg;
+
+	/**
+	 * Message being parsed if objects may refer to its data instead
+	 * of copying it, see nl_msg_parse(). NULL otherwise.
+	 */
+	struct nl_msg *   pp_msg;
 };
 
 /**
@@ -230,10 +236,39 @@ struct nl_cache_ops
 				  change_func_t change_cb, change_func_v2_t change_cb_v2,
 				  void *data);
 
-	void (*reserved_1)(void);
-	void (*reserved_2)(void);
-	void (*reserved_3)(void);
-	void (*reserved_4)(void);
+	/**
+	 * The functions registered under these callbacks are called after
+	 * an object has been added to a cache respectively before it is
+	 * removed from a cache. Objects updated in place by
+	 * nl_object_update() are removed and added again around the update.
+	 *
+	 * The purpose of these functions is to maintain additional lookup
+	 * indexes in \c c_index of the cache. The index is kept while the
+	 * cache is empty and released by co_index_free() when the cache is
+	 * freed.
+	 */
+	void  (*co_obj_added)(struct nl_cache *, struct nl_object *);
+	void  (*co_obj_removed)(struct nl_cache *, struct nl_object *);
+
+	/**
+	 * Called with a message about to be parsed into an object for a
+	 * cache with a filter object, see nl_cache_set_filter(). The
+	 * message is of one of the types of the cache and has a valid
+	 * family specific header.
+	 *
+	 * The purpose of this function is to avoid parsing messages into
+	 * objects which are dropped by the filter anyway. It must return
+	 * NL_SKIP only if the object parsed from the message cannot match
+	 * \c c_filter of the cache, NL_OK otherwise.
+	 */
+	int   (*co_msg_filter)(struct nl_cache *, struct nlmsghdr *);
+
+	/**
+	 * Called when a cache with a non-NULL \c c_index is freed, after
+	 * all objects have been removed. Must release the index.
+	 */
+	void  (*co_index_free)(struct nl_cache *);
+
 	void (*reserved_5)(void);
 	void (*reserved_6)(void);
 	void (*reserved_7)(void);
@@ -263,6 +298,14 @@ struct nl_cache {
 	unsigned int c_flags;
 	struct nl_hash_table *hashtable;
 	struct nl_cache_ops *c_ops;
+	void *c_index;
+	uint32_t c_gen;
+	struct nl_cache_snapshot *c_snap;
+	struct nl_object *c_filter;
+	int c_filter_events;
+	nl_cache_filter_func_t c_filter_func;
+	void *c_filter_arg;
+	pthread_rwlock_t c_lock;
 };
 
 static inline const char *nl_cache_name(struct nl_cache *cache)
@@ -270,6 +313,36 @@ static inline const char *nl_cache_name(struct nl_cache *cache)
 	return cache->c_ops ? cache->c_ops->co_name : "unknown";
 }
 
+/*
+ * Caches flagged NL_CACHE_THREAD_SAFE may be looked up by other threads
+ * while the thread owning the cache adds and removes objects. Lookups
+ * take the lock for reading, changes of the cache structure take it for
+ * writing.
+ */
+static inline void nl_cache_read_lock(struct nl_cache *cache)
+{
+	if (cache->c_flags & NL_CACHE_THREAD_SAFE)
+		nl_read_lock(&cache->c_lock);
+}
+
+static inline void nl_cache_read_unlock(struct nl_cache *cache)
+{
+	if (cache->c_flags & NL_CACHE_THREAD_SAFE)
+		nl_read_unlock(&cache->c_lock);
+}
+
+static inline void nl_cache_write_lock(struct nl_cache *cache)
+{
+	if (cache->c_flags & NL_CACHE_THREAD_SAFE)
+		nl_write_lock(&cache->c_lock);
+}
+
+static inline void nl_cache_write_unlock(struct nl_cache *cache)
+{
+	if (cache->c_flags & NL_CACHE_THREAD_SAFE)
+		nl_write_unlock(&cache->c_lock);
+}
+
 struct nl_cache_assoc {
 	struct nl_cache *ca_cache;
 	change_func_t ca_change;
@@ -6,6 +6,8 @@
 #ifndef __NL_SHARED_CORE_NL_CORE_H__
 #define __NL_SHARED_CORE_NL_CORE_H__
 
+#include <netlink/addr.h>
+
 #ifndef in_addr_t
 typedef uint32_t in_addr_t;
 #endif
@@ -15,6 +17,49 @@ typedef uint32_t in_addr_t;
 #define NL_MSG_PEEK (1 << 3)
 #define NL_MSG_PEEK_EXPLICIT (1 << 4)
 #define NL_NO_AUTO_ACK (1 << 5)
+#define NL_RECV_ZEROCOPY (1 << 6)
+#define NL_RECV_BUF (1 << 7)
+#define NL_SOCK_STRICT_CHK (1 << 8)
+
+/* Receive buffer shared by all messages borrowed from it */
+struct nl_rxbuf {
+	unsigned char *rb_data;
+	size_t rb_size;
+	int rb_refcnt;
+};
+
+/* Ring of receive buffers filled by a single recvmmsg() */
+struct nl_rxbatch {
+	unsigned int rq_size;
+	unsigned int rq_head;
+	unsigned int rq_count;
+	size_t rq_bufsize;
+	struct mmsghdr *rq_msgs;
+	struct iovec *rq_iov;
+	struct sockaddr_nl *rq_addr;
+	struct nl_rxbuf **rq_bufs;
+	uint64_t rq_saved;
+};
+
+/* Request awaiting its ACK or error in asynchronous mode */
+struct nl_async_req {
+	uint32_t ar_seq;
+	int ar_done;
+	int ar_err;
+	struct nl_msg *ar_msg;
+	nl_async_cb_t ar_cb;
+	void *ar_arg;
+};
+
+/* Ring of in-flight requests, ordered by sequence number */
+struct nl_async {
+	unsigned int as_window;
+	unsigned int as_head;
+	unsigned int as_count;
+	int as_err;
+	int as_busy;
+	struct nl_async_req *as_reqs;
+};
 
 struct nl_sock {
 	struct sockaddr_nl s_local;
@@ -26,6 +71,13 @@ struct nl_sock {
 	int s_flags;
 	struct nl_cb *s_cb;
 	size_t s_bufsize;
+	struct nl_rxbuf *s_rxbuf;
+	size_t s_rxbuf_size;
+	unsigned int s_rxbuf_grows;
+	unsigned int s_overruns;
+	struct nl_rxbatch *s_rxbatch;
+	struct nl_async *s_async;
+	struct nl_msg *s_rxmsg;
 };
 
 static inline int wait_for_ack(struct nl_sock *sk)
@@ -40,6 +92,11 @@ static inline int wait_for_ack(struct nl_sock *sk)
 #define ID_COMPARISON 2
 
 #define NL_OBJ_MARK 1
+#define NL_OBJ_HASHED 2
+#define NL_OBJ_SHARED 4
+
+/* Drop the cached hash key after an identity attribute has changed */
+#define nl_object_invalidate_hash(obj) ((obj)->ce_flags &= ~NL_OBJ_HASHED)
 
 struct nl_data {
 	size_t d_size;
@@ -55,7 +112,114 @@ struct nl_addr {
 	char a_addr[0];
 };
 
+/*
+ * Address of up to 16 bytes stored within an object instead of a
+ * separately allocated struct nl_addr. The family is kept by the object.
+ */
+#define NL_ADDR_INLINE_MAX 16
+
+struct nl_addr_inline {
+	uint8_t ai_len;
+	uint8_t ai_prefixlen;
+	uint8_t ai_addr[NL_ADDR_INLINE_MAX];
+};
+
+static inline int _nl_addr_inline_set(struct nl_addr_inline *ai,
+				      const void *buf, unsigned int len,
+				      int prefixlen)
+{
+	if (len > NL_ADDR_INLINE_MAX || prefixlen < 0 ||
+	    prefixlen > 8 * NL_ADDR_INLINE_MAX)
+		return -NLE_RANGE;
+
+	if (len)
+		memcpy(ai->ai_addr, buf, len);
+	ai->ai_len = len;
+	ai->ai_prefixlen = prefixlen;
+
+	return 0;
+}
+
+static inline struct nl_addr *
+_nl_addr_inline_alloc(const struct nl_addr_inline *ai, int family)
+{
+	struct nl_addr *addr;
+
+	addr = nl_addr_build(family, ai->ai_addr, ai->ai_len);
+	if (addr)
+		nl_addr_set_prefixlen(addr, ai->ai_prefixlen);
+
+	return addr;
+}
+
+/* Same order as nl_addr_cmp() for addresses of the same family */
+static inline int _nl_addr_inline_cmp(const struct nl_addr_inline *a,
+				      const struct nl_addr_inline *b)
+{
+	int d = a->ai_len - b->ai_len;
+
+	if (a->ai_len && d == 0) {
+		d = memcmp(a->ai_addr, b->ai_addr, a->ai_len);
+		if (d == 0)
+			return a->ai_prefixlen - b->ai_prefixlen;
+	}
+
+	return d;
+}
+
+/* Same order as nl_addr_cmp_prefix() for addresses of the same family */
+static inline int _nl_addr_inline_cmp_prefix(const struct nl_addr_inline *a,
+					     const struct nl_addr_inline *b)
+{
+	int len = _NL_MIN(a->ai_prefixlen, b->ai_prefixlen);
+	int bytes = len / 8;
+	int d;
+
+	d = memcmp(a->ai_addr, b->ai_addr, bytes);
+	if (d == 0 && (len % 8) != 0) {
+		int mask = (0xFF00 >> (len % 8)) & 0xFF;
+
+		d = (a->ai_addr[bytes] & mask) - (b->ai_addr[bytes] & mask);
+	}
+
+	return d;
+}
+
+/* Formatted like nl_addr2str(), without allocating a struct nl_addr */
+static inline char *_nl_addr_inline2str(const struct nl_addr_inline *ai,
+					int family, char *buf, size_t size)
+{
+	size_t n;
+	unsigned int i;
+
+	if (!size)
+		return buf;
+
+	if (!ai->ai_len)
+		snprintf(buf, size, "none");
+	else if ((family == AF_INET && ai->ai_len == 4) ||
+		 (family == AF_INET6 && ai->ai_len == 16)) {
+		if (!inet_ntop(family, ai->ai_addr, buf, size))
+			buf[0] = '\0';
+	} else {
+		buf[0] = '\0';
+		for (i = 0; i < ai->ai_len; i++) {
+			n = strlen(buf);
+			snprintf(buf + n, size - n, "%s%02x", i ? ":" : "",
+				 ai->ai_addr[i]);
+		}
+	}
+
+	if (ai->ai_prefixlen != 8 * ai->ai_len) {
+		n = strlen(buf);
+		snprintf(buf + n, size - n, "/%u", ai->ai_prefixlen);
+	}
+
+	return buf;
+}
+
 #define NL_MSG_CRED_PRESENT 1
+#define NL_MSG_BORROWED 2
 
 struct nl_msg {
 	int nm_protocol;
@@ -66,6 +230,7 @@ struct nl_msg {
 	struct nlmsghdr *nm_nlh;
 	size_t nm_size;
 	int nm_refcnt;
+	struct nl_rxbuf *nm_rxbuf;
 };
 
 /*****************************************************************************/
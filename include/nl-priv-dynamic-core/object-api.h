@@ -176,6 +176,9 @@
  */
 #define NLHDR_COMMON				\
 	int			ce_refcnt;	\
+	uint32_t		ce_hash;	\
+	uint32_t		ce_gen;		\
+	uint32_t		ce_msg_hash;	\
 	struct nl_object_ops *	ce_ops;		\
 	struct nl_cache *	ce_cache;	\
 	struct nl_list_head	ce_list;	\
@@ -344,12 +347,14 @@ struct nl_object_ops
 	/**
 	 * Hash Key generator function
 	 *
-	 * When called returns a hash key for the object being
-	 * referenced. This key will be used by higher level hash functions
-	 * to build association lists. Each object type gets to specify
-	 * it's own key formulation
+	 * When called returns a 32 bit hash over the identity attributes
+	 * of the object being referenced. This key will be used by higher
+	 * level hash functions to build association lists. Each object type
+	 * gets to specify it's own key formulation. The key is cached in
+	 * ce_hash, setters of attributes covered by the key must call
+	 * nl_object_invalidate_hash().
 	 */
-	void   (*oo_keygen)(struct nl_object *, uint32_t *, uint32_t);
+	uint32_t (*oo_keygen)(struct nl_object *);
 
 	char *(*oo_attrs2str)(int, char *, size_t);
 
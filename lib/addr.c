@@ -524,7 +524,7 @@ struct nl_addr *nl_addr_clone(const struct nl_addr *addr)
  */
 struct nl_addr *nl_addr_get(struct nl_addr *addr)
 {
-	addr->a_refcnt++;
+	_nl_refcnt_inc(&addr->a_refcnt);
 
 	return addr;
 }
@@ -543,10 +543,8 @@ void nl_addr_put(struct nl_addr *addr)
 	if (!addr)
 		return;
 
-	if (addr->a_refcnt == 1)
-		addr_destroy(addr);
-	else
-		addr->a_refcnt--;
+	if (_nl_refcnt_dec(&addr->a_refcnt) == 0)
+		free(addr);
 }
 
 /**
@@ -557,7 +555,7 @@ void nl_addr_put(struct nl_addr *addr)
  */
 int nl_addr_shared(const struct nl_addr *addr)
 {
-	return addr->a_refcnt > 1;
+	return _nl_refcnt_read(&addr->a_refcnt) > 1;
 }
 
 /** @} */
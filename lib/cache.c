@@ -193,6 +193,9 @@ struct nl_cache *nl_cache_alloc(struct nl_cache_ops *ops)
 	cache->c_ops = ops;
 	cache->c_flags |= ops->co_flags;
 	cache->c_refcnt = 1;
+#ifndef DISABLE_PTHREADS
+	pthread_rwlock_init(&cache->c_lock, NULL);
+#endif
 
 	/*
 	 * If object type provides a hash keygen
@@ -374,14 +377,33 @@ void nl_cache_clear(struct nl_cache *cache)
 		nl_cache_remove(obj);
 }
 
+/* The cache is about to change, the last snapshot no longer matches it */
+static void cache_snapshot_invalidate(struct nl_cache *cache)
+{
+	if (cache->c_snap) {
+		nl_cache_snapshot_put(cache->c_snap);
+		cache->c_snap = NULL;
+	}
+}
+
 static void __nl_cache_free(struct nl_cache *cache)
 {
 	nl_cache_clear(cache);
+	cache_snapshot_invalidate(cache);
+
+	if (cache->c_filter)
+		nl_object_put(cache->c_filter);
 
 	if (cache->hashtable)
 		nl_hash_table_free(cache->hashtable);
 
+	if (cache->c_index && cache->c_ops->co_index_free)
+		cache->c_ops->co_index_free(cache);
+
 	NL_DBG(2, "Freeing cache %p <%s>...\n", cache, nl_cache_name(cache));
+#ifndef DISABLE_PTHREADS
+	pthread_rwlock_destroy(&cache->c_lock);
+#endif
 	free(cache);
 }
 
@@ -391,10 +413,10 @@ static void __nl_cache_free(struct nl_cache *cache)
  */
 void nl_cache_get(struct nl_cache *cache)
 {
-	cache->c_refcnt++;
+	int refcnt = _nl_refcnt_inc(&cache->c_refcnt);
 
 	NL_DBG(3, "Incremented cache %p <%s> reference count to %d\n",
-	       cache, nl_cache_name(cache), cache->c_refcnt);
+	       cache, nl_cache_name(cache), refcnt);
 }
 
 /**
@@ -408,15 +430,17 @@ void nl_cache_get(struct nl_cache *cache)
  */
 void nl_cache_free(struct nl_cache *cache)
 {
+	int refcnt;
+
 	if (!cache)
 		return;
 
-	cache->c_refcnt--;
+	refcnt = _nl_refcnt_dec(&cache->c_refcnt);
 
 	NL_DBG(3, "Decremented cache %p <%s> reference count, %d remaining\n",
-	       cache, nl_cache_name(cache), cache->c_refcnt);
+	       cache, nl_cache_name(cache), refcnt);
 
-	if (cache->c_refcnt <= 0)
+	if (refcnt <= 0)
 		__nl_cache_free(cache);
 }
 
@@ -436,12 +460,17 @@ static int __cache_add(struct nl_cache *cache, struct nl_object *obj)
 {
 	int ret;
 
+	nl_cache_write_lock(cache);
+
+	cache_snapshot_invalidate(cache);
+
 	obj->ce_cache = cache;
 
 	if (cache->hashtable) {
 		ret = nl_hash_table_add(cache->hashtable, obj);
 		if (ret < 0) {
 			obj->ce_cache = NULL;
+			nl_cache_write_unlock(cache);
 			return ret;
 		}
 	}
@@ -449,6 +478,11 @@ static int __cache_add(struct nl_cache *cache, struct nl_object *obj)
 	nl_list_add_tail(&obj->ce_list, &cache->c_items);
 	cache->c_nitems++;
 
+	if (cache->c_ops->co_obj_added)
+		cache->c_ops->co_obj_added(cache, obj);
+
+	nl_cache_write_unlock(cache);
+
 	NL_DBG(3, "Added object %p to cache %p <%s>, nitems %d\n",
 	       obj, cache, nl_cache_name(cache), cache->c_nitems);
 
@@ -503,6 +537,113 @@ int nl_cache_add(struct nl_cache *cache, struct nl_object *obj)
 	return ret;
 }
 
+/*
+ * Replace cached object `old` with `new` at the same list position. Both
+ * are swapped within one write locked section so concurrent lookups find
+ * either of them and nothing needs to be allocated. The cache acquires a
+ * reference on `new` and drops its reference on `old`.
+ */
+static int __cache_replace(struct nl_cache *cache, struct nl_object *old,
+			   struct nl_object *new)
+{
+	struct nl_cache_ops *ops = cache->c_ops;
+	int err;
+
+	nl_cache_write_lock(cache);
+
+	if (cache->hashtable) {
+		err = _nl_hash_table_replace(cache->hashtable, old, new);
+		if (err < 0) {
+			nl_cache_write_unlock(cache);
+			return err;
+		}
+	}
+
+	cache_snapshot_invalidate(cache);
+
+	if (ops->co_obj_removed)
+		ops->co_obj_removed(cache, old);
+
+	nl_object_get(new);
+	new->ce_cache = cache;
+	nl_list_add_head(&new->ce_list, &old->ce_list);
+	nl_list_del(&old->ce_list);
+	old->ce_cache = NULL;
+
+	if (ops->co_obj_added)
+		ops->co_obj_added(cache, new);
+
+	nl_cache_write_unlock(cache);
+
+	nl_object_put(old);
+
+	NL_DBG(3, "Replaced object %p with %p in cache %p <%s>\n",
+	       old, new, cache, nl_cache_name(cache));
+
+	return 0;
+}
+
+/*
+ * Update cached object in place, keeping the lookup indexes in sync. An
+ * object which may be part of a snapshot or be in use by another thread
+ * must not change, it is copied and the copy replaces it in the cache.
+ * *objp then points to the copy, the reference held by the caller is
+ * moved along.
+ */
+static int __cache_update(struct nl_cache *cache, struct nl_object **objp,
+			  struct nl_object *new)
+{
+	struct nl_cache_ops *ops = cache->c_ops;
+	struct nl_object *old = *objp, *copy;
+	int err;
+
+	if (!old->ce_ops->oo_update)
+		return -NLE_OPNOTSUPP;
+
+	if ((old->ce_flags & NL_OBJ_SHARED) ||
+	    (cache->c_flags & NL_CACHE_THREAD_SAFE)) {
+		copy = nl_object_clone(old);
+		if (!copy)
+			return -NLE_NOMEM;
+
+		err = nl_object_update(copy, new);
+		if (err < 0) {
+			nl_object_put(copy);
+			return err;
+		}
+
+		/* The copy is part of the same resync generation, its message
+		 * hash stays clear as it no longer matches the message */
+		copy->ce_gen = old->ce_gen;
+
+		err = __cache_replace(cache, old, copy);
+		if (err < 0) {
+			nl_object_put(copy);
+			return err;
+		}
+
+		/* The reference of the clone moves to the caller */
+		nl_object_put(old);
+		*objp = copy;
+		return 0;
+	}
+
+	cache_snapshot_invalidate(cache);
+
+	if (ops->co_obj_removed)
+		ops->co_obj_removed(cache, old);
+
+	err = nl_object_update(old, new);
+
+	/* The object no longer matches the message it was parsed from */
+	old->ce_msg_hash = 0;
+
+	if (ops->co_obj_added)
+		ops->co_obj_added(cache, old);
+
+	return err;
+}
+
 /**
  * Move object from one cache to another
  * @arg cache		Cache to move object to.
@@ -557,6 +698,13 @@ void nl_cache_remove(struct nl_object *obj)
 	if (cache == NULL)
 		return;
 
+	nl_cache_write_lock(cache);
+
+	cache_snapshot_invalidate(cache);
+
+	if (cache->c_ops->co_obj_removed)
+		cache->c_ops->co_obj_removed(cache, obj);
+
 	if (cache->hashtable) {
 		ret = nl_hash_table_del(cache->hashtable, obj);
 		if (ret < 0)
@@ -566,15 +714,157 @@ void nl_cache_remove(struct nl_object *obj)
 
 	nl_list_del(&obj->ce_list);
 	obj->ce_cache = NULL;
-	nl_object_put(obj);
 	cache->c_nitems--;
 
+	nl_cache_write_unlock(cache);
+
+	nl_object_put(obj);
+
 	NL_DBG(2, "Deleted object %p from cache %p <%s>.\n",
 	       obj, cache, nl_cache_name(cache));
 }
 
 /** @} */
 
+/**
+ * @name Snapshots
+ * @{
+ */
+
+/** @cond SKIP */
+struct nl_cache_snapshot {
+	int			cs_refcnt;
+	struct nl_cache_ops *	cs_ops;
+	int			cs_nitems;
+	struct nl_object *	cs_items[];
+};
+/** @endcond */
+
+/**
+ * Take a point-in-time snapshot of a cache
+ * @arg cache		Cache
+ *
+ * Returns a read-only view of the objects currently in the cache. The
+ * objects are shared with the cache instead of being copied as done by
+ * nl_cache_clone(). Objects shared with a snapshot are never modified
+ * afterwards, an update merging a notification into such an object
+ * replaces it with an updated copy in the cache.
+ *
+ * As long as the cache does not change, the same snapshot is returned
+ * again at the cost of a reference, otherwise a new one is created
+ * holding a reference to each object.
+ *
+ * Taking a snapshot must be serialized with updates of the cache, e.g.
+ * by doing it in the thread running the cache manager, unless the cache
+ * has the flag \c NL_CACHE_THREAD_SAFE set. The snapshot can be handed
+ * to readers in other threads which iterate over it without locking
+ * while the cache keeps being updated, and released by any thread.
+ *
+ * @note The objects in a snapshot may have been removed from the cache
+ *       since, use nl_cache_snapshot_item() to iterate instead of
+ *       nl_cache_get_next().
+ *
+ * @see nl_cache_snapshot_put()
+ *
+ * @return Snapshot or NULL if the allocation failed.
+ */
+struct nl_cache_snapshot *nl_cache_snapshot(struct nl_cache *cache)
+{
+	struct nl_cache_snapshot *snap;
+	struct nl_object *obj;
+	int i = 0;
+
+	nl_cache_write_lock(cache);
+
+	if (!cache->c_snap) {
+		snap = malloc(sizeof(*snap) +
+			      cache->c_nitems * sizeof(snap->cs_items[0]));
+		if (!snap) {
+			nl_cache_write_unlock(cache);
+			return NULL;
+		}
+
+		/* The flag is not cleared once the snapshot is gone, such
+		 * objects are merely copied once more than necessary */
+		nl_list_for_each_entry(obj, &cache->c_items, ce_list) {
+			nl_object_get(obj);
+			obj->ce_flags |= NL_OBJ_SHARED;
+			snap->cs_items[i++] = obj;
+		}
+
+		snap->cs_refcnt = 1;
+		snap->cs_ops = cache->c_ops;
+		snap->cs_nitems = i;
+		cache->c_snap = snap;
+
+		NL_DBG(2, "Took snapshot %p of cache %p <%s>, %d objects\n",
+		       snap, cache, nl_cache_name(cache), i);
+	}
+
+	snap = cache->c_snap;
+	_nl_refcnt_inc(&snap->cs_refcnt);
+
+	nl_cache_write_unlock(cache);
+
+	return snap;
+}
+
+/**
+ * Release a cache snapshot
+ * @arg snap		Snapshot
+ *
+ * Drops a reference of the snapshot. The last reference releases the
+ * objects of the snapshot, freeing those which have been removed from
+ * the cache in the meantime.
+ */
+void nl_cache_snapshot_put(struct nl_cache_snapshot *snap)
+{
+	int i;
+
+	if (!snap)
+		return;
+
+	if (_nl_refcnt_dec(&snap->cs_refcnt) > 0)
+		return;
+
+	NL_DBG(2, "Freeing snapshot %p <%s>\n", snap, snap->cs_ops->co_name);
+
+	for (i = 0; i < snap->cs_nitems; i++)
+		nl_object_put(snap->cs_items[i]);
+
+	free(snap);
+}
+
+/**
+ * Return the number of objects in a cache snapshot
+ * @arg snap		Snapshot
+ */
+int nl_cache_snapshot_nitems(struct nl_cache_snapshot *snap)
+{
+	return snap->cs_nitems;
+}
+
+/**
+ * Return object of a cache snapshot
+ * @arg snap		Snapshot
+ * @arg idx		Index of object, starting at 0
+ *
+ * The object is owned by the snapshot and remains valid until the
+ * snapshot is released, no reference is acquired.
+ *
+ * @return Object or NULL if the index is out of range.
+ */
+struct nl_object *nl_cache_snapshot_item(struct nl_cache_snapshot *snap,
+					 int idx)
+{
+	if (idx < 0 || idx >= snap->cs_nitems)
+		return NULL;
+
+	return snap->cs_items[idx];
+}
+
+/** @} */
+
 /**
  * @name Synchronization
  * @{
@@ -610,12 +900,132 @@ void nl_cache_set_arg2(struct nl_cache *cache, int arg)
  * Set cache flags
  * @arg cache		Cache
  * @arg flags		Flags
+ *
+ * The flag \c NL_CACHE_THREAD_SAFE allows other threads to call
+ * nl_cache_search(), nl_cache_find(), nl_cache_snapshot() and the
+ * rtnl_*_get() lookup functions while a single thread updates the
+ * cache. Objects in such a cache are never modified in place, updates
+ * replace them with a modified copy. Set the flag before the cache is
+ * shared with other threads.
  */
 void nl_cache_set_flags(struct nl_cache *cache, unsigned int flags)
 {
 	cache->c_flags |= flags;
 }
 
+static int cache_set_filter(struct nl_cache *cache, struct nl_object *filter,
+			    int events)
+{
+	if (filter && filter->ce_ops != cache->c_ops->co_obj_ops)
+		return -NLE_OBJ_MISMATCH;
+
+	if (filter)
+		nl_object_get(filter);
+	if (cache->c_filter)
+		nl_object_put(cache->c_filter);
+	cache->c_filter = filter;
+	cache->c_filter_events = events;
+
+	return 0;
+}
+
+/**
+ * Restrict dumps of cache to objects matching a filter
+ * @arg cache		Cache
+ * @arg filter		Filter object or NULL to dump all objects
+ *
+ * Dumps requested to fill or resync the cache only return objects
+ * matching \c filter as defined by nl_object_match_filter(). The cache
+ * operations translate the filter into the dump request where the
+ * kernel supports filtering the dump, e.g. by table and output
+ * interface for routes. Strict checking is enabled on the socket while
+ * sending the request, see nl_socket_set_strict_check(). Attributes the
+ * kernel cannot filter on are matched while parsing the dump so the
+ * resulting cache is the same with kernels lacking support for
+ * filtered dumps.
+ *
+ * The cache keeps a reference to \c filter. Changing the filter
+ * afterwards changes the following dumps.
+ *
+ * @note Objects announced by notifications are not subject to the
+ *       filter, see nl_cache_set_filter(). The filter replaces a filter
+ *       set by nl_cache_set_filter().
+ *
+ * @return 0 on success or -NLE_OBJ_MISMATCH if \c filter is of a
+ *         different type than the objects of the cache.
+ */
+int nl_cache_set_dump_filter(struct nl_cache *cache, struct nl_object *filter)
+{
+	return cache_set_filter(cache, filter, 0);
+}
+
+/**
+ * Restrict cache to objects matching a filter
+ * @arg cache		Cache
+ * @arg filter		Filter object or NULL to allow all objects
+ *
+ * Like nl_cache_set_dump_filter() but the filter applies to the
+ * notifications handled by the cache manager as well. Notifications
+ * are matched against the filter before they are parsed into objects
+ * where the cache operations support it. A notification updating only
+ * some attributes is matched once merged with the cached object. An
+ * object no longer matching the filter is removed from the cache and
+ * reported as deleted.
+ *
+ * A daemon following a single VRF or bridge thus never holds the
+ * routes or neighbours of the other ones in memory.
+ *
+ * Objects already in the cache are not checked against a new filter
+ * before the cache is refilled or resynced.
+ *
+ * @return 0 on success or -NLE_OBJ_MISMATCH if \c filter is of a
+ *         different type than the objects of the cache.
+ */
+int nl_cache_set_filter(struct nl_cache *cache, struct nl_object *filter)
+{
+	return cache_set_filter(cache, filter, 1);
+}
+
+/**
+ * Restrict cache to objects accepted by a function
+ * @arg cache		Cache
+ * @arg func		Function returning non-zero for objects to keep or
+ *			NULL to allow all objects
+ * @arg arg		Argument passed to \c func
+ *
+ * Calls \c func for every object parsed from a dump or a notification
+ * handled by the cache manager, in addition to the filter object set by
+ * nl_cache_set_filter(). Objects rejected are not added to the cache,
+ * an object of the cache rejected by a notification is removed from
+ * the cache and reported as deleted.
+ */
+void nl_cache_set_filter_func(struct nl_cache *cache,
+			      nl_cache_filter_func_t func, void *arg)
+{
+	cache->c_filter_func = func;
+	cache->c_filter_arg = arg;
+}
+
+/**
+ * Prepare cache for a number of objects
+ * @arg cache		Cache
+ * @arg nobjs		Expected number of objects
+ *
+ * Grows the hash table used for lookups so that \c nobjs objects can be
+ * added without resizing it again. Useful before filling a cache known to
+ * hold a large number of objects, e.g. a full routing table.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nl_cache_presize(struct nl_cache *cache, unsigned int nobjs)
+{
+	if (!cache->hashtable)
+		return 0;
+
+	return nl_hash_table_presize(cache->hashtable,
+				     _NL_MIN(nobjs, (unsigned int) INT_MAX));
+}
+
 /**
  * Invoke the request-update operation
  * @arg sk		Netlink socket.
@@ -645,6 +1055,8 @@ void nl_cache_set_flags(struct nl_cache *cache, unsigned int flags)
 static int nl_cache_request_full_dump(struct nl_sock *sk,
 				      struct nl_cache *cache)
 {
+	int strict = 0, err;
+
 	if (sk->s_proto != cache->c_ops->co_protocol)
 		return -NLE_PROTO_MISMATCH;
 
@@ -654,13 +1066,111 @@ static int nl_cache_request_full_dump(struct nl_sock *sk,
 	NL_DBG(2, "Requesting update from kernel for cache %p <%s>\n",
 	          cache, nl_cache_name(cache));
 
-	return cache->c_ops->co_request_update(cache, sk);
+	/* Kernels without strict checking ignore the filter attributes of
+	 * the request, the dump filter is applied while parsing as well */
+	if (cache->c_filter && !(sk->s_flags & NL_SOCK_STRICT_CHK))
+		strict = nl_socket_set_strict_check(sk, 1) == 0;
+
+	err = cache->c_ops->co_request_update(cache, sk);
+
+	if (strict)
+		nl_socket_set_strict_check(sk, 0);
+
+	return err;
+}
+
+static inline int cache_dump_match(struct nl_cache *cache,
+				   struct nl_object *obj)
+{
+	if (cache->c_filter && !nl_object_match_filter(obj, cache->c_filter))
+		return 0;
+
+	return !cache->c_filter_func ||
+	       cache->c_filter_func(obj, cache->c_filter_arg);
 }
 
+/** @cond SKIP */
+int _nl_cache_msg_skip(struct nl_cache *cache, struct nlmsghdr *nlh,
+		       int event)
+{
+	struct nl_cache_ops *ops = cache->c_ops;
+	int i;
+
+	if (!cache->c_filter || !ops->co_msg_filter ||
+	    (event && !cache->c_filter_events))
+		return 0;
+
+	if (!nlmsg_valid_hdr(nlh, ops->co_hdrsize))
+		return 0;
+
+	for (i = 0; ops->co_msgtypes[i].mt_id >= 0; i++)
+		if (ops->co_msgtypes[i].mt_id == nlh->nlmsg_type)
+			return ops->co_msg_filter(cache, nlh) == NL_SKIP;
+
+	return 0;
+}
+
+static int cache_event_match(struct nl_cache *cache, struct nl_object *obj)
+{
+	if (cache->c_filter && cache->c_filter_events &&
+	    !nl_object_match_filter(obj, cache->c_filter))
+		return 0;
+
+	return !cache->c_filter_func ||
+	       cache->c_filter_func(obj, cache->c_filter_arg);
+}
+
+int _nl_cache_filter_event(const struct nl_cache_assoc *ca,
+			   struct nl_object *obj)
+{
+	struct nl_cache *cache = ca->ca_cache;
+	struct nl_object *old, *merged = NULL;
+	int match;
+
+	if ((!cache->c_filter || !cache->c_filter_events) &&
+	    !cache->c_filter_func)
+		return NL_OK;
+
+	old = nl_cache_search(cache, obj);
+
+	/* A partial notification is merged into the cached object, the
+	 * filter applies to the result. If the two cannot be merged, the
+	 * notification replaces the cached object. */
+	if (old && old->ce_ops->oo_update) {
+		merged = nl_object_clone(old);
+		if (merged && nl_object_update(merged, obj) < 0) {
+			nl_object_put(merged);
+			merged = NULL;
+		}
+	}
+
+	match = cache_event_match(cache, merged ? merged : obj);
+	nl_object_put(merged);
+
+	if (match || !old) {
+		nl_object_put(old);
+		return match ? NL_OK : NL_SKIP;
+	}
+
+	/* The object matched before the change */
+	nl_cache_remove(old);
+	if (ca->ca_change_v2)
+		ca->ca_change_v2(cache, old, NULL, 0, NL_ACT_DEL,
+				 ca->ca_change_data);
+	else if (ca->ca_change)
+		ca->ca_change(cache, old, NL_ACT_DEL, ca->ca_change_data);
+	nl_object_put(old);
+
+	return NL_SKIP;
+}
+/** @endcond */
+
 /** @cond SKIP */
 struct update_xdata {
+	struct nl_cache *cache;
 	struct nl_cache_ops *ops;
 	struct nl_parser_param *params;
+	uint32_t *msg_hash;
 };
 
 static int update_msg_parser(struct nl_msg *msg, void *arg)
@@ -668,6 +1178,14 @@ static int update_msg_parser(struct nl_msg *msg, void *arg)
 	struct update_xdata *x = arg;
 	int ret = 0;
 
+	if (_nl_cache_msg_skip(x->cache, msg->nm_nlh, 0))
+		return NL_SKIP;
+
+	if (x->msg_hash)
+		*x->msg_hash = nl_hash(nlmsg_data(msg->nm_nlh),
+				       nlmsg_datalen(msg->nm_nlh),
+				       msg->nm_nlh->nlmsg_type);
+
 	ret = nl_cache_parse(x->ops, &msg->nm_src, msg->nm_nlh, x->params);
 	if (ret == -NLE_EXIST)
 		return NL_SKIP;
@@ -681,15 +1199,19 @@ static int update_msg_parser(struct nl_msg *msg, void *arg)
  * @arg sk		Netlink socket
  * @arg cache		Cache
  * @arg param		Parser parameters
+ * @arg msg_hash	Where to store the payload hash of each message before
+ *			it is parsed or NULL
  */
 static int __cache_pickup(struct nl_sock *sk, struct nl_cache *cache,
-			  struct nl_parser_param *param)
+			  struct nl_parser_param *param, uint32_t *msg_hash)
 {
 	int err;
 	struct nl_cb *cb;
 	struct update_xdata x = {
+		.cache = cache,
 		.ops = cache->c_ops,
 		.params = param,
+		.msg_hash = msg_hash,
 	};
 
 	NL_DBG(2, "Picking up answer for cache %p <%s>\n",
@@ -716,9 +1238,12 @@ static int pickup_checkdup_cb(struct nl_object *c, struct nl_parser_param *p)
 	struct nl_cache *cache = (struct nl_cache *)p->pp_arg;
 	struct nl_object *old;
 
+	if (!cache_dump_match(cache, c))
+		return 0;
+
 	old = nl_cache_search(cache, c);
 	if (old) {
-		if (nl_object_update(old, c) == 0) {
+		if (__cache_update(cache, &old, c) == 0) {
 			nl_object_put(old);
 			return 0;
 		}
@@ -734,21 +1259,24 @@ static int pickup_cb(struct nl_object *c, struct nl_parser_param *p)
 {
 	struct nl_cache *cache = p->pp_arg;
 
+	if (!cache_dump_match(cache, c))
+		return 0;
+
 	return nl_cache_add(cache, c);
 }
 
 static int __nl_cache_pickup(struct nl_sock *sk, struct nl_cache *cache,
 			     int checkdup)
 {
-	struct nl_parser_param p;
-
-	p.pp_cb = checkdup ? pickup_checkdup_cb : pickup_cb;
-	p.pp_arg = cache;
+	struct nl_parser_param p = {
+		.pp_cb = checkdup ? pickup_checkdup_cb : pickup_cb,
+		.pp_arg = cache,
+	};
 
 	if (sk->s_proto != cache->c_ops->co_protocol)
 		return -NLE_PROTO_MISMATCH;
 
-	return __cache_pickup(sk, cache, &p);
+	return __cache_pickup(sk, cache, &p, NULL);
 }
 
 /**
@@ -791,6 +1319,10 @@ static int cache_include(struct nl_cache *cache, struct nl_object *obj,
 	struct nl_object *old;
 	struct nl_object *clone = NULL;
 	uint64_t diff = 0;
+	int replaced = 0;
+
+	/* Only a resync knows the message an object has been parsed from */
+	obj->ce_msg_hash = 0;
 
 	switch (type->mt_act) {
 	case NL_ACT_NEW:
@@ -798,7 +1330,8 @@ static int cache_include(struct nl_cache *cache, struct nl_object *obj,
 		old = nl_cache_search(cache, obj);
 		if (old) {
 			if (cb_v2 && old->ce_ops->oo_update) {
-				clone = nl_object_clone(old);
+				if (!(cache->c_flags & NL_CACHE_NO_CHANGE_CLONE))
+					clone = nl_object_clone(old);
 				diff = nl_object_diff64(old, obj);
 			}
 			/*
@@ -806,7 +1339,7 @@ static int cache_include(struct nl_cache *cache, struct nl_object *obj,
 			 * object with the old existing cache object.
 			 * Handle them first.
 			 */
-			if (nl_object_update(old, obj) == 0) {
+			if (__cache_update(cache, &old, obj) == 0) {
 				if (cb_v2) {
 					cb_v2(cache, clone, old, diff,
 					      NL_ACT_CHANGE, data);
@@ -818,7 +1351,14 @@ static int cache_include(struct nl_cache *cache, struct nl_object *obj,
 			}
 			nl_object_put(clone);
 
-			nl_cache_remove(old);
+			/* Concurrent lookups find either the old or the new
+			 * object, never none of them */
+			if (type->mt_act == NL_ACT_NEW && !obj->ce_cache &&
+			    __cache_replace(cache, old, obj) == 0)
+				replaced = 1;
+			else
+				nl_cache_remove(old);
+
 			if (type->mt_act == NL_ACT_DEL) {
 				if (cb_v2)
 					cb_v2(cache, old, NULL, 0, NL_ACT_DEL,
@@ -830,7 +1370,8 @@ static int cache_include(struct nl_cache *cache, struct nl_object *obj,
 		}
 
 		if (type->mt_act == NL_ACT_NEW) {
-			nl_cache_move(cache, obj);
+			if (!replaced)
+				nl_cache_move(cache, obj);
 			if (old == NULL) {
 				if (cb_v2) {
 					cb_v2(cache, NULL, obj, 0, NL_ACT_NEW,
@@ -899,31 +1440,81 @@ int nl_cache_include_v2(struct nl_cache *cache, struct nl_object *obj,
 	return -NLE_MSGTYPE_NOSUPPORT;
 }
 
+/** @cond SKIP */
+struct resync_ctx {
+	struct nl_cache_assoc	rc_assoc;
+	uint32_t		rc_gen;
+	uint32_t		rc_msg_hash;
+};
+/** @endcond */
+
 static int resync_cb(struct nl_object *c, struct nl_parser_param *p)
 {
-	struct nl_cache_assoc *ca = p->pp_arg;
+	struct resync_ctx *rc = p->pp_arg;
+	struct nl_cache_assoc *ca = &rc->rc_assoc;
+	struct nl_object *old;
+	int err;
+
+	/* Unstamped, a cached object no longer matching is removed */
+	if (!cache_dump_match(ca->ca_cache, c))
+		return 0;
+
+	c->ce_gen = rc->rc_gen;
+
+	old = nl_cache_search(ca->ca_cache, c);
+	if (old) {
+		old->ce_gen = rc->rc_gen;
+
+		/* Same message as last time, keep the cached object. The
+		 * hash may collide, it only saves comparing changed objects */
+		if (old->ce_msg_hash == rc->rc_msg_hash &&
+		    !nl_object_diff64(old, c)) {
+			nl_object_put(old);
+			return 0;
+		}
+
+		nl_object_put(old);
+	}
 
 	if (ca->ca_change_v2)
-		return nl_cache_include_v2(ca->ca_cache, c, ca->ca_change_v2,
-					   ca->ca_change_data);
+		err = nl_cache_include_v2(ca->ca_cache, c, ca->ca_change_v2,
+					  ca->ca_change_data);
 	else
-		return nl_cache_include(ca->ca_cache, c, ca->ca_change,
-					ca->ca_change_data);
+		err = nl_cache_include(ca->ca_cache, c, ca->ca_change,
+				       ca->ca_change_data);
+
+	if (err < 0)
+		return err;
+
+	/* Only an object matching the message may carry its hash */
+	if (c->ce_cache == ca->ca_cache)
+		c->ce_msg_hash = rc->rc_msg_hash;
+	else if ((old = nl_cache_search(ca->ca_cache, c))) {
+		/* Merged into the cached object */
+		if (!nl_object_diff64(old, c))
+			old->ce_msg_hash = rc->rc_msg_hash;
+		nl_object_put(old);
+	}
+
+	return 0;
 }
 
-int nl_cache_resync(struct nl_sock *sk, struct nl_cache *cache,
-		    change_func_t change_cb, void *data)
+/** @cond SKIP */
+/*
+ * Resync the cache of @ca, reporting changes to the callback of the
+ * association. Used by nl_cache_resync() and the cache manager.
+ */
+int _nl_cache_resync_assoc(struct nl_sock *sk, const struct nl_cache_assoc *ca)
 {
+	struct nl_cache *cache = ca->ca_cache;
 	struct nl_object *obj, *next;
 	struct nl_af_group *grp;
-	struct nl_cache_assoc ca = {
-		.ca_cache = cache,
-		.ca_change = change_cb,
-		.ca_change_data = data,
+	struct resync_ctx rc = {
+		.rc_assoc = *ca,
 	};
 	struct nl_parser_param p = {
 		.pp_cb = resync_cb,
-		.pp_arg = &ca,
+		.pp_arg = &rc,
 	};
 	int err;
 
@@ -932,8 +1523,11 @@ int nl_cache_resync(struct nl_sock *sk, struct nl_cache *cache,
 
 	NL_DBG(1, "Resyncing cache %p <%s>...\n", cache, nl_cache_name(cache));
 
-	/* Mark all objects so we can see if some of them are obsolete */
-	nl_cache_mark_all(cache);
+	/* Objects not stamped with the new generation are obsolete, 0 is
+	 * the generation of objects which have never been resynced */
+	if (++cache->c_gen == 0)
+		cache->c_gen = 1;
+	rc.rc_gen = cache->c_gen;
 
 	grp = cache->c_ops->co_groups;
 	do {
@@ -946,7 +1540,7 @@ restart:
 		if (err < 0)
 			goto errout;
 
-		err = __cache_pickup(sk, cache, &p);
+		err = __cache_pickup(sk, cache, &p, &rc.rc_msg_hash);
 		if (err == -NLE_DUMP_INTR)
 			goto restart;
 		else if (err < 0)
@@ -958,11 +1552,15 @@ restart:
 		(cache->c_flags & NL_CACHE_AF_ITER));
 
 	nl_list_for_each_entry_safe(obj, next, &cache->c_items, ce_list) {
-		if (nl_object_is_marked(obj)) {
+		if (obj->ce_gen != rc.rc_gen) {
 			nl_object_get(obj);
 			nl_cache_remove(obj);
-			if (change_cb)
-				change_cb(cache, obj, NL_ACT_DEL, data);
+			if (ca->ca_change_v2)
+				ca->ca_change_v2(cache, obj, NULL, 0,
+						 NL_ACT_DEL, ca->ca_change_data);
+			else if (ca->ca_change)
+				ca->ca_change(cache, obj, NL_ACT_DEL,
+					      ca->ca_change_data);
 			nl_object_put(obj);
 		}
 	}
@@ -973,6 +1571,19 @@ restart:
 errout:
 	return err;
 }
+/** @endcond */
+
+int nl_cache_resync(struct nl_sock *sk, struct nl_cache *cache,
+		    change_func_t change_cb, void *data)
+{
+	struct nl_cache_assoc ca = {
+		.ca_cache = cache,
+		.ca_change = change_cb,
+		.ca_change_data = data,
+	};
+
+	return _nl_cache_resync_assoc(sk, &ca);
+}
 
 /** @} */
 
@@ -1025,6 +1636,9 @@ int nl_cache_parse_and_add(struct nl_cache *cache, struct nl_msg *msg)
 		.pp_arg = cache,
 	};
 
+	if (_nl_cache_msg_skip(cache, nlmsg_hdr(msg), 0))
+		return 0;
+
 	return nl_cache_parse(cache->c_ops, NULL, nlmsg_hdr(msg), &p);
 }
 
@@ -1076,6 +1690,508 @@ restart:
 	return err;
 }
 
+/** @cond SKIP */
+struct refill_chunk {
+	void *			rc_buf;
+	int			rc_len;
+	struct sockaddr_nl	rc_nla;
+};
+
+/* One dump request, i.e. one cache and one address family */
+struct refill_stream {
+	struct nl_cache *	rs_cache;
+	int			rs_family;	/* -1 to keep the cache arg1 */
+	struct refill_chunk *	rs_chunks;
+	int			rs_nchunks;
+	int			rs_alloc;
+	int			rs_done;
+	int			rs_nacked;	/* error reported by the kernel */
+	int			rs_err;
+};
+
+struct refill_ctx {
+	struct refill_stream *	rc_streams;
+	int			rc_nstreams;
+	int			rc_next;
+#ifndef DISABLE_PTHREADS
+	pthread_mutex_t		rc_lock;
+#endif
+};
+
+struct refill_worker {
+	struct refill_ctx *	rw_ctx;
+	struct nl_sock *	rw_sk;
+#ifndef DISABLE_PTHREADS
+	pthread_t		rw_thread;
+	int			rw_running;
+#endif
+};
+
+static void refill_stream_reset(struct refill_stream *rs)
+{
+	int i;
+
+	for (i = 0; i < rs->rs_nchunks; i++)
+		free(rs->rs_chunks[i].rc_buf);
+	rs->rs_nchunks = 0;
+}
+
+static int refill_stream_add(struct refill_stream *rs, void *buf, int len,
+			     struct sockaddr_nl *nla)
+{
+	void *shrunk;
+
+	/* Receive buffers are sized for the largest possible message */
+	if (len > 0 && (shrunk = realloc(buf, len)))
+		buf = shrunk;
+
+	if (rs->rs_nchunks == rs->rs_alloc) {
+		int alloc = rs->rs_alloc ? rs->rs_alloc * 2 : 16;
+		struct refill_chunk *chunks;
+
+		chunks = realloc(rs->rs_chunks, alloc * sizeof(*chunks));
+		if (!chunks) {
+			free(buf);
+			return -NLE_NOMEM;
+		}
+
+		rs->rs_chunks = chunks;
+		rs->rs_alloc = alloc;
+	}
+
+	rs->rs_chunks[rs->rs_nchunks].rc_buf = buf;
+	rs->rs_chunks[rs->rs_nchunks].rc_len = len;
+	rs->rs_chunks[rs->rs_nchunks].rc_nla = *nla;
+	rs->rs_nchunks++;
+
+	return 0;
+}
+
+/*
+ * Request the dump of a stream and collect the raw replies. Only the
+ * kernel side of the dump runs in parallel, the replies are parsed into
+ * the cache by the calling thread once all dumps have completed.
+ */
+static int refill_stream_recv(struct refill_ctx *ctx, struct refill_stream *rs,
+			      struct nl_sock *sk)
+{
+	struct sockaddr_nl nla;
+	struct nlmsghdr *hdr;
+	unsigned char *buf;
+	int n, err, done, interrupted;
+
+restart:
+	refill_stream_reset(rs);
+
+	/* The request is built from the arguments of the cache which
+	 * are shared by all streams of the cache */
+	nl_lock(&ctx->rc_lock);
+	if (rs->rs_family >= 0)
+		nl_cache_set_arg1(rs->rs_cache, rs->rs_family);
+	err = nl_cache_request_full_dump(sk, rs->rs_cache);
+	nl_unlock(&ctx->rc_lock);
+	if (err < 0)
+		return err;
+
+	NL_DBG(2, "Refilling cache %p <%s> for family %d on socket %p\n",
+	       rs->rs_cache, nl_cache_name(rs->rs_cache), rs->rs_family, sk);
+
+	done = interrupted = 0;
+	while (!done) {
+		n = nl_recv(sk, &nla, &buf, NULL);
+		if (n <= 0)
+			return n < 0 ? n : -NLE_AGAIN;
+
+		for (hdr = (struct nlmsghdr *) buf; nlmsg_ok(hdr, n);
+		     hdr = nlmsg_next(hdr, &n)) {
+			if (!(sk->s_flags & NL_NO_AUTO_ACK) &&
+			    hdr->nlmsg_seq != sk->s_seq_expect) {
+				err = -NLE_SEQ_MISMATCH;
+				goto errout;
+			}
+
+			if (hdr->nlmsg_flags & NLM_F_DUMP_INTR)
+				interrupted = 1;
+
+			/* The socket stays usable for the next dump after
+			 * an error reported by the kernel */
+			if (hdr->nlmsg_type == NLMSG_DONE ||
+			    hdr->nlmsg_type == NLMSG_ERROR)
+				sk->s_seq_expect++;
+
+			if (hdr->nlmsg_type == NLMSG_DONE) {
+				done = 1;
+			} else if (hdr->nlmsg_type == NLMSG_OVERRUN) {
+				err = -NLE_MSG_OVERFLOW;
+				goto errout;
+			} else if (hdr->nlmsg_type == NLMSG_ERROR) {
+				struct nlmsgerr *e = nlmsg_data(hdr);
+
+				if (hdr->nlmsg_len < (unsigned) nlmsg_size(sizeof(*e))) {
+					err = -NLE_MSG_TRUNC;
+					goto errout;
+				} else if (e->error) {
+					rs->rs_nacked = 1;
+					err = -nl_syserr2nlerr(e->error);
+					goto errout;
+				}
+				done = 1;
+			}
+		}
+
+		/* Takes ownership of the buffer */
+		err = refill_stream_add(rs, buf, (unsigned char *) hdr - buf, &nla);
+		if (err < 0)
+			return err;
+	}
+
+	if (interrupted) {
+		NL_DBG(2, "Dump interrupted, restarting!\n");
+		goto restart;
+	}
+
+	return 0;
+
+errout:
+	free(buf);
+	return err;
+}
+
+static void *refill_worker_run(void *arg)
+{
+	struct refill_worker *rw = arg;
+	struct refill_ctx *ctx = rw->rw_ctx;
+	struct refill_stream *rs;
+
+	for (;;) {
+		nl_lock(&ctx->rc_lock);
+		if (ctx->rc_next >= ctx->rc_nstreams)
+			rs = NULL;
+		else
+			rs = &ctx->rc_streams[ctx->rc_next++];
+		nl_unlock(&ctx->rc_lock);
+
+		if (!rs)
+			break;
+
+		rs->rs_err = refill_stream_recv(ctx, rs, rw->rw_sk);
+		rs->rs_done = 1;
+
+		/* Other than an error reply of the kernel, a failure may
+		 * leave replies behind on the socket, the other sockets
+		 * take over the remaining dumps */
+		if (rs->rs_err < 0 && !rs->rs_nacked)
+			break;
+	}
+
+	return NULL;
+}
+
+static int refill_stream_parse(struct refill_stream *rs)
+{
+	struct nl_cache *cache = rs->rs_cache;
+	struct nl_parser_param p = {
+		.pp_cb = pickup_cb,
+		.pp_arg = cache,
+	};
+	struct nlmsghdr *hdr;
+	int i, n, err;
+
+	for (i = 0; i < rs->rs_nchunks; i++) {
+		n = rs->rs_chunks[i].rc_len;
+
+		for (hdr = rs->rs_chunks[i].rc_buf; nlmsg_ok(hdr, n);
+		     hdr = nlmsg_next(hdr, &n)) {
+			if (hdr->nlmsg_type < NLMSG_MIN_TYPE ||
+			    _nl_cache_msg_skip(cache, hdr, 0))
+				continue;
+
+			err = nl_cache_parse(cache->c_ops,
+					     &rs->rs_chunks[i].rc_nla, hdr, &p);
+			if (err < 0 && err != -NLE_EXIST)
+				return err;
+		}
+	}
+
+	return 0;
+}
+/** @endcond */
+
+/**
+ * (Re)fill several caches concurrently
+ * @arg sks		Array of netlink sockets
+ * @arg nsks		Number of netlink sockets
+ * @arg caches		Array of caches to update
+ * @arg ncaches		Number of caches
+ *
+ * Clears the specified caches and fills them with the current state in the
+ * kernel, like calling nl_cache_refill() for each of them. A dump request
+ * is issued for every cache and, for caches with the flag
+ * \c NL_CACHE_AF_ITER, for every address family. Up to \c nsks of these
+ * dumps are run concurrently, each on its own socket and thread. Dumps
+ * interrupted by a concurrent change (\c NLM_F_DUMP_INTR) are restarted
+ * individually.
+ *
+ * The replies are parsed and added to the caches by the calling thread in
+ * the same order nl_cache_refill() would. The callbacks of the sockets are
+ * not invoked.
+ *
+ * All sockets must be connected to the netlink protocol of all caches and
+ * must not be used by anyone else for the duration of the call.
+ *
+ * If a dump fails, the remaining dumps are still run. Caches with a failed
+ * dump are left empty, all other caches are filled. The error of the first
+ * such cache is returned. A socket which failed for a reason other than an
+ * error reported by the kernel is not used for further dumps.
+ *
+ * @note The replies of all dumps are buffered until the last dump has
+ *       completed.
+ *
+ * @see nl_cache_refill()
+ *
+ * @return 0 on success or a negative error code.
+ * @retval -NLE_PROTO_MISMATCH A socket is connected to the wrong protocol.
+ * @retval -NLE_AGAIN A dump could not be run because all sockets failed.
+ */
+int nl_cache_refill_parallel(struct nl_sock **sks, int nsks,
+			     struct nl_cache **caches, int ncaches)
+{
+	_nl_auto_free struct refill_stream *streams = NULL;
+	_nl_auto_free struct refill_worker *workers = NULL;
+	struct refill_ctx ctx = {
+		.rc_next = 0,
+	};
+	struct nl_af_group *grp;
+	int i, k, nstreams = 0, err = 0;
+
+	if (nsks <= 0 || ncaches < 0)
+		return -NLE_INVAL;
+
+	for (i = 0; i < ncaches; i++) {
+		for (k = 0; k < nsks; k++)
+			if (sks[k]->s_proto != caches[i]->c_ops->co_protocol)
+				return -NLE_PROTO_MISMATCH;
+
+		grp = caches[i]->c_ops->co_groups;
+		if (grp && (caches[i]->c_flags & NL_CACHE_AF_ITER))
+			for (; grp->ag_group; grp++)
+				nstreams++;
+		else
+			nstreams++;
+	}
+
+	if (nstreams == 0)
+		return 0;
+
+	streams = calloc(nstreams, sizeof(*streams));
+	workers = calloc(nsks, sizeof(*workers));
+	if (!streams || !workers)
+		return -NLE_NOMEM;
+
+	for (i = 0, nstreams = 0; i < ncaches; i++) {
+		nl_cache_clear(caches[i]);
+
+		grp = caches[i]->c_ops->co_groups;
+		if (grp && (caches[i]->c_flags & NL_CACHE_AF_ITER)) {
+			for (; grp->ag_group; grp++) {
+				streams[nstreams].rs_cache = caches[i];
+				streams[nstreams++].rs_family = grp->ag_family;
+			}
+		} else {
+			streams[nstreams].rs_cache = caches[i];
+			streams[nstreams++].rs_family = -1;
+		}
+	}
+
+	ctx.rc_streams = streams;
+	ctx.rc_nstreams = nstreams;
+
+	if (nsks > nstreams)
+		nsks = nstreams;
+
+	for (k = 0; k < nsks; k++) {
+		workers[k].rw_ctx = &ctx;
+		workers[k].rw_sk = sks[k];
+	}
+
+#ifndef DISABLE_PTHREADS
+	pthread_mutex_init(&ctx.rc_lock, NULL);
+
+	/* The calling thread works on the first socket */
+	for (k = 1; k < nsks; k++) {
+		if (pthread_create(&workers[k].rw_thread, NULL,
+				   refill_worker_run, &workers[k]) == 0)
+			workers[k].rw_running = 1;
+		else
+			NL_DBG(1, "Unable to start refill thread, continuing with fewer sockets\n");
+	}
+
+	refill_worker_run(&workers[0]);
+
+	for (k = 1; k < nsks; k++)
+		if (workers[k].rw_running)
+			pthread_join(workers[k].rw_thread, NULL);
+
+	pthread_mutex_destroy(&ctx.rc_lock);
+#else
+	refill_worker_run(&workers[0]);
+#endif
+
+	/* Dumps left over when all sockets failed */
+	for (i = 0; i < nstreams; i++) {
+		if (!streams[i].rs_done)
+			streams[i].rs_err = -NLE_AGAIN;
+	}
+
+	/* A cache is filled only if all of its dumps succeeded, the streams
+	 * of a cache are adjacent */
+	for (i = 0; i < nstreams; i = k) {
+		struct nl_cache *cache = streams[i].rs_cache;
+		int cache_err = 0;
+
+		for (k = i; k < nstreams && streams[k].rs_cache == cache; k++) {
+			if (!cache_err)
+				cache_err = streams[k].rs_err;
+		}
+
+		for (k = i; k < nstreams && streams[k].rs_cache == cache; k++) {
+			if (!cache_err)
+				cache_err = refill_stream_parse(&streams[k]);
+			refill_stream_reset(&streams[k]);
+			free(streams[k].rs_chunks);
+		}
+
+		if (cache_err < 0) {
+			nl_cache_clear(cache);
+			if (!err)
+				err = cache_err;
+		}
+	}
+
+	return err;
+}
+
+/** @cond SKIP */
+struct stream_ctx {
+	struct nl_cache *	sc_cache;
+	nl_cache_stream_func_t	sc_func;
+	void *			sc_arg;
+	int			sc_stop;
+};
+
+static int stream_cb(struct nl_object *obj, struct nl_parser_param *p)
+{
+	struct stream_ctx *sc = p->pp_arg;
+	int ret;
+
+	if (!cache_dump_match(sc->sc_cache, obj))
+		return 0;
+
+	ret = sc->sc_func(obj, sc->sc_arg);
+	if (ret < 0 || ret == NL_STOP)
+		sc->sc_stop = ret;
+
+	return 0;
+}
+
+static int stream_msg_parser(struct nl_msg *msg, void *arg)
+{
+	struct stream_ctx *sc = arg;
+	struct nl_parser_param p = {
+		.pp_cb = stream_cb,
+		.pp_arg = sc,
+	};
+
+	/* The rest of a stopped dump is read from the socket but not parsed */
+	if (sc->sc_stop || _nl_cache_msg_skip(sc->sc_cache, msg->nm_nlh, 0))
+		return NL_SKIP;
+
+	return nl_cache_parse(sc->sc_cache->c_ops, &msg->nm_src, msg->nm_nlh,
+			      &p);
+}
+/** @endcond */
+
+/**
+ * Stream the contents in the kernel to a callback
+ * @arg sk		Netlink socket.
+ * @arg cache		Cache specifying the dump
+ * @arg func		Function called for each object
+ * @arg arg		Argument passed to \c func
+ *
+ * Requests the same dump as nl_cache_refill() but hands each object to
+ * \c func as soon as it has been parsed instead of adding it to \c cache.
+ * The object is released once \c func returns unless \c func takes a
+ * reference to it. Memory usage is thus bounded by the size of a single
+ * receive buffer no matter how many objects are dumped, the kernel
+ * continues the dump only as fast as \c func consumes the objects.
+ *
+ * The cache is only used for its type, arguments and filters, e.g. one
+ * allocated by nl_cache_alloc() or an allocation function of the object
+ * type called without a socket. Its contents are left untouched.
+ *
+ * \c func returns NL_OK to continue, NL_STOP to end the dump early or a
+ * negative error code to abort it. The remaining messages of a dump
+ * ended early are read from the socket without being parsed.
+ *
+ * Unlike nl_cache_refill(), a dump interrupted by concurrent changes in
+ * the kernel is not restarted as the objects have been handed out
+ * already. Such dumps complete with -NLE_DUMP_INTR, the objects may not
+ * be consistent with each other.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nl_cache_stream(struct nl_sock *sk, struct nl_cache *cache,
+		    nl_cache_stream_func_t func, void *arg)
+{
+	struct stream_ctx sc = {
+		.sc_cache = cache,
+		.sc_func = func,
+		.sc_arg = arg,
+	};
+	struct nl_af_group *grp;
+	struct nl_cb *cb;
+	int err;
+
+	if (sk->s_proto != cache->c_ops->co_protocol)
+		return -NLE_PROTO_MISMATCH;
+
+	cb = nl_cb_clone(sk->s_cb);
+	if (cb == NULL)
+		return -NLE_NOMEM;
+
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, stream_msg_parser, &sc);
+
+	grp = cache->c_ops->co_groups;
+	do {
+		if (grp && grp->ag_group &&
+			(cache->c_flags & NL_CACHE_AF_ITER))
+			nl_cache_set_arg1(cache, grp->ag_family);
+
+		err = nl_cache_request_full_dump(sk, cache);
+		if (err < 0)
+			break;
+
+		NL_DBG(2, "Streaming dump of cache %p <%s> for family %u\n",
+		       cache, nl_cache_name(cache),
+		       grp ? grp->ag_family : AF_UNSPEC);
+
+		err = nl_recvmsgs(sk, cb);
+		if (err < 0 || sc.sc_stop)
+			break;
+
+		if (grp)
+			grp++;
+	} while (grp && grp->ag_group &&
+			(cache->c_flags & NL_CACHE_AF_ITER));
+
+	nl_cb_put(cb);
+
+	if (err >= 0 && sc.sc_stop < 0)
+		err = sc.sc_stop;
+
+	return err < 0 ? err : 0;
+}
+
 /** @} */
 
 /**
@@ -1088,12 +2204,10 @@ static struct nl_object *__cache_fast_lookup(struct nl_cache *cache,
 	struct nl_object *obj;
 
 	obj = nl_hash_table_lookup(cache->hashtable, needle);
-	if (obj) {
+	if (obj)
 		nl_object_get(obj);
-		return obj;
-	}
 
-	return NULL;
+	return obj;
 }
 
 /**
@@ -1116,17 +2230,25 @@ struct nl_object *nl_cache_search(struct nl_cache *cache,
 {
 	struct nl_object *obj;
 
-	if (cache->hashtable)
-		return __cache_fast_lookup(cache, needle);
+	nl_cache_read_lock(cache);
+
+	if (cache->hashtable) {
+		obj = __cache_fast_lookup(cache, needle);
+		goto out;
+	}
 
 	nl_list_for_each_entry(obj, &cache->c_items, ce_list) {
 		if (nl_object_identical(obj, needle)) {
 			nl_object_get(obj);
-			return obj;
+			goto out;
 		}
 	}
 
-	return NULL;
+	obj = NULL;
+out:
+	nl_cache_read_unlock(cache);
+
+	return obj;
 }
 
 /**
@@ -1154,18 +2276,26 @@ struct nl_object *nl_cache_find(struct nl_cache *cache,
 	if (cache->c_ops == NULL)
 		BUG();
 
+	nl_cache_read_lock(cache);
+
 	if ((nl_object_get_id_attrs(filter) == filter->ce_mask)
-		&& cache->hashtable)
-		return __cache_fast_lookup(cache, filter);
+		&& cache->hashtable) {
+		obj = __cache_fast_lookup(cache, filter);
+		goto out;
+	}
 
 	nl_list_for_each_entry(obj, &cache->c_items, ce_list) {
 		if (nl_object_match_filter(obj, filter)) {
 			nl_object_get(obj);
-			return obj;
+			goto out;
 		}
 	}
 
-	return NULL;
+	obj = NULL;
+out:
+	nl_cache_read_unlock(cache);
+
+	return obj;
 }
 
 /**
@@ -14,6 +14,16 @@
  *
  * @note This functionality is still considered experimental.
  *
+ * The thread calling nl_cache_mngr_poll() or nl_cache_mngr_data_ready()
+ * is the only writer of the managed caches. Other threads may look up
+ * objects concurrently with nl_cache_search(), nl_cache_find() and the
+ * rtnl_*_get() functions if the caches have the flag
+ * \c NL_CACHE_THREAD_SAFE set, see nl_cache_set_flags(). Objects returned
+ * by these functions are referenced and must be treated as read-only,
+ * the manager replaces changed objects instead of modifying them. To
+ * iterate over a cache from another thread, take a snapshot with
+ * nl_cache_snapshot().
+ *
  * Related sections in the development guide:
  * - @core_doc{_cache_manager,Cache Manager}
  *
@@ -31,6 +41,7 @@
 #include <netlink/netlink.h>
 #include <netlink/cache.h>
 #include <netlink/utils.h>
+#include <netlink/hashtable.h>
 
 #include "nl-core.h"
 #include "nl-priv-dynamic-core/nl-core.h"
@@ -39,6 +50,12 @@
 
 #define NL_ALLOCATED_SYNC_SOCK 4
 
+/* Recoveries attempted by a single nl_cache_mngr_data_ready() call */
+#define MNGR_MAX_RESYNC		3
+
+/* Datagrams discarded at most before resyncing after an overrun */
+#define MNGR_MAX_DRAIN		4096
+
 /** @cond SKIP */
 struct nl_cache_mngr
 {
@@ -48,12 +65,108 @@ struct nl_cache_mngr
 	struct nl_sock *	cm_sock;
 	struct nl_sock *	cm_sync_sock;
 	struct nl_cache_assoc *	cm_assocs;
+	struct mngr_type_slot *	cm_types;
+	int			cm_ntypes;
+	uint64_t		cm_overruns;
+};
+
+/*
+ * Maps each message type handled by the manager to the index of the
+ * association it is routed to, see mngr_reindex().
+ */
+struct mngr_type_slot {
+	int			ts_type;
+	int			ts_assoc;
 };
 
 #define NASSOC_INIT		16
 #define NASSOC_EXPAND		8
 /** @endcond */
 
+static unsigned int mngr_type_hash(int type)
+{
+	uint32_t key = type;
+
+	return nl_hash(&key, sizeof(key), 0);
+}
+
+/*
+ * Rebuild the message type table after a cache has been added. Generic
+ * netlink message types are assigned at runtime and may still change, a
+ * manager for NETLINK_GENERIC therefore always walks the associations.
+ */
+static void mngr_reindex(struct nl_cache_mngr *mngr)
+{
+	struct mngr_type_slot *types = NULL;
+	struct nl_cache_ops *ops;
+	int i, n, slot, ntypes = 0, size = 16;
+
+	if (mngr->cm_protocol == NETLINK_GENERIC)
+		goto out;
+
+	for (i = 0; i < mngr->cm_nassocs; i++) {
+		if (!mngr->cm_assocs[i].ca_cache)
+			continue;
+
+		ops = mngr->cm_assocs[i].ca_cache->c_ops;
+		for (n = 0; ops->co_msgtypes[n].mt_id >= 0; n++)
+			ntypes++;
+	}
+
+	while (size < ntypes * 2)
+		size *= 2;
+
+	types = malloc(size * sizeof(*types));
+	if (!types) {
+		NL_DBG(1, "Cache manager %p: unable to index message types\n",
+		       mngr);
+		goto out;
+	}
+
+	for (slot = 0; slot < size; slot++)
+		types[slot].ts_assoc = -1;
+
+	for (i = 0; i < mngr->cm_nassocs; i++) {
+		if (!mngr->cm_assocs[i].ca_cache)
+			continue;
+
+		ops = mngr->cm_assocs[i].ca_cache->c_ops;
+		for (n = 0; ops->co_msgtypes[n].mt_id >= 0; n++) {
+			int type = ops->co_msgtypes[n].mt_id;
+
+			/* The first association takes precedence */
+			for (slot = mngr_type_hash(type) & (size - 1);
+			     types[slot].ts_assoc >= 0;
+			     slot = (slot + 1) & (size - 1))
+				if (types[slot].ts_type == type)
+					break;
+
+			if (types[slot].ts_assoc < 0) {
+				types[slot].ts_type = type;
+				types[slot].ts_assoc = i;
+			}
+		}
+	}
+
+out:
+	free(mngr->cm_types);
+	mngr->cm_types = types;
+	mngr->cm_ntypes = types ? size : 0;
+}
+
+static int mngr_lookup_type(struct nl_cache_mngr *mngr, int type)
+{
+	int slot;
+
+	for (slot = mngr_type_hash(type) & (mngr->cm_ntypes - 1);
+	     mngr->cm_types[slot].ts_assoc >= 0;
+	     slot = (slot + 1) & (mngr->cm_ntypes - 1))
+		if (mngr->cm_types[slot].ts_type == type)
+			return mngr->cm_types[slot].ts_assoc;
+
+	return -1;
+}
+
 static int include_cb(struct nl_object *obj, struct nl_parser_param *p)
 {
 	struct nl_cache_assoc *ca = p->pp_arg;
@@ -68,6 +181,9 @@ static int include_cb(struct nl_object *obj, struct nl_parser_param *p)
 		if (ops->co_event_filter(ca->ca_cache, obj) != NL_OK)
 			return 0;
 
+	if (_nl_cache_filter_event(ca, obj) != NL_OK)
+		return 0;
+
 	if (ops->co_include_event)
 		return ops->co_include_event(ca->ca_cache, obj, ca->ca_change,
 					     ca->ca_change_v2,
@@ -101,6 +217,15 @@ static int event_input(struct nl_msg *msg, void *arg)
 	if (mngr->cm_protocol != protocol)
 		BUG();
 
+	if (mngr->cm_types) {
+		i = mngr_lookup_type(mngr, type);
+		if (i < 0)
+			return NL_SKIP;
+
+		ops = mngr->cm_assocs[i].ca_cache->c_ops;
+		goto found;
+	}
+
 	for (i = 0; i < mngr->cm_nassocs; i++) {
 		if (mngr->cm_assocs[i].ca_cache) {
 			ops = mngr->cm_assocs[i].ca_cache->c_ops;
@@ -117,6 +242,9 @@ found:
 	       msg, mngr->cm_assocs[i].ca_cache);
 	p.pp_arg = &mngr->cm_assocs[i];
 
+	if (_nl_cache_msg_skip(mngr->cm_assocs[i].ca_cache, nlmsg_hdr(msg), 1))
+		return NL_SKIP;
+
 	return nl_cache_parse(ops, NULL, nlmsg_hdr(msg), &p);
 }
 
@@ -124,7 +252,7 @@ found:
  * Allocate new cache manager
  * @arg sk		Netlink socket or NULL to auto allocate
  * @arg protocol	Netlink protocol this manager is used for
- * @arg flags		Flags (\c NL_AUTO_PROVIDE)
+ * @arg flags		Flags (\c NL_AUTO_PROVIDE, \c NL_AUTO_RESYNC)
  * @arg result		Result pointer
  *
  * Allocates a new cache manager for the specified netlink protocol.
@@ -142,6 +270,9 @@ found:
  * manager will automatically be made available to other users using
  * nl_cache_mngt_provide().
  *
+ * If the flag \c NL_AUTO_RESYNC is specified, the manager recovers from
+ * lost notifications by itself, see nl_cache_mngr_data_ready().
+ *
  * @note If the socket is provided by the caller, it is NOT recommended
  *       to use the socket for anything else besides receiving netlink
  *       notifications.
@@ -159,7 +290,7 @@ int nl_cache_mngr_alloc(struct nl_sock *sk, int protocol, int flags,
  * @arg sk		Netlink socket or NULL to auto allocate
  * @arg sync_sk		Blocking Netlink socket for cache refills
  * @arg protocol	Netlink protocol this manager is used for
- * @arg flags		Flags (\c NL_AUTO_PROVIDE)
+ * @arg flags		Flags (\c NL_AUTO_PROVIDE, \c NL_AUTO_RESYNC)
  * @arg result		Result pointer
  *
  * Same as \f nl_cache_mngr_alloc, but sets custom refill socket
@@ -174,7 +305,7 @@ int nl_cache_mngr_alloc_ex(struct nl_sock *sk, struct nl_sock *sync_sk, int prot
 	/* Catch abuse of flags */
 	if (flags & NL_ALLOCATED_SOCK)
 		BUG();
-	flags = flags & NL_AUTO_PROVIDE;
+	flags = flags & (NL_AUTO_PROVIDE | NL_AUTO_RESYNC);
 
 	mngr = calloc(1, sizeof(*mngr));
 	if (!mngr)
@@ -242,6 +373,12 @@ int nl_cache_mngr_alloc_ex(struct nl_sock *sk, struct nl_sock *sync_sk, int prot
  * first is the deleted object the second is NULL. On NL_ACT_NEW the first is
  * NULL and the second the new netlink object.
  *
+ * Objects merged into an existing cache object, such as IPv6 multipath
+ * routes, are copied before the merge to provide the previous object. If
+ * the cache has the flag \c NL_CACHE_NO_CHANGE_CLONE set, the copy is
+ * skipped and the first object is NULL for such changes, only the diff
+ * describes what changed.
+ *
  * The user is responsible for calling nl_cache_mngr_poll() or monitor
  * the socket and call nl_cache_mngr_data_ready() to allow the library
  * to process netlink notification events.
@@ -368,6 +505,7 @@ int nl_cache_mngr_add_cache(struct nl_cache_mngr *mngr, struct nl_cache *cache,
 	mngr->cm_assocs[i].ca_cache = cache;
 	mngr->cm_assocs[i].ca_change = cb;
 	mngr->cm_assocs[i].ca_change_data = data;
+	mngr_reindex(mngr);
 
 	if (mngr->cm_flags & NL_AUTO_PROVIDE)
 		nl_cache_mngt_provide(cache);
@@ -494,6 +632,25 @@ int nl_cache_mngr_get_fd(struct nl_cache_mngr *mngr)
 	return nl_socket_get_fd(mngr->cm_sock);
 }
 
+/**
+ * Set number of notifications received per system call
+ * @arg mngr		Cache Manager
+ * @arg n		Maximum number of datagrams per system call.
+ *
+ * Enables batched receiving of event notifications on the socket of the
+ * manager. Each call to nl_cache_mngr_data_ready() then reads up to \c n
+ * datagrams per recvmmsg() system call. A value of 0 or 1 disables
+ * batching.
+ *
+ * @see nl_socket_set_recv_batch()
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nl_cache_mngr_set_recv_batch(struct nl_cache_mngr *mngr, unsigned int n)
+{
+	return nl_socket_set_recv_batch(mngr->cm_sock, n);
+}
+
 /**
  * Check for event notifications
  * @arg mngr		Cache Manager
@@ -537,6 +694,57 @@ int nl_cache_mngr_poll(struct nl_cache_mngr *mngr, int timeout)
 	return nl_cache_mngr_data_ready(mngr);
 }
 
+static int drain_input(struct nl_msg *msg, void *arg)
+{
+	return NL_SKIP;
+}
+
+/*
+ * Notifications have been lost. Everything still queued on the event
+ * socket is older than the dump about to be requested and is discarded,
+ * then all caches are resynced over the sync socket. Notifications
+ * arriving in the meantime are queued and processed afterwards.
+ */
+static int mngr_recover(struct nl_cache_mngr *mngr)
+{
+	struct nl_cb *cb;
+	int i, err, ndrained = 0;
+
+	NL_DBG(1, "Cache manager %p: notifications lost, resyncing\n", mngr);
+
+	cb = nl_cb_clone(mngr->cm_sock->s_cb);
+	if (cb == NULL)
+		return -NLE_NOMEM;
+
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, drain_input, NULL);
+
+	while (ndrained < MNGR_MAX_DRAIN) {
+		err = nl_recvmsgs_report(mngr->cm_sock, cb);
+		if (err == -NLE_AGAIN || err == 0)
+			break;
+		if (err < 0 && err != -NLE_NOMEM && err != -NLE_MSG_OVERFLOW)
+			break;
+		ndrained++;
+	}
+
+	nl_cb_put(cb);
+
+	NL_DBG(2, "Cache manager %p: discarded %d stale reads\n",
+	       mngr, ndrained);
+
+	for (i = 0; i < mngr->cm_nassocs; i++) {
+		if (!mngr->cm_assocs[i].ca_cache)
+			continue;
+
+		err = _nl_cache_resync_assoc(mngr->cm_sync_sock,
+					     &mngr->cm_assocs[i]);
+		if (err < 0)
+			return err;
+	}
+
+	return 0;
+}
+
 /**
  * Receive available event notifications
  * @arg mngr		Cache manager
@@ -548,13 +756,26 @@ int nl_cache_mngr_poll(struct nl_cache_mngr *mngr, int timeout)
  * The function will process messages until there is no more data to
  * be read from the socket.
  *
+ * If the socket receive buffer overflowed or the kernel reported an
+ * overrun, notifications have been lost and the caches may be out of
+ * date. The number of such events is counted, see
+ * nl_cache_mngr_get_overruns(). If the manager was allocated with the
+ * flag \c NL_AUTO_RESYNC, the stale notifications are discarded, all
+ * caches are resynced with nl_cache_resync() semantics and the change
+ * callbacks are invoked for every difference found. Notifications
+ * received during the resync are processed afterwards in order.
+ * Otherwise the error is returned as before.
+ *
  * @see nl_cache_mngr_poll()
  *
  * @return The number of messages processed or a negative error code.
+ * @retval -NLE_NOMEM Out of memory or the socket receive buffer overflowed.
+ * @retval -NLE_MSG_OVERFLOW The kernel reported an overrun.
  */
 int nl_cache_mngr_data_ready(struct nl_cache_mngr *mngr)
 {
-	int err, nread = 0;
+	int err, nread = 0, nresync = 0;
+	unsigned int overruns;
 	struct nl_cb *cb;
 
 	NL_DBG(2, "Cache manager %p, reading new data from fd %d\n",
@@ -566,12 +787,29 @@ int nl_cache_mngr_data_ready(struct nl_cache_mngr *mngr)
 
 	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, event_input, mngr);
 
+retry:
+	overruns = mngr->cm_sock->s_overruns;
+
 	while ((err = nl_recvmsgs_report(mngr->cm_sock, cb)) > 0) {
 		NL_DBG(2, "Cache manager %p, recvmsgs read %d messages\n",
 		       mngr, err);
 		nread += err;
 	}
 
+	/* ENOBUFS is reported as -NLE_NOMEM, tell it apart from a
+	 * failed allocation by the socket counter */
+	if (err == -NLE_MSG_OVERFLOW ||
+	    (err == -NLE_NOMEM && mngr->cm_sock->s_overruns != overruns)) {
+		mngr->cm_overruns++;
+
+		if ((mngr->cm_flags & NL_AUTO_RESYNC) &&
+		    nresync++ < MNGR_MAX_RESYNC) {
+			err = mngr_recover(mngr);
+			if (err == 0)
+				goto retry;
+		}
+	}
+
 	nl_cb_put(cb);
 	if (err < 0 && err != -NLE_AGAIN)
 		return err;
@@ -579,6 +817,23 @@ int nl_cache_mngr_data_ready(struct nl_cache_mngr *mngr)
 	return nread;
 }
 
+/**
+ * Get number of lost notification events
+ * @arg mngr		Cache manager
+ *
+ * Returns how many times the socket of the manager overflowed or the
+ * kernel reported an overrun, regardless of whether the manager
+ * recovered from it automatically.
+ *
+ * @see nl_cache_mngr_data_ready()
+ *
+ * @return Number of overruns since the manager has been allocated.
+ */
+uint64_t nl_cache_mngr_get_overruns(struct nl_cache_mngr *mngr)
+{
+	return mngr->cm_overruns;
+}
+
 /**
  * Print information about cache manager
  * @arg mngr		Cache manager
@@ -599,6 +854,11 @@ void nl_cache_mngr_info(struct nl_cache_mngr *mngr, struct nl_dump_params *p)
 	nl_dump_line(p, "  .flags    = %#x\n", mngr->cm_flags);
 	nl_dump_line(p, "  .nassocs  = %u\n", mngr->cm_nassocs);
 	nl_dump_line(p, "  .sock     = <%p>\n", mngr->cm_sock);
+	nl_dump_line(p, "  .overruns = %" PRIu64 "\n", mngr->cm_overruns);
+	if (nl_socket_get_recv_batch(mngr->cm_sock))
+		nl_dump_line(p, "  .batch    = %u (%" PRIu64 " syscalls saved)\n",
+			     nl_socket_get_recv_batch(mngr->cm_sock),
+			     nl_socket_get_recv_batch_saved(mngr->cm_sock));
 
 	for (i = 0; i < mngr->cm_nassocs; i++) {
 		struct nl_cache_assoc *assoc = &mngr->cm_assocs[i];
@@ -654,6 +914,7 @@ void nl_cache_mngr_free(struct nl_cache_mngr *mngr)
 	}
 
 	free(mngr->cm_assocs);
+	free(mngr->cm_types);
 
 	NL_DBG(1, "Cache manager %p freed\n", mngr);
 
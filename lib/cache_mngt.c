@@ -24,6 +24,7 @@
 #include <netlink/netlink.h>
 #include <netlink/cache.h>
 #include <netlink/utils.h>
+#include <netlink/hashtable.h>
 
 #include "nl-priv-dynamic-core/nl-core.h"
 #include "nl-priv-dynamic-core/object-api.h"
@@ -33,6 +34,129 @@
 static struct nl_cache_ops *cache_ops;
 static NL_RW_LOCK(cache_ops_lock);
 
+/** @cond SKIP */
+/*
+ * The registered cache operations are additionally indexed by name and by
+ * protocol and message type so the lookups done for every received message
+ * do not have to walk the list. Both indexes are rebuilt whenever cache
+ * operations are registered or unregistered. If this fails, the lookups
+ * fall back to walking the list.
+ *
+ * Generic netlink message types are assigned at runtime and patched into
+ * the cache operations after registration, these are never indexed.
+ */
+struct cache_ops_slot {
+	uint32_t		os_key;
+	struct nl_cache_ops *	os_ops;
+};
+
+static struct cache_ops_slot *cache_ops_by_name;
+static struct cache_ops_slot *cache_ops_by_type;
+static unsigned int cache_ops_by_name_size;
+static unsigned int cache_ops_by_type_size;
+
+static unsigned int cache_ops_index_size(unsigned int nentries)
+{
+	unsigned int size = 16;
+
+	/* Keep the load factor at or below 50% */
+	while (size < nentries * 2)
+		size *= 2;
+
+	return size;
+}
+
+static uint32_t cache_ops_name_hash(const char *name)
+{
+	return nl_hash((void *) name, strlen(name), 0);
+}
+
+static int cache_ops_type_indexed(int protocol, int msgtype)
+{
+	return protocol != NETLINK_GENERIC && msgtype >= 0 &&
+	       msgtype <= UINT16_MAX;
+}
+
+static uint32_t cache_ops_type_key(int protocol, int msgtype)
+{
+	return ((uint32_t) protocol << 16) | (uint32_t) msgtype;
+}
+
+static uint32_t cache_ops_type_hash(uint32_t key)
+{
+	return nl_hash(&key, sizeof(key), 0);
+}
+
+/* Must hold cache_ops_lock for writing */
+static void cache_ops_reindex(void)
+{
+	struct cache_ops_slot *by_name = NULL, *by_type = NULL;
+	unsigned int name_size = 0, type_size = 0;
+	unsigned int nnames = 0, ntypes = 0;
+	struct nl_cache_ops *ops;
+	unsigned int n;
+	int i;
+
+	for (ops = cache_ops; ops; ops = ops->co_next) {
+		nnames++;
+		for (i = 0; ops->co_msgtypes[i].mt_id >= 0; i++)
+			ntypes++;
+	}
+
+	if (nnames) {
+		name_size = cache_ops_index_size(nnames);
+		type_size = cache_ops_index_size(ntypes);
+		by_name = calloc(name_size, sizeof(*by_name));
+		by_type = calloc(type_size, sizeof(*by_type));
+		if (!by_name || !by_type) {
+			NL_DBG(1, "Unable to index cache operations\n");
+			free(by_name);
+			free(by_type);
+			by_name = by_type = NULL;
+			name_size = type_size = 0;
+		}
+	}
+
+	for (ops = by_name ? cache_ops : NULL; ops; ops = ops->co_next) {
+		uint32_t key = cache_ops_name_hash(ops->co_name);
+
+		/* Names are unique, see nl_cache_mngt_register() */
+		for (n = key & (name_size - 1); by_name[n].os_ops;
+		     n = (n + 1) & (name_size - 1))
+			;
+		by_name[n].os_key = key;
+		by_name[n].os_ops = ops;
+
+		for (i = 0; ops->co_msgtypes[i].mt_id >= 0; i++) {
+			int msgtype = ops->co_msgtypes[i].mt_id;
+
+			if (!cache_ops_type_indexed(ops->co_protocol, msgtype))
+				continue;
+
+			key = cache_ops_type_key(ops->co_protocol, msgtype);
+
+			/* The first match in the list takes precedence */
+			for (n = cache_ops_type_hash(key) & (type_size - 1);
+			     by_type[n].os_ops; n = (n + 1) & (type_size - 1))
+				if (by_type[n].os_key == key)
+					break;
+
+			if (!by_type[n].os_ops) {
+				by_type[n].os_key = key;
+				by_type[n].os_ops = ops;
+			}
+		}
+	}
+
+	free(cache_ops_by_name);
+	free(cache_ops_by_type);
+	cache_ops_by_name = by_name;
+	cache_ops_by_type = by_type;
+	cache_ops_by_name_size = name_size;
+	cache_ops_by_type_size = type_size;
+}
+/** @endcond */
+
 /**
  * @name Cache Operations Sets
  * @{
@@ -41,6 +165,23 @@ static NL_RW_LOCK(cache_ops_lock);
 static struct nl_cache_ops *__nl_cache_ops_lookup(const char *name)
 {
 	struct nl_cache_ops *ops;
+	uint32_t key;
+	unsigned int n;
+
+	if (cache_ops_by_name) {
+		key = cache_ops_name_hash(name);
+
+		for (n = key & (cache_ops_by_name_size - 1);
+		     cache_ops_by_name[n].os_ops;
+		     n = (n + 1) & (cache_ops_by_name_size - 1)) {
+			ops = cache_ops_by_name[n].os_ops;
+			if (cache_ops_by_name[n].os_key == key &&
+			    !strcmp(ops->co_name, name))
+				return ops;
+		}
+
+		return NULL;
+	}
 
 	for (ops = cache_ops; ops; ops = ops->co_next)
 		if (!strcmp(ops->co_name, name))
@@ -112,6 +253,20 @@ static struct nl_cache_ops *__cache_ops_associate(int protocol, int msgtype)
 {
 	int i;
 	struct nl_cache_ops *ops;
+	uint32_t key;
+	unsigned int n;
+
+	if (cache_ops_by_type && cache_ops_type_indexed(protocol, msgtype)) {
+		key = cache_ops_type_key(protocol, msgtype);
+
+		for (n = cache_ops_type_hash(key) & (cache_ops_by_type_size - 1);
+		     cache_ops_by_type[n].os_ops;
+		     n = (n + 1) & (cache_ops_by_type_size - 1))
+			if (cache_ops_by_type[n].os_key == key)
+				return cache_ops_by_type[n].os_ops;
+
+		return NULL;
+	}
 
 	for (ops = cache_ops; ops; ops = ops->co_next) {
 		if (ops->co_protocol != protocol)
@@ -266,6 +421,7 @@ int nl_cache_mngt_register(struct nl_cache_ops *ops)
 	ops->co_refcnt = 0;
 	ops->co_next = cache_ops;
 	cache_ops = ops;
+	cache_ops_reindex();
 	nl_write_unlock(&cache_ops_lock);
 
 	NL_DBG(1, "Registered cache operations %s\n", ops->co_name);
@@ -308,6 +464,7 @@ int nl_cache_mngt_unregister(struct nl_cache_ops *ops)
 	NL_DBG(1, "Unregistered cache operations %s\n", ops->co_name);
 
 	*tp = t->co_next;
+	cache_ops_reindex();
 errout:
 	nl_write_unlock(&cache_ops_lock);
 
@@ -9,31 +9,184 @@
 #include <netlink/hash.h>
 #include <netlink/hashtable.h>
 
+#include "nl-core.h"
 #include "nl-aux-core/nl-core.h"
 
 /**
  * @ingroup core_types
  * @defgroup hashtable Hashtable
+ *
+ * The hashtable grows automatically once the average chain length exceeds
+ * two objects. Instead of moving all objects at once, the table size is
+ * doubled and the objects are migrated a few chains at a time by the
+ * following add and delete operations. Until the migration has completed,
+ * both tables are searched. Lookups never modify the table, so they may run
+ * concurrently with each other.
+ *
+ * The number of chains is always a power of two. The full hash of each
+ * object is kept in its node so a chain is selected by masking the hash
+ * and migrating objects never requires to hash them again.
+ *
+ * The layout of `nl_hash_table_t` is unchanged, the resize state is kept
+ * in a private structure allocated along with it. Its chains only hold
+ * the objects migrated so far, use the access functions instead of
+ * walking them directly.
+ *
  * @{
  */
 
+/** @cond SKIP */
+/* Average chain length at which the hash table is grown */
+#define NL_HASH_TABLE_MAX_LOAD 2
+
+/* Number of chains migrated per operation while resizing */
+#define REHASH_STEP 1
+
+/* nl_hash_table_t is public, the resize state is kept out of it */
+struct nl_hash_table_priv {
+	nl_hash_table_t		ht;
+	/* Number of objects stored */
+	int			count;
+	/* Chains still to be migrated while resizing */
+	int			old_size;
+	nl_hash_node_t **	old_nodes;
+	int			rehash_idx;
+};
+
+static inline struct nl_hash_table_priv *ht_priv(nl_hash_table_t *ht)
+{
+	return (struct nl_hash_table_priv *) ht;
+}
+
+static void ht_rehash_step(nl_hash_table_t *ht, int nchains)
+{
+	struct nl_hash_table_priv *priv = ht_priv(ht);
+	/* Bound the number of empty chains visited as well */
+	int nvisits = nchains * 10;
+
+	if (!priv->old_nodes)
+		return;
+
+	while (nchains > 0 && priv->rehash_idx < priv->old_size) {
+		nl_hash_node_t *node = priv->old_nodes[priv->rehash_idx];
+
+		if (!node) {
+			priv->rehash_idx++;
+			if (--nvisits == 0)
+				break;
+			continue;
+		}
+
+		while (node) {
+			nl_hash_node_t *next = node->next;
+			uint32_t idx = node->key & (ht->size - 1);
+
+			node->next = ht->nodes[idx];
+			ht->nodes[idx] = node;
+			node = next;
+		}
+
+		priv->old_nodes[priv->rehash_idx++] = NULL;
+		nchains--;
+	}
+
+	if (priv->rehash_idx >= priv->old_size) {
+		NL_DBG(3, "hashtable %p: resize to %d chains completed\n",
+		       ht, ht->size);
+		free(priv->old_nodes);
+		priv->old_nodes = NULL;
+		priv->old_size = 0;
+		priv->rehash_idx = 0;
+	}
+}
+
+static int ht_resize(nl_hash_table_t *ht, int size)
+{
+	struct nl_hash_table_priv *priv = ht_priv(ht);
+	nl_hash_node_t **nodes;
+
+	/* Only one migration at a time */
+	if (priv->old_nodes)
+		ht_rehash_step(ht, priv->old_size);
+
+	nodes = calloc(size, sizeof (*nodes));
+	if (!nodes)
+		return -NLE_NOMEM;
+
+	NL_DBG(3, "hashtable %p: resizing from %d to %d chains\n",
+	       ht, ht->size, size);
+
+	priv->old_nodes = ht->nodes;
+	priv->old_size = ht->size;
+	priv->rehash_idx = 0;
+	ht->nodes = nodes;
+	ht->size = size;
+
+	return 0;
+}
+
+static nl_hash_node_t **ht_find(nl_hash_node_t **nodes, int size,
+				uint32_t key_hash, struct nl_object *obj)
+{
+	nl_hash_node_t **pnode;
+
+	for (pnode = &nodes[key_hash & (size - 1)]; *pnode;
+	     pnode = &(*pnode)->next) {
+		if ((*pnode)->key == key_hash &&
+		    nl_object_identical((*pnode)->obj, obj))
+			return pnode;
+	}
+
+	return NULL;
+}
+
+static nl_hash_node_t **ht_find_any(nl_hash_table_t *ht,
+				    struct nl_object *obj)
+{
+	struct nl_hash_table_priv *priv = ht_priv(ht);
+	nl_hash_node_t **pnode;
+	uint32_t key_hash = _nl_object_hash(obj);
+
+	pnode = ht_find(ht->nodes, ht->size, key_hash, obj);
+	if (!pnode && priv->old_nodes)
+		pnode = ht_find(priv->old_nodes, priv->old_size, key_hash,
+				obj);
+
+	return pnode;
+}
+/** @endcond */
+
 /**
  * Allocate hashtable
  * @arg size		Size of hashtable in number of elements
  *
+ * The size is only the initial number of chains, the hashtable grows as
+ * objects are added. It is rounded up to the next power of two, a size
+ * of 0 or less yields a hashtable with a single chain.
+ *
  * @return Allocated hashtable or NULL.
  */
 nl_hash_table_t *nl_hash_table_alloc(int size)
 {
+	struct nl_hash_table_priv *priv;
 	nl_hash_table_t *ht;
+	int n = 1;
+
+	if (size > INT_MAX / 2 + 1)
+		return NULL;
 
-	ht = calloc(1, sizeof (*ht));
-	if (!ht)
+	while (n < size)
+		n *= 2;
+	size = n;
+
+	priv = calloc(1, sizeof (*priv));
+	if (!priv)
 		goto errout;
+	ht = &priv->ht;
 
 	ht->nodes = calloc(size, sizeof (*ht->nodes));
 	if (!ht->nodes) {
-		free(ht);
+		free(priv);
 		goto errout;
 	}
 
@@ -54,6 +207,9 @@ void nl_hash_table_free(nl_hash_table_t *ht)
 {
 	int i;
 
+	/* Moves all remaining objects to the current chains */
+	ht_rehash_step(ht, ht_priv(ht)->old_size);
+
 	for(i = 0; i < ht->size; i++) {
 		nl_hash_node_t *node = ht->nodes[i];
 		nl_hash_node_t *saved_node;
@@ -67,7 +223,7 @@ void nl_hash_table_free(nl_hash_table_t *ht)
 	}
 
 	free(ht->nodes);
-	free(ht);
+	free(ht_priv(ht));
 }
 
 /**
@@ -83,19 +239,11 @@ void nl_hash_table_free(nl_hash_table_t *ht)
 struct nl_object* nl_hash_table_lookup(nl_hash_table_t *ht,
 				       struct nl_object *obj)
 {
-	nl_hash_node_t *node;
-	uint32_t key_hash;
-
-	nl_object_keygen(obj, &key_hash, ht->size);
-	node = ht->nodes[key_hash];
+	nl_hash_node_t **pnode;
 
-	while (node) {
-		if (nl_object_identical(node->obj, obj))
-			return node->obj;
-		node = node->next;
-	}
+	pnode = ht_find_any(ht, obj);
 
-	return NULL;
+	return pnode ? (*pnode)->obj : NULL;
 }
 
 /**
@@ -106,6 +254,9 @@ struct nl_object* nl_hash_table_lookup(nl_hash_table_t *ht,
  * Adds `obj` to the hashtable. Object type must support hashing, otherwise all
  * objects will be added to the chain `0`.
  *
+ * Doubles the number of chains if the average chain length exceeds two
+ * objects.
+ *
  * @note The reference counter of the object is incremented.
  *
  * @return 0 on success or a negative error code
@@ -113,20 +264,24 @@ struct nl_object* nl_hash_table_lookup(nl_hash_table_t *ht,
  */
 int nl_hash_table_add(nl_hash_table_t *ht, struct nl_object *obj)
 {
+	struct nl_hash_table_priv *priv = ht_priv(ht);
 	nl_hash_node_t *node;
 	uint32_t key_hash;
 
-	nl_object_keygen(obj, &key_hash, ht->size);
-	node = ht->nodes[key_hash];
+	ht_rehash_step(ht, REHASH_STEP);
 
-	while (node) {
-		if (nl_object_identical(node->obj, obj)) {
-			NL_DBG(2, "Warning: Add to hashtable found duplicate...\n");
-			return -NLE_EXIST;
-		}
-		node = node->next;
+	if (ht_find_any(ht, obj)) {
+		NL_DBG(2, "Warning: Add to hashtable found duplicate...\n");
+		return -NLE_EXIST;
 	}
 
+	/* Failing to grow only costs performance */
+	if (priv->count >= ht->size * NL_HASH_TABLE_MAX_LOAD &&
+	    ht->size <= INT_MAX / 2 / NL_HASH_TABLE_MAX_LOAD)
+		ht_resize(ht, ht->size * 2);
+
+	key_hash = _nl_object_hash(obj);
+
 	NL_DBG (5, "adding cache entry of obj %p in table %p, with hash 0x%x\n",
 		obj, ht, key_hash);
 
@@ -137,8 +292,9 @@ int nl_hash_table_add(nl_hash_table_t *ht, struct nl_object *obj)
 	node->obj = obj;
 	node->key = key_hash;
 	node->key_size = sizeof(uint32_t);
-	node->next = ht->nodes[key_hash];
-	ht->nodes[key_hash] = node;
+	node->next = ht->nodes[key_hash & (ht->size - 1)];
+	ht->nodes[key_hash & (ht->size - 1)] = node;
+	priv->count++;
 
 	return 0;
 }
@@ -157,33 +313,92 @@ int nl_hash_table_add(nl_hash_table_t *ht, struct nl_object *obj)
  */
 int nl_hash_table_del(nl_hash_table_t *ht, struct nl_object *obj)
 {
-	nl_hash_node_t *node, *prev;
-	uint32_t key_hash;
+	nl_hash_node_t **pnode, *node;
 
-	nl_object_keygen(obj, &key_hash, ht->size);
-	prev = node = ht->nodes[key_hash];
+	ht_rehash_step(ht, REHASH_STEP);
 
-	while (node) {
-		if (nl_object_identical(node->obj, obj)) {
-			nl_object_put(obj);
+	pnode = ht_find_any(ht, obj);
+	if (!pnode)
+		return -NLE_OBJ_NOTFOUND;
 
-			NL_DBG (5, "deleting cache entry of obj %p in table %p, with"
-			        " hash 0x%x\n", obj, ht, key_hash);
+	node = *pnode;
+	nl_object_put(obj);
 
-			if (node == ht->nodes[key_hash])
-				ht->nodes[key_hash] = node->next;
-			else
-				prev->next = node->next;
+	NL_DBG (5, "deleting cache entry of obj %p in table %p, with"
+	        " hash 0x%x\n", obj, ht, node->key);
 
-			free(node);
+	*pnode = node->next;
+	free(node);
+	ht_priv(ht)->count--;
 
-			return 0;
-		}
-		prev = node;
-		node = node->next;
+	return 0;
+}
+
+/** @cond SKIP */
+/*
+ * Replace `old` with the identical object `new`. The node of `old` is reused
+ * so the replacement cannot fail for lack of memory.
+ */
+int _nl_hash_table_replace(nl_hash_table_t *ht, struct nl_object *old,
+			   struct nl_object *new)
+{
+	nl_hash_node_t **pnode, *node;
+	uint32_t key_hash;
+
+	pnode = ht_find_any(ht, old);
+	if (!pnode)
+		return -NLE_OBJ_NOTFOUND;
+
+	node = *pnode;
+	key_hash = _nl_object_hash(new);
+
+	/* Only attributes outside of the key may differ, just in case */
+	if (key_hash != node->key) {
+		*pnode = node->next;
+		node->key = key_hash;
+		node->next = ht->nodes[key_hash & (ht->size - 1)];
+		ht->nodes[key_hash & (ht->size - 1)] = node;
 	}
 
-	return -NLE_OBJ_NOTFOUND;
+	nl_object_get(new);
+	node->obj = new;
+	nl_object_put(old);
+
+	return 0;
+}
+/** @endcond */
+
+/**
+ * Grow hashtable to hold a number of objects
+ * @arg ht		Hashtable
+ * @arg nobjs		Expected number of objects
+ *
+ * Doubles the number of chains until `nobjs` objects fit without exceeding
+ * an average chain length of two objects and migrates all objects right
+ * away. Calling this before a large number of objects is added avoids the
+ * repeated resizing otherwise done while adding. The hashtable is never
+ * shrunk.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nl_hash_table_presize(nl_hash_table_t *ht, int nobjs)
+{
+	int size = ht->size;
+	int err;
+
+	while (size < nobjs / NL_HASH_TABLE_MAX_LOAD && size <= INT_MAX / 2)
+		size *= 2;
+
+	if (size == ht->size)
+		return 0;
+
+	err = ht_resize(ht, size);
+	if (err < 0)
+		return err;
+
+	ht_rehash_step(ht, ht_priv(ht)->old_size);
+
+	return 0;
 }
 
 uint32_t nl_hash(void *k, size_t length, uint32_t initval)
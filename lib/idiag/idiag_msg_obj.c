@@ -208,6 +208,7 @@ void idiagnl_msg_set_family(struct idiagnl_msg *msg, uint8_t family)
 {
 	msg->idiag_family = family;
 	msg->ce_mask |= IDIAGNL_ATTR_FAMILY;
+	nl_object_invalidate_hash(msg);
 }
 
 uint8_t idiagnl_msg_get_state(const struct idiagnl_msg *msg)
@@ -252,6 +253,7 @@ void idiagnl_msg_set_sport(struct idiagnl_msg *msg, uint16_t port)
 {
 	msg->idiag_sport = port;
 	msg->ce_mask |= IDIAGNL_ATTR_SPORT;
+	nl_object_invalidate_hash(msg);
 }
 
 uint16_t idiagnl_msg_get_dport(struct idiagnl_msg *msg)
@@ -263,6 +265,7 @@ void idiagnl_msg_set_dport(struct idiagnl_msg *msg, uint16_t port)
 {
 	msg->idiag_dport = port;
 	msg->ce_mask |= IDIAGNL_ATTR_DPORT;
+	nl_object_invalidate_hash(msg);
 }
 
 struct nl_addr *idiagnl_msg_get_src(const struct idiagnl_msg *msg)
@@ -278,6 +281,7 @@ int idiagnl_msg_set_src(struct idiagnl_msg *msg, struct nl_addr *addr)
 	nl_addr_get(addr);
 	msg->idiag_src = addr;
 	msg->ce_mask |= IDIAGNL_ATTR_SRC;
+	nl_object_invalidate_hash(msg);
 
 	return 0;
 }
@@ -295,6 +299,7 @@ int idiagnl_msg_set_dst(struct idiagnl_msg *msg, struct nl_addr *addr)
 	nl_addr_get(addr);
 	msg->idiag_dst = addr;
 	msg->ce_mask |= IDIAGNL_ATTR_DST;
+	nl_object_invalidate_hash(msg);
 
 	return 0;
 }
@@ -941,8 +946,7 @@ static uint64_t idiagnl_compare(struct nl_object *_a, struct nl_object *_b,
 	return diff;
 }
 
-static void idiagnl_keygen(struct nl_object *obj, uint32_t *hashkey,
-        uint32_t table_sz)
+static uint32_t idiagnl_keygen(struct nl_object *obj)
 {
 	struct idiagnl_msg *msg = (struct idiagnl_msg *)obj;
 	unsigned int key_sz;
@@ -953,6 +957,7 @@ static void idiagnl_keygen(struct nl_object *obj, uint32_t *hashkey,
 		uint16_t sport;
 		uint16_t dport;
 	} _nl_packed key;
+	uint32_t hash;
 
 	key_sz = sizeof(key);
 	key.family = msg->idiag_family;
@@ -970,12 +975,12 @@ static void idiagnl_keygen(struct nl_object *obj, uint32_t *hashkey,
 		                        nl_addr_get_len(msg->idiag_dst), 0);
 	}
 
-	*hashkey = nl_hash(&key, key_sz, 0) % table_sz;
+	hash = nl_hash(&key, key_sz, 0);
 
 	NL_DBG(5, "idiagnl %p key (fam %d src_hash %d dst_hash %d sport %d dport %d) keysz %d, hash 0x%x\n",
-	       msg, key.family, key.src_hash, key.dst_hash, key.sport, key.dport, key_sz, *hashkey);
+	       msg, key.family, key.src_hash, key.dst_hash, key.sport, key.dport, key_sz, hash);
 
-	return;
+	return hash;
 }
 
 /** @cond SKIP */
@@ -403,6 +403,116 @@ struct nl_msg *nlmsg_convert(struct nlmsghdr *hdr)
 	return nm;
 }
 
+/** @cond SKIP */
+struct nl_rxbuf *_nl_rxbuf_alloc(unsigned char *data, size_t size)
+{
+	struct nl_rxbuf *rb;
+
+	rb = calloc(1, sizeof(*rb));
+	if (!rb)
+		return NULL;
+
+	rb->rb_data = data;
+	rb->rb_size = size;
+	rb->rb_refcnt = 1;
+
+	return rb;
+}
+
+void _nl_rxbuf_put(struct nl_rxbuf *rb)
+{
+	int refcnt;
+
+	if (!rb)
+		return;
+
+	refcnt = _nl_refcnt_dec(&rb->rb_refcnt);
+
+	if (refcnt < 0)
+		BUG();
+
+	if (refcnt <= 0) {
+		free(rb->rb_data);
+		free(rb);
+	}
+}
+
+/*
+ * Wraps a message located in a receive buffer without copying it. The
+ * message keeps a reference on the buffer until it is freed. The maximum
+ * size equals the message length, thus there is no tailroom to append to.
+ */
+struct nl_msg *_nlmsg_borrow(struct nl_rxbuf *rb, struct nlmsghdr *hdr)
+{
+	struct nl_msg *nm;
+
+	nm = calloc(1, sizeof(*nm));
+	if (!nm)
+		return NULL;
+
+	nm->nm_refcnt = 1;
+	nm->nm_protocol = -1;
+	nm->nm_flags = NL_MSG_BORROWED;
+	nm->nm_nlh = hdr;
+	nm->nm_size = hdr->nlmsg_len;
+	nm->nm_rxbuf = rb;
+	_nl_refcnt_inc(&rb->rb_refcnt);
+
+	return nm;
+}
+
+static int nlmsg_borrow_unshared(struct nl_msg *msg)
+{
+	return (msg->nm_flags & NL_MSG_BORROWED) &&
+	       _nl_refcnt_read(&msg->nm_refcnt) == 1;
+}
+
+/*
+ * Like _nlmsg_borrow() but reuses @msg if it is a borrowed message nobody
+ * else holds a reference to. Otherwise the reference to @msg is released.
+ */
+struct nl_msg *_nlmsg_borrow_reuse(struct nl_msg *msg, struct nl_rxbuf *rb,
+				   struct nlmsghdr *hdr)
+{
+	if (!msg || !nlmsg_borrow_unshared(msg)) {
+		nlmsg_free(msg);
+		return _nlmsg_borrow(rb, hdr);
+	}
+
+	_nl_refcnt_inc(&rb->rb_refcnt);
+	_nl_rxbuf_put(msg->nm_rxbuf);
+
+	*msg = (struct nl_msg) {
+		.nm_refcnt = 1,
+		.nm_protocol = -1,
+		.nm_flags = NL_MSG_BORROWED,
+		.nm_nlh = hdr,
+		.nm_size = hdr->nlmsg_len,
+		.nm_rxbuf = rb,
+	};
+
+	return msg;
+}
+
+/*
+ * Detaches an unshared borrowed message from its buffer to keep it for
+ * _nlmsg_borrow_reuse(). Other messages are released, NULL is returned.
+ */
+struct nl_msg *_nlmsg_borrow_release(struct nl_msg *msg)
+{
+	if (!msg || !nlmsg_borrow_unshared(msg)) {
+		nlmsg_free(msg);
+		return NULL;
+	}
+
+	_nl_rxbuf_put(msg->nm_rxbuf);
+	msg->nm_rxbuf = NULL;
+	msg->nm_nlh = NULL;
+
+	return msg;
+}
+/** @endcond */
+
 /**
  * Reserve room for additional data in a netlink message
  * @arg n		netlink message
@@ -488,9 +598,22 @@ int nlmsg_expand(struct nl_msg *n, size_t newlen)
 	if (newlen <= n->nm_size)
 		return -NLE_INVAL;
 
-	tmp = realloc(n->nm_nlh, newlen);
-	if (tmp == NULL)
-		return -NLE_NOMEM;
+	if (n->nm_flags & NL_MSG_BORROWED) {
+		/* The message lives in a shared receive buffer, detach it
+		 * by moving it into a private allocation. */
+		tmp = calloc(1, newlen);
+		if (tmp == NULL)
+			return -NLE_NOMEM;
+
+		memcpy(tmp, n->nm_nlh, n->nm_nlh->nlmsg_len);
+		_nl_rxbuf_put(n->nm_rxbuf);
+		n->nm_rxbuf = NULL;
+		n->nm_flags &= ~NL_MSG_BORROWED;
+	} else {
+		tmp = realloc(n->nm_nlh, newlen);
+		if (tmp == NULL)
+			return -NLE_NOMEM;
+	}
 
 	n->nm_nlh = tmp;
 	n->nm_size = newlen;
@@ -558,9 +681,9 @@ struct nlmsghdr *nlmsg_hdr(struct nl_msg *n)
  */
 void nlmsg_get(struct nl_msg *msg)
 {
-	msg->nm_refcnt++;
-	NL_DBG(4, "New reference to message %p, total %d\n",
-	       msg, msg->nm_refcnt);
+	int refcnt = _nl_refcnt_inc(&msg->nm_refcnt);
+
+	NL_DBG(4, "New reference to message %p, total %d\n", msg, refcnt);
 }
 
 /**
@@ -571,18 +694,23 @@ void nlmsg_get(struct nl_msg *msg)
  */
 void nlmsg_free(struct nl_msg *msg)
 {
+	int refcnt;
+
 	if (!msg)
 		return;
 
-	msg->nm_refcnt--;
+	refcnt = _nl_refcnt_dec(&msg->nm_refcnt);
 	NL_DBG(4, "Returned message reference %p, %d remaining\n",
-	       msg, msg->nm_refcnt);
+	       msg, refcnt);
 
-	if (msg->nm_refcnt < 0)
+	if (refcnt < 0)
 		BUG();
 
-	if (msg->nm_refcnt <= 0) {
-		free(msg->nm_nlh);
+	if (refcnt <= 0) {
+		if (msg->nm_flags & NL_MSG_BORROWED)
+			_nl_rxbuf_put(msg->nm_rxbuf);
+		else
+			free(msg->nm_nlh);
 		NL_DBG(2, "msg %p: Freed\n", msg);
 		free(msg);
 	}
@@ -731,12 +859,25 @@ static int parse_cb(struct nl_object *obj, struct nl_parser_param *p)
 	return 0;
 }
 
+/**
+ * Parse netlink message into objects
+ * @arg msg		Netlink message
+ * @arg cb		Function called for every object
+ * @arg arg		Argument passed to \c cb
+ *
+ * If \c msg was delivered without copying, see
+ * nl_socket_enable_msg_zerocopy(), the objects may refer to data in the
+ * message and hold a reference on it instead of copying the data.
+ *
+ * @return 0 on success or a negative error code.
+ */
 int nl_msg_parse(struct nl_msg *msg, void (*cb)(struct nl_object *, void *),
 		 void *arg)
 {
 	struct nl_cache_ops *ops;
 	struct nl_parser_param p = {
-		.pp_cb = parse_cb
+		.pp_cb = parse_cb,
+		.pp_msg = msg,
 	};
 	struct dp_xdata x = {
 		.cb = cb,
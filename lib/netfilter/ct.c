@@ -99,56 +99,43 @@ static struct nla_policy ct_timestamp_policy[CTA_TIMESTAMP_MAX + 1] = {
 static int ct_parse_ip(struct nfnl_ct *ct, int repl, struct nlattr *attr)
 {
 	struct nlattr *tb[CTA_IP_MAX+1];
-	struct nl_addr *addr;
 	int err;
 
 	err = nla_parse_nested(tb, CTA_IP_MAX, attr, ct_ip_policy);
 	if (err < 0)
-		goto errout;
+		return err;
 
+	/* Copied into the object without allocating an nl_addr */
 	if (tb[CTA_IP_V4_SRC]) {
-		addr = nl_addr_alloc_attr(tb[CTA_IP_V4_SRC], AF_INET);
-		if (addr == NULL)
-			goto errout_enomem;
-		err = nfnl_ct_set_src(ct, repl, addr);
-		nl_addr_put(addr);
+		err = _nfnl_ct_set_src(ct, repl, AF_INET,
+				       nla_data(tb[CTA_IP_V4_SRC]),
+				       nla_len(tb[CTA_IP_V4_SRC]));
 		if (err < 0)
-			goto errout;
+			return err;
 	}
 	if (tb[CTA_IP_V4_DST]) {
-		addr = nl_addr_alloc_attr(tb[CTA_IP_V4_DST], AF_INET);
-		if (addr == NULL)
-			goto errout_enomem;
-		err = nfnl_ct_set_dst(ct, repl, addr);
-		nl_addr_put(addr);
+		err = _nfnl_ct_set_dst(ct, repl, AF_INET,
+				       nla_data(tb[CTA_IP_V4_DST]),
+				       nla_len(tb[CTA_IP_V4_DST]));
 		if (err < 0)
-			goto errout;
+			return err;
 	}
 	if (tb[CTA_IP_V6_SRC]) {
-		addr = nl_addr_alloc_attr(tb[CTA_IP_V6_SRC], AF_INET6);
-		if (addr == NULL)
-			goto errout_enomem;
-		err = nfnl_ct_set_src(ct, repl, addr);
-		nl_addr_put(addr);
+		err = _nfnl_ct_set_src(ct, repl, AF_INET6,
+				       nla_data(tb[CTA_IP_V6_SRC]),
+				       nla_len(tb[CTA_IP_V6_SRC]));
 		if (err < 0)
-			goto errout;
+			return err;
 	}
 	if (tb[CTA_IP_V6_DST]) {
-		addr = nl_addr_alloc_attr(tb[CTA_IP_V6_DST], AF_INET6);
-		if (addr == NULL)
-			goto errout_enomem;
-		err = nfnl_ct_set_dst(ct, repl, addr);
-		nl_addr_put(addr);
+		err = _nfnl_ct_set_dst(ct, repl, AF_INET6,
+				       nla_data(tb[CTA_IP_V6_DST]),
+				       nla_len(tb[CTA_IP_V6_DST]));
 		if (err < 0)
-			goto errout;
+			return err;
 	}
 
 	return 0;
-
-errout_enomem:
-	err = -NLE_NOMEM;
-errout:
-	return err;
 }
 
 static int ct_parse_proto(struct nfnl_ct *ct, int repl, struct nlattr *attr)
@@ -463,8 +450,8 @@ static int ct_request_update(struct nl_cache *cache, struct nl_sock *sk)
 static int nfnl_ct_build_tuple(struct nl_msg *msg, const struct nfnl_ct *ct,
 			       int repl)
 {
+	const struct nl_addr_inline *addr;
 	struct nlattr *tuple, *ip, *proto;
-	struct nl_addr *addr;
 	int family;
 
 	family = nfnl_ct_get_family(ct);
@@ -477,17 +464,17 @@ static int nfnl_ct_build_tuple(struct nl_msg *msg, const struct nfnl_ct *ct,
 	if (!ip)
 		goto nla_put_failure;
 
-	addr = nfnl_ct_get_src(ct, repl);
+	/* Put from the inline addresses, building a request does not
+	 * create address handles */
+	addr = _nfnl_ct_get_src(ct, repl);
 	if (addr)
-		NLA_PUT_ADDR(msg,
-			     family == AF_INET ? CTA_IP_V4_SRC : CTA_IP_V6_SRC,
-			     addr);
+		NLA_PUT(msg, family == AF_INET ? CTA_IP_V4_SRC : CTA_IP_V6_SRC,
+			addr->ai_len, addr->ai_addr);
 
-	addr = nfnl_ct_get_dst(ct, repl);
+	addr = _nfnl_ct_get_dst(ct, repl);
 	if (addr)
-		NLA_PUT_ADDR(msg,
-			     family == AF_INET ? CTA_IP_V4_DST : CTA_IP_V6_DST,
-			     addr);
+		NLA_PUT(msg, family == AF_INET ? CTA_IP_V4_DST : CTA_IP_V6_DST,
+			addr->ai_len, addr->ai_addr);
 
 	nla_nest_end(msg, ip);
 
@@ -554,13 +541,13 @@ static int nfnl_ct_build_message(const struct nfnl_ct *ct, int cmd, int flags,
 		return -NLE_NOMEM;
 
 	/* We use REPLY || ORIG, depending on requests. */
-	if (nfnl_ct_get_src(ct, 1) || nfnl_ct_get_dst(ct, 1)) {
+	if (_nfnl_ct_get_src(ct, 1) || _nfnl_ct_get_dst(ct, 1)) {
 		reply = 1;
 		if ((err = nfnl_ct_build_tuple(msg, ct, 1)) < 0)
 			goto err_out;
 	}
 
-	if (!reply || nfnl_ct_get_src(ct, 0) || nfnl_ct_get_dst(ct, 0)) {
+	if (!reply || _nfnl_ct_get_src(ct, 0) || _nfnl_ct_get_dst(ct, 0)) {
 		if ((err = nfnl_ct_build_tuple(msg, ct, 0)) < 0)
 			goto err_out;
 	}
@@ -16,10 +16,12 @@
 
 #include <netlink/netfilter/nfnl.h>
 #include <netlink/netfilter/ct.h>
+#include <netlink/hashtable.h>
 
 #include "nl-priv-dynamic-core/object-api.h"
 #include "nl-netfilter.h"
 #include "nl-priv-dynamic-core/nl-core.h"
+#include "nl-aux-core/nl-core.h"
 
 /** @cond SKIP */
 #define CT_ATTR_FAMILY		(1UL << 0)
@@ -54,69 +56,49 @@
 #define CT_ATTR_REPL_BYTES	(1UL << 25)
 #define CT_ATTR_TIMESTAMP	(1UL << 26)
 #define CT_ATTR_ZONE	(1UL << 27)
+
+/* A connection is identified by its original direction tuple */
+#define CT_ATTR_ORIG_TUPLE	(CT_ATTR_ORIG_SRC | CT_ATTR_ORIG_DST |	\
+				 CT_ATTR_ORIG_SRC_PORT | CT_ATTR_ORIG_DST_PORT | \
+				 CT_ATTR_ORIG_ICMP_ID | CT_ATTR_ORIG_ICMP_TYPE | \
+				 CT_ATTR_ORIG_ICMP_CODE)
+
+/* Index of an address in ct_addrs */
+#define CT_ADDR_IDX(repl, dst)	(((repl) ? 2 : 0) + ((dst) ? 1 : 0))
+#define CT_ADDR_MAX		4
 /** @endcond */
 
 static void ct_free_data(struct nl_object *c)
 {
 	struct nfnl_ct *ct = (struct nfnl_ct *) c;
+	int i;
 
-	if (ct == NULL)
+	if (ct == NULL || !ct->ct_addrs)
 		return;
 
-	nl_addr_put(ct->ct_orig.src);
-	nl_addr_put(ct->ct_orig.dst);
-	nl_addr_put(ct->ct_repl.src);
-	nl_addr_put(ct->ct_repl.dst);
+	for (i = 0; i < CT_ADDR_MAX; i++)
+		nl_addr_put(ct->ct_addrs[i]);
+	free(ct->ct_addrs);
 }
 
 static int ct_clone(struct nl_object *_dst, struct nl_object *_src)
 {
 	struct nfnl_ct *dst = (struct nfnl_ct *) _dst;
-	struct nfnl_ct *src = (struct nfnl_ct *) _src;
-	struct nl_addr *addr;
-
-	dst->ct_orig.src = NULL;
-	dst->ct_orig.dst = NULL;
-	dst->ct_repl.src = NULL;
-	dst->ct_repl.dst = NULL;
-
-	if (src->ct_orig.src) {
-		addr = nl_addr_clone(src->ct_orig.src);
-		if (!addr)
-			return -NLE_NOMEM;
-		dst->ct_orig.src = addr;
-	}
-
-	if (src->ct_orig.dst) {
-		addr = nl_addr_clone(src->ct_orig.dst);
-		if (!addr)
-			return -NLE_NOMEM;
-		dst->ct_orig.dst = addr;
-	}
-
-	if (src->ct_repl.src) {
-		addr = nl_addr_clone(src->ct_repl.src);
-		if (!addr)
-			return -NLE_NOMEM;
-		dst->ct_repl.src = addr;
-	}
 
-	if (src->ct_repl.dst) {
-		addr = nl_addr_clone(src->ct_repl.dst);
-		if (!addr)
-			return -NLE_NOMEM;
-		dst->ct_repl.dst = addr;
-	}
+	/* The addresses are stored inline, handles are created again */
+	dst->ct_addrs = NULL;
 
 	return 0;
 }
 
-static void dump_addr(struct nl_dump_params *p, struct nl_addr *addr, int port)
+static void dump_addr(struct nl_dump_params *p, const struct nfnl_ct *ct,
+		      const struct nl_addr_inline *addr, int port)
 {
 	char buf[64];
 
 	if (addr)
-		nl_dump(p, "%s", nl_addr2str(addr, buf, sizeof(buf)));
+		nl_dump(p, "%s", _nl_addr_inline2str(addr, ct->ct_family,
+						     buf, sizeof(buf)));
 
 	if (port)
 		nl_dump(p, ":%u ", port);
@@ -138,14 +120,21 @@ static void dump_icmp(struct nl_dump_params *p, struct nfnl_ct *ct, int reply)
 
 static void ct_dump_tuples(struct nfnl_ct *ct, struct nl_dump_params *p)
 {
-	struct nl_addr *orig_src, *orig_dst, *reply_src, *reply_dst;
+	const struct nl_addr_inline *orig_src = NULL, *orig_dst = NULL;
+	const struct nl_addr_inline *reply_src = NULL, *reply_dst = NULL;
 	int orig_sport = 0, orig_dport = 0, reply_sport = 0, reply_dport = 0;
 	int sync = 0;
 
-	orig_src = nfnl_ct_get_src(ct, 0);
-	orig_dst = nfnl_ct_get_dst(ct, 0);
-	reply_src = nfnl_ct_get_src(ct, 1);
-	reply_dst = nfnl_ct_get_dst(ct, 1);
+	/* Formatted from the inline addresses, dumping a cache does not
+	 * create address handles */
+	if (ct->ce_mask & CT_ATTR_ORIG_SRC)
+		orig_src = &ct->ct_orig.src;
+	if (ct->ce_mask & CT_ATTR_ORIG_DST)
+		orig_dst = &ct->ct_orig.dst;
+	if (ct->ce_mask & CT_ATTR_REPL_SRC)
+		reply_src = &ct->ct_repl.src;
+	if (ct->ce_mask & CT_ATTR_REPL_DST)
+		reply_dst = &ct->ct_repl.dst;
 
 	if (nfnl_ct_test_src_port(ct, 0))
 		orig_sport = nfnl_ct_get_src_port(ct, 0);
@@ -161,19 +150,19 @@ static void ct_dump_tuples(struct nfnl_ct *ct, struct nl_dump_params *p)
 
 	if (orig_src && orig_dst && reply_src && reply_dst &&
 	    orig_sport == reply_dport && orig_dport == reply_sport &&
-	    !nl_addr_cmp(orig_src, reply_dst) &&
-	    !nl_addr_cmp(orig_dst, reply_src))
+	    !_nl_addr_inline_cmp(orig_src, reply_dst) &&
+	    !_nl_addr_inline_cmp(orig_dst, reply_src))
 		sync = 1;
 
-	dump_addr(p, orig_src, orig_sport);
+	dump_addr(p, ct, orig_src, orig_sport);
 	nl_dump(p, sync ? "<-> " : "-> ");
-	dump_addr(p, orig_dst, orig_dport);
+	dump_addr(p, ct, orig_dst, orig_dport);
 	dump_icmp(p, ct, 0);
 
 	if (!sync) {
-		dump_addr(p, reply_src, reply_sport);
+		dump_addr(p, ct, reply_src, reply_sport);
 		nl_dump(p, "<- ");
-		dump_addr(p, reply_dst, reply_dport);
+		dump_addr(p, ct, reply_dst, reply_dport);
 		dump_icmp(p, ct, 1);
 	}
 }
@@ -315,8 +304,11 @@ static uint64_t ct_compare(struct nl_object *_a, struct nl_object *_b,
 #define _DIFF_VAL(ATTR, FIELD) _DIFF(ATTR, a->FIELD != b->FIELD)
 #define _DIFF_ADDR(ATTR, FIELD)                                                \
 	((flags & LOOSE_COMPARISON) ?                                          \
-		 _DIFF(ATTR, nl_addr_cmp_prefix(a->FIELD, b->FIELD)) :         \
-		 _DIFF(ATTR, nl_addr_cmp(a->FIELD, b->FIELD)))
+		 _DIFF(ATTR, a->ct_family != b->ct_family ||                   \
+				     _nl_addr_inline_cmp_prefix(&a->FIELD,     \
+								&b->FIELD)) :  \
+		 _DIFF(ATTR, a->ct_family != b->ct_family ||                   \
+				     _nl_addr_inline_cmp(&a->FIELD, &b->FIELD)))
 	diff |= _DIFF_VAL(CT_ATTR_FAMILY, ct_family);
 	diff |= _DIFF_VAL(CT_ATTR_PROTO, ct_proto);
 	diff |= _DIFF_VAL(CT_ATTR_TCP_STATE, ct_protoinfo.tcp.state);
@@ -324,6 +316,7 @@ static uint64_t ct_compare(struct nl_object *_a, struct nl_object *_b,
 	diff |= _DIFF_VAL(CT_ATTR_MARK, ct_mark);
 	diff |= _DIFF_VAL(CT_ATTR_USE, ct_use);
 	diff |= _DIFF_VAL(CT_ATTR_ID, ct_id);
+	diff |= _DIFF_VAL(CT_ATTR_ZONE, ct_zone);
 	diff |= _DIFF_ADDR(CT_ATTR_ORIG_SRC, ct_orig.src);
 	diff |= _DIFF_ADDR(CT_ATTR_ORIG_DST, ct_orig.dst);
 	diff |= _DIFF_VAL(CT_ATTR_ORIG_SRC_PORT, ct_orig.proto.port.src);
@@ -355,6 +348,52 @@ static uint64_t ct_compare(struct nl_object *_a, struct nl_object *_b,
 	return diff;
 }
 
+static uint32_t ct_keygen(struct nl_object *obj)
+{
+	struct nfnl_ct *ct = (struct nfnl_ct *) obj;
+	const struct nfnl_ct_dir *dir = &ct->ct_orig;
+	struct ct_hash_key {
+		uint8_t		ct_family;
+		uint8_t		ct_proto;
+		uint16_t	ct_zone;
+		uint16_t	sport;
+		uint16_t	dport;
+		uint16_t	icmp_id;
+		uint8_t		icmp_type;
+		uint8_t		icmp_code;
+	} _nl_packed ckey;
+	uint32_t hash;
+
+	/* Ports and ICMP share a union, only hash what is present */
+	memset(&ckey, 0, sizeof(ckey));
+	ckey.ct_family = ct->ct_family;
+	ckey.ct_proto = ct->ct_proto;
+	if (ct->ce_mask & CT_ATTR_ZONE)
+		ckey.ct_zone = ct->ct_zone;
+	if (ct->ce_mask & CT_ATTR_ORIG_SRC_PORT)
+		ckey.sport = dir->proto.port.src;
+	if (ct->ce_mask & CT_ATTR_ORIG_DST_PORT)
+		ckey.dport = dir->proto.port.dst;
+	if (ct->ce_mask & CT_ATTR_ORIG_ICMP_ID)
+		ckey.icmp_id = dir->proto.icmp.id;
+	if (ct->ce_mask & CT_ATTR_ORIG_ICMP_TYPE)
+		ckey.icmp_type = dir->proto.icmp.type;
+	if (ct->ce_mask & CT_ATTR_ORIG_ICMP_CODE)
+		ckey.icmp_code = dir->proto.icmp.code;
+
+	hash = nl_hash(&ckey, sizeof(ckey), 0);
+	if (ct->ce_mask & CT_ATTR_ORIG_SRC)
+		hash = nl_hash((void *) dir->src.ai_addr, dir->src.ai_len, hash);
+	if (ct->ce_mask & CT_ATTR_ORIG_DST)
+		hash = nl_hash((void *) dir->dst.ai_addr, dir->dst.ai_len, hash);
+
+	NL_DBG(5, "ct %p key (fam %d proto %d zone %d sport %d dport %d) hash 0x%x\n",
+	       ct, ckey.ct_family, ckey.ct_proto, ckey.ct_zone,
+	       ckey.sport, ckey.dport, hash);
+
+	return hash;
+}
+
 static const struct trans_tbl ct_attrs[] = {
 	__ADD(CT_ATTR_FAMILY,		family),
 	__ADD(CT_ATTR_PROTO,		proto),
@@ -420,6 +459,7 @@ void nfnl_ct_set_family(struct nfnl_ct *ct, uint8_t family)
 {
 	ct->ct_family = family;
 	ct->ce_mask |= CT_ATTR_FAMILY;
+	nl_object_invalidate_hash(ct);
 }
 
 uint8_t nfnl_ct_get_family(const struct nfnl_ct *ct)
@@ -434,6 +474,7 @@ void nfnl_ct_set_proto(struct nfnl_ct *ct, uint8_t proto)
 {
 	ct->ct_proto = proto;
 	ct->ce_mask |= CT_ATTR_PROTO;
+	nl_object_invalidate_hash(ct);
 }
 
 int nfnl_ct_test_proto(const struct nfnl_ct *ct)
@@ -602,6 +643,7 @@ void nfnl_ct_set_zone(struct nfnl_ct *ct, uint16_t zone)
 {
 	ct->ct_zone = zone;
 	ct->ce_mask |= CT_ATTR_ZONE;
+	nl_object_invalidate_hash(ct);
 }
 
 int nfnl_ct_test_zone(const struct nfnl_ct *ct)
@@ -614,55 +656,154 @@ uint16_t nfnl_ct_get_zone(const struct nfnl_ct *ct)
 	return ct->ct_zone;
 }
 
-static int ct_set_addr(struct nfnl_ct *ct, struct nl_addr *addr,
-		int attr, struct nl_addr ** ct_addr)
+static int ct_set_addr(struct nfnl_ct *ct, int family, const void *buf,
+		       unsigned int len, int prefixlen, int attr, int idx,
+		       struct nl_addr_inline *ct_addr)
 {
-	if (ct->ce_mask & CT_ATTR_FAMILY) {
-		if (addr->a_family != ct->ct_family)
-			return -NLE_AF_MISMATCH;
-	} else
-		nfnl_ct_set_family(ct, addr->a_family);
+	int err;
+
+	if ((ct->ce_mask & CT_ATTR_FAMILY) && family != ct->ct_family)
+		return -NLE_AF_MISMATCH;
 
-	if (*ct_addr)
-		nl_addr_put(*ct_addr);
+	if ((err = _nl_addr_inline_set(ct_addr, buf, len, prefixlen)) < 0)
+		return err;
+
+	if (!(ct->ce_mask & CT_ATTR_FAMILY))
+		nfnl_ct_set_family(ct, family);
+
+	if (ct->ct_addrs && ct->ct_addrs[idx]) {
+		nl_addr_put(ct->ct_addrs[idx]);
+		ct->ct_addrs[idx] = NULL;
+	}
 
-	nl_addr_get(addr);
-	*ct_addr = addr;
 	ct->ce_mask |= attr;
+	nl_object_invalidate_hash(ct);
 
 	return 0;
 }
 
+/*
+ * The handle stays valid as long as the object and is shared by all
+ * callers. Objects in a cache may be looked up concurrently, the handles
+ * are published atomically.
+ */
+static struct nl_addr *ct_get_addr(const struct nfnl_ct *ct, int idx,
+				   const struct nl_addr_inline *ct_addr)
+{
+	struct nl_addr ***addrsp = &((struct nfnl_ct *) ct)->ct_addrs;
+	struct nl_addr **addrs, **expected = NULL;
+	struct nl_addr *addr, *expected_addr = NULL;
+
+	addrs = __atomic_load_n(addrsp, __ATOMIC_ACQUIRE);
+	if (!addrs) {
+		addrs = calloc(CT_ADDR_MAX, sizeof(*addrs));
+		if (!addrs)
+			return NULL;
+
+		if (!__atomic_compare_exchange_n(addrsp, &expected, addrs, 0,
+						 __ATOMIC_ACQ_REL,
+						 __ATOMIC_ACQUIRE)) {
+			free(addrs);
+			addrs = expected;
+		}
+	}
+
+	addr = __atomic_load_n(&addrs[idx], __ATOMIC_ACQUIRE);
+	if (addr)
+		return addr;
+
+	addr = _nl_addr_inline_alloc(ct_addr, ct->ct_family);
+	if (!addr)
+		return NULL;
+
+	if (!__atomic_compare_exchange_n(&addrs[idx], &expected_addr, addr, 0,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		nl_addr_put(addr);
+		addr = expected_addr;
+	}
+
+	return addr;
+}
+
+/* Addresses are copied into the object, up to 16 bytes */
 int nfnl_ct_set_src(struct nfnl_ct *ct, int repl, struct nl_addr *addr)
 {
 	struct nfnl_ct_dir *dir = repl ? &ct->ct_repl : &ct->ct_orig;
 	int attr = repl ? CT_ATTR_REPL_SRC : CT_ATTR_ORIG_SRC;
-	return ct_set_addr(ct, addr, attr, &dir->src);
+
+	return ct_set_addr(ct, addr->a_family, addr->a_addr, addr->a_len,
+			   addr->a_prefixlen, attr, CT_ADDR_IDX(repl, 0),
+			   &dir->src);
 }
 
 int nfnl_ct_set_dst(struct nfnl_ct *ct, int repl, struct nl_addr *addr)
 {
 	struct nfnl_ct_dir *dir = repl ? &ct->ct_repl : &ct->ct_orig;
 	int attr = repl ? CT_ATTR_REPL_DST : CT_ATTR_ORIG_DST;
-	return ct_set_addr(ct, addr, attr, &dir->dst);
+
+	return ct_set_addr(ct, addr->a_family, addr->a_addr, addr->a_len,
+			   addr->a_prefixlen, attr, CT_ADDR_IDX(repl, 1),
+			   &dir->dst);
 }
 
-struct nl_addr *nfnl_ct_get_src(const struct nfnl_ct *ct, int repl)
+/** @cond SKIP */
+int _nfnl_ct_set_src(struct nfnl_ct *ct, int repl, int family,
+		     const void *buf, unsigned int len)
 {
-	const struct nfnl_ct_dir *dir = repl ? &ct->ct_repl : &ct->ct_orig;
+	struct nfnl_ct_dir *dir = repl ? &ct->ct_repl : &ct->ct_orig;
 	int attr = repl ? CT_ATTR_REPL_SRC : CT_ATTR_ORIG_SRC;
+
+	return ct_set_addr(ct, family, buf, len, 8 * len, attr,
+			   CT_ADDR_IDX(repl, 0), &dir->src);
+}
+
+int _nfnl_ct_set_dst(struct nfnl_ct *ct, int repl, int family,
+		     const void *buf, unsigned int len)
+{
+	struct nfnl_ct_dir *dir = repl ? &ct->ct_repl : &ct->ct_orig;
+	int attr = repl ? CT_ATTR_REPL_DST : CT_ATTR_ORIG_DST;
+
+	return ct_set_addr(ct, family, buf, len, 8 * len, attr,
+			   CT_ADDR_IDX(repl, 1), &dir->dst);
+}
+
+const struct nl_addr_inline *_nfnl_ct_get_src(const struct nfnl_ct *ct,
+					      int repl)
+{
+	int attr = repl ? CT_ATTR_REPL_SRC : CT_ATTR_ORIG_SRC;
+
 	if (!(ct->ce_mask & attr))
 		return NULL;
-	return dir->src;
+	return repl ? &ct->ct_repl.src : &ct->ct_orig.src;
 }
 
-struct nl_addr *nfnl_ct_get_dst(const struct nfnl_ct *ct, int repl)
+const struct nl_addr_inline *_nfnl_ct_get_dst(const struct nfnl_ct *ct,
+					      int repl)
 {
-	const struct nfnl_ct_dir *dir = repl ? &ct->ct_repl : &ct->ct_orig;
 	int attr = repl ? CT_ATTR_REPL_DST : CT_ATTR_ORIG_DST;
+
 	if (!(ct->ce_mask & attr))
 		return NULL;
-	return dir->dst;
+	return repl ? &ct->ct_repl.dst : &ct->ct_orig.dst;
+}
+/** @endcond */
+
+struct nl_addr *nfnl_ct_get_src(const struct nfnl_ct *ct, int repl)
+{
+	const struct nl_addr_inline *addr = _nfnl_ct_get_src(ct, repl);
+
+	if (!addr)
+		return NULL;
+	return ct_get_addr(ct, CT_ADDR_IDX(repl, 0), addr);
+}
+
+struct nl_addr *nfnl_ct_get_dst(const struct nfnl_ct *ct, int repl)
+{
+	const struct nl_addr_inline *addr = _nfnl_ct_get_dst(ct, repl);
+
+	if (!addr)
+		return NULL;
+	return ct_get_addr(ct, CT_ADDR_IDX(repl, 1), addr);
 }
 
 void nfnl_ct_set_src_port(struct nfnl_ct *ct, int repl, uint16_t port)
@@ -672,6 +813,7 @@ void nfnl_ct_set_src_port(struct nfnl_ct *ct, int repl, uint16_t port)
 
 	dir->proto.port.src = port;
 	ct->ce_mask |= attr;
+	nl_object_invalidate_hash(ct);
 }
 
 int nfnl_ct_test_src_port(const struct nfnl_ct *ct, int repl)
@@ -694,6 +836,7 @@ void nfnl_ct_set_dst_port(struct nfnl_ct *ct, int repl, uint16_t port)
 
 	dir->proto.port.dst = port;
 	ct->ce_mask |= attr;
+	nl_object_invalidate_hash(ct);
 }
 
 int nfnl_ct_test_dst_port(const struct nfnl_ct *ct, int repl)
@@ -716,6 +859,7 @@ void nfnl_ct_set_icmp_id(struct nfnl_ct *ct, int repl, uint16_t id)
 
 	dir->proto.icmp.id = id;
 	ct->ce_mask |= attr;
+	nl_object_invalidate_hash(ct);
 }
 
 int nfnl_ct_test_icmp_id(const struct nfnl_ct *ct, int repl)
@@ -738,6 +882,7 @@ void nfnl_ct_set_icmp_type(struct nfnl_ct *ct, int repl, uint8_t type)
 
 	dir->proto.icmp.type = type;
 	ct->ce_mask |= attr;
+	nl_object_invalidate_hash(ct);
 }
 
 int nfnl_ct_test_icmp_type(const struct nfnl_ct *ct, int repl)
@@ -760,6 +905,7 @@ void nfnl_ct_set_icmp_code(struct nfnl_ct *ct, int repl, uint8_t code)
 
 	dir->proto.icmp.code = code;
 	ct->ce_mask |= attr;
+	nl_object_invalidate_hash(ct);
 }
 
 int nfnl_ct_test_icmp_code(const struct nfnl_ct *ct, int repl)
@@ -849,7 +995,10 @@ struct nl_object_ops ct_obj_ops = {
 	    [NL_DUMP_STATS]	= ct_dump_stats,
 	},
 	.oo_compare		= ct_compare,
+	.oo_keygen		= ct_keygen,
 	.oo_attrs2str		= ct_attrs2str,
+	.oo_id_attrs		= (CT_ATTR_FAMILY | CT_ATTR_PROTO | CT_ATTR_ZONE |
+				   CT_ATTR_ORIG_TUPLE),
 };
 
 /** @} */
@@ -17,10 +17,12 @@
 
 #include <netlink/netfilter/nfnl.h>
 #include <netlink/netfilter/exp.h>
+#include <netlink/hashtable.h>
 
 #include "nl-priv-dynamic-core/object-api.h"
 #include "nl-netfilter.h"
 #include "nl-priv-dynamic-core/nl-core.h"
+#include "nl-aux-core/nl-core.h"
 
 // The 32-bit attribute mask in the common object header isn't
 // big enough to handle all attributes of an expectation.  So
@@ -59,6 +61,12 @@
 #define EXP_ATTR_NAT_L4PROTO_PORTS	(1UL << 26)
 #define EXP_ATTR_NAT_L4PROTO_ICMP	(1UL << 27)
 #define EXP_ATTR_NAT_DIR		(1UL << 28)
+
+/* An expectation is identified by its expected tuple */
+#define EXP_ATTR_EXPECT_TUPLE	(EXP_ATTR_EXPECT_IP_SRC | EXP_ATTR_EXPECT_IP_DST | \
+				 EXP_ATTR_EXPECT_L4PROTO_NUM |			\
+				 EXP_ATTR_EXPECT_L4PROTO_PORTS |		\
+				 EXP_ATTR_EXPECT_L4PROTO_ICMP)
 /** @endcond */
 
 static void exp_free_data(struct nl_object *c)
@@ -308,6 +316,43 @@ static int exp_cmp_l4proto_icmp (union nfnl_exp_protodata *a, union nfnl_exp_pro
 	return d;
 }
 
+static uint32_t exp_keygen(struct nl_object *obj)
+{
+	struct nfnl_exp *exp = (struct nfnl_exp *) obj;
+	const struct nfnl_exp_dir *dir = &exp->exp_expect;
+	struct exp_hash_key {
+		uint8_t		exp_family;
+		uint8_t		l4protonum;
+		uint16_t	exp_zone;
+		union nfnl_exp_protodata l4protodata;
+	} _nl_packed ekey;
+	uint32_t hash;
+
+	memset(&ekey, 0, sizeof(ekey));
+	ekey.exp_family = exp->exp_family;
+	if (exp->ce_mask & EXP_ATTR_ZONE)
+		ekey.exp_zone = exp->exp_zone;
+	if (exp->ce_mask & EXP_ATTR_EXPECT_L4PROTO_NUM)
+		ekey.l4protonum = dir->proto.l4protonum;
+	/* Ports and ICMP share the union and are always set as a whole */
+	if (exp->ce_mask & (EXP_ATTR_EXPECT_L4PROTO_PORTS |
+			    EXP_ATTR_EXPECT_L4PROTO_ICMP))
+		ekey.l4protodata = dir->proto.l4protodata;
+
+	hash = nl_hash(&ekey, sizeof(ekey), 0);
+	if (exp->ce_mask & EXP_ATTR_EXPECT_IP_SRC)
+		hash = nl_hash(nl_addr_get_binary_addr(dir->src),
+			       nl_addr_get_len(dir->src), hash);
+	if (exp->ce_mask & EXP_ATTR_EXPECT_IP_DST)
+		hash = nl_hash(nl_addr_get_binary_addr(dir->dst),
+			       nl_addr_get_len(dir->dst), hash);
+
+	NL_DBG(5, "exp %p key (fam %d proto %d zone %d) hash 0x%x\n",
+	       exp, ekey.exp_family, ekey.l4protonum, ekey.exp_zone, hash);
+
+	return hash;
+}
+
 static uint64_t exp_compare(struct nl_object *_a, struct nl_object *_b,
 			    uint64_t attrs, int flags)
 {
@@ -449,6 +494,7 @@ void nfnl_exp_set_family(struct nfnl_exp *exp, uint8_t family)
 {
 	exp->exp_family = family;
 	exp->ce_mask |= EXP_ATTR_FAMILY;
+	nl_object_invalidate_hash(exp);
 }
 
 uint8_t nfnl_exp_get_family(const struct nfnl_exp *exp)
@@ -555,6 +601,7 @@ void nfnl_exp_set_zone(struct nfnl_exp *exp, uint16_t zone)
 {
 	exp->exp_zone = zone;
 	exp->ce_mask |= EXP_ATTR_ZONE;
+	nl_object_invalidate_hash(exp);
 }
 
 int nfnl_exp_test_zone(const struct nfnl_exp *exp)
@@ -688,6 +735,7 @@ static int exp_set_addr(struct nfnl_exp *exp, struct nl_addr *addr,
 	nl_addr_get(addr);
 	*exp_addr = addr;
 	exp->ce_mask |= attr;
+	nl_object_invalidate_hash(exp);
 
 	return 0;
 }
@@ -762,6 +810,7 @@ void nfnl_exp_set_l4protonum(struct nfnl_exp *exp, int tuple, uint8_t l4protonum
 
 	dir->proto.l4protonum = l4protonum;
 	exp->ce_mask |= exp_get_l4protonum_attr(tuple);
+	nl_object_invalidate_hash(exp);
 }
 
 int nfnl_exp_test_l4protonum(const struct nfnl_exp *exp, int tuple)
@@ -805,6 +854,7 @@ void nfnl_exp_set_ports(struct nfnl_exp *exp, int tuple, uint16_t srcport, uint1
 	dir->proto.l4protodata.port.dst = dstport;
 
 	exp->ce_mask |= exp_get_l4ports_attr(tuple);
+	nl_object_invalidate_hash(exp);
 }
 
 int nfnl_exp_test_ports(const struct nfnl_exp *exp, int tuple)
@@ -856,6 +906,7 @@ void nfnl_exp_set_icmp(struct nfnl_exp *exp, int tuple, uint16_t id, uint8_t typ
 	dir->proto.l4protodata.icmp.code = code;
 
 	exp->ce_mask |= exp_get_l4icmp_attr(tuple);
+	nl_object_invalidate_hash(exp);
 }
 
 int nfnl_exp_test_icmp(const struct nfnl_exp *exp, int tuple)
@@ -897,7 +948,10 @@ struct nl_object_ops exp_obj_ops = {
 		[NL_DUMP_DETAILS]	= exp_dump_details,
 	},
 	.oo_compare	= exp_compare,
+	.oo_keygen	= exp_keygen,
 	.oo_attrs2str	= exp_attrs2str,
+	.oo_id_attrs	= (EXP_ATTR_FAMILY | EXP_ATTR_ZONE |
+			   EXP_ATTR_EXPECT_TUPLE),
 };
 
 /** @} */
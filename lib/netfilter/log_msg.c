@@ -24,6 +24,7 @@
 #include <netlink/netfilter/log_msg.h>
 
 #include "nl-netfilter.h"
+#include "nl-priv-dynamic-core/nl-core.h"
 #include "nl-priv-dynamic-core/cache-api.h"
 
 static struct nla_policy log_msg_policy[NFULA_MAX+1] = {
@@ -82,23 +83,19 @@ nfnlmsg_log_msg_parse_vlan(struct nlattr *attr_full, struct nfnl_log_msg *msg)
 	return 0;
 }
 
-int nfnlmsg_log_msg_parse(struct nlmsghdr *nlh, struct nfnl_log_msg **result)
+static int log_msg_fill(struct nfnl_log_msg *msg, struct nlmsghdr *nlh,
+			struct nl_msg *ref)
 {
-	struct nfnl_log_msg *msg;
 	struct nlattr *tb[NFULA_MAX+1];
 	struct nlattr *attr;
 	int err;
 
-	msg = nfnl_log_msg_alloc();
-	if (!msg)
-		return -NLE_NOMEM;
-
 	msg->ce_msgtype = nlh->nlmsg_type;
 
 	err = nlmsg_parse(nlh, sizeof(struct nfgenmsg), tb, NFULA_MAX,
 			  log_msg_policy);
 	if (err < 0)
-		goto errout;
+		return err;
 
 	nfnl_log_msg_set_family(msg, nfnlmsg_family(nlh));
 
@@ -149,18 +146,20 @@ int nfnlmsg_log_msg_parse(struct nlmsghdr *nlh, struct nfnl_log_msg **result)
 	}
 
 	attr = tb[NFULA_PAYLOAD];
-	if (attr) {
+	if (attr && ref)
+		_nfnl_log_msg_ref_payload(msg, ref, nla_data(attr),
+					  nla_len(attr));
+	else if (attr) {
 		err = nfnl_log_msg_set_payload(msg, nla_data(attr), nla_len(attr));
 		if (err < 0)
-			goto errout;
+			return err;
 	}
 
-	attr = tb[NFULA_PREFIX];
-	if (attr) {
-		err = nfnl_log_msg_set_prefix(msg, nla_data(attr));
-		if (err < 0)
-			goto errout;
-	}
+	/* Clears the prefix left by a previous message */
+	err = nfnl_log_msg_set_prefix(msg, tb[NFULA_PREFIX] ?
+				      nla_data(tb[NFULA_PREFIX]) : NULL);
+	if (err < 0)
+		return err;
 
 	attr = tb[NFULA_UID];
 	if (attr)
@@ -189,12 +188,14 @@ int nfnlmsg_log_msg_parse(struct nlmsghdr *nlh, struct nfnl_log_msg **result)
 	attr = tb[NFULA_HWHEADER];
 	if (attr)
 		nfnl_log_msg_set_hwheader(msg, nla_data(attr), nla_len(attr));
+	else
+		nfnl_log_msg_set_hwheader(msg, NULL, 0);
 
 	attr = tb[NFULA_VLAN];
 	if (attr) {
 		err = nfnlmsg_log_msg_parse_vlan(attr, msg);
 		if (err < 0)
-			goto errout;
+			return err;
 	}
 
 	attr = tb[NFULA_CT];
@@ -202,7 +203,7 @@ int nfnlmsg_log_msg_parse(struct nlmsghdr *nlh, struct nfnl_log_msg **result)
 		struct nfnl_ct *ct = NULL;
 		err = nfnlmsg_ct_parse_nested(attr, &ct);
 		if (err < 0)
-			goto errout;
+			return err;
 		nfnl_log_msg_set_ct(msg, ct);
 		nfnl_ct_put(ct);
 	}
@@ -211,12 +212,50 @@ int nfnlmsg_log_msg_parse(struct nlmsghdr *nlh, struct nfnl_log_msg **result)
 	if (attr)
 		nfnl_log_msg_set_ct_info(msg, ntohl(nla_get_u32(attr)));
 
+	return 0;
+}
+
+static int __nfnlmsg_log_msg_parse(struct nlmsghdr *nlh, struct nl_msg *ref,
+				   struct nfnl_log_msg **result)
+{
+	struct nfnl_log_msg *msg;
+	int err;
+
+	msg = nfnl_log_msg_alloc();
+	if (!msg)
+		return -NLE_NOMEM;
+
+	err = log_msg_fill(msg, nlh, ref);
+	if (err < 0) {
+		nfnl_log_msg_put(msg);
+		return err;
+	}
+
 	*result = msg;
 	return 0;
+}
 
-errout:
-	nfnl_log_msg_put(msg);
-	return err;
+int nfnlmsg_log_msg_parse(struct nlmsghdr *nlh, struct nfnl_log_msg **result)
+{
+	return __nfnlmsg_log_msg_parse(nlh, NULL, result);
+}
+
+/**
+ * Parse a log message without copying the payload
+ * @arg msg		Netlink message
+ * @arg result		Where to store the log message object
+ *
+ * The payload of the log message object points into \c msg, the object
+ * holds a reference on \c msg for as long as it refers to the payload.
+ * Combined with nl_socket_enable_msg_zerocopy() the payload is never
+ * copied after it has been received.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nfnlmsg_log_msg_parse_zerocopy(struct nl_msg *msg,
+				   struct nfnl_log_msg **result)
+{
+	return __nfnlmsg_log_msg_parse(nlmsg_hdr(msg), msg, result);
 }
 
 static int log_msg_parser(struct nl_cache_ops *ops, struct sockaddr_nl *who,
@@ -225,7 +264,12 @@ static int log_msg_parser(struct nl_cache_ops *ops, struct sockaddr_nl *who,
 	struct nfnl_log_msg *msg;
 	int err;
 
-	if ((err = nfnlmsg_log_msg_parse(nlh, &msg)) < 0)
+	/* Messages delivered without copying stay without copying */
+	if (pp->pp_msg && (pp->pp_msg->nm_flags & NL_MSG_BORROWED))
+		err = nfnlmsg_log_msg_parse_zerocopy(pp->pp_msg, &msg);
+	else
+		err = nfnlmsg_log_msg_parse(nlh, &msg);
+	if (err < 0)
 		return err;
 
 	err = pp->pp_cb((struct nl_object *) msg, pp);
@@ -233,6 +277,245 @@ static int log_msg_parser(struct nl_cache_ops *ops, struct sockaddr_nl *who,
 	return err;
 }
 
+/**
+ * @name Collector
+ *
+ * A collector receives log messages at a high rate. Every message of a
+ * datagram is parsed into the same log message object, which is handed
+ * to a callback and reused for the next message unless the callback took
+ * a reference. The netlink message wrapping a log message is reused by
+ * the socket as well, no memory is allocated per message. Enable
+ * NFNL_LOG_FLAG_SEQ on the log instances to account for messages the
+ * kernel failed to deliver.
+ *
+ * @code
+ * static void handle_msg(struct nfnl_log_msg *msg, void *arg)
+ * {
+ *	...
+ * }
+ *
+ * lc = nfnl_log_collector_alloc(sk, handle_msg, NULL);
+ * while (nfnl_log_collector_recv(lc) >= 0)
+ *	;
+ * @endcode
+ * @{
+ */
+
+/** @cond SKIP */
+struct log_collector_seq {
+	uint16_t			ls_group;
+	uint32_t			ls_seq;
+};
+
+struct nfnl_log_collector {
+	struct nl_sock *		lc_sk;
+	struct nl_cb *			lc_cb;
+	nfnl_log_collector_func_t	lc_func;
+	void *				lc_arg;
+	struct nfnl_log_msg *		lc_msg;
+	struct log_collector_seq *	lc_seqs;
+	unsigned int			lc_nseqs;
+	int				lc_have_seq_global;
+	uint32_t			lc_seq_global;
+	uint64_t			lc_received;
+	uint64_t			lc_lost;
+	uint64_t			lc_lost_global;
+};
+
+static uint32_t log_collector_gap(uint32_t last, uint32_t seq)
+{
+	/* Sequence numbers going backwards are a restarted instance */
+	return (int32_t) (seq - last) > 1 ? seq - last - 1 : 0;
+}
+
+static void log_collector_track(struct nfnl_log_collector *lc,
+				struct nlmsghdr *nlh, struct nfnl_log_msg *msg)
+{
+	struct log_collector_seq *ls;
+	uint16_t group;
+	unsigned int i;
+
+	if (nfnl_log_msg_test_seq(msg)) {
+		group = nfnlmsg_res_id(nlh);
+
+		for (i = 0; i < lc->lc_nseqs; i++)
+			if (lc->lc_seqs[i].ls_group == group)
+				break;
+
+		if (i < lc->lc_nseqs) {
+			ls = &lc->lc_seqs[i];
+			lc->lc_lost += log_collector_gap(ls->ls_seq,
+							 msg->log_msg_seq);
+			ls->ls_seq = msg->log_msg_seq;
+		} else if ((ls = realloc(lc->lc_seqs,
+					 (i + 1) * sizeof(*ls)))) {
+			lc->lc_seqs = ls;
+			lc->lc_nseqs++;
+			ls[i].ls_group = group;
+			ls[i].ls_seq = msg->log_msg_seq;
+		}
+	}
+
+	if (nfnl_log_msg_test_seq_global(msg)) {
+		if (lc->lc_have_seq_global)
+			lc->lc_lost_global +=
+				log_collector_gap(lc->lc_seq_global,
+						  msg->log_msg_seq_global);
+		lc->lc_seq_global = msg->log_msg_seq_global;
+		lc->lc_have_seq_global = 1;
+	}
+}
+
+static int log_collector_input(struct nl_msg *nlmsg, void *arg)
+{
+	struct nfnl_log_collector *lc = arg;
+	struct nlmsghdr *nlh = nlmsg_hdr(nlmsg);
+	struct nfnl_log_msg *msg;
+
+	if (nfnlmsg_subsys(nlh) != NFNL_SUBSYS_ULOG ||
+	    nfnlmsg_subtype(nlh) != NFULNL_MSG_PACKET)
+		return NL_SKIP;
+
+	if (!lc->lc_msg && !(lc->lc_msg = nfnl_log_msg_alloc()))
+		return -NLE_NOMEM;
+
+	msg = lc->lc_msg;
+	if (log_msg_fill(msg, nlh, nlmsg) < 0) {
+		_nfnl_log_msg_reset(msg);
+		return NL_SKIP;
+	}
+
+	lc->lc_received++;
+	log_collector_track(lc, nlh, msg);
+
+	lc->lc_func(msg, lc->lc_arg);
+
+	/* Release the receive buffer right away, unless the object is
+	 * still in use by the callback */
+	if (nl_object_shared((struct nl_object *) msg)) {
+		nfnl_log_msg_put(msg);
+		lc->lc_msg = NULL;
+	} else
+		_nfnl_log_msg_reset(msg);
+
+	return NL_OK;
+}
+
+static int log_collector_seq_check(struct nl_msg *msg, void *arg)
+{
+	return NL_OK;
+}
+/** @endcond */
+
+/**
+ * Allocate a log message collector
+ * @arg sk		Netfilter netlink socket
+ * @arg func		Function called for every log message
+ * @arg arg		Argument passed to \c func
+ *
+ * Enables zero-copy message delivery on \c sk, the payload of the log
+ * messages refers to the receive buffer. The log message passed to
+ * \c func is only valid during the call unless \c func takes a reference
+ * with nfnl_log_msg_get().
+ *
+ * @return Newly allocated collector or NULL.
+ */
+struct nfnl_log_collector *nfnl_log_collector_alloc(struct nl_sock *sk,
+						    nfnl_log_collector_func_t func,
+						    void *arg)
+{
+	struct nfnl_log_collector *lc;
+
+	lc = calloc(1, sizeof(*lc));
+	if (!lc)
+		return NULL;
+
+	lc->lc_cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!lc->lc_cb) {
+		free(lc);
+		return NULL;
+	}
+
+	nl_cb_set(lc->lc_cb, NL_CB_VALID, NL_CB_CUSTOM, log_collector_input, lc);
+	nl_cb_set(lc->lc_cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM,
+		  log_collector_seq_check, NULL);
+	nl_socket_enable_msg_zerocopy(sk);
+
+	lc->lc_sk = sk;
+	lc->lc_func = func;
+	lc->lc_arg = arg;
+
+	return lc;
+}
+
+/**
+ * Free a log message collector
+ * @arg lc		Collector
+ */
+void nfnl_log_collector_free(struct nfnl_log_collector *lc)
+{
+	if (!lc)
+		return;
+
+	if (lc->lc_msg)
+		nfnl_log_msg_put(lc->lc_msg);
+	nl_cb_put(lc->lc_cb);
+	free(lc->lc_seqs);
+	free(lc);
+}
+
+/**
+ * Receive log messages
+ * @arg lc		Collector
+ *
+ * Receives as nl_recvmsgs() does and calls the function of the collector
+ * for every log message received.
+ *
+ * @return Number of messages received or a negative error code.
+ */
+int nfnl_log_collector_recv(struct nfnl_log_collector *lc)
+{
+	return nl_recvmsgs_report(lc->lc_sk, lc->lc_cb);
+}
+
+/**
+ * Number of log messages received by a collector
+ * @arg lc		Collector
+ */
+uint64_t nfnl_log_collector_get_received(const struct nfnl_log_collector *lc)
+{
+	return lc->lc_received;
+}
+
+/**
+ * Number of log messages lost before reaching a collector
+ * @arg lc		Collector
+ *
+ * Derived from gaps in the sequence numbers of the log instances, see
+ * NFNL_LOG_FLAG_SEQ. Messages get lost when the receive buffer of the
+ * socket overruns or the kernel fails to allocate them.
+ */
+uint64_t nfnl_log_collector_get_lost(const struct nfnl_log_collector *lc)
+{
+	return lc->lc_lost;
+}
+
+/**
+ * Number of log messages lost according to the global sequence number
+ * @arg lc		Collector
+ *
+ * Derived from gaps in the global sequence number, see
+ * NFNL_LOG_FLAG_SEQ_GLOBAL. It is shared by all log instances with the
+ * flag, the count is only meaningful if the collector receives all of
+ * them.
+ */
+uint64_t nfnl_log_collector_get_lost_global(const struct nfnl_log_collector *lc)
+{
+	return lc->lc_lost_global;
+}
+
+/** @} */
+
 /** @} */
 
 #define NFNLMSG_LOG_TYPE(type) NFNLMSG_TYPE(NFNL_SUBSYS_ULOG, (type))
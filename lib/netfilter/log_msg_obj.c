@@ -42,6 +42,17 @@
 #define LOG_MSG_ATTR_CT			(1UL << 22)
 /** @endcond */
 
+static void log_msg_release_payload(struct nfnl_log_msg *msg)
+{
+	if (msg->log_msg_payload_msg)
+		nlmsg_free(msg->log_msg_payload_msg);
+	else
+		free(msg->log_msg_payload);
+
+	msg->log_msg_payload_msg = NULL;
+	msg->log_msg_payload = NULL;
+}
+
 static void log_msg_free_data(struct nl_object *c)
 {
 	struct nfnl_log_msg *msg = (struct nfnl_log_msg *) c;
@@ -49,7 +60,7 @@ static void log_msg_free_data(struct nl_object *c)
 	if (msg == NULL)
 		return;
 
-	free(msg->log_msg_payload);
+	log_msg_release_payload(msg);
 	free(msg->log_msg_prefix);
 	free(msg->log_msg_hwheader);
 	if (msg->log_msg_ct)
@@ -64,12 +75,19 @@ static int log_msg_clone(struct nl_object *_dst, struct nl_object *_src)
 
 	dst->log_msg_payload = NULL;
 	dst->log_msg_payload_len = 0;
+	dst->log_msg_payload_msg = NULL;
 	dst->log_msg_prefix = NULL;
 	dst->log_msg_hwheader = NULL;
 	dst->log_msg_hwheader_len = 0;
 	dst->log_msg_ct = NULL;
 
-	if (src->log_msg_payload) {
+	/* A payload in a message is never modified, it can be shared */
+	if (src->log_msg_payload_msg) {
+		nlmsg_get(src->log_msg_payload_msg);
+		dst->log_msg_payload_msg = src->log_msg_payload_msg;
+		dst->log_msg_payload = src->log_msg_payload;
+		dst->log_msg_payload_len = src->log_msg_payload_len;
+	} else if (src->log_msg_payload) {
 		err = nfnl_log_msg_set_payload(dst, src->log_msg_payload,
 		                               src->log_msg_payload_len);
 		if (err < 0)
@@ -408,7 +426,7 @@ int nfnl_log_msg_set_payload(struct nfnl_log_msg *msg, uint8_t *payload, int len
 	if (!p && len > 0)
 		return -NLE_NOMEM;
 
-	free(msg->log_msg_payload);
+	log_msg_release_payload(msg);
 	msg->log_msg_payload = p;
 	msg->log_msg_payload_len = len;
 	if (len > 0)
@@ -418,6 +436,37 @@ int nfnl_log_msg_set_payload(struct nfnl_log_msg *msg, uint8_t *payload, int len
 	return 0;
 }
 
+/** @cond SKIP */
+void _nfnl_log_msg_ref_payload(struct nfnl_log_msg *msg, struct nl_msg *nlmsg,
+			       void *payload, int len)
+{
+	nlmsg_get(nlmsg);
+	log_msg_release_payload(msg);
+	msg->log_msg_payload_msg = nlmsg;
+	msg->log_msg_payload = payload;
+	msg->log_msg_payload_len = len;
+	if (len > 0)
+		msg->ce_mask |= LOG_MSG_ATTR_PAYLOAD;
+	else
+		msg->ce_mask &= ~LOG_MSG_ATTR_PAYLOAD;
+}
+
+void _nfnl_log_msg_reset(struct nfnl_log_msg *msg)
+{
+	log_msg_release_payload(msg);
+	msg->log_msg_payload_len = 0;
+
+	if (msg->log_msg_ct) {
+		nfnl_ct_put(msg->log_msg_ct);
+		msg->log_msg_ct = NULL;
+	}
+
+	/* Prefix and hardware header are kept for the next message, their
+	 * setters reuse them */
+	msg->ce_mask = 0;
+}
+/** @endcond */
+
 const void *nfnl_log_msg_get_payload(const struct nfnl_log_msg *msg, int *len)
 {
 	if (!(msg->ce_mask & LOG_MSG_ATTR_PAYLOAD)) {
@@ -433,6 +482,13 @@ int nfnl_log_msg_set_prefix(struct nfnl_log_msg *msg, void *prefix)
 {
 	char *p = NULL;
 
+	/* Messages of a rule carry the same prefix */
+	if (prefix && msg->log_msg_prefix &&
+	    !strcmp(prefix, msg->log_msg_prefix)) {
+		msg->ce_mask |= LOG_MSG_ATTR_PREFIX;
+		return 0;
+	}
+
 	if (prefix) {
 		p = strdup(prefix);
 		if (!p)
@@ -558,6 +614,12 @@ int nfnl_log_msg_set_hwheader(struct nfnl_log_msg *msg, void *data, int len)
 	if (len < 0)
 		return -NLE_INVAL;
 
+	if (len > 0 && len == msg->log_msg_hwheader_len) {
+		memmove(msg->log_msg_hwheader, data, len);
+		msg->ce_mask |= LOG_MSG_ATTR_HWHEADER;
+		return 0;
+	}
+
 	p = _nl_memdup(data, len);
 	if (!p && len > 0)
 		return -NLE_NOMEM;
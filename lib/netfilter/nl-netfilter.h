@@ -10,6 +10,7 @@
 #include <netlink/netfilter/ct.h>
 
 #include "nl-priv-dynamic-core/object-api.h"
+#include "nl-priv-dynamic-core/nl-core.h"
 
 union nfnl_ct_proto {
 	struct {
@@ -24,8 +25,8 @@ union nfnl_ct_proto {
 };
 
 struct nfnl_ct_dir {
-	struct nl_addr *src;
-	struct nl_addr *dst;
+	struct nl_addr_inline src;
+	struct nl_addr_inline dst;
 	union nfnl_ct_proto proto;
 	uint64_t packets;
 	uint64_t bytes;
@@ -56,6 +57,10 @@ struct nfnl_ct {
 	struct nfnl_ct_dir ct_repl;
 
 	struct nfnl_ct_timestamp ct_tstamp;
+
+	/* Handles returned by nfnl_ct_get_src() and nfnl_ct_get_dst(),
+	 * created on demand */
+	struct nl_addr **ct_addrs;
 };
 
 union nfnl_exp_protodata {
@@ -117,6 +122,7 @@ struct nfnl_log_msg {
 	int log_msg_hwaddr_len;
 	void *log_msg_payload;
 	int log_msg_payload_len;
+	struct nl_msg *log_msg_payload_msg;
 	char *log_msg_prefix;
 	uint32_t log_msg_uid;
 	uint32_t log_msg_gid;
@@ -150,7 +156,42 @@ struct nfnl_queue_msg {
 	int queue_msg_hwaddr_len;
 	void *queue_msg_payload;
 	int queue_msg_payload_len;
+	struct nl_msg *queue_msg_payload_msg;
 	uint32_t queue_msg_verdict;
 };
 
+/*
+ * Let the payload point into a netlink message instead of a copy. The
+ * object holds a reference on the message until the payload is replaced
+ * or the object is freed.
+ */
+void _nfnl_log_msg_ref_payload(struct nfnl_log_msg *msg, struct nl_msg *nlmsg,
+			       void *payload, int len);
+void _nfnl_queue_msg_ref_payload(struct nfnl_queue_msg *msg,
+				 struct nl_msg *nlmsg, void *payload, int len);
+
+/*
+ * Set an address of a conntrack entry from its binary form, without
+ * allocating a struct nl_addr.
+ */
+int _nfnl_ct_set_src(struct nfnl_ct *ct, int repl, int family,
+		     const void *buf, unsigned int len);
+int _nfnl_ct_set_dst(struct nfnl_ct *ct, int repl, int family,
+		     const void *buf, unsigned int len);
+
+/*
+ * Address of a conntrack entry in its binary form or NULL if unset,
+ * without creating the handle returned by nfnl_ct_get_src().
+ */
+const struct nl_addr_inline *_nfnl_ct_get_src(const struct nfnl_ct *ct,
+					      int repl);
+const struct nl_addr_inline *_nfnl_ct_get_dst(const struct nfnl_ct *ct,
+					      int repl);
+
+/*
+ * Clear a log message for reuse. Drops the references held by the object
+ * but keeps the buffers of prefix and hardware header.
+ */
+void _nfnl_log_msg_reset(struct nfnl_log_msg *msg);
+
 #endif /* __LIB_NETFILTER_NL_NETFILTER_H__*/
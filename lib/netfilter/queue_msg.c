@@ -14,6 +14,7 @@
 #include "nl-default.h"
 
 #include <sys/types.h>
+#include <time.h>
 
 #include <linux/netfilter/nfnetlink_queue.h>
 
@@ -47,8 +48,8 @@ static struct nla_policy queue_policy[NFQA_MAX+1] = {
 	},
 };
 
-int nfnlmsg_queue_msg_parse(struct nlmsghdr *nlh,
-			    struct nfnl_queue_msg **result)
+static int __nfnlmsg_queue_msg_parse(struct nlmsghdr *nlh, struct nl_msg *ref,
+				     struct nfnl_queue_msg **result)
 {
 	struct nfnl_queue_msg *msg;
 	struct nlattr *tb[NFQA_MAX+1];
@@ -118,7 +119,10 @@ int nfnlmsg_queue_msg_parse(struct nlmsghdr *nlh,
 	}
 
 	attr = tb[NFQA_PAYLOAD];
-	if (attr) {
+	if (attr && ref)
+		_nfnl_queue_msg_ref_payload(msg, ref, nla_data(attr),
+					    nla_len(attr));
+	else if (attr) {
 		err = nfnl_queue_msg_set_payload(msg, nla_data(attr),
 						 nla_len(attr));
 		if (err < 0)
@@ -133,13 +137,44 @@ errout:
 	return err;
 }
 
+int nfnlmsg_queue_msg_parse(struct nlmsghdr *nlh,
+			    struct nfnl_queue_msg **result)
+{
+	return __nfnlmsg_queue_msg_parse(nlh, NULL, result);
+}
+
+/**
+ * Parse a queue message without copying the payload
+ * @arg msg		Netlink message
+ * @arg result		Where to store the queue message object
+ *
+ * The payload of the queue message object points into \c msg, the object
+ * holds a reference on \c msg for as long as it refers to the payload.
+ * Combined with nl_socket_enable_msg_zerocopy() the payload is never
+ * copied after it has been received, and passing it to
+ * nfnl_queue_msg_send_verdict_payload() sends it straight from the
+ * receive buffer.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nfnlmsg_queue_msg_parse_zerocopy(struct nl_msg *msg,
+				     struct nfnl_queue_msg **result)
+{
+	return __nfnlmsg_queue_msg_parse(nlmsg_hdr(msg), msg, result);
+}
+
 static int queue_msg_parser(struct nl_cache_ops *ops, struct sockaddr_nl *who,
 			    struct nlmsghdr *nlh, struct nl_parser_param *pp)
 {
 	struct nfnl_queue_msg *msg;
 	int err;
 
-	if ((err = nfnlmsg_queue_msg_parse(nlh, &msg)) < 0)
+	/* Messages delivered without copying stay without copying */
+	if (pp->pp_msg && (pp->pp_msg->nm_flags & NL_MSG_BORROWED))
+		err = nfnlmsg_queue_msg_parse_zerocopy(pp->pp_msg, &msg);
+	else
+		err = nfnlmsg_queue_msg_parse(nlh, &msg);
+	if (err < 0)
 		return err;
 
 	err = pp->pp_cb((struct nl_object *) msg, pp);
@@ -243,6 +278,11 @@ int nfnl_queue_msg_send_verdict_batch(struct nl_sock *nlh,
 * @arg msg            queue msg
 * @arg payload_data   packet payload data
 * @arg payload_len    payload length
+*
+* The payload is sent from where it is without being copied, e.g. from
+* the receive buffer for a message parsed by
+* nfnlmsg_queue_msg_parse_zerocopy().
+*
 * @return 0 on OK or error code
 */
 int nfnl_queue_msg_send_verdict_payload(struct nl_sock *nlh,
@@ -282,6 +322,345 @@ int nfnl_queue_msg_send_verdict_payload(struct nl_sock *nlh,
 	return wait_for_ack(nlh);
 }
 
+/**
+ * @name Verdict Buffers
+ * @{
+ */
+
+/** @cond SKIP */
+#define VERDICT_MSG_SIZE (NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(struct nfgenmsg)) + \
+			  NLA_HDRLEN + NLA_ALIGN(sizeof(struct nfqnl_msg_verdict_hdr)))
+#define VERDICT_MSG_MAX_SIZE (VERDICT_MSG_SIZE + NLA_HDRLEN + NLA_ALIGN(4))
+
+#define VERDICT_BUF_DEFAULT_MAX		64
+#define VERDICT_BUF_DEFAULT_DELAY	1
+
+struct nfnl_queue_verdict_buf {
+	struct nl_sock *	vb_sk;
+	void *			vb_buf;
+	size_t			vb_size;
+	size_t			vb_len;
+	struct nfqnl_msg_verdict_hdr *vb_batch;
+	uint32_t		vb_batch_verdict;
+	uint32_t		vb_last_id;
+	int			vb_have_last;
+	unsigned int		vb_pending;
+	unsigned int		vb_max_pending;
+	unsigned int		vb_max_delay;
+	struct timespec		vb_first;
+	uint16_t		vb_queuenum;
+	uint8_t			vb_family;
+};
+
+/* Number of verdicts fitting into a datagram accepted by the kernel */
+static unsigned int verdict_buf_sndbuf_max(struct nl_sock *sk)
+{
+	int sndbuf = 0;
+	socklen_t len = sizeof(sndbuf);
+
+	/* The kernel rejects datagrams exceeding the send buffer */
+	if (getsockopt(nl_socket_get_fd(sk), SOL_SOCKET, SO_SNDBUF, &sndbuf,
+		       &len) < 0 ||
+	    sndbuf <= 32)
+		return UINT_MAX;
+
+	return _NL_MAX((unsigned int) (sndbuf - 32) / VERDICT_MSG_MAX_SIZE, 1u);
+}
+
+static long verdict_buf_elapsed(const struct nfnl_queue_verdict_buf *vb)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - vb->vb_first.tv_sec) * 1000 +
+	       (now.tv_nsec - vb->vb_first.tv_nsec) / 1000000;
+}
+
+static struct nfqnl_msg_verdict_hdr *
+verdict_buf_append(struct nfnl_queue_verdict_buf *vb, uint8_t type,
+		   uint32_t id, uint32_t verdict, const uint32_t *mark)
+{
+	struct nlmsghdr *nlh = (struct nlmsghdr *) ((char *) vb->vb_buf + vb->vb_len);
+	struct nfqnl_msg_verdict_hdr *hdr;
+	struct nfgenmsg *nfg;
+	struct nlattr *nla;
+
+	nlh->nlmsg_len = mark ? VERDICT_MSG_MAX_SIZE : VERDICT_MSG_SIZE;
+	nlh->nlmsg_type = NFNL_SUBSYS_QUEUE << 8 | type;
+	nlh->nlmsg_flags = NLM_F_REQUEST;
+	nlh->nlmsg_seq = nl_socket_use_seq(vb->vb_sk);
+	nlh->nlmsg_pid = nl_socket_get_local_port(vb->vb_sk);
+
+	nfg = nlmsg_data(nlh);
+	nfg->nfgen_family = vb->vb_family;
+	nfg->version = NFNETLINK_V0;
+	nfg->res_id = htons(vb->vb_queuenum);
+
+	nla = (struct nlattr *) ((char *) nfg + NLMSG_ALIGN(sizeof(*nfg)));
+	nla->nla_type = NFQA_VERDICT_HDR;
+	nla->nla_len = NLA_HDRLEN + sizeof(*hdr);
+	hdr = nla_data(nla);
+	hdr->verdict = htonl(verdict);
+	hdr->id = htonl(id);
+
+	if (mark) {
+		nla = (struct nlattr *) ((char *) nla + NLA_ALIGN(nla->nla_len));
+		nla->nla_type = NFQA_MARK;
+		nla->nla_len = NLA_HDRLEN + sizeof(uint32_t);
+		*(uint32_t *) nla_data(nla) = htonl(*mark);
+	}
+
+	vb->vb_len += nlh->nlmsg_len;
+
+	return hdr;
+}
+
+static int verdict_buf_add(struct nfnl_queue_verdict_buf *vb, uint32_t id,
+			   uint32_t verdict, const uint32_t *mark)
+{
+	int err, later;
+
+	if (vb->vb_len + VERDICT_MSG_MAX_SIZE > vb->vb_size &&
+	    (err = nfnl_queue_verdict_buf_flush(vb)) < 0)
+		return err;
+
+	if (!vb->vb_pending && vb->vb_max_delay)
+		clock_gettime(CLOCK_MONOTONIC, &vb->vb_first);
+
+	later = !vb->vb_have_last || (int32_t) (id - vb->vb_last_id) > 0;
+
+	if (mark || !later) {
+		/* Only the verdict for this packet id may be sent */
+		verdict_buf_append(vb, NFQNL_MSG_VERDICT, id, verdict, mark);
+		vb->vb_batch = NULL;
+	} else if (vb->vb_batch && vb->vb_batch_verdict == verdict)
+		vb->vb_batch->id = htonl(id);
+	else {
+		vb->vb_batch = verdict_buf_append(vb, NFQNL_MSG_VERDICT_BATCH,
+						  id, verdict, NULL);
+		vb->vb_batch_verdict = verdict;
+	}
+
+	if (later) {
+		vb->vb_last_id = id;
+		vb->vb_have_last = 1;
+	}
+
+	if (++vb->vb_pending >= vb->vb_max_pending ||
+	    (vb->vb_max_delay && verdict_buf_elapsed(vb) >= vb->vb_max_delay))
+		return nfnl_queue_verdict_buf_flush(vb);
+
+	return 0;
+}
+/** @endcond */
+
+/**
+ * Allocate a verdict buffer
+ * @arg sk		Netlink socket the packets are received on
+ * @arg family		Protocol family of the queue
+ * @arg queuenum	Queue number
+ *
+ * A verdict buffer collects the verdicts for the packets of one queue and
+ * sends them in a single datagram, consecutive packets with the same
+ * verdict are covered by a single NFQNL_MSG_VERDICT_BATCH message. The
+ * messages are built in place in a buffer allocated once, no
+ * acknowledgements are requested.
+ *
+ * Verdicts must be added in the order the packets were received. A batch
+ * verdict applies to all packets of the queue up to its packet id, a
+ * packet whose verdict is still outstanding when a verdict for a later
+ * packet is added gets that verdict as well.
+ *
+ * The buffer is flushed once 64 verdicts are pending or the oldest
+ * pending verdict is 1ms old, see nfnl_queue_verdict_buf_set_limits().
+ *
+ * @return Newly allocated verdict buffer or NULL.
+ */
+struct nfnl_queue_verdict_buf *
+nfnl_queue_verdict_buf_alloc(struct nl_sock *sk, uint8_t family,
+			     uint16_t queuenum)
+{
+	struct nfnl_queue_verdict_buf *vb;
+
+	vb = calloc(1, sizeof(*vb));
+	if (!vb)
+		return NULL;
+
+	vb->vb_sk = sk;
+	vb->vb_family = family;
+	vb->vb_queuenum = queuenum;
+
+	if (nfnl_queue_verdict_buf_set_limits(vb, VERDICT_BUF_DEFAULT_MAX,
+					      VERDICT_BUF_DEFAULT_DELAY) < 0) {
+		free(vb);
+		return NULL;
+	}
+
+	return vb;
+}
+
+/**
+ * Free a verdict buffer
+ * @arg vb		Verdict buffer
+ *
+ * Pending verdicts are discarded, use nfnl_queue_verdict_buf_flush()
+ * first to send them.
+ */
+void nfnl_queue_verdict_buf_free(struct nfnl_queue_verdict_buf *vb)
+{
+	if (!vb)
+		return;
+
+	free(vb->vb_buf);
+	free(vb);
+}
+
+/**
+ * Set the thresholds for flushing a verdict buffer
+ * @arg vb		Verdict buffer
+ * @arg max_verdicts	Number of pending verdicts causing a flush
+ * @arg max_delay	Age of the oldest pending verdict causing a flush
+ *			in milliseconds or 0 to disable
+ *
+ * The age is checked whenever a verdict is added. An application waiting
+ * for packets should limit the wait to nfnl_queue_verdict_buf_timeout()
+ * and flush the buffer once it expired.
+ *
+ * Pending verdicts are sent before the buffer is resized. The number of
+ * verdicts is reduced to what fits into the send buffer of the socket,
+ * call this function again after changing the send buffer size.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nfnl_queue_verdict_buf_set_limits(struct nfnl_queue_verdict_buf *vb,
+				      unsigned int max_verdicts,
+				      unsigned int max_delay)
+{
+	size_t size;
+	void *buf;
+	int err;
+
+	if (!max_verdicts || max_verdicts > 65536)
+		return -NLE_RANGE;
+
+	if ((err = nfnl_queue_verdict_buf_flush(vb)) < 0)
+		return err;
+
+	max_verdicts = _NL_MIN(max_verdicts, verdict_buf_sndbuf_max(vb->vb_sk));
+
+	size = (size_t) max_verdicts * VERDICT_MSG_MAX_SIZE;
+	if (size != vb->vb_size) {
+		if (!(buf = realloc(vb->vb_buf, size)))
+			return -NLE_NOMEM;
+
+		vb->vb_buf = buf;
+		vb->vb_size = size;
+	}
+
+	vb->vb_max_pending = max_verdicts;
+	vb->vb_max_delay = max_delay;
+
+	return 0;
+}
+
+/**
+ * Add a verdict to a verdict buffer
+ * @arg vb		Verdict buffer
+ * @arg packetid	Packet id
+ * @arg verdict		Verdict, e.g. NF_ACCEPT
+ *
+ * Flushes the buffer if one of its thresholds is reached. If sending
+ * fails the verdicts remain pending.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nfnl_queue_verdict_buf_add(struct nfnl_queue_verdict_buf *vb,
+			       uint32_t packetid, unsigned int verdict)
+{
+	return verdict_buf_add(vb, packetid, verdict, NULL);
+}
+
+/**
+ * Add the verdict of a queue message to a verdict buffer
+ * @arg vb		Verdict buffer
+ * @arg msg		Queue message
+ *
+ * Adds the verdict and mark set in \c msg for its packet id, see
+ * nfnl_queue_verdict_buf_add(). Verdicts setting a mark are never
+ * merged.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nfnl_queue_verdict_buf_add_msg(struct nfnl_queue_verdict_buf *vb,
+				   const struct nfnl_queue_msg *msg)
+{
+	uint32_t mark;
+
+	if (nfnl_queue_msg_get_group(msg) != vb->vb_queuenum)
+		return -NLE_INVAL;
+
+	if (nfnl_queue_msg_test_mark(msg)) {
+		mark = nfnl_queue_msg_get_mark(msg);
+		return verdict_buf_add(vb, nfnl_queue_msg_get_packetid(msg),
+				       nfnl_queue_msg_get_verdict(msg), &mark);
+	}
+
+	return verdict_buf_add(vb, nfnl_queue_msg_get_packetid(msg),
+			       nfnl_queue_msg_get_verdict(msg), NULL);
+}
+
+/**
+ * Send the pending verdicts of a verdict buffer
+ * @arg vb		Verdict buffer
+ *
+ * Errors for individual verdicts, e.g. for unknown packet ids, are not
+ * reported here but received on the socket as error messages.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nfnl_queue_verdict_buf_flush(struct nfnl_queue_verdict_buf *vb)
+{
+	int err;
+
+	if (!vb->vb_len)
+		return 0;
+
+	if ((err = nl_sendto(vb->vb_sk, vb->vb_buf, vb->vb_len)) < 0)
+		return err;
+
+	vb->vb_len = 0;
+	vb->vb_pending = 0;
+	vb->vb_batch = NULL;
+
+	return 0;
+}
+
+/**
+ * Time until a verdict buffer needs to be flushed
+ * @arg vb		Verdict buffer
+ *
+ * @return Milliseconds until the oldest pending verdict reaches the
+ *         maximum delay, 0 if it already has, or -1 if there is nothing
+ *         to wait for. Suitable as timeout for poll().
+ */
+int nfnl_queue_verdict_buf_timeout(const struct nfnl_queue_verdict_buf *vb)
+{
+	long elapsed;
+
+	if (!vb->vb_pending)
+		return -1;
+
+	if (!vb->vb_max_delay)
+		return -1;
+
+	elapsed = verdict_buf_elapsed(vb);
+
+	return elapsed >= vb->vb_max_delay ? 0 : vb->vb_max_delay - elapsed;
+}
+
+/** @} */
+
 #define NFNLMSG_QUEUE_TYPE(type) NFNLMSG_TYPE(NFNL_SUBSYS_QUEUE, (type))
 static struct nl_cache_ops nfnl_queue_msg_ops = {
 	.co_name		= "netfilter/queue_msg",
@@ -32,6 +32,17 @@
 #define QUEUE_MSG_ATTR_VERDICT		(1UL << 13)
 /** @endcond */
 
+static void queue_msg_release_payload(struct nfnl_queue_msg *msg)
+{
+	if (msg->queue_msg_payload_msg)
+		nlmsg_free(msg->queue_msg_payload_msg);
+	else
+		free(msg->queue_msg_payload);
+
+	msg->queue_msg_payload_msg = NULL;
+	msg->queue_msg_payload = NULL;
+}
+
 static void nfnl_queue_msg_free_data(struct nl_object *c)
 {
 	struct nfnl_queue_msg *msg = (struct nfnl_queue_msg *) c;
@@ -39,7 +50,7 @@ static void nfnl_queue_msg_free_data(struct nl_object *c)
 	if (msg == NULL)
 		return;
 
-	free(msg->queue_msg_payload);
+	queue_msg_release_payload(msg);
 }
 
 static int nfnl_queue_msg_clone(struct nl_object *_dst, struct nl_object *_src)
@@ -50,8 +61,15 @@ static int nfnl_queue_msg_clone(struct nl_object *_dst, struct nl_object *_src)
 
 	dst->queue_msg_payload = NULL;
 	dst->queue_msg_payload_len = 0;
-
-	if (src->queue_msg_payload) {
+	dst->queue_msg_payload_msg = NULL;
+
+	/* A payload in a message is never modified, it can be shared */
+	if (src->queue_msg_payload_msg) {
+		nlmsg_get(src->queue_msg_payload_msg);
+		dst->queue_msg_payload_msg = src->queue_msg_payload_msg;
+		dst->queue_msg_payload = src->queue_msg_payload;
+		dst->queue_msg_payload_len = src->queue_msg_payload_len;
+	} else if (src->queue_msg_payload) {
 		err = nfnl_queue_msg_set_payload(dst, src->queue_msg_payload,
 		                                 src->queue_msg_payload_len);
 		if (err < 0)
@@ -416,7 +434,7 @@ int nfnl_queue_msg_set_payload(struct nfnl_queue_msg *msg, uint8_t *payload,
 	if (!p && len > 0)
 		return -NLE_NOMEM;
 
-	free(msg->queue_msg_payload);
+	queue_msg_release_payload(msg);
 	msg->queue_msg_payload = p;
 	msg->queue_msg_payload_len = len;
 	if (len > 0)
@@ -426,6 +444,22 @@ int nfnl_queue_msg_set_payload(struct nfnl_queue_msg *msg, uint8_t *payload,
 	return 0;
 }
 
+/** @cond SKIP */
+void _nfnl_queue_msg_ref_payload(struct nfnl_queue_msg *msg,
+				 struct nl_msg *nlmsg, void *payload, int len)
+{
+	nlmsg_get(nlmsg);
+	queue_msg_release_payload(msg);
+	msg->queue_msg_payload_msg = nlmsg;
+	msg->queue_msg_payload = payload;
+	msg->queue_msg_payload_len = len;
+	if (len > 0)
+		msg->ce_mask |= QUEUE_MSG_ATTR_PAYLOAD;
+	else
+		msg->ce_mask &= ~QUEUE_MSG_ATTR_PAYLOAD;
+}
+/** @endcond */
+
 int nfnl_queue_msg_test_payload(const struct nfnl_queue_msg *msg)
 {
 	return !!(msg->ce_mask & QUEUE_MSG_ATTR_PAYLOAD);
@@ -26,12 +26,15 @@ struct nfnl_queue {
 	uint32_t		queue_maxlen;
 	uint32_t		queue_copy_range;
 	uint8_t			queue_copy_mode;
+	uint32_t		queue_flags;
+	uint32_t		queue_flag_mask;
 };
 
 #define QUEUE_ATTR_GROUP		(1UL << 0)
 #define QUEUE_ATTR_MAXLEN		(1UL << 1)
 #define QUEUE_ATTR_COPY_MODE		(1UL << 2)
 #define QUEUE_ATTR_COPY_RANGE		(1UL << 3)
+#define QUEUE_ATTR_FLAGS		(1UL << 4)
 /** @endcond */
 
 
@@ -56,6 +59,11 @@ static void nfnl_queue_dump(struct nl_object *a, struct nl_dump_params *p)
 	if (queue->ce_mask & QUEUE_ATTR_COPY_RANGE)
 		nl_dump(p, "copy_range=%u ", queue->queue_copy_range);
 
+	if (queue->ce_mask & QUEUE_ATTR_FLAGS)
+		nl_dump(p, "flags=%s ",
+			nfnl_queue_flags2str(queue->queue_flags,
+					     buf, sizeof(buf)));
+
 	nl_dump(p, "\n");
 }
 
@@ -168,6 +176,56 @@ uint32_t nfnl_queue_get_copy_range(const struct nfnl_queue *queue)
 	return queue->queue_copy_range;
 }
 
+/*
+ * Only the flags set or unset are changed in the kernel, the flags
+ * mask tells which ones.
+ */
+void nfnl_queue_set_flags(struct nfnl_queue *queue, unsigned int flags)
+{
+	queue->queue_flags |= flags;
+	queue->queue_flag_mask |= flags;
+	queue->ce_mask |= QUEUE_ATTR_FLAGS;
+}
+
+void nfnl_queue_unset_flags(struct nfnl_queue *queue, unsigned int flags)
+{
+	queue->queue_flags &= ~flags;
+	queue->queue_flag_mask |= flags;
+	queue->ce_mask |= QUEUE_ATTR_FLAGS;
+}
+
+int nfnl_queue_test_flags(const struct nfnl_queue *queue)
+{
+	return !!(queue->ce_mask & QUEUE_ATTR_FLAGS);
+}
+
+unsigned int nfnl_queue_get_flags(const struct nfnl_queue *queue)
+{
+	return queue->queue_flags;
+}
+
+unsigned int nfnl_queue_get_flag_mask(const struct nfnl_queue *queue)
+{
+	return queue->queue_flag_mask;
+}
+
+static const struct trans_tbl queue_flags[] = {
+	__ADD(NFNL_QUEUE_FLAG_FAIL_OPEN,	fail_open),
+	__ADD(NFNL_QUEUE_FLAG_CONNTRACK,	conntrack),
+	__ADD(NFNL_QUEUE_FLAG_GSO,		gso),
+};
+
+char *nfnl_queue_flags2str(unsigned int flags, char *buf, size_t len)
+{
+	return __flags2str(flags, buf, len, queue_flags,
+			   ARRAY_SIZE(queue_flags));
+}
+
+unsigned int nfnl_queue_str2flags(const char *name)
+{
+	return __str2flags(name, queue_flags, ARRAY_SIZE(queue_flags));
+}
+
 static uint64_t nfnl_queue_compare(struct nl_object *_a, struct nl_object *_b,
 				   uint64_t attrs, int flags)
 {
@@ -181,6 +239,9 @@ static uint64_t nfnl_queue_compare(struct nl_object *_a, struct nl_object *_b,
 	diff |= _DIFF_VAL(QUEUE_ATTR_MAXLEN, queue_maxlen);
 	diff |= _DIFF_VAL(QUEUE_ATTR_COPY_MODE, queue_copy_mode);
 	diff |= _DIFF_VAL(QUEUE_ATTR_COPY_RANGE, queue_copy_range);
+	diff |= _DIFF(QUEUE_ATTR_FLAGS,
+		      a->queue_flags != b->queue_flags ||
+		      a->queue_flag_mask != b->queue_flag_mask);
 #undef _DIFF
 #undef _DIFF_VAL
 
@@ -192,6 +253,7 @@ static const struct trans_tbl nfnl_queue_attrs[] = {
 	__ADD(QUEUE_ATTR_MAXLEN,	maxlen),
 	__ADD(QUEUE_ATTR_COPY_MODE,	copy_mode),
 	__ADD(QUEUE_ATTR_COPY_RANGE,	copy_range),
+	__ADD(QUEUE_ATTR_FLAGS,		flags),
 };
 
 static char *nfnl_queue_attrs2str(int attrs, char *buf, size_t len)
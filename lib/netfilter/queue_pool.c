@@ -0,0 +1,555 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+/**
+ * @ingroup queue
+ * @defgroup queue_pool Queue Pool
+ * @brief Serve a range of queues with one socket and thread each
+ *
+ * Packets spread over several queues, e.g. by the `--queue-balance`
+ * option of the NFQUEUE target, are handled by one worker thread per
+ * queue. Every worker receives the packets of its queue, passes them to
+ * the function given to nfnl_queue_pool_start() and sends the verdicts
+ * through a verdict buffer.
+ *
+ * @code
+ * static int handle_packet(struct nfnl_queue_msg *msg, void *arg)
+ * {
+ *	return NF_ACCEPT;
+ * }
+ *
+ * queue = nfnl_queue_alloc();
+ * nfnl_queue_set_group(queue, 0);
+ * nfnl_queue_set_copy_mode(queue, NFNL_QUEUE_COPY_PACKET);
+ * nfnl_queue_set_copy_range(queue, 0xFFFF);
+ * nfnl_queue_set_flags(queue, NFNL_QUEUE_FLAG_FAIL_OPEN | NFNL_QUEUE_FLAG_GSO);
+ *
+ * // Queues 0 to 3
+ * pool = nfnl_queue_pool_alloc(queue, 4);
+ * err = nfnl_queue_pool_start(pool, handle_packet, NULL);
+ * ...
+ * nfnl_queue_pool_free(pool);
+ * @endcode
+ * @{
+ */
+
+#include "nl-default.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sched.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink_queue.h>
+
+#include <netlink/msg.h>
+#include <netlink/netfilter/nfnl.h>
+#include <netlink/netfilter/queue.h>
+#include <netlink/netfilter/queue_msg.h>
+
+#include "nl-aux-core/nl-core.h"
+#include "nl-priv-dynamic-core/nl-core.h"
+
+/** @cond SKIP */
+/* Datagrams read with one system call */
+#define QUEUE_POOL_RECV_BATCH 64
+
+/* Room per queued packet in the receive buffer besides the payload */
+#define QUEUE_POOL_PKT_OVERHEAD 512
+
+struct queue_worker {
+	struct nfnl_queue_pool *	qw_pool;
+	struct nfnl_queue *		qw_queue;
+	struct nl_sock *		qw_sk;
+	struct nfnl_queue_verdict_buf *	qw_verdicts;
+	int				qw_cpu;
+	int				qw_running;
+	int				qw_have_id;
+	uint32_t			qw_last_id;
+	uint64_t			qw_packets;
+	uint64_t			qw_lost;
+	uint64_t			qw_overruns;
+	uint64_t			qw_overruns_base;
+	uint64_t			qw_verdict_errors;
+#ifndef DISABLE_PTHREADS
+	pthread_t			qw_thread;
+#endif
+};
+
+struct nfnl_queue_pool {
+	struct nfnl_queue *		qp_queue;
+	struct queue_worker *		qp_workers;
+	unsigned int			qp_nqueues;
+	nfnl_queue_pool_func_t		qp_func;
+	void *				qp_arg;
+	int				qp_stop[2];
+	int				qp_started;
+};
+
+/* Published by the worker, the socket is not touched by other threads */
+static void queue_worker_sync_overruns(struct queue_worker *qw)
+{
+	__atomic_store_n(&qw->qw_overruns,
+			 qw->qw_overruns_base + qw->qw_sk->s_overruns,
+			 __ATOMIC_RELAXED);
+}
+
+#ifndef DISABLE_PTHREADS
+static void queue_worker_count(uint64_t *counter, uint64_t n)
+{
+	__atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n,
+			 __ATOMIC_RELAXED);
+}
+
+static int queue_worker_input(struct nl_msg *msg, void *arg)
+{
+	struct queue_worker *qw = arg;
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct nfnl_queue_msg *qmsg;
+	uint32_t id;
+	int verdict, err;
+
+	if (nfnlmsg_subsys(nlh) != NFNL_SUBSYS_QUEUE ||
+	    nfnlmsg_subtype(nlh) != NFQNL_MSG_PACKET)
+		return NL_SKIP;
+
+	if (nfnlmsg_queue_msg_parse_zerocopy(msg, &qmsg) < 0)
+		return NL_SKIP;
+
+	/* Packet ids are assigned in sequence, packets the kernel failed
+	 * to deliver to the socket leave a gap. Packets exceeding the queue
+	 * length are never assigned one. */
+	id = nfnl_queue_msg_get_packetid(qmsg);
+	if (qw->qw_have_id && (int32_t) (id - qw->qw_last_id) > 1)
+		queue_worker_count(&qw->qw_lost, id - qw->qw_last_id - 1);
+	qw->qw_last_id = id;
+	qw->qw_have_id = 1;
+	queue_worker_count(&qw->qw_packets, 1);
+
+	verdict = qw->qw_pool->qp_func(qmsg, qw->qw_pool->qp_arg);
+	if (verdict < 0)
+		verdict = NF_DROP;
+
+	/* The buffer could not be flushed, the verdict for this packet is
+	 * sent on its own instead */
+	err = nfnl_queue_verdict_buf_add(qw->qw_verdicts, id, verdict);
+	if (err < 0) {
+		queue_worker_count(&qw->qw_verdict_errors, 1);
+		nfnl_queue_msg_set_verdict(qmsg, verdict);
+		if ((err = nfnl_queue_msg_send_verdict(qw->qw_sk, qmsg)) < 0)
+			NL_DBG(1, "Unable to send verdict for packet %u: %s\n",
+			       id, nl_geterror(err));
+	}
+
+	nfnl_queue_msg_put(qmsg);
+
+	return NL_OK;
+}
+
+static void *queue_worker_run(void *arg)
+{
+	struct queue_worker *qw = arg;
+	struct pollfd fds[2] = {
+		{ .fd = nl_socket_get_fd(qw->qw_sk), .events = POLLIN },
+		{ .fd = qw->qw_pool->qp_stop[0], .events = POLLIN },
+	};
+	int err;
+
+	for (;;) {
+		err = poll(fds, 2, nfnl_queue_verdict_buf_timeout(qw->qw_verdicts));
+		if (err < 0 && errno != EINTR)
+			break;
+
+		if (fds[1].revents)
+			break;
+
+		/* Batched datagrams are kept by the socket, drain it. Errors
+		 * reported by the kernel, e.g. overruns, are skipped. */
+		if (err > 0 && fds[0].revents) {
+			while ((err = nl_recvmsgs_default(qw->qw_sk)) != -NLE_AGAIN)
+				if (err == -NLE_BAD_SOCK)
+					goto out;
+			queue_worker_sync_overruns(qw);
+		}
+
+		nfnl_queue_verdict_buf_flush(qw->qw_verdicts);
+	}
+
+out:
+	nfnl_queue_verdict_buf_flush(qw->qw_verdicts);
+
+	return NULL;
+}
+
+static int queue_worker_rcvbuf(const struct nfnl_queue *queue)
+{
+	uint64_t size = QUEUE_POOL_PKT_OVERHEAD;
+
+	if (!nfnl_queue_test_copy_mode(queue) ||
+	    nfnl_queue_get_copy_mode(queue) == NFNL_QUEUE_COPY_PACKET)
+		size += nfnl_queue_test_copy_range(queue) ?
+			_NL_MIN(nfnl_queue_get_copy_range(queue), 0xFFFFu) :
+			0xFFFF;
+
+	size *= nfnl_queue_get_maxlen(queue);
+
+	return size > INT_MAX ? INT_MAX : (int) size;
+}
+
+static int queue_worker_setup(struct queue_worker *qw)
+{
+	int err;
+
+	if (!(qw->qw_sk = nl_socket_alloc()))
+		return -NLE_NOMEM;
+
+	qw->qw_overruns_base = qw->qw_overruns;
+
+	if ((err = nl_connect(qw->qw_sk, NETLINK_NETFILTER)) < 0)
+		return err;
+
+	/* The queue is bound with acknowledgement, verdicts go without */
+	if ((err = nfnl_queue_create(qw->qw_sk, qw->qw_queue)) < 0)
+		return err;
+
+	nl_socket_disable_auto_ack(qw->qw_sk);
+	nl_socket_disable_seq_check(qw->qw_sk);
+	nl_socket_enable_msg_zerocopy(qw->qw_sk);
+	nl_socket_set_recv_batch(qw->qw_sk, QUEUE_POOL_RECV_BATCH);
+	nl_socket_modify_cb(qw->qw_sk, NL_CB_VALID, NL_CB_CUSTOM,
+			    queue_worker_input, qw);
+
+	if ((err = nl_socket_set_nonblocking(qw->qw_sk)) < 0)
+		return err;
+
+	/* Room for a full queue in the socket, within the system limit */
+	if (nfnl_queue_test_maxlen(qw->qw_queue))
+		nl_socket_set_buffer_size(qw->qw_sk,
+					  queue_worker_rcvbuf(qw->qw_queue), 0);
+
+	qw->qw_verdicts = nfnl_queue_verdict_buf_alloc(qw->qw_sk, AF_UNSPEC,
+						nfnl_queue_get_group(qw->qw_queue));
+	if (!qw->qw_verdicts)
+		return -NLE_NOMEM;
+
+	return 0;
+}
+#endif
+
+static void queue_worker_teardown(struct queue_worker *qw)
+{
+	if (qw->qw_sk && nl_socket_get_fd(qw->qw_sk) >= 0) {
+		/* Unbinding drops the packets still queued. Those received
+		 * while waiting for the acknowledgement are left to the
+		 * kernel as well, the worker is gone. */
+		nl_socket_modify_cb(qw->qw_sk, NL_CB_VALID, NL_CB_DEFAULT,
+				    NULL, NULL);
+		nl_socket_enable_auto_ack(qw->qw_sk);
+		nfnl_queue_delete(qw->qw_sk, qw->qw_queue);
+	}
+
+	if (qw->qw_sk)
+		queue_worker_sync_overruns(qw);
+
+	nfnl_queue_verdict_buf_free(qw->qw_verdicts);
+	nl_socket_free(qw->qw_sk);
+	qw->qw_verdicts = NULL;
+	qw->qw_sk = NULL;
+}
+/** @endcond */
+
+/**
+ * Allocate a queue pool
+ * @arg queue		Queue configuration
+ * @arg nqueues		Number of queues
+ *
+ * The pool serves the \c nqueues queues starting at the group of
+ * \c queue, all configured like \c queue. Setting the maximum queue
+ * length of \c queue also sizes the receive buffer of the sockets to
+ * hold as many packets, within the limit of the system.
+ *
+ * @return Newly allocated queue pool or NULL.
+ */
+struct nfnl_queue_pool *nfnl_queue_pool_alloc(const struct nfnl_queue *queue,
+					      unsigned int nqueues)
+{
+	struct nfnl_queue_pool *pool;
+	unsigned int i;
+
+	if (!nqueues || !nfnl_queue_test_group(queue) ||
+	    nfnl_queue_get_group(queue) + nqueues - 1 > UINT16_MAX)
+		return NULL;
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	pool->qp_nqueues = nqueues;
+	pool->qp_stop[0] = pool->qp_stop[1] = -1;
+	pool->qp_workers = calloc(nqueues, sizeof(*pool->qp_workers));
+	if (!pool->qp_workers)
+		goto errout;
+
+	for (i = 0; i < nqueues; i++) {
+		struct queue_worker *qw = &pool->qp_workers[i];
+
+		qw->qw_pool = pool;
+		qw->qw_cpu = -1;
+		qw->qw_queue = (struct nfnl_queue *)
+			nl_object_clone((struct nl_object *) queue);
+		if (!qw->qw_queue)
+			goto errout;
+
+		nfnl_queue_set_group(qw->qw_queue,
+				     nfnl_queue_get_group(queue) + i);
+	}
+
+	return pool;
+
+errout:
+	nfnl_queue_pool_free(pool);
+	return NULL;
+}
+
+/**
+ * Free a queue pool
+ * @arg pool		Queue pool
+ *
+ * Stops the pool if it is running.
+ */
+void nfnl_queue_pool_free(struct nfnl_queue_pool *pool)
+{
+	unsigned int i;
+
+	if (!pool)
+		return;
+
+	nfnl_queue_pool_stop(pool);
+
+	if (pool->qp_workers)
+		for (i = 0; i < pool->qp_nqueues; i++)
+			if (pool->qp_workers[i].qw_queue)
+				nfnl_queue_put(pool->qp_workers[i].qw_queue);
+
+	free(pool->qp_workers);
+	free(pool);
+}
+
+/**
+ * Pin the worker of a queue to a CPU
+ * @arg pool		Queue pool
+ * @arg idx		Index of the queue in the pool
+ * @arg cpu		CPU number or -1 to not pin the worker
+ *
+ * Takes effect when the pool is started.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nfnl_queue_pool_set_cpu(struct nfnl_queue_pool *pool, unsigned int idx,
+			    int cpu)
+{
+	if (idx >= pool->qp_nqueues || cpu < -1 || cpu >= CPU_SETSIZE)
+		return -NLE_RANGE;
+
+	pool->qp_workers[idx].qw_cpu = cpu;
+
+	return 0;
+}
+
+/**
+ * Start a queue pool
+ * @arg pool		Queue pool
+ * @arg func		Function called for every packet
+ * @arg arg		Argument passed to \c func
+ *
+ * Binds all queues of the pool and starts a worker thread for each.
+ * \c func is called by the worker threads concurrently and returns the
+ * verdict for the packet, e.g. NF_ACCEPT. A negative return value drops
+ * the packet. The verdicts are sent batched, see
+ * nfnl_queue_verdict_buf_alloc(). The payload of the queue message
+ * refers to the receive buffer, it is not copied.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nfnl_queue_pool_start(struct nfnl_queue_pool *pool,
+			  nfnl_queue_pool_func_t func, void *arg)
+{
+#ifndef DISABLE_PTHREADS
+	struct queue_worker *qw;
+	pthread_attr_t attr;
+	cpu_set_t cpus;
+	unsigned int i;
+	int err;
+
+	if (pool->qp_started)
+		return -NLE_EXIST;
+
+	pool->qp_func = func;
+	pool->qp_arg = arg;
+
+	if (pipe2(pool->qp_stop, O_CLOEXEC) < 0)
+		return -nl_syserr2nlerr(errno);
+
+	pool->qp_started = 1;
+
+	for (i = 0; i < pool->qp_nqueues; i++) {
+		qw = &pool->qp_workers[i];
+		qw->qw_have_id = 0;
+
+		if ((err = queue_worker_setup(qw)) < 0)
+			goto errout;
+	}
+
+	for (i = 0; i < pool->qp_nqueues; i++) {
+		qw = &pool->qp_workers[i];
+
+		pthread_attr_init(&attr);
+		if (qw->qw_cpu >= 0) {
+			CPU_ZERO(&cpus);
+			CPU_SET(qw->qw_cpu, &cpus);
+			pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+		}
+
+		err = pthread_create(&qw->qw_thread, &attr, queue_worker_run, qw);
+		pthread_attr_destroy(&attr);
+		if (err) {
+			err = -nl_syserr2nlerr(err);
+			goto errout;
+		}
+
+		qw->qw_running = 1;
+	}
+
+	return 0;
+
+errout:
+	nfnl_queue_pool_stop(pool);
+	return err;
+#else
+	return -NLE_OPNOTSUPP;
+#endif
+}
+
+/**
+ * Stop a queue pool
+ * @arg pool		Queue pool
+ *
+ * Stops the worker threads once they have sent the pending verdicts and
+ * unbinds the queues. Packets still queued are dropped by the kernel.
+ * The pool may be started again.
+ */
+void nfnl_queue_pool_stop(struct nfnl_queue_pool *pool)
+{
+	unsigned int i;
+
+	if (!pool->qp_started)
+		return;
+
+	if (write(pool->qp_stop[1], "", 1) < 0)
+		NL_DBG(1, "Unable to signal queue pool workers: %s\n",
+		       nl_strerror_l(errno));
+
+	for (i = 0; i < pool->qp_nqueues; i++) {
+		struct queue_worker *qw = &pool->qp_workers[i];
+
+#ifndef DISABLE_PTHREADS
+		if (qw->qw_running)
+			pthread_join(qw->qw_thread, NULL);
+#endif
+		qw->qw_running = 0;
+		queue_worker_teardown(qw);
+	}
+
+	close(pool->qp_stop[0]);
+	close(pool->qp_stop[1]);
+	pool->qp_stop[0] = pool->qp_stop[1] = -1;
+	pool->qp_started = 0;
+}
+
+/**
+ * Number of queues of a queue pool
+ * @arg pool		Queue pool
+ */
+unsigned int nfnl_queue_pool_get_nqueues(const struct nfnl_queue_pool *pool)
+{
+	return pool->qp_nqueues;
+}
+
+/**
+ * Number of packets received on a queue of a queue pool
+ * @arg pool		Queue pool
+ * @arg idx		Index of the queue in the pool
+ */
+uint64_t nfnl_queue_pool_get_packets(const struct nfnl_queue_pool *pool,
+				     unsigned int idx)
+{
+	if (idx >= pool->qp_nqueues)
+		return 0;
+
+	return __atomic_load_n(&pool->qp_workers[idx].qw_packets,
+			       __ATOMIC_RELAXED);
+}
+
+/**
+ * Number of packets lost on a queue of a queue pool
+ * @arg pool		Queue pool
+ * @arg idx		Index of the queue in the pool
+ *
+ * Counts the packets the kernel queued but failed to deliver to the
+ * socket of the worker, usually because its receive buffer was full.
+ * Depending on NFNL_QUEUE_FLAG_FAIL_OPEN they were dropped or accepted
+ * without verdict. The count is derived from gaps in the packet ids.
+ *
+ * Packets exceeding the maximum queue length are rejected before they
+ * are assigned an id and are not counted. The kernel accounts for them
+ * as \c queue_dropped in \c /proc/net/netfilter/nfnetlink_queue.
+ */
+uint64_t nfnl_queue_pool_get_lost(const struct nfnl_queue_pool *pool,
+				  unsigned int idx)
+{
+	if (idx >= pool->qp_nqueues)
+		return 0;
+
+	return __atomic_load_n(&pool->qp_workers[idx].qw_lost,
+			       __ATOMIC_RELAXED);
+}
+
+/**
+ * Number of receive buffer overruns on a queue of a queue pool
+ * @arg pool		Queue pool
+ * @arg idx		Index of the queue in the pool
+ *
+ * Counts how often packets did not fit into the receive buffer of the
+ * socket. One overrun may stand for several packets, those are counted
+ * by nfnl_queue_pool_get_lost().
+ */
+uint64_t nfnl_queue_pool_get_overruns(const struct nfnl_queue_pool *pool,
+				      unsigned int idx)
+{
+	if (idx >= pool->qp_nqueues)
+		return 0;
+
+	return __atomic_load_n(&pool->qp_workers[idx].qw_overruns,
+			       __ATOMIC_RELAXED);
+}
+
+/**
+ * Number of verdicts of a queue pool which could not be buffered
+ * @arg pool		Queue pool
+ * @arg idx		Index of the queue in the pool
+ *
+ * Counts the packets whose verdict could not be added to the verdict
+ * buffer of the worker because flushing it failed. The verdicts for
+ * these packets are sent individually instead.
+ */
+uint64_t nfnl_queue_pool_get_verdict_errors(const struct nfnl_queue_pool *pool,
+					    unsigned int idx)
+{
+	if (idx >= pool->qp_nqueues)
+		return 0;
+
+	return __atomic_load_n(&pool->qp_workers[idx].qw_verdict_errors,
+			       __ATOMIC_RELAXED);
+}
+
+/** @} */
@@ -52,6 +52,35 @@ uint32_t _nl_socket_set_local_port_no_release(struct nl_sock *sk, int generate_o
 void _nl_socket_used_ports_release_all(const uint32_t *used_ports);
 void _nl_socket_used_ports_set(uint32_t *used_ports, uint32_t port);
 
+struct nl_object;
+struct nl_rxbuf;
+struct nl_rxbatch;
+struct nl_async;
+
+struct nl_rxbuf *_nl_rxbuf_alloc(unsigned char *data, size_t size);
+void _nl_rxbuf_put(struct nl_rxbuf *rb);
+struct nl_msg *_nlmsg_borrow(struct nl_rxbuf *rb, struct nlmsghdr *hdr);
+struct nl_msg *_nlmsg_borrow_reuse(struct nl_msg *msg, struct nl_rxbuf *rb,
+				   struct nlmsghdr *hdr);
+struct nl_msg *_nlmsg_borrow_release(struct nl_msg *msg);
+
+uint32_t _nl_object_hash(struct nl_object *obj);
+
+struct nl_hash_table;
+int _nl_hash_table_replace(struct nl_hash_table *ht, struct nl_object *old,
+			   struct nl_object *new);
+
+void _nl_rxbatch_free(struct nl_rxbatch *rq);
+void _nl_async_free(struct nl_async *as);
+
+struct nl_cache_assoc;
+int _nl_cache_resync_assoc(struct nl_sock *sk,
+			   const struct nl_cache_assoc *ca);
+int _nl_cache_msg_skip(struct nl_cache *cache, struct nlmsghdr *nlh,
+		       int event);
+int _nl_cache_filter_event(const struct nl_cache_assoc *ca,
+			   struct nl_object *obj);
+
 extern int nl_cache_parse(struct nl_cache_ops *, struct sockaddr_nl *,
 			  struct nlmsghdr *, struct nl_parser_param *);
 
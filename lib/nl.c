@@ -602,92 +602,764 @@ errout:
 /** @} */
 
 /**
- * @name Receive
+ * @name Batched Send
  * @{
  */
 
+/** @cond SKIP */
+/* Upper limit of iovecs per sendmsg() and of messages per sendmmsg() */
+#define NL_SEND_BATCH_MAX_IOV 1024
+
+struct nl_send_batch
+{
+	struct nl_sock *	sb_sock;
+	struct nl_msg **	sb_msgs;
+	size_t			sb_nmsgs;
+	size_t			sb_nsent;
+	size_t			sb_alloc;
+	size_t			sb_nexpect;
+	size_t			sb_ndone;
+	int			sb_err;
+	nl_send_batch_err_cb_t	sb_err_cb;
+	void *			sb_err_arg;
+};
+
+static int send_batch_append(struct nl_send_batch *b, struct nl_msg *msg)
+{
+	if (b->sb_nmsgs >= b->sb_alloc) {
+		size_t alloc = b->sb_alloc ? b->sb_alloc * 2 : 64;
+		struct nl_msg **tmp;
+
+		tmp = realloc(b->sb_msgs, alloc * sizeof(*tmp));
+		if (!tmp)
+			return -NLE_NOMEM;
+
+		b->sb_msgs = tmp;
+		b->sb_alloc = alloc;
+	}
+
+	b->sb_msgs[b->sb_nmsgs++] = msg;
+
+	return 0;
+}
+
+static void send_batch_release(struct nl_send_batch *b)
+{
+	size_t i;
+
+	for (i = 0; i < b->sb_nmsgs; i++)
+		nlmsg_free(b->sb_msgs[i]);
+
+	b->sb_nmsgs = 0;
+	b->sb_nsent = 0;
+	b->sb_nexpect = 0;
+	b->sb_ndone = 0;
+}
+
+static void send_batch_drop_unsent(struct nl_send_batch *b)
+{
+	size_t i;
+
+	/* Messages which could not be sent will never be answered */
+	for (i = b->sb_nsent; i < b->sb_nmsgs; i++)
+		nlmsg_free(b->sb_msgs[i]);
+
+	b->sb_nmsgs = b->sb_nsent;
+}
+
+static size_t send_batch_limit(struct nl_sock *sk)
+{
+	int sndbuf = 0;
+	socklen_t len = sizeof(sndbuf);
+
+	/* The kernel rejects datagrams exceeding the send buffer */
+	if (getsockopt(sk->s_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len) < 0 ||
+	    sndbuf <= 32)
+		return getpagesize();
+
+	return sndbuf - 32;
+}
+/** @endcond */
+
+/**
+ * Allocate a batch of Netlink messages to be transmitted together
+ * @arg sk		Netlink socket (required)
+ *
+ * Messages added to the batch using nl_send_batch_add() are transmitted
+ * by nl_send_batch_flush() with as few system calls as possible: the
+ * messages are packed back-to-back into datagrams up to the size of the
+ * socket send buffer and all datagrams are handed to a single sendmmsg().
+ *
+ * @see nl_send_batch_free()
+ *
+ * @return Newly allocated batch or NULL.
+ */
+struct nl_send_batch *nl_send_batch_alloc(struct nl_sock *sk)
+{
+	struct nl_send_batch *b;
+
+	b = calloc(1, sizeof(*b));
+	if (!b)
+		return NULL;
+
+	b->sb_sock = sk;
+
+	return b;
+}
+
+/**
+ * Free a batch of Netlink messages
+ * @arg b		Batch (optional)
+ *
+ * Releases all messages still held by the batch. Messages which have not
+ * been flushed yet are discarded.
+ */
+void nl_send_batch_free(struct nl_send_batch *b)
+{
+	if (!b)
+		return;
+
+	send_batch_release(b);
+	free(b->sb_msgs);
+	free(b);
+}
+
+/**
+ * Add Netlink message to batch
+ * @arg b		Batch (required)
+ * @arg msg		Netlink message (required)
+ *
+ * Finalizes the message using nl_complete_msg(), which assigns the next
+ * sequence number of the socket, and queues it for transmission by
+ * nl_send_batch_flush(). The batch takes its own reference on the message
+ * until all replies have been collected by nl_send_batch_wait(), the
+ * caller may free its reference right away.
+ *
+ * @note The message must not be modified after it has been added.
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nl_send_batch_add(struct nl_send_batch *b, struct nl_msg *msg)
+{
+	int err;
+
+	nl_complete_msg(b->sb_sock, msg);
+
+	err = send_batch_append(b, msg);
+	if (err < 0)
+		return err;
+
+	nlmsg_get(msg);
+
+	return 0;
+}
+
+/**
+ * Transmit all queued Netlink messages of a batch
+ * @arg b		Batch (required)
+ *
+ * Packs all messages added since the last flush into as few datagrams as
+ * the send buffer size of the socket permits and transmits all of them
+ * with a single sendmmsg() system call (or more if there are more than
+ * 1024 datagrams).
+ *
+ * If any of the messages does not request an acknowledgment, e.g. because
+ * Auto-ACK mode has been disabled, an `NLMSG_NOOP` request asking for an
+ * ACK is appended. Since the kernel processes messages in order, its ACK
+ * tells nl_send_batch_wait() that all errors must have arrived.
+ *
+ * The messages are addressed to the peer of the socket, destination
+ * addresses and credentials stored in the individual messages are not
+ * taken into account.
+ *
+ * @callback This function triggers the `NL_CB_MSG_OUT` callback for each
+ *           message. If the callback does not return NL_OK, none of the
+ *           messages added since the last flush are transmitted and they
+ *           are dropped. A negative error code returned by the callback is
+ *           passed on, NL_SKIP and NL_STOP are reported as -NLE_INVAL.
+ *           Messages transmitted by earlier flushes remain in the batch
+ *           until nl_send_batch_wait() collects their replies.
+ *
+ * @note Each reply occupies receive buffer space until it is read. When
+ *       flushing many messages at once, make sure the receive buffer is
+ *       large enough (nl_socket_set_buffer_size()) or replies are lost.
+ *
+ * @return Number of messages transmitted or a negative error code.
+ */
+int nl_send_batch_flush(struct nl_send_batch *b)
+{
+	struct nl_sock *sk = b->sb_sock;
+	struct nl_cb *cb = sk->s_cb;
+	_nl_auto_free struct iovec *iov = NULL;
+	_nl_auto_free struct mmsghdr *hdrs = NULL;
+	size_t limit, bytes, i, first, nhdrs, nsent;
+	int need_barrier = 0;
+	int err;
+
+	if (sk->s_fd < 0)
+		return -NLE_BAD_SOCK;
+
+	first = b->sb_nsent;
+	if (first == b->sb_nmsgs)
+		return 0;
+
+	for (i = first; i < b->sb_nmsgs; i++) {
+		if (!(nlmsg_hdr(b->sb_msgs[i])->nlmsg_flags & NLM_F_ACK))
+			need_barrier = 1;
+	}
+
+	if (need_barrier) {
+		struct nl_msg *barrier;
+		struct nlmsghdr *nlh;
+
+		barrier = nlmsg_alloc_simple(NLMSG_NOOP, NLM_F_REQUEST | NLM_F_ACK);
+		if (!barrier)
+			return -NLE_NOMEM;
+
+		nlh = nlmsg_hdr(barrier);
+		nlh->nlmsg_pid = nl_socket_get_local_port(sk);
+		nlh->nlmsg_seq = sk->s_seq_next++;
+
+		err = send_batch_append(b, barrier);
+		if (err < 0) {
+			nlmsg_free(barrier);
+			return err;
+		}
+	}
+
+	if (cb->cb_send_ow) {
+		/* Sending has been overwritten, hand out messages one by one */
+		for (i = first; i < b->sb_nmsgs; i++) {
+			err = nl_send(sk, b->sb_msgs[i]);
+			if (err < 0)
+				goto out;
+			b->sb_nsent = i + 1;
+		}
+		err = 0;
+		goto out;
+	}
+
+	iov = calloc(b->sb_nmsgs - first, sizeof(*iov));
+	hdrs = calloc(b->sb_nmsgs - first, sizeof(*hdrs));
+	if (!iov || !hdrs)
+		return -NLE_NOMEM;
+
+	limit = send_batch_limit(sk);
+	nhdrs = 0;
+	bytes = 0;
+
+	for (i = first; i < b->sb_nmsgs; i++) {
+		struct nl_msg *msg = b->sb_msgs[i];
+		struct nlmsghdr *nlh = nlmsg_hdr(msg);
+		struct iovec *v = &iov[i - first];
+		struct msghdr *hdr;
+
+		nlmsg_set_src(msg, &sk->s_local);
+		if (cb->cb_set[NL_CB_MSG_OUT]) {
+			if ((err = nl_cb_call(cb, NL_CB_MSG_OUT, msg)) != NL_OK) {
+				/* Earlier flushes still await their replies */
+				send_batch_drop_unsent(b);
+				return err < 0 ? err : -NLE_INVAL;
+			}
+		}
+
+		/* Messages are padded, they can be placed back to back */
+		v->iov_base = nlh;
+		v->iov_len = NLMSG_ALIGN(nlh->nlmsg_len);
+
+		hdr = nhdrs ? &hdrs[nhdrs - 1].msg_hdr : NULL;
+		if (!hdr || bytes + v->iov_len > limit ||
+		    hdr->msg_iovlen >= NL_SEND_BATCH_MAX_IOV) {
+			hdr = &hdrs[nhdrs++].msg_hdr;
+			hdr->msg_name = (void *) &sk->s_peer;
+			hdr->msg_namelen = sizeof(struct sockaddr_nl);
+			hdr->msg_iov = v;
+			bytes = 0;
+		}
+
+		hdr->msg_iovlen++;
+		bytes += v->iov_len;
+	}
+
+	for (i = 0, nsent = first; i < nhdrs; ) {
+		int n;
+
+		n = sendmmsg(sk->s_fd, &hdrs[i],
+			     _NL_MIN(nhdrs - i, (size_t) NL_SEND_BATCH_MAX_IOV), 0);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+
+			NL_DBG(4, "nl_send_batch_flush(%p): sendmmsg() failed with %d (%s)\n",
+				sk, errno, nl_strerror_l(errno));
+			err = -nl_syserr2nlerr(errno);
+			goto out;
+		}
+
+		NL_DBG(4, "nl_send_batch_flush(%p): sent %d datagrams\n", sk, n);
+
+		for (; n > 0; n--, i++)
+			nsent += hdrs[i].msg_hdr.msg_iovlen;
+		b->sb_nsent = nsent;
+	}
+
+	err = 0;
+out:
+	for (i = first; i < b->sb_nsent; i++) {
+		if (nlmsg_hdr(b->sb_msgs[i])->nlmsg_flags & NLM_F_ACK)
+			b->sb_nexpect++;
+	}
+
+	if (err < 0) {
+		send_batch_drop_unsent(b);
+		return err;
+	}
+
+	/* The barrier is not accounted for */
+	return b->sb_nsent - first - need_barrier;
+}
+
+/**
+ * Look up message of batch by sequence number
+ * @arg b		Batch (required)
+ * @arg seq		Sequence number
+ *
+ * Allows to map a reply, e.g. an error message received by a custom
+ * receive loop, back to the message it refers to.
+ *
+ * @return Message with sequence number \c seq or NULL. No reference is
+ *         acquired.
+ */
+struct nl_msg *nl_send_batch_find(struct nl_send_batch *b, uint32_t seq)
+{
+	size_t i;
+
+	if (b->sb_nmsgs == 0)
+		return NULL;
+
+	/* Sequence numbers are usually assigned consecutively */
+	i = seq - nlmsg_hdr(b->sb_msgs[0])->nlmsg_seq;
+	if (i < b->sb_nmsgs && nlmsg_hdr(b->sb_msgs[i])->nlmsg_seq == seq)
+		return b->sb_msgs[i];
+
+	for (i = 0; i < b->sb_nmsgs; i++) {
+		if (nlmsg_hdr(b->sb_msgs[i])->nlmsg_seq == seq)
+			return b->sb_msgs[i];
+	}
+
+	return NULL;
+}
+
+/** @cond SKIP */
+static int send_batch_seq_check(struct nl_msg *msg, void *arg)
+{
+	struct nl_send_batch *b = arg;
+
+	/* Replies arrive in order but not every message is answered */
+	if (!nl_send_batch_find(b, nlmsg_hdr(msg)->nlmsg_seq))
+		return NL_SKIP;
+
+	return NL_OK;
+}
+
+static int send_batch_ack(struct nl_msg *msg, void *arg)
+{
+	struct nl_send_batch *b = arg;
+
+	if (nl_send_batch_find(b, nlmsg_hdr(msg)->nlmsg_seq))
+		b->sb_ndone++;
+
+	return b->sb_ndone >= b->sb_nexpect ? NL_STOP : NL_OK;
+}
+
+static int send_batch_error(struct sockaddr_nl *nla, struct nlmsgerr *e,
+			    void *arg)
+{
+	struct nl_send_batch *b = arg;
+	struct nl_msg *msg;
+	int err = -nl_syserr2nlerr(e->error);
+
+	msg = nl_send_batch_find(b, e->msg.nlmsg_seq);
+	if (!msg)
+		return NL_SKIP;
+
+	if (nlmsg_hdr(msg)->nlmsg_flags & NLM_F_ACK)
+		b->sb_ndone++;
+
+	if (!b->sb_err)
+		b->sb_err = err;
+
+	if (b->sb_err_cb)
+		b->sb_err_cb(msg, err, b->sb_err_arg);
+
+	return NL_SKIP;
+}
+/** @endcond */
+
+/**
+ * Wait for the replies to all transmitted messages of a batch
+ * @arg b		Batch (required)
+ * @arg err_cb		Function called for each failed message (optional)
+ * @arg arg		Argument passed on to \c err_cb
+ *
+ * Receives replies until every message transmitted by nl_send_batch_flush()
+ * has been acknowledged or has failed. For every error message reported
+ * by the peer, the originating message is looked up by its sequence number
+ * and passed to \c err_cb together with the error code. Other messages
+ * are processed by the callbacks configured on the socket.
+ *
+ * Afterwards, the batch releases all transmitted messages and can be
+ * reused.
+ *
+ * @pre The netlink socket must be in blocking state.
+ *
+ * @return 0 if all messages succeeded, the error code of the first failed
+ *         message or a negative error code if receiving failed.
+ */
+int nl_send_batch_wait(struct nl_send_batch *b, nl_send_batch_err_cb_t err_cb,
+		       void *arg)
+{
+	struct nl_cb *cb;
+	int err = 0;
+
+	cb = nl_cb_clone(b->sb_sock->s_cb);
+	if (cb == NULL)
+		return -NLE_NOMEM;
+
+	b->sb_err = 0;
+	b->sb_err_cb = err_cb;
+	b->sb_err_arg = arg;
+
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, send_batch_ack, b);
+	nl_cb_err(cb, NL_CB_CUSTOM, send_batch_error, b);
+	if (!cb->cb_set[NL_CB_SEQ_CHECK])
+		nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM,
+			  send_batch_seq_check, b);
+
+	while (b->sb_ndone < b->sb_nexpect) {
+		err = nl_recvmsgs(b->sb_sock, cb);
+		if (err < 0)
+			break;
+	}
+
+	nl_cb_put(cb);
+
+	/* All replies have been consumed */
+	b->sb_sock->s_seq_expect = b->sb_sock->s_seq_next;
+
+	/* Keep messages not flushed yet */
+	if (b->sb_nsent) {
+		size_t i;
+
+		for (i = 0; i < b->sb_nsent; i++)
+			nlmsg_free(b->sb_msgs[i]);
+		memmove(b->sb_msgs, b->sb_msgs + b->sb_nsent,
+			(b->sb_nmsgs - b->sb_nsent) * sizeof(*b->sb_msgs));
+		b->sb_nmsgs -= b->sb_nsent;
+		b->sb_nsent = 0;
+	}
+	b->sb_nexpect = 0;
+	b->sb_ndone = 0;
+
+	if (err < 0)
+		return err;
+
+	return b->sb_err;
+}
+
+/**
+ * @name Asynchronous Requests
+ * @{
+ */
+
+/** @cond SKIP */
+#define NL_ASYNC_WINDOW_DEFAULT 64
+
+static struct nl_async_req *async_find(struct nl_async *as, uint32_t seq)
+{
+	unsigned int i;
+
+	/* Replies arrive in order, the oldest request is the likely match */
+	for (i = 0; i < as->as_count; i++) {
+		struct nl_async_req *r;
+
+		r = &as->as_reqs[(as->as_head + i) % as->as_window];
+		if (!r->ar_done && r->ar_seq == seq)
+			return r;
+	}
+
+	return NULL;
+}
+
+static void async_complete(struct nl_async *as, struct nl_async_req *r,
+			   int err)
+{
+	r->ar_done = 1;
+	r->ar_err = err;
+
+	/* Callbacks run in request order and only once the slot has been
+	 * released, a reply overtaking an older request waits for it */
+	while (as->as_count > 0 && as->as_reqs[as->as_head].ar_done) {
+		struct nl_async_req *head = &as->as_reqs[as->as_head];
+		struct nl_msg *msg = head->ar_msg;
+		nl_async_cb_t cb = head->ar_cb;
+		void *arg = head->ar_arg;
+
+		err = head->ar_err;
+		head->ar_msg = NULL;
+		as->as_head = (as->as_head + 1) % as->as_window;
+		as->as_count--;
+
+		if (err < 0 && !as->as_err)
+			as->as_err = err;
+
+		if (cb) {
+			as->as_busy++;
+			cb(msg, err, arg);
+			as->as_busy--;
+		}
+
+		nlmsg_free(msg);
+	}
+}
+
+static int async_seq_check(struct nl_msg *msg, void *arg)
+{
+	struct nl_sock *sk = arg;
+
+	if (!async_find(sk->s_async, nlmsg_hdr(msg)->nlmsg_seq))
+		return NL_SKIP;
+
+	return NL_OK;
+}
+
+static int async_ack(struct nl_msg *msg, void *arg)
+{
+	struct nl_sock *sk = arg;
+	struct nl_async_req *r;
+
+	r = async_find(sk->s_async, nlmsg_hdr(msg)->nlmsg_seq);
+	if (r)
+		async_complete(sk->s_async, r, 0);
+
+	return NL_OK;
+}
+
+static int async_error(struct sockaddr_nl *nla, struct nlmsgerr *e, void *arg)
+{
+	struct nl_sock *sk = arg;
+	struct nl_async_req *r;
+
+	r = async_find(sk->s_async, e->msg.nlmsg_seq);
+	if (r)
+		async_complete(sk->s_async, r, -nl_syserr2nlerr(e->error));
+
+	return NL_SKIP;
+}
+
+/*
+ * Process replies until less than limit requests are in flight. A limit
+ * of 0 processes a single round of nl_recvmsgs().
+ */
+static int async_recv(struct nl_sock *sk, unsigned int limit)
+{
+	struct nl_cb *cb;
+	int err;
+
+	/* Completion callbacks must not receive from within nl_recvmsgs() */
+	if (sk->s_async->as_busy)
+		return -NLE_BUSY;
+
+	cb = nl_cb_clone(sk->s_cb);
+	if (cb == NULL)
+		return -NLE_NOMEM;
+
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, async_ack, sk);
+	nl_cb_err(cb, NL_CB_CUSTOM, async_error, sk);
+	if (!cb->cb_set[NL_CB_SEQ_CHECK])
+		nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM,
+			  async_seq_check, sk);
+
+	do {
+		err = nl_recvmsgs(sk, cb);
+	} while (err >= 0 && limit && sk->s_async->as_count >= limit);
+
+	nl_cb_put(cb);
+
+	if (sk->s_async->as_count == 0)
+		sk->s_seq_expect = sk->s_seq_next;
+
+	return err < 0 ? err : 0;
+}
+/** @endcond */
+
+/**
+ * Send Netlink message without waiting for its acknowledgment
+ * @arg sk		Netlink socket (required)
+ * @arg msg		Netlink message (required)
+ * @arg cb		Completion callback (optional)
+ * @arg arg		Argument passed on to \c cb
+ *
+ * Completes the message using nl_complete_msg(), requests an ACK and
+ * sends it. Unlike nl_send_sync(), the function returns right away which
+ * allows to keep many requests in flight at once, up to the window size
+ * set with nl_socket_set_async_window(). If the window is full, replies
+ * are processed until a request has completed. On a non-blocking socket,
+ * -NLE_AGAIN is returned instead and the message is not sent.
+ *
+ * Once the ACK or error message carrying the sequence number of the
+ * request has been received, \c cb is called with the request and 0 or
+ * the error code reported by the peer. Callbacks are called in the order
+ * the requests were sent, a reply arriving before the one of an older
+ * request is held back until the older request has completed. Replies are
+ * processed by nl_async_process(), nl_async_wait() and by nl_send_async()
+ * itself. Other messages received in the meantime, e.g. replies to get
+ * requests, are handed to the callbacks configured on the socket.
+ *
+ * The slot of a request is released before its completion callback is
+ * called, so the callback may send a new request. Sending more requests
+ * than there are free slots from within a callback fails with -NLE_BUSY,
+ * as do nl_async_process() and nl_async_wait().
+ *
+ * @see nl_async_wait()
+ *
+ * @return 0 on success or a negative error code.
+ */
+int nl_send_async(struct nl_sock *sk, struct nl_msg *msg, nl_async_cb_t cb,
+		  void *arg)
+{
+	struct nl_async *as;
+	struct nl_async_req *r;
+	int err;
+
+	if (!sk->s_async) {
+		err = nl_socket_set_async_window(sk, NL_ASYNC_WINDOW_DEFAULT);
+		if (err < 0)
+			return err;
+	}
+
+	as = sk->s_async;
+	if (as->as_count >= as->as_window) {
+		err = async_recv(sk, as->as_window);
+
+		/* A non-blocking socket may have run dry after a slot
+		 * has been released */
+		if (err < 0 &&
+		    (err != -NLE_AGAIN || as->as_count >= as->as_window))
+			return err;
+	}
+
+	nl_complete_msg(sk, msg);
+	nlmsg_hdr(msg)->nlmsg_flags |= NLM_F_ACK;
+
+	err = nl_send(sk, msg);
+	if (err < 0)
+		return err;
+
+	r = &as->as_reqs[(as->as_head + as->as_count) % as->as_window];
+	r->ar_seq = nlmsg_hdr(msg)->nlmsg_seq;
+	r->ar_done = 0;
+	r->ar_msg = msg;
+	r->ar_cb = cb;
+	r->ar_arg = arg;
+	as->as_count++;
+
+	nlmsg_get(msg);
+
+	return 0;
+}
+
 /**
- * Receive data from netlink socket
+ * Process replies to asynchronous requests
  * @arg sk		Netlink socket (required)
- * @arg nla		Netlink socket structure to hold address of peer (required)
- * @arg buf		Destination pointer for message content (required)
- * @arg creds		Destination pointer for credentials (optional)
- *
- * Receives data from a connected netlink socket using recvmsg() and returns
- * the number of bytes read. The read data is stored in a newly allocated
- * buffer that is assigned to \c *buf. The peer's netlink address will be
- * stored in \c *nla.
- *
- * This function blocks until data is available to be read unless the socket
- * has been put into non-blocking mode using nl_socket_set_nonblocking() in
- * which case this function will return immediately with a return value of
- * -NLA_AGAIN (versions before 3.2.22 returned instead 0, in which case you
- * should check first clear errno and then check for errno EAGAIN).
  *
- * The buffer size used when reading from the netlink socket and thus limiting
- * the maximum size of a netlink message that can be read defaults to the size
- * of a memory page (getpagesize()). The buffer size can be modified on a per
- * socket level using the function nl_socket_set_msg_buf_size().
- *
- * If message peeking is enabled using nl_socket_enable_msg_peek() the size of
- * the message to be read will be determined using the MSG_PEEK flag prior to
- * performing the actual read. This leads to an additional recvmsg() call for
- * every read operation which has performance implications and is not
- * recommended for high throughput protocols.
+ * Receives and processes the pending replies like a single call to
+ * nl_recvmsgs() would and completes the requests they refer to. Intended
+ * for event loops which poll() the socket file descriptor.
  *
- * An eventual interruption of the recvmsg() system call is automatically
- * handled by retrying the operation.
+ * @return 0 on success or a negative error code.
+ */
+int nl_async_process(struct nl_sock *sk)
+{
+	if (!sk->s_async || sk->s_async->as_count == 0)
+		return 0;
+
+	return async_recv(sk, 0);
+}
+
+/**
+ * Wait for all asynchronous requests to complete
+ * @arg sk		Netlink socket (required)
  *
- * If receiving of credentials has been enabled using the function
- * nl_socket_set_passcred(), this function will allocate a new struct ucred
- * filled with the received credentials and assign it to \c *creds. The caller
- * is responsible for freeing the buffer.
+ * Processes replies until every request sent by nl_send_async() has been
+ * acknowledged or has failed.
  *
- * @note The caller is responsible to free the returned data buffer and if
- *       enabled, the credentials buffer.
+ * @pre The netlink socket must be in blocking state.
  *
- * @see nl_socket_set_nonblocking()
- * @see nl_socket_set_msg_buf_size()
- * @see nl_socket_enable_msg_peek()
- * @see nl_socket_set_passcred()
+ * @return 0 if all requests completed successfully, the error code of the
+ *         first failed request since the previous call or a negative error
+ *         code if receiving failed.
+ */
+int nl_async_wait(struct nl_sock *sk)
+{
+	struct nl_async *as = sk->s_async;
+	int err;
+
+	if (!as)
+		return 0;
+
+	if (as->as_count > 0) {
+		err = async_recv(sk, 1);
+		if (err < 0)
+			return err;
+	}
+
+	err = as->as_err;
+	as->as_err = 0;
+
+	return err;
+}
+
+/** @} */
+
+/**
+ * @name Receive
+ * @{
+ */
+
+/** @cond SKIP */
+static size_t default_recv_bufsize(void)
+{
+	static size_t page_size = 0; /* GLOBAL! */
+
+	if (page_size == 0)
+		page_size = getpagesize() * 4;
+
+	return page_size;
+}
+
+/*
+ * Performs the actual recvmsg() into the buffer described by @iov. If
+ * @flags contains MSG_PEEK, the buffer is enlarged as needed before the
+ * message is read. Otherwise a truncated message results in -NLE_MSG_TRUNC,
+ * if MSG_TRUNC is given the buffer is still enlarged to the size of the
+ * truncated message so that the next message of that size fits.
  *
- * @return Number of bytes read, 0 on EOF, 0 on no data event (non-blocking
- *         mode), or a negative error code.
+ * The buffer remains owned by the caller, also on error.
  */
-int nl_recv(struct nl_sock *sk, struct sockaddr_nl *nla,
-	    unsigned char **buf, struct ucred **creds)
+static int _nl_recv(struct nl_sock *sk, struct sockaddr_nl *nla,
+		    struct iovec *iov, int flags, struct ucred **creds)
 {
 	ssize_t n;
-	int flags = 0;
-	static int page_size = 0; /* GLOBAL! */
-	struct iovec iov;
 	struct msghdr msg = {
 		.msg_name = (void *) nla,
 		.msg_namelen = sizeof(struct sockaddr_nl),
-		.msg_iov = &iov,
+		.msg_iov = iov,
 		.msg_iovlen = 1,
 	};
 	struct ucred* tmpcreds = NULL;
 	int retval = 0;
 
-	if (!buf || !nla)
-		return -NLE_INVAL;
-
-	if (   (sk->s_flags & NL_MSG_PEEK)
-	    || (!(sk->s_flags & NL_MSG_PEEK_EXPLICIT) && sk->s_bufsize == 0))
-		flags |= MSG_PEEK | MSG_TRUNC;
-
-	if (page_size == 0)
-		page_size = getpagesize() * 4;
-
-	iov.iov_len = sk->s_bufsize ? sk->s_bufsize : ((size_t)page_size);
-	iov.iov_base = malloc(iov.iov_len);
-
-	if (!iov.iov_base) {
-		retval = -NLE_NOMEM;
-		goto abort;
-	}
-
 	if (creds && (sk->s_flags & NL_SOCK_PASSCRED)) {
 		msg.msg_controllen = CMSG_SPACE(sizeof(struct ucred));
 		msg.msg_control = malloc(msg.msg_controllen);
@@ -709,6 +1381,9 @@ retry:
 			goto retry;
 		}
 
+		if (errno == ENOBUFS)
+			sk->s_overruns++;
+
 		NL_DBG(4, "recvmsg(%p): nl_recv() failed with %d (%s)\n",
 			sk, errno, nl_strerror_l(errno));
 		retval = -nl_syserr2nlerr(errno);
@@ -734,30 +1409,40 @@ retry:
 		goto retry;
 	}
 
-	if (iov.iov_len < ((size_t)n) || (msg.msg_flags & MSG_TRUNC)) {
+	if (iov->iov_len < ((size_t)n) || (msg.msg_flags & MSG_TRUNC)) {
 		void *tmp;
 
 		/* respond with error to an incomplete message */
-		if (flags == 0) {
+		if (!(flags & MSG_PEEK)) {
 			retval = -NLE_MSG_TRUNC;
+
+			/* The message is lost but with MSG_TRUNC we know
+			 * its size, make room for the next one. */
+			if ((flags & MSG_TRUNC) && iov->iov_len < ((size_t)n)) {
+				tmp = realloc(iov->iov_base, n);
+				if (tmp) {
+					iov->iov_base = tmp;
+					iov->iov_len = n;
+				}
+			}
 			goto abort;
 		}
 
 		/* Provided buffer is not long enough, enlarge it
 		 * to size of n (which should be total length of the message)
 		 * and try again. */
-		iov.iov_len = n;
-		tmp = realloc(iov.iov_base, iov.iov_len);
+		tmp = realloc(iov->iov_base, n);
 		if (!tmp) {
 			retval = -NLE_NOMEM;
 			goto abort;
 		}
-		iov.iov_base = tmp;
+		iov->iov_base = tmp;
+		iov->iov_len = n;
 		flags = 0;
 		goto retry;
 	}
 
-	if (flags != 0) {
+	if (flags & MSG_PEEK) {
 		/* Buffer is big enough, do the actual reading */
 		flags = 0;
 		goto retry;
@@ -791,18 +1476,285 @@ abort:
 	free(msg.msg_control);
 
 	if (retval <= 0) {
-		free(iov.iov_base);
-		iov.iov_base = NULL;
 		free(tmpcreds);
 		tmpcreds = NULL;
-	} else
-		*buf = iov.iov_base;
+	}
 
 	if (creds)
 		*creds = tmpcreds;
 
 	return retval;
 }
+/** @endcond */
+
+/**
+ * Receive data from netlink socket
+ * @arg sk		Netlink socket (required)
+ * @arg nla		Netlink socket structure to hold address of peer (required)
+ * @arg buf		Destination pointer for message content (required)
+ * @arg creds		Destination pointer for credentials (optional)
+ *
+ * Receives data from a connected netlink socket using recvmsg() and returns
+ * the number of bytes read. The read data is stored in a newly allocated
+ * buffer that is assigned to \c *buf. The peer's netlink address will be
+ * stored in \c *nla.
+ *
+ * This function blocks until data is available to be read unless the socket
+ * has been put into non-blocking mode using nl_socket_set_nonblocking() in
+ * which case this function will return immediately with a return value of
+ * -NLA_AGAIN (versions before 3.2.22 returned instead 0, in which case you
+ * should check first clear errno and then check for errno EAGAIN).
+ *
+ * The buffer size used when reading from the netlink socket and thus limiting
+ * the maximum size of a netlink message that can be read defaults to the size
+ * of a memory page (getpagesize()). The buffer size can be modified on a per
+ * socket level using the function nl_socket_set_msg_buf_size().
+ *
+ * If message peeking is enabled using nl_socket_enable_msg_peek() the size of
+ * the message to be read will be determined using the MSG_PEEK flag prior to
+ * performing the actual read. This leads to an additional recvmsg() call for
+ * every read operation which has performance implications and is not
+ * recommended for high throughput protocols.
+ *
+ * An eventual interruption of the recvmsg() system call is automatically
+ * handled by retrying the operation.
+ *
+ * If receiving of credentials has been enabled using the function
+ * nl_socket_set_passcred(), this function will allocate a new struct ucred
+ * filled with the received credentials and assign it to \c *creds. The caller
+ * is responsible for freeing the buffer.
+ *
+ * @note The caller is responsible to free the returned data buffer and if
+ *       enabled, the credentials buffer.
+ *
+ * @see nl_socket_set_nonblocking()
+ * @see nl_socket_set_msg_buf_size()
+ * @see nl_socket_enable_msg_peek()
+ * @see nl_socket_set_passcred()
+ *
+ * @return Number of bytes read, 0 on EOF, 0 on no data event (non-blocking
+ *         mode), or a negative error code.
+ */
+int nl_recv(struct nl_sock *sk, struct sockaddr_nl *nla,
+	    unsigned char **buf, struct ucred **creds)
+{
+	int flags = 0;
+	struct iovec iov;
+	int retval;
+
+	if (!buf || !nla)
+		return -NLE_INVAL;
+
+	if (   (sk->s_flags & NL_MSG_PEEK)
+	    || (!(sk->s_flags & NL_MSG_PEEK_EXPLICIT) && sk->s_bufsize == 0))
+		flags |= MSG_PEEK | MSG_TRUNC;
+
+	iov.iov_len = sk->s_bufsize ? sk->s_bufsize : default_recv_bufsize();
+	iov.iov_base = malloc(iov.iov_len);
+
+	if (!iov.iov_base) {
+		if (creds)
+			*creds = NULL;
+		return -NLE_NOMEM;
+	}
+
+	retval = _nl_recv(sk, nla, &iov, flags, creds);
+	if (retval <= 0)
+		free(iov.iov_base);
+	else
+		*buf = iov.iov_base;
+
+	return retval;
+}
+
+/** @cond SKIP */
+/*
+ * Receives into the persistent receive buffer of the socket, see
+ * nl_socket_enable_recv_buf(). The buffer is reused as long as no borrowed
+ * message still refers to it. On success, a reference to the buffer is
+ * returned in @rxbuf.
+ */
+static int nl_recv_rxbuf(struct nl_sock *sk, struct sockaddr_nl *nla,
+			 struct nl_rxbuf **rxbuf, struct ucred **creds)
+{
+	struct nl_rxbuf *rb = sk->s_rxbuf;
+	size_t size;
+	struct iovec iov;
+	int flags = MSG_TRUNC;
+	int retval;
+
+	size = sk->s_bufsize ? sk->s_bufsize : default_recv_bufsize();
+
+	if (rb && _nl_refcnt_read(&rb->rb_refcnt) > 1) {
+		/* Still pinned by messages handed out earlier */
+		_nl_rxbuf_put(rb);
+		sk->s_rxbuf = rb = NULL;
+	}
+
+	if (!rb) {
+		unsigned char *data;
+
+		size = _NL_MAX(size, sk->s_rxbuf_size);
+		data = malloc(size);
+		if (!data)
+			goto nomem;
+
+		rb = _nl_rxbuf_alloc(data, size);
+		if (!rb) {
+			free(data);
+			goto nomem;
+		}
+		sk->s_rxbuf = rb;
+	} else if (rb->rb_size < size) {
+		void *tmp;
+
+		tmp = realloc(rb->rb_data, size);
+		if (!tmp)
+			goto nomem;
+		rb->rb_data = tmp;
+		rb->rb_size = size;
+	}
+
+	if (sk->s_flags & NL_MSG_PEEK)
+		flags |= MSG_PEEK;
+
+	iov.iov_base = rb->rb_data;
+	iov.iov_len = rb->rb_size;
+
+	retval = _nl_recv(sk, nla, &iov, flags, creds);
+
+	rb->rb_data = iov.iov_base;
+	if (iov.iov_len > rb->rb_size) {
+		NL_DBG(3, "nl_recv_rxbuf(%p): Receive buffer grown from %zu "
+		       "to %zu bytes\n", sk, rb->rb_size, iov.iov_len);
+		rb->rb_size = iov.iov_len;
+		sk->s_rxbuf_grows++;
+	}
+	sk->s_rxbuf_size = rb->rb_size;
+
+	if (retval > 0) {
+		_nl_refcnt_inc(&rb->rb_refcnt);
+		*rxbuf = rb;
+	}
+
+	return retval;
+
+nomem:
+	if (creds)
+		*creds = NULL;
+	return -NLE_NOMEM;
+}
+/** @endcond */
+
+/** @cond SKIP */
+/*
+ * Returns the next datagram from the batch ring of the socket, see
+ * nl_socket_set_recv_batch(). If all datagrams of the previous batch have
+ * been consumed, the ring is refilled with a single recvmmsg(). On success,
+ * a reference to the buffer holding the datagram is returned in @rxbuf.
+ */
+static int nl_recv_batch(struct nl_sock *sk, struct sockaddr_nl *nla,
+			 struct nl_rxbuf **rxbuf)
+{
+	struct nl_rxbatch *rq = sk->s_rxbatch;
+	struct mmsghdr *m;
+	unsigned int i;
+	int n;
+
+	if (rq->rq_head >= rq->rq_count) {
+		for (i = 0; i < rq->rq_size; i++) {
+			struct nl_rxbuf *rb = rq->rq_bufs[i];
+
+			if (rb && (_nl_refcnt_read(&rb->rb_refcnt) > 1 ||
+				   rb->rb_size < rq->rq_bufsize)) {
+				/* Still pinned by borrowed messages or
+				 * too small after a truncated datagram */
+				_nl_rxbuf_put(rb);
+				rq->rq_bufs[i] = rb = NULL;
+			}
+
+			if (!rb) {
+				unsigned char *data;
+
+				data = malloc(rq->rq_bufsize);
+				if (!data)
+					return -NLE_NOMEM;
+
+				rb = _nl_rxbuf_alloc(data, rq->rq_bufsize);
+				if (!rb) {
+					free(data);
+					return -NLE_NOMEM;
+				}
+				rq->rq_bufs[i] = rb;
+			}
+
+			rq->rq_iov[i].iov_base = rb->rb_data;
+			rq->rq_iov[i].iov_len = rb->rb_size;
+			rq->rq_msgs[i].msg_hdr = (struct msghdr) {
+				.msg_name = (void *) &rq->rq_addr[i],
+				.msg_namelen = sizeof(struct sockaddr_nl),
+				.msg_iov = &rq->rq_iov[i],
+				.msg_iovlen = 1,
+			};
+			rq->rq_msgs[i].msg_len = 0;
+		}
+
+retry:
+		n = recvmmsg(sk->s_fd, rq->rq_msgs, rq->rq_size,
+			     MSG_WAITFORONE | MSG_TRUNC, NULL);
+		if (!n)
+			return 0;
+		if (n < 0) {
+			if (errno == EINTR) {
+				NL_DBG(3, "recvmmsg() returned EINTR, retrying\n");
+				goto retry;
+			}
+
+			if (errno == ENOBUFS)
+				sk->s_overruns++;
+
+			NL_DBG(4, "recvmmsg(%p): nl_recv_batch() failed with %d (%s)\n",
+				sk, errno, nl_strerror_l(errno));
+			return -nl_syserr2nlerr(errno);
+		}
+
+		NL_DBG(3, "nl_recv_batch(%p): Read %d datagrams with one "
+		       "system call\n", sk, n);
+
+		rq->rq_head = 0;
+		rq->rq_count = n;
+		rq->rq_saved += n - 1;
+	}
+
+	i = rq->rq_head++;
+	m = &rq->rq_msgs[i];
+
+	if (m->msg_len == 0)
+		return 0;
+
+	if (m->msg_len > rq->rq_iov[i].iov_len ||
+	    (m->msg_hdr.msg_flags & MSG_TRUNC)) {
+		/* The datagram is lost, make room for the next one */
+		if (m->msg_len > rq->rq_bufsize) {
+			NL_DBG(3, "nl_recv_batch(%p): Batch buffers grown from "
+			       "%zu to %u bytes\n", sk, rq->rq_bufsize,
+			       m->msg_len);
+			rq->rq_bufsize = m->msg_len;
+			sk->s_rxbuf_grows++;
+		}
+		return -NLE_MSG_TRUNC;
+	}
+
+	if (m->msg_hdr.msg_namelen != sizeof(struct sockaddr_nl))
+		return -NLE_NOADDR;
+
+	memcpy(nla, &rq->rq_addr[i], sizeof(*nla));
+	_nl_refcnt_inc(&rq->rq_bufs[i]->rb_refcnt);
+	*rxbuf = rq->rq_bufs[i];
+
+	return m->msg_len;
+}
+/** @endcond */
 
 /** @cond SKIP */
 #define NL_CB_CALL(cb, type, msg) \
@@ -822,6 +1774,15 @@ do { \
 } while (0)
 /** @endcond */
 
+static void recvmsgs_put_msg(struct nl_sock *sk, struct nl_msg *msg)
+{
+	/* An unused borrowed message is kept for the next call */
+	if (!sk->s_rxmsg)
+		sk->s_rxmsg = _nlmsg_borrow_release(msg);
+	else
+		nlmsg_free(msg);
+}
+
 static int recvmsgs(struct nl_sock *sk, struct nl_cb *cb)
 {
 	int n, err = 0, multipart = 0, interrupted = 0, nrecv = 0;
@@ -836,11 +1797,16 @@ static int recvmsgs(struct nl_sock *sk, struct nl_cb *cb)
 	struct sockaddr_nl nla = {0};
 	struct nl_msg *msg = NULL;
 	struct ucred *creds = NULL;
+	struct nl_rxbuf *rxbuf = NULL;
 
 continue_reading:
 	NL_DBG(3, "Attempting to read from %p\n", sk);
 	if (cb->cb_recv_ow)
 		n = cb->cb_recv_ow(sk, &nla, &buf, &creds);
+	else if (sk->s_rxbatch && !(sk->s_flags & NL_SOCK_PASSCRED))
+		n = nl_recv_batch(sk, &nla, &rxbuf);
+	else if (sk->s_flags & NL_RECV_BUF)
+		n = nl_recv_rxbuf(sk, &nla, &rxbuf, &creds);
 	else
 		n = nl_recv(sk, &nla, &buf, &creds);
 
@@ -849,12 +1815,32 @@ continue_reading:
 
 	NL_DBG(3, "recvmsgs(%p): Read %d bytes\n", sk, n);
 
-	hdr = (struct nlmsghdr *) buf;
+	if (!rxbuf && (sk->s_flags & NL_RECV_ZEROCOPY)) {
+		/* Messages are handed out as views into the buffer */
+		rxbuf = _nl_rxbuf_alloc(buf, n);
+		if (!rxbuf) {
+			err = -NLE_NOMEM;
+			goto out;
+		}
+		buf = NULL;
+	}
+
+	hdr = (struct nlmsghdr *) (rxbuf ? rxbuf->rb_data : buf);
 	while (nlmsg_ok(hdr, n)) {
 		NL_DBG(3, "recvmsgs(%p): Processing valid message...\n", sk);
 
-		nlmsg_free(msg);
-		msg = nlmsg_convert(hdr);
+		if (sk->s_flags & NL_RECV_ZEROCOPY) {
+			/* The message of the previous call is reused unless
+			 * a callback kept a reference to it */
+			if (!msg) {
+				msg = sk->s_rxmsg;
+				sk->s_rxmsg = NULL;
+			}
+			msg = _nlmsg_borrow_reuse(msg, rxbuf, hdr);
+		} else {
+			nlmsg_free(msg);
+			msg = nlmsg_convert(hdr);
+		}
 		if (!msg) {
 			err = -NLE_NOMEM;
 			goto out;
@@ -1010,11 +1996,13 @@ skip:
 		hdr = nlmsg_next(hdr, &n);
 	}
 
-	nlmsg_free(msg);
+	recvmsgs_put_msg(sk, msg);
+	_nl_rxbuf_put(rxbuf);
 	free(buf);
 	free(creds);
 	buf = NULL;
 	msg = NULL;
+	rxbuf = NULL;
 	creds = NULL;
 
 	if (multipart) {
@@ -1024,7 +2012,8 @@ skip:
 stop:
 	err = 0;
 out:
-	nlmsg_free(msg);
+	recvmsgs_put_msg(sk, msg);
+	_nl_rxbuf_put(rxbuf);
 	free(buf);
 	free(creds);
 
@@ -209,9 +209,9 @@ void nl_object_free(struct nl_object *obj)
  */
 void nl_object_get(struct nl_object *obj)
 {
-	obj->ce_refcnt++;
-	NL_DBG(4, "New reference to object %p, total %d\n",
-	       obj, obj->ce_refcnt);
+	int refcnt = _nl_refcnt_inc(&obj->ce_refcnt);
+
+	NL_DBG(4, "New reference to object %p, total %d\n", obj, refcnt);
 }
 
 /**
@@ -220,17 +220,19 @@ void nl_object_get(struct nl_object *obj)
  */
 void nl_object_put(struct nl_object *obj)
 {
+	int refcnt;
+
 	if (!obj)
 		return;
 
-	obj->ce_refcnt--;
+	refcnt = _nl_refcnt_dec(&obj->ce_refcnt);
 	NL_DBG(4, "Returned object reference %p, %d remaining\n",
-	       obj, obj->ce_refcnt);
+	       obj, refcnt);
 
-	if (obj->ce_refcnt < 0)
+	if (refcnt < 0)
 		BUG();
 
-	if (obj->ce_refcnt <= 0)
+	if (refcnt <= 0)
 		nl_object_free(obj);
 }
 
@@ -241,7 +243,7 @@ void nl_object_put(struct nl_object *obj)
  */
 int nl_object_shared(struct nl_object *obj)
 {
-	return obj->ce_refcnt > 1;
+	return _nl_refcnt_read(&obj->ce_refcnt) > 1;
 }
 
 /** @} */
@@ -461,25 +463,35 @@ char *nl_object_attr_list(struct nl_object *obj, char *buf, size_t len)
 	return nl_object_attrs2str(obj, obj->ce_mask, buf, len);
 }
 
+/** @cond SKIP */
+uint32_t _nl_object_hash(struct nl_object *obj)
+{
+	struct nl_object_ops *ops = obj_ops(obj);
+
+	if (!(obj->ce_flags & NL_OBJ_HASHED)) {
+		obj->ce_hash = ops->oo_keygen ? ops->oo_keygen(obj) : 0;
+		obj->ce_flags |= NL_OBJ_HASHED;
+	}
+
+	return obj->ce_hash;
+}
+/** @endcond */
+
 /**
  * Generate object hash key
  * @arg obj		the object
  * @arg hashkey		destination buffer to be used for key stream
  * @arg hashtbl_sz	hash table size
  *
+ * The hash is computed once and cached in the object until one of its
+ * identity attributes is modified.
+ *
  * @return hash key in destination buffer
  */
 void nl_object_keygen(struct nl_object *obj, uint32_t *hashkey,
 		      uint32_t hashtbl_sz)
 {
-	struct nl_object_ops *ops = obj_ops(obj);
-
-	if (ops->oo_keygen)
-		ops->oo_keygen(obj, hashkey, hashtbl_sz);
-	else
-		*hashkey = 0;
-
-	return;
+	*hashkey = _nl_object_hash(obj) % hashtbl_sz;
 }
 
 /** @} */
@@ -497,7 +509,7 @@ void nl_object_keygen(struct nl_object *obj, uint32_t *hashkey,
  */
 int nl_object_get_refcnt(struct nl_object *obj)
 {
-	return obj->ce_refcnt;
+	return _nl_refcnt_read(&obj->ce_refcnt);
 }
 
 /**
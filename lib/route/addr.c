@@ -108,6 +108,7 @@
 #include <netlink/route/route.h>
 #include <netlink/route/link.h>
 #include <netlink/utils.h>
+#include <netlink/hashtable.h>
 
 #include "nl-route.h"
 #include "nl-priv-dynamic-core/nl-core.h"
@@ -402,9 +403,42 @@ errout_nomem:
 	goto errout;
 }
 
+static int addr_msg_filter(struct nl_cache *cache, struct nlmsghdr *nlh)
+{
+	struct rtnl_addr *filter = (struct rtnl_addr *) cache->c_filter;
+	struct ifaddrmsg *ifa = nlmsg_data(nlh);
+
+	if ((filter->ce_mask & ADDR_ATTR_FAMILY) &&
+	    filter->a_family != ifa->ifa_family)
+		return NL_SKIP;
+
+	if ((filter->ce_mask & ADDR_ATTR_IFINDEX) &&
+	    filter->a_ifindex != ifa->ifa_index)
+		return NL_SKIP;
+
+	if ((filter->ce_mask & ADDR_ATTR_PREFIXLEN) &&
+	    filter->a_prefixlen != ifa->ifa_prefixlen)
+		return NL_SKIP;
+
+	return NL_OK;
+}
+
 static int addr_request_update(struct nl_cache *cache, struct nl_sock *sk)
 {
-	return nl_rtgen_request(sk, RTM_GETADDR, AF_UNSPEC, NLM_F_DUMP);
+	struct rtnl_addr *filter = (struct rtnl_addr *) cache->c_filter;
+	struct ifaddrmsg ifa = { 0 };
+
+	if (!filter)
+		return nl_rtgen_request(sk, RTM_GETADDR, AF_UNSPEC, NLM_F_DUMP);
+
+	/* Strict checking requires a full header and filters by family
+	 * and interface */
+	if (filter->ce_mask & ADDR_ATTR_FAMILY)
+		ifa.ifa_family = filter->a_family;
+	if (filter->ce_mask & ADDR_ATTR_IFINDEX)
+		ifa.ifa_index = filter->a_ifindex;
+
+	return nl_send_simple(sk, RTM_GETADDR, NLM_F_DUMP, &ifa, sizeof(ifa));
 }
 
 static void addr_dump_line(struct nl_object *obj, struct nl_dump_params *p)
@@ -506,6 +540,32 @@ static void addr_dump_stats(struct nl_object *obj, struct nl_dump_params *p)
 	addr_dump_details(obj, p);
 }
 
+static uint32_t addr_keygen(struct nl_object *obj)
+{
+	struct rtnl_addr *addr = (struct rtnl_addr *) obj;
+	struct addr_hash_key {
+		uint32_t	a_family;
+		uint32_t	a_ifindex;
+	} _nl_packed akey;
+	char buf[INET6_ADDRSTRLEN+5];
+	uint32_t hash;
+
+	akey.a_family = addr->a_family;
+	akey.a_ifindex = addr->a_ifindex;
+
+	/* The peer is compared by prefix only, leave it out */
+	hash = nl_hash(&akey, sizeof(akey), 0);
+	if (addr->a_local)
+		hash = nl_hash(nl_addr_get_binary_addr(addr->a_local),
+			       nl_addr_get_len(addr->a_local), hash);
+
+	NL_DBG(5, "addr %p key (fam %d dev %d local %s) hash 0x%x\n",
+	       addr, akey.a_family, akey.a_ifindex,
+	       nl_addr2str(addr->a_local, buf, sizeof(buf)), hash);
+
+	return hash;
+}
+
 static uint32_t addr_id_attrs_get(struct nl_object *obj)
 {
 	struct rtnl_addr *addr = (struct rtnl_addr *)obj;
@@ -641,6 +701,7 @@ struct rtnl_addr *rtnl_addr_get(struct nl_cache *cache, int ifindex,
 	if (cache->c_ops != &rtnl_addr_ops)
 		return NULL;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(a, &cache->c_items, ce_list) {
 		if (ifindex != 0 && a->a_ifindex != ((unsigned)ifindex))
 			continue;
@@ -648,9 +709,11 @@ struct rtnl_addr *rtnl_addr_get(struct nl_cache *cache, int ifindex,
 		if (a->ce_mask & ADDR_ATTR_LOCAL &&
 		    !nl_addr_cmp(a->a_local, addr)) {
 			nl_object_get((struct nl_object *) a);
+			nl_cache_read_unlock(cache);
 			return a;
 		}
 	}
+	nl_cache_read_unlock(cache);
 
 	return NULL;
 }
@@ -903,6 +966,7 @@ void rtnl_addr_set_ifindex(struct rtnl_addr *addr, int ifindex)
 {
 	addr->a_ifindex = ifindex;
 	addr->ce_mask |= ADDR_ATTR_IFINDEX;
+	nl_object_invalidate_hash(addr);
 }
 
 int rtnl_addr_get_ifindex(struct rtnl_addr *addr)
@@ -921,6 +985,7 @@ void rtnl_addr_set_link(struct rtnl_addr *addr, struct rtnl_link *link)
 	addr->a_link = link;
 	addr->a_ifindex = link->l_index;
 	addr->ce_mask |= ADDR_ATTR_IFINDEX;
+	nl_object_invalidate_hash(addr);
 }
 
 struct rtnl_link *rtnl_addr_get_link(struct rtnl_addr *addr)
@@ -937,6 +1002,7 @@ void rtnl_addr_set_family(struct rtnl_addr *addr, int family)
 {
 	addr->a_family = family;
 	addr->ce_mask |= ADDR_ATTR_FAMILY;
+	nl_object_invalidate_hash(addr);
 }
 
 int rtnl_addr_get_family(struct rtnl_addr *addr)
@@ -1037,6 +1103,8 @@ static inline int __assign_addr(struct rtnl_addr *addr, struct nl_addr **pos,
 		addr->ce_mask &= ~flag;
 	}
 
+	nl_object_invalidate_hash(addr);
+
 	return 0;
 }
 
@@ -1210,6 +1278,7 @@ static struct nl_object_ops addr_obj_ops = {
 	    [NL_DUMP_STATS]	= addr_dump_stats,
 	},
 	.oo_compare		= addr_compare,
+	.oo_keygen		= addr_keygen,
 	.oo_attrs2str		= addr_attrs2str,
 	.oo_id_attrs_get	= addr_id_attrs_get,
 	.oo_id_attrs		= (ADDR_ATTR_FAMILY | ADDR_ATTR_IFINDEX |
@@ -1235,6 +1304,7 @@ static struct nl_cache_ops rtnl_addr_ops = {
 	.co_groups		= addr_groups,
 	.co_request_update      = addr_request_update,
 	.co_msg_parser          = addr_msg_parser,
+	.co_msg_filter		= addr_msg_filter,
 	.co_obj_ops		= &addr_obj_ops,
 };
 
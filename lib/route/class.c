@@ -358,13 +358,17 @@ struct rtnl_class *rtnl_class_get(struct nl_cache *cache, int ifindex,
 	if (cache->c_ops != &rtnl_class_ops)
 		return NULL;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(class, &cache->c_items, ce_list) {
 		if (class->c_handle == handle &&
 		    class->c_ifindex == ((unsigned)ifindex)) {
 			nl_object_get((struct nl_object *) class);
+			nl_cache_read_unlock(cache);
 			return class;
 		}
 	}
+	nl_cache_read_unlock(cache);
+
 	return NULL;
 }
 
@@ -390,13 +394,16 @@ struct rtnl_class *rtnl_class_get_by_parent(struct nl_cache *cache, int ifindex,
 	if (cache->c_ops != &rtnl_class_ops)
 		return NULL;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(class, &cache->c_items, ce_list) {
 		if (class->c_parent == parent &&
 		    class->c_ifindex == ((unsigned)ifindex)) {
 			nl_object_get((struct nl_object *) class);
+			nl_cache_read_unlock(cache);
 			return class;
 		}
 	}
+	nl_cache_read_unlock(cache);
 
 	return NULL;
 }
@@ -304,6 +304,8 @@ static int link_clone(struct nl_object *_dst, struct nl_object *_src)
 	dst->l_phys_port_id = NULL;
 	dst->l_phys_switch_id = NULL;
 	dst->l_vf_list = NULL;
+	dst->l_index_next = NULL;
+	dst->l_name_next = NULL;
 
 	if (src->l_addr)
 		if (!(dst->l_addr = nl_addr_clone(src->l_addr)))
@@ -810,6 +812,40 @@ static int link_msg_parser(struct nl_cache_ops *ops, struct sockaddr_nl *who,
 	return pp->pp_cb((struct nl_object *) link, pp);
 }
 
+static int link_msg_filter(struct nl_cache *cache, struct nlmsghdr *nlh)
+{
+	struct rtnl_link *filter = (struct rtnl_link *) cache->c_filter;
+	struct ifinfomsg *ifi = nlmsg_data(nlh);
+
+	if ((filter->ce_mask & LINK_ATTR_IFINDEX) &&
+	    filter->l_index != (uint32_t) ifi->ifi_index)
+		return NL_SKIP;
+
+	return NL_OK;
+}
+
+/* The kernel filters link dumps by master and kind only */
+static int link_put_dump_filter(struct nl_msg *msg, struct rtnl_link *filter)
+{
+	struct nlattr *info;
+
+	if (filter->ce_mask & LINK_ATTR_MASTER)
+		NLA_PUT_U32(msg, IFLA_MASTER, filter->l_master);
+
+	if ((filter->ce_mask & LINK_ATTR_LINKINFO) && filter->l_info_kind) {
+		if (!(info = nla_nest_start(msg, IFLA_LINKINFO)))
+			goto nla_put_failure;
+
+		NLA_PUT_STRING(msg, IFLA_INFO_KIND, filter->l_info_kind);
+		nla_nest_end(msg, info);
+	}
+
+	return 0;
+
+nla_put_failure:
+	return -NLE_MSGSIZE;
+}
+
 static int link_request_update(struct nl_cache *cache, struct nl_sock *sk)
 {
 	_nl_auto_nl_msg struct nl_msg *msg = NULL;
@@ -839,6 +875,12 @@ static int link_request_update(struct nl_cache *cache, struct nl_sock *sk)
 			return err;
 	}
 
+	if (cache->c_filter) {
+		err = link_put_dump_filter(msg, (struct rtnl_link *) cache->c_filter);
+		if (err < 0)
+			return err;
+	}
+
 	err = nl_send_auto(sk, msg);
 	if (err < 0)
 		return 0;
@@ -1089,8 +1131,7 @@ static int link_handle_event(struct nl_object *a, struct rtnl_link_event_cb *cb)
 #endif
 
 
-static void link_keygen(struct nl_object *obj, uint32_t *hashkey,
-        uint32_t table_sz)
+static uint32_t link_keygen(struct nl_object *obj)
 {
 	struct rtnl_link *link = (struct rtnl_link *) obj;
 	unsigned int lkey_sz;
@@ -1098,17 +1139,18 @@ static void link_keygen(struct nl_object *obj, uint32_t *hashkey,
 		uint32_t	l_index;
 		uint32_t	l_family;
 	} _nl_packed lkey;
+	uint32_t hash;
 
 	lkey_sz = sizeof(lkey);
 	lkey.l_index = link->l_index;
 	lkey.l_family = link->l_family;
 
-	*hashkey = nl_hash(&lkey, lkey_sz, 0) % table_sz;
+	hash = nl_hash(&lkey, lkey_sz, 0);
 
 	NL_DBG(5, "link %p key (dev %d fam %d) keysz %d, hash 0x%x\n",
-	       link, lkey.l_index, lkey.l_family, lkey_sz, *hashkey);
+	       link, lkey.l_index, lkey.l_family, lkey_sz, hash);
 
-	return;
+	return hash;
 }
 
 static uint64_t link_compare(struct nl_object *_a, struct nl_object *_b,
@@ -1296,6 +1338,267 @@ int rtnl_link_alloc_cache(struct nl_sock *sk, int family, struct nl_cache **resu
 	return rtnl_link_alloc_cache_flags(sk, family, result, 0);
 }
 
+/** @cond SKIP */
+/*
+ * Link caches maintain two additional hash indexes keyed by interface
+ * index and by name so rtnl_link_get() and rtnl_link_get_by_name() do not
+ * have to walk the list of links. The keys are remembered in the link at
+ * the time it is indexed, the chains are thus found again on removal even
+ * if the link has been modified in the meantime. The index is kept until
+ * the cache is freed.
+ *
+ * A cache may hold per address family links next to the generic link of
+ * the same interface. Lookups return the first match in the list, each
+ * link therefore carries its list position. Links are appended to the
+ * list or replace a link at its position, so a link at the tail gets the
+ * next position and any other one takes over the position of the link
+ * removed right before.
+ */
+#define LINK_INDEX_MIN_SIZE 64
+
+struct link_index {
+	unsigned int		li_size;
+	unsigned int		li_count;
+	uint64_t		li_next_pos;
+	uint64_t		li_removed_pos;
+	struct rtnl_link **	li_ifindex;
+	struct rtnl_link **	li_name;
+};
+
+static uint32_t link_name_hash(const char *name)
+{
+	return nl_hash((void *) name, strlen(name), 0);
+}
+
+static int link_index_resize(struct link_index *li, unsigned int size)
+{
+	struct rtnl_link **ifindex, **name;
+	struct rtnl_link *link, *next;
+	unsigned int i;
+
+	ifindex = calloc(size, sizeof(*ifindex));
+	name = calloc(size, sizeof(*name));
+	if (!ifindex || !name) {
+		free(ifindex);
+		free(name);
+		return -NLE_NOMEM;
+	}
+
+	for (i = 0; i < li->li_size; i++) {
+		for (link = li->li_ifindex[i]; link; link = next) {
+			next = link->l_index_next;
+			link->l_index_next = ifindex[link->l_index_key & (size - 1)];
+			ifindex[link->l_index_key & (size - 1)] = link;
+		}
+
+		for (link = li->li_name[i]; link; link = next) {
+			next = link->l_name_next;
+			link->l_name_next = name[link->l_name_hash & (size - 1)];
+			name[link->l_name_hash & (size - 1)] = link;
+		}
+	}
+
+	free(li->li_ifindex);
+	free(li->li_name);
+	li->li_ifindex = ifindex;
+	li->li_name = name;
+	li->li_size = size;
+
+	return 0;
+}
+
+static void link_index_insert(struct link_index *li, struct rtnl_link *link,
+			      uint64_t pos)
+{
+	unsigned int i;
+
+	/* Failing to grow only costs performance */
+	if (li->li_count >= li->li_size && li->li_size <= UINT_MAX / 2)
+		link_index_resize(li, li->li_size * 2);
+
+	link->l_index_key = link->l_index;
+	link->l_name_hash = link_name_hash(link->l_name);
+	link->l_index_pos = pos;
+
+	i = link->l_index_key & (li->li_size - 1);
+	link->l_index_next = li->li_ifindex[i];
+	li->li_ifindex[i] = link;
+
+	i = link->l_name_hash & (li->li_size - 1);
+	link->l_name_next = li->li_name[i];
+	li->li_name[i] = link;
+
+	li->li_count++;
+}
+
+static void link_index_free(struct nl_cache *cache)
+{
+	struct link_index *li = cache->c_index;
+
+	free(li->li_ifindex);
+	free(li->li_name);
+	free(li);
+	cache->c_index = NULL;
+}
+
+static void link_obj_added(struct nl_cache *cache, struct nl_object *obj)
+{
+	struct link_index *li = cache->c_index;
+	struct rtnl_link *link;
+	uint64_t pos;
+
+	if (li) {
+		if (nl_list_at_tail(obj, &cache->c_items, ce_list))
+			pos = li->li_next_pos++;
+		else
+			pos = li->li_removed_pos;
+
+		link_index_insert(li, (struct rtnl_link *) obj, pos);
+		return;
+	}
+
+	/* Lookups walk the list until the index could be allocated, it
+	 * then takes all links of the cache, including this one */
+	li = calloc(1, sizeof(*li));
+	if (!li)
+		return;
+
+	if (link_index_resize(li, LINK_INDEX_MIN_SIZE) < 0) {
+		free(li);
+		return;
+	}
+
+	nl_list_for_each_entry(link, &cache->c_items, ce_list)
+		link_index_insert(li, link, li->li_next_pos++);
+
+	cache->c_index = li;
+}
+
+static void link_obj_removed(struct nl_cache *cache, struct nl_object *obj)
+{
+	struct rtnl_link *link = (struct rtnl_link *) obj;
+	struct link_index *li = cache->c_index;
+	struct rtnl_link **pos;
+
+	if (!li)
+		return;
+
+	for (pos = &li->li_ifindex[link->l_index_key & (li->li_size - 1)];
+	     *pos; pos = &(*pos)->l_index_next) {
+		if (*pos == link) {
+			*pos = link->l_index_next;
+			break;
+		}
+	}
+
+	for (pos = &li->li_name[link->l_name_hash & (li->li_size - 1)];
+	     *pos; pos = &(*pos)->l_name_next) {
+		if (*pos == link) {
+			*pos = link->l_name_next;
+			break;
+		}
+	}
+
+	link->l_index_next = NULL;
+	link->l_name_next = NULL;
+	li->li_removed_pos = link->l_index_pos;
+	li->li_count--;
+}
+
+/*
+ * Returns the cache whose index holds the link. The keys of the link are
+ * about to change, the link is unlinked from the chains and must be
+ * indexed again with link_index_rekey_done().
+ */
+static struct nl_cache *link_index_rekey(struct rtnl_link *link)
+{
+	struct nl_cache *cache = link->ce_cache;
+
+	if (!cache || !cache->c_index ||
+	    cache->c_ops->co_obj_removed != link_obj_removed)
+		return NULL;
+
+	link_obj_removed(cache, (struct nl_object *) link);
+
+	return cache;
+}
+
+static void link_index_rekey_done(struct nl_cache *cache,
+				  struct rtnl_link *link)
+{
+	if (cache)
+		link_obj_added(cache, (struct nl_object *) link);
+}
+/** @endcond */
+
+/** @cond SKIP */
+/*
+ * Both lookups return the first matching link in the list of the cache,
+ * the list is only walked if the index could not be allocated.
+ */
+static struct rtnl_link *__link_get(struct nl_cache *cache, int ifindex)
+{
+	struct link_index *li = cache->c_index;
+	struct rtnl_link *link, *found = NULL;
+
+	if (li) {
+		for (link = li->li_ifindex[((unsigned)ifindex) & (li->li_size - 1)];
+		     link; link = link->l_index_next) {
+			if (link->l_index == ((unsigned)ifindex) &&
+			    (!found || link->l_index_pos < found->l_index_pos))
+				found = link;
+		}
+
+		if (found)
+			nl_object_get((struct nl_object *) found);
+
+		return found;
+	}
+
+	nl_list_for_each_entry(link, &cache->c_items, ce_list) {
+		if (link->l_index == ((unsigned)ifindex)) {
+			nl_object_get((struct nl_object *) link);
+			return link;
+		}
+	}
+
+	return NULL;
+}
+
+static struct rtnl_link *__link_get_by_name(struct nl_cache *cache,
+					    const char *name)
+{
+	struct link_index *li = cache->c_index;
+	struct rtnl_link *link, *found = NULL;
+	uint32_t hash;
+
+	if (li) {
+		hash = link_name_hash(name);
+
+		for (link = li->li_name[hash & (li->li_size - 1)]; link;
+		     link = link->l_name_next) {
+			if (link->l_name_hash == hash &&
+			    !strcmp(name, link->l_name) &&
+			    (!found || link->l_index_pos < found->l_index_pos))
+				found = link;
+		}
+
+		if (found)
+			nl_object_get((struct nl_object *) found);
+
+		return found;
+	}
+
+	nl_list_for_each_entry(link, &cache->c_items, ce_list) {
+		if (!strcmp(name, link->l_name)) {
+			nl_object_get((struct nl_object *) link);
+			return link;
+		}
+	}
+
+	return NULL;
+}
+/** @endcond */
 
 /**
  * Lookup link in cache by interface index
@@ -1319,14 +1622,11 @@ struct rtnl_link *rtnl_link_get(struct nl_cache *cache, int ifindex)
 	if (cache->c_ops != &rtnl_link_ops)
 		return NULL;
 
-	nl_list_for_each_entry(link, &cache->c_items, ce_list) {
-		if (link->l_index == ((unsigned)ifindex)) {
-			nl_object_get((struct nl_object *) link);
-			return link;
-		}
-	}
+	nl_cache_read_lock(cache);
+	link = __link_get(cache, ifindex);
+	nl_cache_read_unlock(cache);
 
-	return NULL;
+	return link;
 }
 
 /**
@@ -1352,14 +1652,11 @@ struct rtnl_link *rtnl_link_get_by_name(struct nl_cache *cache,
 	if (cache->c_ops != &rtnl_link_ops)
 		return NULL;
 
-	nl_list_for_each_entry(link, &cache->c_items, ce_list) {
-		if (!strcmp(name, link->l_name)) {
-			nl_object_get((struct nl_object *) link);
-			return link;
-		}
-	}
+	nl_cache_read_lock(cache);
+	link = __link_get_by_name(cache, name);
+	nl_cache_read_unlock(cache);
 
-	return NULL;
+	return link;
 }
 
 /**
@@ -1947,8 +2244,11 @@ void rtnl_link_put(struct rtnl_link *link)
  */
 void rtnl_link_set_name(struct rtnl_link *link, const char *name)
 {
+	struct nl_cache *cache = link_index_rekey(link);
+
 	_nl_strncpy_trunc(link->l_name, name, sizeof(link->l_name));
 	link->ce_mask |= LINK_ATTR_IFNAME;
+	link_index_rekey_done(cache, link);
 }
 
 /**
@@ -2112,6 +2412,7 @@ void rtnl_link_set_family(struct rtnl_link *link, int family)
 {
 	link->l_family = family;
 	link->ce_mask |= LINK_ATTR_FAMILY;
+	nl_object_invalidate_hash(link);
 
 	if (link->l_af_ops) {
 		int ao_family = link->l_af_ops->ao_family;
@@ -2176,8 +2477,12 @@ unsigned int rtnl_link_get_arptype(struct rtnl_link *link)
  */
 void rtnl_link_set_ifindex(struct rtnl_link *link, int ifindex)
 {
+	struct nl_cache *cache = link_index_rekey(link);
+
 	link->l_index = ifindex;
 	link->ce_mask |= LINK_ATTR_IFINDEX;
+	nl_object_invalidate_hash(link);
+	link_index_rekey_done(cache, link);
 }
 
 
@@ -3211,6 +3516,10 @@ static struct nl_cache_ops rtnl_link_ops = {
 	.co_groups		= link_groups,
 	.co_request_update	= link_request_update,
 	.co_msg_parser		= link_msg_parser,
+	.co_msg_filter		= link_msg_filter,
+	.co_obj_added		= link_obj_added,
+	.co_obj_removed		= link_obj_removed,
+	.co_index_free		= link_index_free,
 	.co_obj_ops		= &link_obj_ops,
 };
 
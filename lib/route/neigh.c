@@ -230,19 +230,17 @@ static int neigh_clone(struct nl_object *_dst, struct nl_object *_src)
 	return 0;
 }
 
-static void neigh_keygen(struct nl_object *obj, uint32_t *hashkey,
-			 uint32_t table_sz)
+static uint32_t neigh_keygen(struct nl_object *obj)
 {
 	struct rtnl_neigh *neigh = (struct rtnl_neigh *) obj;
-	unsigned int nkey_sz;
 	struct nl_addr *addr = NULL;
 	struct neigh_hash_key {
 		uint32_t	n_family;
 		uint32_t	n_ifindex;
 		uint16_t	n_vlan;
-		char		n_addr[0];
-	} _nl_packed *nkey;
+	} _nl_packed nkey;
 	char buf[INET6_ADDRSTRLEN+5];
+	uint32_t hash;
 
 	if (neigh->n_family == AF_BRIDGE) {
 		if (neigh->n_lladdr)
@@ -251,40 +249,27 @@ static void neigh_keygen(struct nl_object *obj, uint32_t *hashkey,
 		addr = neigh->n_dst;
 	}
 
-	nkey_sz = sizeof(*nkey);
-	if (addr)
-		nkey_sz += nl_addr_get_len(addr);
-
-	nkey = calloc(1, nkey_sz);
-	if (!nkey) {
-		*hashkey = 0;
-		return;
-	}
-	nkey->n_family = neigh->n_family;
+	memset(&nkey, 0, sizeof(nkey));
+	nkey.n_family = neigh->n_family;
 	if (neigh->n_family == AF_BRIDGE) {
-		nkey->n_vlan = neigh->n_vlan;
+		nkey.n_vlan = neigh->n_vlan;
 		if (neigh->n_flags & NTF_SELF)
-			nkey->n_ifindex = neigh->n_ifindex;
+			nkey.n_ifindex = neigh->n_ifindex;
 		else
-			nkey->n_ifindex = neigh->n_master;
+			nkey.n_ifindex = neigh->n_master;
 	} else
-		nkey->n_ifindex = neigh->n_ifindex;
+		nkey.n_ifindex = neigh->n_ifindex;
 
+	hash = nl_hash(&nkey, sizeof(nkey), 0);
 	if (addr)
-		memcpy(nkey->n_addr,
-			nl_addr_get_binary_addr(addr),
-			nl_addr_get_len(addr));
+		hash = nl_hash(nl_addr_get_binary_addr(addr),
+			       nl_addr_get_len(addr), hash);
 
-	*hashkey = nl_hash(nkey, nkey_sz, 0) % table_sz;
+	NL_DBG(5, "neigh %p key (fam %d dev %d addr %s) hash 0x%x\n",
+		neigh, nkey.n_family, nkey.n_ifindex,
+		nl_addr2str(addr, buf, sizeof(buf)), hash);
 
-	NL_DBG(5, "neigh %p key (fam %d dev %d addr %s) keysz %d hash 0x%x\n",
-		neigh, nkey->n_family, nkey->n_ifindex,
-		nl_addr2str(addr, buf, sizeof(buf)),
-		nkey_sz, *hashkey);
-
-	free(nkey);
-
-	return;
+	return hash;
 }
 
 static uint64_t neigh_compare(struct nl_object *_a, struct nl_object *_b,
@@ -484,10 +469,66 @@ errout:
 	return err;
 }
 
+/* Family and interface identify all but bridge neighbours */
+static int neigh_msg_filter(struct nl_cache *c, struct nlmsghdr *nlh)
+{
+	struct rtnl_neigh *filter = (struct rtnl_neigh *) c->c_filter;
+	struct ndmsg *ndm = nlmsg_data(nlh);
+
+	if ((filter->ce_mask & NEIGH_ATTR_FAMILY) &&
+	    filter->n_family != ndm->ndm_family)
+		return NL_SKIP;
+
+	if ((filter->ce_mask & NEIGH_ATTR_IFINDEX) &&
+	    ndm->ndm_family != AF_BRIDGE &&
+	    filter->n_ifindex != (uint32_t) ndm->ndm_ifindex)
+		return NL_SKIP;
+
+	return NL_OK;
+}
+
+static int neigh_request_filtered(struct nl_cache *c, struct nl_sock *h)
+{
+	_nl_auto_nl_msg struct nl_msg *msg = NULL;
+	struct rtnl_neigh *filter = (struct rtnl_neigh *) c->c_filter;
+	struct ndmsg ndm = {
+		.ndm_family = c->c_iarg1,
+	};
+
+	/* Strict checking requires a full header, the interface is
+	 * passed as attribute */
+	if (!ndm.ndm_family && (filter->ce_mask & NEIGH_ATTR_FAMILY))
+		ndm.ndm_family = filter->n_family;
+
+	msg = nlmsg_alloc_simple(RTM_GETNEIGH, NLM_F_DUMP);
+	if (!msg)
+		return -NLE_NOMEM;
+
+	if (nlmsg_append(msg, &ndm, sizeof(ndm), NLMSG_ALIGNTO) < 0)
+		return -NLE_MSGSIZE;
+
+	if (filter->ce_mask & NEIGH_ATTR_IFINDEX)
+		NLA_PUT_U32(msg, NDA_IFINDEX, filter->n_ifindex);
+
+	if (filter->ce_mask & NEIGH_ATTR_MASTER)
+		NLA_PUT_U32(msg, NDA_MASTER, filter->n_master);
+
+	return nl_send_auto(h, msg);
+
+nla_put_failure:
+	return -NLE_MSGSIZE;
+}
+
 static int neigh_request_update(struct nl_cache *c, struct nl_sock *h)
 {
 	int family = c->c_iarg1;
 
+	if (family != AF_UNSPEC && family != AF_BRIDGE)
+		return -NLE_INVAL;
+
+	if (c->c_filter)
+		return neigh_request_filtered(c, h);
+
 	if (family == AF_UNSPEC) {
 		return nl_rtgen_request(h, RTM_GETNEIGH, family, NLM_F_DUMP);
 	} else if (family == AF_BRIDGE) {
@@ -675,14 +716,17 @@ struct rtnl_neigh * rtnl_neigh_get(struct nl_cache *cache, int ifindex,
 {
 	struct rtnl_neigh *neigh;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(neigh, &cache->c_items, ce_list) {
 		if (neigh->n_ifindex == ((unsigned)ifindex) &&
 		    neigh->n_family == ((unsigned)dst->a_family) &&
 		    !nl_addr_cmp(neigh->n_dst, dst)) {
 			nl_object_get((struct nl_object *) neigh);
+			nl_cache_read_unlock(cache);
 			return neigh;
 		}
 	}
+	nl_cache_read_unlock(cache);
 
 	return NULL;
 }
@@ -982,6 +1026,7 @@ void rtnl_neigh_set_flags(struct rtnl_neigh *neigh, unsigned int flags)
 	neigh->n_flag_mask |= flags;
 	neigh->n_flags |= flags;
 	neigh->ce_mask |= NEIGH_ATTR_FLAGS;
+	nl_object_invalidate_hash(neigh);
 }
 
 unsigned int rtnl_neigh_get_flags(struct rtnl_neigh *neigh)
@@ -994,12 +1039,14 @@ void rtnl_neigh_unset_flags(struct rtnl_neigh *neigh, unsigned int flags)
 	neigh->n_flag_mask |= flags;
 	neigh->n_flags &= ~flags;
 	neigh->ce_mask |= NEIGH_ATTR_FLAGS;
+	nl_object_invalidate_hash(neigh);
 }
 
 void rtnl_neigh_set_ifindex(struct rtnl_neigh *neigh, int ifindex)
 {
 	neigh->n_ifindex = ifindex;
 	neigh->ce_mask |= NEIGH_ATTR_IFINDEX;
+	nl_object_invalidate_hash(neigh);
 }
 
 int rtnl_neigh_get_ifindex(struct rtnl_neigh *neigh)
@@ -1027,6 +1074,7 @@ static inline int __assign_addr(struct rtnl_neigh *neigh, struct nl_addr **pos,
 	*pos = new;
 
 	neigh->ce_mask |= flag;
+	nl_object_invalidate_hash(neigh);
 
 	return 0;
 }
@@ -1062,6 +1110,7 @@ void rtnl_neigh_set_family(struct rtnl_neigh *neigh, int family)
 {
 	neigh->n_family = family;
 	neigh->ce_mask |= NEIGH_ATTR_FAMILY;
+	nl_object_invalidate_hash(neigh);
 }
 
 int rtnl_neigh_get_family(struct rtnl_neigh *neigh)
@@ -1087,6 +1136,7 @@ void rtnl_neigh_set_vlan(struct rtnl_neigh *neigh, int vlan)
 {
 	neigh->n_vlan = vlan;
 	neigh->ce_mask |= NEIGH_ATTR_VLAN;
+	nl_object_invalidate_hash(neigh);
 }
 
 int rtnl_neigh_get_vlan(struct rtnl_neigh *neigh)
@@ -1101,6 +1151,7 @@ void rtnl_neigh_set_master(struct rtnl_neigh *neigh, int ifindex)
 {
 	neigh->n_master = ifindex;
 	neigh->ce_mask |= NEIGH_ATTR_MASTER;
+	nl_object_invalidate_hash(neigh);
 }
 
 int rtnl_neigh_get_master(struct rtnl_neigh *neigh) {
@@ -1159,6 +1210,7 @@ static struct nl_cache_ops rtnl_neigh_ops = {
 	.co_groups		= neigh_groups,
 	.co_request_update	= neigh_request_update,
 	.co_msg_parser		= neigh_msg_parser,
+	.co_msg_filter		= neigh_msg_filter,
 	.co_obj_ops		= &neigh_obj_ops,
 };
 
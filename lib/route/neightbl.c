@@ -532,13 +532,16 @@ struct rtnl_neightbl *rtnl_neightbl_get(struct nl_cache *cache,
 	if (cache->c_ops != &rtnl_neightbl_ops)
 		return NULL;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(nt, &cache->c_items, ce_list) {
 		if (!strcasecmp(nt->nt_name, name) &&
 		    ((unsigned)ifindex) == nt->nt_parms.ntp_ifindex) {
 			nl_object_get((struct nl_object *)nt);
+			nl_cache_read_unlock(cache);
 			return nt;
 		}
 	}
+	nl_cache_read_unlock(cache);
 
 	return NULL;
 }
@@ -269,8 +269,7 @@ static char *netconf_attrs2str(int attrs, char *buf, size_t len)
 			   ARRAY_SIZE(netconf_attrs));
 }
 
-static void netconf_keygen(struct nl_object *obj, uint32_t *hashkey,
-			   uint32_t table_sz)
+static uint32_t netconf_keygen(struct nl_object *obj)
 {
 	struct rtnl_netconf *nc = (struct rtnl_netconf *) obj;
 	unsigned int nckey_sz;
@@ -278,15 +277,18 @@ static void netconf_keygen(struct nl_object *obj, uint32_t *hashkey,
 		int        nc_family;
 		int        nc_index;
 	} _nl_packed nckey;
+	uint32_t hash;
 
 	nckey_sz = sizeof(nckey);
 	nckey.nc_family = nc->family;
 	nckey.nc_index = nc->ifindex;
 
-	*hashkey = nl_hash(&nckey, nckey_sz, 0) % table_sz;
+	hash = nl_hash(&nckey, nckey_sz, 0);
 
 	NL_DBG(5, "netconf %p key (dev %d fam %d) keysz %d, hash 0x%x\n",
-	       nc, nckey.nc_index, nckey.nc_family, nckey_sz, *hashkey);
+	       nc, nckey.nc_index, nckey.nc_family, nckey_sz, hash);
+
+	return hash;
 }
 
 static uint64_t netconf_compare(struct nl_object *_a, struct nl_object *_b,
@@ -377,13 +379,16 @@ struct rtnl_netconf *rtnl_netconf_get_by_idx(struct nl_cache *cache, int family,
 	if (!ifindex || !family || cache->c_ops != &rtnl_netconf_ops)
 		return NULL;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(nc, &cache->c_items, ce_list) {
 		if (nc->ifindex == ifindex &&
 		    nc->family == family) {
 			nl_object_get((struct nl_object *) nc);
+			nl_cache_read_unlock(cache);
 			return nc;
 		}
 	}
+	nl_cache_read_unlock(cache);
 
 	return NULL;
 }
@@ -169,8 +169,7 @@ void rtnl_nh_put(struct rtnl_nh *nh)
 	nl_object_put(obj);
 }
 
-static void nexthop_keygen(struct nl_object *obj, uint32_t *hashkey,
-			   uint32_t table_sz)
+static uint32_t nexthop_keygen(struct nl_object *obj)
 {
 	struct rtnl_nh *nexthop = nl_object_priv(obj);
 	unsigned int lkey_sz;
@@ -181,9 +180,7 @@ static void nexthop_keygen(struct nl_object *obj, uint32_t *hashkey,
 	lkey_sz = sizeof(lkey);
 	lkey.nh_id = nexthop->nh_id;
 
-	*hashkey = nl_hash(&lkey, lkey_sz, 0) % table_sz;
-
-	return;
+	return nl_hash(&lkey, lkey_sz, 0);
 }
 
 int rtnl_nh_set_gateway(struct rtnl_nh *nexthop, struct nl_addr *addr)
@@ -453,12 +450,15 @@ struct rtnl_nh *rtnl_nh_get(struct nl_cache *cache, int nhid)
 	if (cache->c_ops != &rtnl_nh_ops)
 		return NULL;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(nh, &cache->c_items, ce_list) {
 		if (nh->nh_id == ((unsigned)nhid)) {
 			nl_object_get((struct nl_object *)nh);
+			nl_cache_read_unlock(cache);
 			return nh;
 		}
 	}
+	nl_cache_read_unlock(cache);
 
 	return NULL;
 }
@@ -73,6 +73,12 @@ struct rtnl_link {
 	int l_ns_fd;
 	pid_t l_ns_pid;
 	struct rtnl_link_vf *l_vf_list;
+	/* Chains of the link cache indexes, see link_obj_added() */
+	struct rtnl_link *l_index_next;
+	struct rtnl_link *l_name_next;
+	uint32_t l_index_key;
+	uint32_t l_name_hash;
+	uint64_t l_index_pos;
 };
 
 struct rtnl_nh_encap {
@@ -163,6 +169,17 @@ static inline int build_sysconf_path(char **strp, const char *filename)
 
 /*****************************************************************************/
 
+struct rtmsg;
+struct rtnl_route;
+
+extern int _nl_rtnl_route_build_dump_request(struct nl_msg *msg,
+					     struct rtmsg *rtm,
+					     struct rtnl_route *filter);
+extern int _nl_rtnl_route_msg_filter(struct nl_cache *cache,
+				     struct nlmsghdr *nlh);
+
+/*****************************************************************************/
+
 static inline int rtnl_tc_calc_txtime64(int bufsize, uint64_t rate)
 {
 	return ((double)bufsize / (double)rate) * 1000000.0;
@@ -387,13 +387,16 @@ struct rtnl_qdisc *rtnl_qdisc_get_by_parent(struct nl_cache *cache,
 	if (cache->c_ops != &rtnl_qdisc_ops)
 		return NULL;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(q, &cache->c_items, ce_list) {
 		if (q->q_parent == parent &&
 		    q->q_ifindex == ((unsigned)ifindex)) {
 			nl_object_get((struct nl_object *) q);
+			nl_cache_read_unlock(cache);
 			return q;
 		}
 	}
+	nl_cache_read_unlock(cache);
 
 	return NULL;
 }
@@ -420,13 +423,16 @@ struct rtnl_qdisc *rtnl_qdisc_get_by_kind(struct nl_cache *cache,
 	if (cache->c_ops != &rtnl_qdisc_ops)
 		return NULL;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(q, &cache->c_items, ce_list) {
 		if ((q->q_ifindex == ((unsigned)ifindex)) &&
 		    (!strcmp(q->q_kind, kind))) {
 			nl_object_get((struct nl_object *) q);
+			nl_cache_read_unlock(cache);
 			return q;
 		}
 	}
+	nl_cache_read_unlock(cache);
 
 	return NULL;
 }
@@ -453,13 +459,16 @@ struct rtnl_qdisc *rtnl_qdisc_get(struct nl_cache *cache, int ifindex,
 	if (cache->c_ops != &rtnl_qdisc_ops)
 		return NULL;
 
+	nl_cache_read_lock(cache);
 	nl_list_for_each_entry(q, &cache->c_items, ce_list) {
 		if (q->q_handle == handle &&
 		    q->q_ifindex == ((unsigned)ifindex)) {
 			nl_object_get((struct nl_object *) q);
+			nl_cache_read_unlock(cache);
 			return q;
 		}
 	}
+	nl_cache_read_unlock(cache);
 
 	return NULL;
 }
@@ -16,6 +16,7 @@
 #include <netlink/cache.h>
 #include <netlink/utils.h>
 #include <netlink/data.h>
+#include <netlink/hashtable.h>
 #include <netlink/route/rtnl.h>
 #include <netlink/route/route.h>
 #include <netlink/route/link.h>
@@ -44,16 +45,455 @@ static int route_msg_parser(struct nl_cache_ops *ops, struct sockaddr_nl *who,
 
 static int route_request_update(struct nl_cache *c, struct nl_sock *h)
 {
+	_nl_auto_nl_msg struct nl_msg *msg = NULL;
 	struct rtmsg rhdr = {
 		.rtm_family = c->c_iarg1,
 	};
+	int err;
 
 	if (c->c_iarg2 & ROUTE_CACHE_CONTENT)
 		rhdr.rtm_flags |= RTM_F_CLONED;
 
-	return nl_send_simple(h, RTM_GETROUTE, NLM_F_DUMP, &rhdr, sizeof(rhdr));
+	if (!c->c_filter)
+		return nl_send_simple(h, RTM_GETROUTE, NLM_F_DUMP, &rhdr,
+				      sizeof(rhdr));
+
+	msg = nlmsg_alloc_simple(RTM_GETROUTE, NLM_F_DUMP);
+	if (!msg)
+		return -NLE_NOMEM;
+
+	err = _nl_rtnl_route_build_dump_request(
+		msg, &rhdr, (struct rtnl_route *) c->c_filter);
+	if (err < 0)
+		return err;
+
+	return nl_send_auto(h, msg);
+}
+
+/** @cond SKIP */
+/*
+ * Route caches maintain a longest prefix match index, a path compressed
+ * binary trie per address family and table. Every node stands for the
+ * prefix stored in it, nodes without routes only exist to branch. The
+ * route preferred for the prefix of a node is remembered in the node so
+ * lookups only have to descend the trie. Routes with a TOS are only kept
+ * in the index to find them again on removal, lookups ignore them.
+ */
+#define ROUTE_LPM_MAX_BITS 128
+
+struct route_lpm_node {
+	struct route_lpm_node *	ln_child[2];
+	struct rtnl_route *	ln_best;
+	struct rtnl_route **	ln_routes;
+	unsigned int		ln_nroutes;
+	unsigned int		ln_plen;
+	uint8_t			ln_key[ROUTE_LPM_MAX_BITS / 8];
+};
+
+struct route_lpm_trie {
+	struct route_lpm_trie *	lt_next;
+	struct route_lpm_node *	lt_root;
+	uint32_t		lt_table;
+	int			lt_family;
+	unsigned int		lt_bits;
+};
+
+struct route_lpm {
+	struct route_lpm_trie *	rl_tries;
+	unsigned int		rl_count;
+	int			rl_broken;
+};
+
+static inline int lpm_bit(const uint8_t *key, unsigned int i)
+{
+	return (key[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+/* Number of leading bits two keys have in common, at most max */
+static inline unsigned int lpm_common(const uint8_t *a, const uint8_t *b,
+				      unsigned int max)
+{
+	unsigned int i, n;
+	uint8_t x;
+
+	for (i = 0, n = 0; n < max; i++, n += 8) {
+		if ((x = a[i] ^ b[i])) {
+			n += __builtin_clz(x) - 24;
+			break;
+		}
+	}
+
+	return n < max ? n : max;
+}
+
+static unsigned int lpm_family_bits(int family)
+{
+	switch (family) {
+	case AF_INET:
+		return 32;
+	case AF_INET6:
+		return 128;
+	default:
+		return 0;
+	}
+}
+
+/* Copies the first bits of addr into key, the remaining bits are zero */
+static int lpm_key(struct nl_addr *addr, unsigned int bits, unsigned int plen,
+		   uint8_t *key)
+{
+	unsigned int len = nl_addr_get_len(addr);
+
+	if (plen > bits || len * 8 > bits || len * 8 < plen)
+		return -NLE_INVAL;
+
+	memset(key, 0, ROUTE_LPM_MAX_BITS / 8);
+	memcpy(key, nl_addr_get_binary_addr(addr), len);
+
+	if (plen % 8)
+		key[plen / 8] &= 0xff << (8 - plen % 8);
+	memset(key + (plen + 7) / 8, 0,
+	       ROUTE_LPM_MAX_BITS / 8 - (plen + 7) / 8);
+
+	return 0;
+}
+
+static int lpm_route_key(struct rtnl_route *route, unsigned int *bits,
+			 unsigned int *plen, uint8_t *key)
+{
+	struct nl_addr *dst = rtnl_route_get_dst(route);
+
+	if (!dst || !(*bits = lpm_family_bits(rtnl_route_get_family(route))))
+		return -NLE_INVAL;
+
+	*plen = nl_addr_get_prefixlen(dst);
+
+	return lpm_key(dst, *bits, *plen, key);
+}
+
+static struct route_lpm_node *lpm_node_alloc(const uint8_t *key,
+					     unsigned int plen)
+{
+	struct route_lpm_node *n;
+
+	if (!(n = calloc(1, sizeof(*n))))
+		return NULL;
+
+	n->ln_plen = plen;
+	memcpy(n->ln_key, key, (plen + 7) / 8);
+	if (plen % 8)
+		n->ln_key[plen / 8] &= 0xff << (8 - plen % 8);
+
+	return n;
+}
+
+static void lpm_node_free(struct route_lpm_node *n)
+{
+	if (n) {
+		lpm_node_free(n->ln_child[0]);
+		lpm_node_free(n->ln_child[1]);
+		free(n->ln_routes);
+		free(n);
+	}
+}
+
+/* Lowest metric wins among the routes without TOS, as in the kernel */
+static void lpm_node_select(struct route_lpm_node *n)
+{
+	struct rtnl_route *route;
+	unsigned int i;
+
+	n->ln_best = NULL;
+	for (i = 0; i < n->ln_nroutes; i++) {
+		route = n->ln_routes[i];
+		if (rtnl_route_get_tos(route))
+			continue;
+		if (!n->ln_best || rtnl_route_get_priority(route) <
+				   rtnl_route_get_priority(n->ln_best))
+			n->ln_best = route;
+	}
+}
+
+static struct route_lpm_trie *lpm_trie(struct route_lpm *rl, int family,
+				       uint32_t table, int create)
+{
+	struct route_lpm_trie *lt;
+
+	for (lt = rl->rl_tries; lt; lt = lt->lt_next)
+		if (lt->lt_family == family && lt->lt_table == table)
+			return lt;
+
+	if (!create || !(lt = calloc(1, sizeof(*lt))))
+		return NULL;
+
+	lt->lt_family = family;
+	lt->lt_table = table;
+	lt->lt_bits = lpm_family_bits(family);
+	lt->lt_next = rl->rl_tries;
+	rl->rl_tries = lt;
+
+	return lt;
+}
+
+static struct route_lpm_node *lpm_insert(struct route_lpm_trie *lt,
+					 const uint8_t *key, unsigned int plen)
+{
+	struct route_lpm_node **pp = &lt->lt_root, *n, *node, *glue;
+	unsigned int common;
+
+	while ((n = *pp)) {
+		common = lpm_common(n->ln_key, key, _NL_MIN(n->ln_plen, plen));
+		if (common == n->ln_plen) {
+			if (n->ln_plen == plen)
+				return n;
+			pp = &n->ln_child[lpm_bit(key, n->ln_plen)];
+			continue;
+		}
+
+		/* The new prefix covers the prefix of n or branches off */
+		if (!(node = lpm_node_alloc(key, plen)))
+			return NULL;
+
+		if (common == plen) {
+			node->ln_child[lpm_bit(n->ln_key, plen)] = n;
+			*pp = node;
+			return node;
+		}
+
+		if (!(glue = lpm_node_alloc(key, common))) {
+			free(node);
+			return NULL;
+		}
+
+		glue->ln_child[lpm_bit(key, common)] = node;
+		glue->ln_child[lpm_bit(n->ln_key, common)] = n;
+		*pp = glue;
+		return node;
+	}
+
+	return *pp = lpm_node_alloc(key, plen);
 }
 
+static void lpm_remove(struct route_lpm_trie *lt, const uint8_t *key,
+		       unsigned int plen, struct rtnl_route *route)
+{
+	struct route_lpm_node **path[ROUTE_LPM_MAX_BITS + 2];
+	struct route_lpm_node **pp = &lt->lt_root, *n;
+	unsigned int i;
+	int depth = 0;
+
+	while ((n = *pp) && n->ln_plen < plen) {
+		if (lpm_common(n->ln_key, key, n->ln_plen) != n->ln_plen)
+			return;
+		path[depth++] = pp;
+		pp = &n->ln_child[lpm_bit(key, n->ln_plen)];
+	}
+
+	if (!n || n->ln_plen != plen || lpm_common(n->ln_key, key, plen) != plen)
+		return;
+	path[depth] = pp;
+
+	for (i = 0; i < n->ln_nroutes; i++)
+		if (n->ln_routes[i] == route)
+			break;
+	if (i == n->ln_nroutes)
+		return;
+
+	n->ln_routes[i] = n->ln_routes[--n->ln_nroutes];
+	lpm_node_select(n);
+
+	/* Drop the nodes no longer needed to branch */
+	for (; depth >= 0; depth--) {
+		n = *path[depth];
+		if (n->ln_nroutes || (n->ln_child[0] && n->ln_child[1]))
+			break;
+
+		*path[depth] = n->ln_child[0] ? n->ln_child[0] : n->ln_child[1];
+		n->ln_child[0] = n->ln_child[1] = NULL;
+		lpm_node_free(n);
+	}
+}
+
+static struct rtnl_route *lpm_lookup(struct route_lpm_trie *lt,
+				     const uint8_t *key)
+{
+	struct route_lpm_node *n = lt->lt_root;
+	struct rtnl_route *best = NULL;
+
+	while (n && lpm_common(n->ln_key, key, n->ln_plen) == n->ln_plen) {
+		if (n->ln_best)
+			best = n->ln_best;
+		if (n->ln_plen >= lt->lt_bits)
+			break;
+		n = n->ln_child[lpm_bit(key, n->ln_plen)];
+	}
+
+	return best;
+}
+
+static void route_lpm_clear(struct route_lpm *rl)
+{
+	struct route_lpm_trie *lt, *next;
+
+	for (lt = rl->rl_tries; lt; lt = next) {
+		next = lt->lt_next;
+		lpm_node_free(lt->lt_root);
+		free(lt);
+	}
+
+	rl->rl_tries = NULL;
+	rl->rl_broken = 0;
+}
+
+static void route_lpm_add(struct nl_cache *cache, struct route_lpm *rl,
+			  struct rtnl_route *route)
+{
+	uint8_t key[ROUTE_LPM_MAX_BITS / 8];
+	unsigned int bits, plen;
+	struct route_lpm_trie *lt;
+	struct route_lpm_node *n;
+	struct rtnl_route **routes;
+
+	rl->rl_count++;
+
+	if (rl->rl_broken || lpm_route_key(route, &bits, &plen, key) < 0)
+		return;
+
+	if (!(lt = lpm_trie(rl, rtnl_route_get_family(route),
+			    rtnl_route_get_table(route), 1)) ||
+	    !(n = lpm_insert(lt, key, plen)) ||
+	    !(routes = realloc(n->ln_routes,
+			       (n->ln_nroutes + 1) * sizeof(*routes)))) {
+		/* A partial index would return wrong results */
+		NL_DBG(1, "Unable to index route, route cache %p falls back "
+			  "to linear lookups\n", cache);
+		rl->rl_broken = 1;
+		return;
+	}
+
+	n->ln_routes = routes;
+	n->ln_routes[n->ln_nroutes++] = route;
+	lpm_node_select(n);
+}
+
+static void route_index_free(struct nl_cache *cache)
+{
+	struct route_lpm *rl = cache->c_index;
+
+	route_lpm_clear(rl);
+	free(rl);
+	cache->c_index = NULL;
+}
+
+static void route_obj_added(struct nl_cache *cache, struct nl_object *obj)
+{
+	struct route_lpm *rl = cache->c_index;
+	struct nl_object *route;
+
+	if (rl) {
+		route_lpm_add(cache, rl, (struct rtnl_route *) obj);
+		return;
+	}
+
+	/* Lookups walk the list until the index could be allocated, it
+	 * then takes all routes of the cache, including this one */
+	rl = calloc(1, sizeof(*rl));
+	if (!rl)
+		return;
+
+	nl_list_for_each_entry(route, &cache->c_items, ce_list)
+		route_lpm_add(cache, rl, (struct rtnl_route *) route);
+
+	cache->c_index = rl;
+}
+
+static void route_obj_removed(struct nl_cache *cache, struct nl_object *obj)
+{
+	struct rtnl_route *route = (struct rtnl_route *) obj;
+	struct route_lpm *rl = cache->c_index;
+	uint8_t key[ROUTE_LPM_MAX_BITS / 8];
+	unsigned int bits, plen;
+	struct route_lpm_trie *lt;
+
+	if (!rl)
+		return;
+
+	if (lpm_route_key(route, &bits, &plen, key) == 0 &&
+	    (lt = lpm_trie(rl, rtnl_route_get_family(route),
+			   rtnl_route_get_table(route), 0)))
+		lpm_remove(lt, key, plen, route);
+
+	/* Once emptied, a broken index starts over */
+	if (--rl->rl_count == 0 && rl->rl_broken)
+		route_lpm_clear(rl);
+}
+
+/* The most specific route without TOS and with the lowest metric */
+static struct rtnl_route *route_lookup_list(struct nl_cache *cache,
+					    uint32_t table, int family,
+					    const uint8_t *key)
+{
+	uint8_t rkey[ROUTE_LPM_MAX_BITS / 8];
+	struct rtnl_route *route, *best = NULL;
+	unsigned int bits, plen, best_plen = 0;
+	struct nl_object *obj;
+
+	nl_list_for_each_entry(obj, &cache->c_items, ce_list) {
+		route = (struct rtnl_route *) obj;
+		if (rtnl_route_get_family(route) != family ||
+		    rtnl_route_get_table(route) != table ||
+		    rtnl_route_get_tos(route) ||
+		    lpm_route_key(route, &bits, &plen, rkey) < 0 ||
+		    lpm_common(rkey, key, plen) != plen)
+			continue;
+
+		if (!best || plen > best_plen ||
+		    (plen == best_plen && rtnl_route_get_priority(route) <
+					  rtnl_route_get_priority(best))) {
+			best = route;
+			best_plen = plen;
+		}
+	}
+
+	return best;
+}
+
+/* Weighted choice among the live nexthops by hash of the destination */
+static struct rtnl_nexthop *route_select_nexthop(struct rtnl_route *route,
+						 const uint8_t *key,
+						 unsigned int len)
+{
+	struct rtnl_nexthop *nh;
+	uint32_t total = 0, h;
+	int i, n;
+
+	n = rtnl_route_get_nnexthops(route);
+	if (n <= 1)
+		return n ? rtnl_route_nexthop_n(route, 0) : NULL;
+
+	for (i = 0; i < n; i++) {
+		nh = rtnl_route_nexthop_n(route, i);
+		if (!(rtnl_route_nh_get_flags(nh) & RTNH_F_DEAD))
+			total += rtnl_route_nh_get_weight(nh) + 1;
+	}
+
+	if (!total)
+		return rtnl_route_nexthop_n(route, 0);
+
+	h = nl_hash((void *) key, len, 0) % total;
+	for (i = 0; i < n; i++) {
+		nh = rtnl_route_nexthop_n(route, i);
+		if (rtnl_route_nh_get_flags(nh) & RTNH_F_DEAD)
+			continue;
+		if (h <= rtnl_route_nh_get_weight(nh))
+			return nh;
+		h -= rtnl_route_nh_get_weight(nh) + 1;
+	}
+
+	return rtnl_route_nexthop_n(route, 0);
+}
+/** @endcond */
+
 /**
  * @name Cache Management
  * @{
@@ -98,6 +538,73 @@ int rtnl_route_alloc_cache(struct nl_sock *sk, int family, int flags,
 	return 0;
 }
 
+/**
+ * Lookup the route to a destination in a route cache
+ * @arg cache		Route cache
+ * @arg table		Routing table
+ * @arg dst		Destination address
+ * @arg nh		Where to store the selected nexthop or NULL
+ *
+ * Finds the route with the longest prefix matching \c dst in \c table of
+ * the cache, among those the one with the lowest metric. Routes with a
+ * TOS are not considered. Route caches maintain an index for this, no
+ * message is exchanged with the kernel and the cost of a lookup does not
+ * depend on the number of routes. The index is updated along with the
+ * cache, e.g. by the cache manager.
+ *
+ * For multipath routes, a nexthop is selected by a hash of \c dst
+ * weighted by the nexthop weights, nexthops marked dead are skipped. The
+ * selection is deterministic but not identical to the one of the kernel,
+ * which hashes more than the destination. Routes
+ * referring to a nexthop object have no nexthop. The nexthop remains
+ * valid as long as the reference to the route is held.
+ *
+ * Policy rules are not evaluated, use rtnl_route_lookup() to resolve a
+ * destination exactly as the kernel does.
+ *
+ * @attention The reference counter of the returned route object will be
+ *            incremented. Use rtnl_route_put() to release the reference.
+ *
+ * @return Route object or NULL if no route matches.
+ */
+struct rtnl_route *rtnl_route_cache_lookup(struct nl_cache *cache,
+					   uint32_t table, struct nl_addr *dst,
+					   struct rtnl_nexthop **nh)
+{
+	uint8_t key[ROUTE_LPM_MAX_BITS / 8];
+	struct route_lpm_trie *lt;
+	struct route_lpm *rl;
+	struct rtnl_route *route = NULL;
+	int family = nl_addr_get_family(dst);
+	unsigned int bits = lpm_family_bits(family);
+
+	if (nh)
+		*nh = NULL;
+
+	if (cache->c_ops != &rtnl_route_ops || !bits ||
+	    lpm_key(dst, bits, bits, key) < 0)
+		return NULL;
+
+	nl_cache_read_lock(cache);
+
+	rl = cache->c_index;
+	if (rl && !rl->rl_broken) {
+		if ((lt = lpm_trie(rl, family, table, 0)))
+			route = lpm_lookup(lt, key);
+	} else
+		route = route_lookup_list(cache, table, family, key);
+
+	if (route) {
+		nl_object_get((struct nl_object *) route);
+		if (nh)
+			*nh = route_select_nexthop(route, key, bits / 8);
+	}
+
+	nl_cache_read_unlock(cache);
+
+	return route;
+}
+
 /** @} */
 
 /**
@@ -217,6 +724,10 @@ static struct nl_cache_ops rtnl_route_ops = {
 	.co_groups		= route_groups,
 	.co_request_update	= route_request_update,
 	.co_msg_parser		= route_msg_parser,
+	.co_msg_filter		= _nl_rtnl_route_msg_filter,
+	.co_obj_added		= route_obj_added,
+	.co_obj_removed		= route_obj_removed,
+	.co_index_free		= route_index_free,
 	.co_obj_ops		= &route_obj_ops,
 };
 
@@ -41,6 +41,7 @@
 #include "nl-route.h"
 #include "nl-aux-route/nl-route.h"
 #include "nl-priv-dynamic-core/nl-core.h"
+#include "nl-priv-dynamic-core/cache-api.h"
 #include "nexthop-encap.h"
 
 /** @cond SKIP */
@@ -338,50 +339,36 @@ static void route_dump_stats(struct nl_object *obj, struct nl_dump_params *p)
 	}
 }
 
-static void route_keygen(struct nl_object *obj, uint32_t *hashkey,
-			  uint32_t table_sz)
+static uint32_t route_keygen(struct nl_object *obj)
 {
 	struct rtnl_route *route = (struct rtnl_route *) obj;
-	unsigned int rkey_sz;
-	struct nl_addr *addr = NULL;
-	_nl_auto_free struct route_hash_key {
+	struct nl_addr *addr = route->rt_dst;
+	struct route_hash_key {
 		uint8_t		rt_family;
 		uint8_t		rt_tos;
 		uint32_t	rt_table;
 		uint32_t	rt_prio;
-		char 		rt_addr[0];
-	} _nl_packed *rkey = NULL;
+	} _nl_packed rkey;
 	char buf[INET6_ADDRSTRLEN+5];
+	uint32_t hash;
 
-	if (route->rt_dst)
-		addr = route->rt_dst;
+	rkey.rt_family = route->rt_family;
+	rkey.rt_tos = route->rt_tos;
+	rkey.rt_table = route->rt_table;
+	rkey.rt_prio = route->rt_prio;
 
-	rkey_sz = sizeof(*rkey);
-	if (addr)
-		rkey_sz += nl_addr_get_len(addr);
-	rkey = calloc(1, rkey_sz);
-	if (!rkey) {
-		NL_DBG(2, "Warning: calloc failed for %d bytes...\n", rkey_sz);
-		*hashkey = 0;
-		return;
-	}
-	rkey->rt_family = route->rt_family;
-	rkey->rt_tos = route->rt_tos;
-	rkey->rt_table = route->rt_table;
-	rkey->rt_prio = route->rt_prio;
+	/* Hash the destination on top, no need to build a packed key */
+	hash = nl_hash(&rkey, sizeof(rkey), 0);
 	if (addr)
-		memcpy(rkey->rt_addr, nl_addr_get_binary_addr(addr),
-			nl_addr_get_len(addr));
-
-	*hashkey = nl_hash(rkey, rkey_sz, 0) % table_sz;
+		hash = nl_hash(nl_addr_get_binary_addr(addr),
+			       nl_addr_get_len(addr), hash);
 
 	NL_DBG(5,
-	       "route %p key (fam %d tos %d table %d prio %d addr %s) keysz %d hash 0x%x\n",
-	       route, rkey->rt_family, rkey->rt_tos, rkey->rt_table,
-	       rkey->rt_prio, nl_addr2str(addr, buf, sizeof(buf)), rkey_sz,
-	       *hashkey);
+	       "route %p key (fam %d tos %d table %d prio %d addr %s) hash 0x%x\n",
+	       route, rkey.rt_family, rkey.rt_tos, rkey.rt_table,
+	       rkey.rt_prio, nl_addr2str(addr, buf, sizeof(buf)), hash);
 
-	return;
+	return hash;
 }
 
 static uint32_t route_id_attrs_get(struct nl_object *obj)
@@ -667,6 +654,7 @@ void rtnl_route_set_table(struct rtnl_route *route, uint32_t table)
 {
 	route->rt_table = table;
 	route->ce_mask |= ROUTE_ATTR_TABLE;
+	nl_object_invalidate_hash(route);
 }
 
 uint32_t rtnl_route_get_table(struct rtnl_route *route)
@@ -689,6 +677,7 @@ void rtnl_route_set_tos(struct rtnl_route *route, uint8_t tos)
 {
 	route->rt_tos = tos;
 	route->ce_mask |= ROUTE_ATTR_TOS;
+	nl_object_invalidate_hash(route);
 }
 
 uint8_t rtnl_route_get_tos(struct rtnl_route *route)
@@ -711,6 +700,7 @@ void rtnl_route_set_priority(struct rtnl_route *route, uint32_t prio)
 {
 	route->rt_prio = prio;
 	route->ce_mask |= ROUTE_ATTR_PRIO;
+	nl_object_invalidate_hash(route);
 }
 
 uint32_t rtnl_route_get_priority(struct rtnl_route *route)
@@ -727,6 +717,7 @@ int rtnl_route_set_family(struct rtnl_route *route, uint8_t family)
 	case AF_MPLS:
 		route->rt_family = family;
 		route->ce_mask |= ROUTE_ATTR_FAMILY;
+		nl_object_invalidate_hash(route);
 		return 0;
 	}
 
@@ -753,6 +744,7 @@ int rtnl_route_set_dst(struct rtnl_route *route, struct nl_addr *addr)
 	route->rt_dst = addr;
 
 	route->ce_mask |= (ROUTE_ATTR_DST | ROUTE_ATTR_FAMILY);
+	nl_object_invalidate_hash(route);
 
 	return 0;
 }
@@ -1542,6 +1534,80 @@ nla_put_failure:
 }
 
 /** @cond SKIP */
+/*
+ * Append the header of a route dump request and the attributes the
+ * kernel filters route dumps by if strict checking is enabled. The
+ * kernel rejects all other header fields and attributes.
+ */
+int _nl_rtnl_route_build_dump_request(struct nl_msg *msg, struct rtmsg *rtm,
+				      struct rtnl_route *filter)
+{
+	struct rtnl_nexthop *nh = NULL;
+
+	if (!rtm->rtm_family && (filter->ce_mask & ROUTE_ATTR_FAMILY))
+		rtm->rtm_family = filter->rt_family;
+
+	if (filter->ce_mask & ROUTE_ATTR_PROTOCOL)
+		rtm->rtm_protocol = filter->rt_protocol;
+
+	if (rtm->rtm_family != AF_MPLS) {
+		if (filter->ce_mask & ROUTE_ATTR_TABLE)
+			rtm->rtm_table = filter->rt_table < 256 ?
+						 filter->rt_table :
+						 RT_TABLE_COMPAT;
+
+		if (filter->ce_mask & ROUTE_ATTR_TYPE)
+			rtm->rtm_type = filter->rt_type;
+	}
+
+	if (nlmsg_append(msg, rtm, sizeof(*rtm), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	if (rtm->rtm_family != AF_MPLS &&
+	    (filter->ce_mask & ROUTE_ATTR_TABLE))
+		NLA_PUT_U32(msg, RTA_TABLE, filter->rt_table);
+
+	if (rtnl_route_get_nnexthops(filter) == 1)
+		nh = rtnl_route_nexthop_n(filter, 0);
+	if (nh && nh->rtnh_ifindex)
+		NLA_PUT_U32(msg, RTA_OIF, nh->rtnh_ifindex);
+
+	return 0;
+
+nla_put_failure:
+	return -NLE_MSGSIZE;
+}
+
+/*
+ * Skip route messages not matching the identity attributes of the cache
+ * filter before they are parsed.
+ */
+int _nl_rtnl_route_msg_filter(struct nl_cache *cache, struct nlmsghdr *nlh)
+{
+	struct rtnl_route *filter = (struct rtnl_route *) cache->c_filter;
+	struct rtmsg *rtm = nlmsg_data(nlh);
+	struct nlattr *nla;
+	uint32_t table;
+
+	if ((filter->ce_mask & ROUTE_ATTR_FAMILY) &&
+	    filter->rt_family != rtm->rtm_family)
+		return NL_SKIP;
+
+	if ((filter->ce_mask & ROUTE_ATTR_TOS) && filter->rt_tos != rtm->rtm_tos)
+		return NL_SKIP;
+
+	if (filter->ce_mask & ROUTE_ATTR_TABLE) {
+		table = rtm->rtm_table;
+		nla = nlmsg_find_attr(nlh, sizeof(*rtm), RTA_TABLE);
+		if (nla && nla_len(nla) >= (int) sizeof(uint32_t))
+			table = nla_get_u32(nla);
+		if (filter->rt_table != table)
+			return NL_SKIP;
+	}
+
+	return NL_OK;
+}
+
 struct nl_object_ops route_obj_ops = {
 	.oo_name		= "route/route",
 	.oo_size		= sizeof(struct rtnl_route),
@@ -271,6 +271,10 @@ void nl_socket_free(struct nl_sock *sk)
 	if (!(sk->s_flags & NL_OWN_PORT))
 		release_local_port(sk->s_local.nl_pid);
 
+	nlmsg_free(sk->s_rxmsg);
+	_nl_rxbuf_put(sk->s_rxbuf);
+	_nl_rxbatch_free(sk->s_rxbatch);
+	_nl_async_free(sk->s_async);
 	nl_cb_put(sk->s_cb);
 	free(sk);
 }
@@ -756,6 +760,38 @@ void nl_socket_disable_msg_peek(struct nl_sock *sk)
 	sk->s_flags &= ~NL_MSG_PEEK;
 }
 
+/**
+ * Enable zero-copy delivery of received messages
+ * @arg sk		Netlink socket.
+ *
+ * By default, nl_recvmsgs() copies every message contained in a received
+ * datagram into a newly allocated message object before passing it to the
+ * callbacks. With zero-copy delivery enabled, the message objects instead
+ * point directly into the receive buffer, which is reference counted and
+ * released once the last message borrowed from it has been freed.
+ *
+ * Taking a reference with nlmsg_get() therefore remains safe, but keeps
+ * the whole receive buffer alive. Callbacks which want to keep a message
+ * without pinning the buffer should create a private copy using
+ * nlmsg_convert(nlmsg_hdr(msg)). Borrowed messages have no tailroom,
+ * nlmsg_expand() moves them into a private buffer.
+ */
+void nl_socket_enable_msg_zerocopy(struct nl_sock *sk)
+{
+	sk->s_flags |= NL_RECV_ZEROCOPY;
+}
+
+/**
+ * Disable zero-copy delivery of received messages
+ * @arg sk		Netlink socket.
+ *
+ * @see nl_socket_enable_msg_zerocopy()
+ */
+void nl_socket_disable_msg_zerocopy(struct nl_sock *sk)
+{
+	sk->s_flags &= ~NL_RECV_ZEROCOPY;
+}
+
 /** @} */
 
 /**
@@ -904,6 +940,273 @@ size_t nl_socket_get_msg_buf_size(struct nl_sock *sk)
 	return sk->s_bufsize;
 }
 
+/**
+ * Enable persistent receive buffer
+ * @arg sk		Netlink socket.
+ *
+ * Attaches a receive buffer to the socket which is reused by nl_recvmsgs()
+ * for every datagram instead of allocating a new buffer for each call of
+ * nl_recv(). Each datagram is read with a single recvmsg() system call
+ * unless message peeking has been explicitly enabled with
+ * nl_socket_enable_msg_peek().
+ *
+ * The initial size of the buffer is the message buffer size set with
+ * nl_socket_set_msg_buf_size() or 4 times getpagesize(). Without peeking,
+ * a datagram exceeding the buffer is truncated and reported as
+ * -NLE_MSG_TRUNC, the buffer then grows to the size of that datagram. See
+ * nl_socket_get_recv_buf_grows().
+ *
+ * If messages are delivered zero-copy (nl_socket_enable_msg_zerocopy())
+ * and a message is still held when the next datagram is to be read, a new
+ * buffer is allocated while the old one is released with the last message.
+ *
+ * @note The buffer is not used if the receive function has been replaced
+ *       using nl_cb_overwrite_recv().
+ */
+void nl_socket_enable_recv_buf(struct nl_sock *sk)
+{
+	sk->s_flags |= NL_RECV_BUF;
+}
+
+/**
+ * Disable persistent receive buffer
+ * @arg sk		Netlink socket.
+ *
+ * Releases the receive buffer, nl_recvmsgs() will allocate a buffer
+ * for every datagram again.
+ *
+ * @see nl_socket_enable_recv_buf()
+ */
+void nl_socket_disable_recv_buf(struct nl_sock *sk)
+{
+	sk->s_flags &= ~NL_RECV_BUF;
+	_nl_rxbuf_put(sk->s_rxbuf);
+	sk->s_rxbuf = NULL;
+}
+
+/**
+ * Get size of persistent receive buffer
+ * @arg sk		Netlink socket.
+ *
+ * @return Current size of the receive buffer in bytes or 0 if no buffer
+ *         has been allocated yet.
+ */
+size_t nl_socket_get_recv_buf_size(const struct nl_sock *sk)
+{
+	return sk->s_rxbuf_size;
+}
+
+/**
+ * Get number of times the persistent receive buffer has grown
+ * @arg sk		Netlink socket.
+ *
+ * The buffer grows whenever a datagram did not fit. A steadily increasing
+ * value means the message buffer size (nl_socket_set_msg_buf_size()) is
+ * chosen too small.
+ *
+ * @return Number of times the receive buffer was enlarged.
+ */
+unsigned int nl_socket_get_recv_buf_grows(const struct nl_sock *sk)
+{
+	return sk->s_rxbuf_grows;
+}
+
+/** @cond SKIP */
+#define NL_RECV_BATCH_MAX 1024
+
+void _nl_rxbatch_free(struct nl_rxbatch *rq)
+{
+	unsigned int i;
+
+	if (!rq)
+		return;
+
+	if (rq->rq_bufs) {
+		for (i = 0; i < rq->rq_size; i++)
+			_nl_rxbuf_put(rq->rq_bufs[i]);
+	}
+
+	free(rq->rq_bufs);
+	free(rq->rq_addr);
+	free(rq->rq_iov);
+	free(rq->rq_msgs);
+	free(rq);
+}
+/** @endcond */
+
+/**
+ * Set number of datagrams received per system call
+ * @arg sk		Netlink socket.
+ * @arg n		Maximum number of datagrams per system call.
+ *
+ * Enables batched receiving if \c n is greater than 1. nl_recvmsgs() then
+ * reads up to \c n datagrams with a single recvmmsg() system call into a
+ * ring of preallocated buffers and processes them one after another
+ * through the usual callbacks before issuing the next system call. A value
+ * of 0 or 1 disables batching.
+ *
+ * Datagrams already received but not yet processed are kept by the socket
+ * and returned by the following calls to nl_recvmsgs(). Users which poll()
+ * the file descriptor must therefore keep calling nl_recvmsgs() until it
+ * returns -NLE_AGAIN on a non-blocking socket, like
+ * nl_cache_mngr_data_ready() does. Datagrams still pending when batching
+ * is disabled are dropped.
+ *
+ * The buffers are sized like the persistent receive buffer, see
+ * nl_socket_enable_recv_buf(). Batching is not used while credential
+ * passing is enabled or if the receive function has been replaced using
+ * nl_cb_overwrite_recv().
+ *
+ * @see nl_socket_get_recv_batch_saved()
+ *
+ * @return 0 on success or a negative error code.
+ * @retval -NLE_RANGE More than 1024 datagrams per batch requested.
+ */
+int nl_socket_set_recv_batch(struct nl_sock *sk, unsigned int n)
+{
+	struct nl_rxbatch *rq;
+
+	if (n > NL_RECV_BATCH_MAX)
+		return -NLE_RANGE;
+
+	_nl_rxbatch_free(sk->s_rxbatch);
+	sk->s_rxbatch = NULL;
+
+	if (n <= 1)
+		return 0;
+
+	rq = calloc(1, sizeof(*rq));
+	if (!rq)
+		return -NLE_NOMEM;
+
+	rq->rq_size = n;
+	rq->rq_bufsize = sk->s_bufsize ? sk->s_bufsize : (size_t)getpagesize() * 4;
+	rq->rq_msgs = calloc(n, sizeof(*rq->rq_msgs));
+	rq->rq_iov = calloc(n, sizeof(*rq->rq_iov));
+	rq->rq_addr = calloc(n, sizeof(*rq->rq_addr));
+	rq->rq_bufs = calloc(n, sizeof(*rq->rq_bufs));
+	if (!rq->rq_msgs || !rq->rq_iov || !rq->rq_addr || !rq->rq_bufs) {
+		_nl_rxbatch_free(rq);
+		return -NLE_NOMEM;
+	}
+
+	sk->s_rxbatch = rq;
+
+	return 0;
+}
+
+/**
+ * Get number of datagrams received per system call
+ * @arg sk		Netlink socket.
+ *
+ * @return Batch size or 0 if batched receiving is disabled.
+ */
+unsigned int nl_socket_get_recv_batch(const struct nl_sock *sk)
+{
+	return sk->s_rxbatch ? sk->s_rxbatch->rq_size : 0;
+}
+
+/**
+ * Get number of system calls saved by batched receiving
+ * @arg sk		Netlink socket.
+ *
+ * Counts the datagrams which were received along with another datagram
+ * in the same recvmmsg() system call, i.e. the number of system calls
+ * unbatched receiving would have required in addition.
+ *
+ * @return Number of system calls saved since batching was enabled.
+ */
+uint64_t nl_socket_get_recv_batch_saved(const struct nl_sock *sk)
+{
+	return sk->s_rxbatch ? sk->s_rxbatch->rq_saved : 0;
+}
+
+/** @cond SKIP */
+#define NL_ASYNC_WINDOW_MAX 4096
+
+void _nl_async_free(struct nl_async *as)
+{
+	unsigned int i;
+
+	if (!as)
+		return;
+
+	for (i = 0; i < as->as_count; i++)
+		nlmsg_free(as->as_reqs[(as->as_head + i) % as->as_window].ar_msg);
+
+	free(as->as_reqs);
+	free(as);
+}
+/** @endcond */
+
+/**
+ * Set maximum number of outstanding asynchronous requests
+ * @arg sk		Netlink socket.
+ * @arg window		Maximum number of requests in flight.
+ *
+ * Limits the number of requests sent by nl_send_async() which may await
+ * their acknowledgment at the same time. Once the window is full,
+ * nl_send_async() processes replies until a request has completed.
+ *
+ * If not set, a window of 64 requests is used.
+ *
+ * @return 0 on success or a negative error code.
+ * @retval -NLE_RANGE Window is 0 or larger than 4096.
+ * @retval -NLE_BUSY Requests are still in flight or a completion callback
+ *                   is running.
+ */
+int nl_socket_set_async_window(struct nl_sock *sk, unsigned int window)
+{
+	struct nl_async *as;
+
+	if (window == 0 || window > NL_ASYNC_WINDOW_MAX)
+		return -NLE_RANGE;
+
+	if (sk->s_async &&
+	    (sk->s_async->as_count > 0 || sk->s_async->as_busy))
+		return -NLE_BUSY;
+
+	as = calloc(1, sizeof(*as));
+	if (!as)
+		return -NLE_NOMEM;
+
+	as->as_window = window;
+	as->as_reqs = calloc(window, sizeof(*as->as_reqs));
+	if (!as->as_reqs) {
+		free(as);
+		return -NLE_NOMEM;
+	}
+
+	_nl_async_free(sk->s_async);
+	sk->s_async = as;
+
+	return 0;
+}
+
+/**
+ * Get maximum number of outstanding asynchronous requests
+ * @arg sk		Netlink socket.
+ *
+ * @return Window size or 0 if no asynchronous request has been sent yet
+ *         and no window has been set.
+ */
+unsigned int nl_socket_get_async_window(const struct nl_sock *sk)
+{
+	return sk->s_async ? sk->s_async->as_window : 0;
+}
+
+/**
+ * Get number of asynchronous requests in flight
+ * @arg sk		Netlink socket.
+ *
+ * @return Number of requests sent by nl_send_async() which have not
+ *         completed yet.
+ */
+unsigned int nl_socket_get_async_pending(const struct nl_sock *sk)
+{
+	return sk->s_async ? sk->s_async->as_count : 0;
+}
+
 /**
  * Enable/disable credential passing on netlink socket.
  * @arg sk		Netlink socket.
@@ -959,6 +1262,46 @@ int nl_socket_recv_pktinfo(struct nl_sock *sk, int state)
 	return 0;
 }
 
+/**
+ * Enable/disable strict checking of dump requests
+ * @arg sk		Netlink socket.
+ * @arg state		New state (0 - disabled, 1 - enabled)
+ *
+ * With strict checking enabled, the kernel validates the header and
+ * attributes of dump requests and honours the attributes it supports
+ * as filters, e.g. RTA_TABLE and RTA_OIF for route dumps. Dump requests
+ * carrying header fields or attributes not supported as filter are
+ * rejected.
+ *
+ * Caches configured with nl_cache_set_dump_filter() enable strict
+ * checking on their own while requesting a dump.
+ *
+ * @return 0 on success or a negative error code, -NLE_INVAL if the
+ *         kernel does not support strict checking.
+ */
+int nl_socket_set_strict_check(struct nl_sock *sk, int state)
+{
+	int err;
+
+	if (sk->s_fd == -1)
+		return -NLE_BAD_SOCK;
+
+	err = setsockopt(sk->s_fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK,
+			 &state, sizeof(state));
+	if (err < 0) {
+		NL_DBG(4, "nl_socket_set_strict_check(%p): setsockopt() failed with %d (%s)\n",
+			sk, errno, nl_strerror_l(errno));
+		return -nl_syserr2nlerr(errno);
+	}
+
+	if (state)
+		sk->s_flags |= NL_SOCK_STRICT_CHK;
+	else
+		sk->s_flags &= ~NL_SOCK_STRICT_CHK;
+
+	return 0;
+}
+
 /** @} */
 
 /** @} */
@@ -129,6 +129,7 @@
 #include <netlink/cache.h>
 #include <netlink/object.h>
 #include <netlink/xfrm/ae.h>
+#include <netlink/hashtable.h>
 
 #include "nl-xfrm.h"
 #include "nl-priv-dynamic-core/object-api.h"
@@ -222,6 +223,32 @@ static int xfrm_ae_clone(struct nl_object *_dst, struct nl_object *_src)
 	return 0;
 }
 
+static uint32_t xfrm_ae_keygen(struct nl_object *obj)
+{
+	struct xfrmnl_ae *ae = (struct xfrmnl_ae *) obj;
+	struct xfrm_ae_hash_key {
+		uint32_t	spi;
+		uint8_t		proto;
+	} _nl_packed akey;
+	uint32_t hash;
+
+	memset(&akey, 0, sizeof(akey));
+	if (ae->ce_mask & XFRM_AE_ATTR_SPI)
+		akey.spi = ae->sa_id.spi;
+	if (ae->ce_mask & XFRM_AE_ATTR_PROTO)
+		akey.proto = ae->sa_id.proto;
+
+	hash = nl_hash(&akey, sizeof(akey), 0);
+	if ((ae->ce_mask & XFRM_AE_ATTR_DADDR) && ae->sa_id.daddr)
+		hash = nl_hash(nl_addr_get_binary_addr(ae->sa_id.daddr),
+			       nl_addr_get_len(ae->sa_id.daddr), hash);
+
+	NL_DBG(5, "xfrm ae %p key (spi 0x%x proto %d) hash 0x%x\n",
+	       ae, akey.spi, akey.proto, hash);
+
+	return hash;
+}
+
 static uint64_t xfrm_ae_compare(struct nl_object *_a, struct nl_object *_b,
 				uint64_t attrs, int flags)
 {
@@ -726,6 +753,7 @@ static inline int __assign_addr(struct xfrmnl_ae* ae, struct nl_addr **pos,
 	*pos = new;
 
 	ae->ce_mask |= flag;
+	nl_object_invalidate_hash(ae);
 
 	return 0;
 }
@@ -756,6 +784,7 @@ int xfrmnl_ae_set_spi (struct xfrmnl_ae* ae, unsigned int spi)
 {
 	ae->sa_id.spi = spi;
 	ae->ce_mask |= XFRM_AE_ATTR_SPI;
+	nl_object_invalidate_hash(ae);
 
 	return 0;
 }
@@ -788,6 +817,7 @@ int xfrmnl_ae_set_proto (struct xfrmnl_ae* ae, unsigned int protocol)
 {
 	ae->sa_id.proto = protocol;
 	ae->ce_mask |= XFRM_AE_ATTR_PROTO;
+	nl_object_invalidate_hash(ae);
 
 	return 0;
 }
@@ -1019,6 +1049,7 @@ static struct nl_object_ops xfrm_ae_obj_ops = {
 	                        [NL_DUMP_DETAILS]   =   xfrm_ae_dump_details,
 	                        [NL_DUMP_STATS]     =   xfrm_ae_dump_stats,
 	                    },
+	.oo_keygen      =   xfrm_ae_keygen,
 	.oo_compare     =   xfrm_ae_compare,
 	.oo_attrs2str   =   xfrm_ae_attrs2str,
 	.oo_id_attrs    =   (XFRM_AE_ATTR_DADDR | XFRM_AE_ATTR_SPI | XFRM_AE_ATTR_PROTO),
@@ -47,6 +47,7 @@
 #include <netlink/cache.h>
 #include <netlink/object.h>
 #include <netlink/xfrm/sa.h>
+#include <netlink/hashtable.h>
 #include <netlink/xfrm/selector.h>
 #include <netlink/xfrm/lifetime.h>
 
@@ -306,6 +307,32 @@ static int xfrm_sa_clone(struct nl_object *_dst, struct nl_object *_src)
 	return 0;
 }
 
+static uint32_t xfrm_sa_keygen(struct nl_object *obj)
+{
+	struct xfrmnl_sa *sa = (struct xfrmnl_sa *) obj;
+	struct xfrm_sa_hash_key {
+		uint32_t	spi;
+		uint8_t		proto;
+	} _nl_packed skey;
+	uint32_t hash;
+
+	memset(&skey, 0, sizeof(skey));
+	if (sa->ce_mask & XFRM_SA_ATTR_SPI)
+		skey.spi = sa->id.spi;
+	if (sa->ce_mask & XFRM_SA_ATTR_PROTO)
+		skey.proto = sa->id.proto;
+
+	hash = nl_hash(&skey, sizeof(skey), 0);
+	if ((sa->ce_mask & XFRM_SA_ATTR_DADDR) && sa->id.daddr)
+		hash = nl_hash(nl_addr_get_binary_addr(sa->id.daddr),
+			       nl_addr_get_len(sa->id.daddr), hash);
+
+	NL_DBG(5, "xfrm sa %p key (spi 0x%x proto %d) hash 0x%x\n",
+	       sa, skey.spi, skey.proto, hash);
+
+	return hash;
+}
+
 static uint64_t xfrm_sa_compare(struct nl_object *_a, struct nl_object *_b,
 				uint64_t attrs, int flags)
 {
@@ -1540,6 +1567,7 @@ static inline int __assign_addr(struct xfrmnl_sa* sa, struct nl_addr **pos,
 	*pos = new;
 
 	sa->ce_mask |= flag;
+	nl_object_invalidate_hash(sa);
 
 	return 0;
 }
@@ -1570,6 +1598,7 @@ int xfrmnl_sa_set_spi (struct xfrmnl_sa* sa, unsigned int spi)
 {
 	sa->id.spi = spi;
 	sa->ce_mask |= XFRM_SA_ATTR_SPI;
+	nl_object_invalidate_hash(sa);
 
 	return 0;
 }
@@ -1586,6 +1615,7 @@ int xfrmnl_sa_set_proto (struct xfrmnl_sa* sa, unsigned int protocol)
 {
 	sa->id.proto = protocol;
 	sa->ce_mask |= XFRM_SA_ATTR_PROTO;
+	nl_object_invalidate_hash(sa);
 
 	return 0;
 }
@@ -2337,6 +2367,7 @@ static struct nl_object_ops xfrm_sa_obj_ops = {
 	                        [NL_DUMP_DETAILS]   =   xfrm_sa_dump_details,
 	                        [NL_DUMP_STATS]     =   xfrm_sa_dump_stats,
 	                    },
+	.oo_keygen      =   xfrm_sa_keygen,
 	.oo_compare     =   xfrm_sa_compare,
 	.oo_attrs2str   =   xfrm_sa_attrs2str,
 	.oo_id_attrs    =   (XFRM_SA_ATTR_DADDR | XFRM_SA_ATTR_SPI | XFRM_SA_ATTR_PROTO),
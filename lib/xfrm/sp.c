@@ -49,6 +49,7 @@
 #include <netlink/xfrm/lifetime.h>
 #include <netlink/xfrm/template.h>
 #include <netlink/xfrm/sp.h>
+#include <netlink/hashtable.h>
 
 #include "nl-xfrm.h"
 #include "nl-priv-dynamic-core/object-api.h"
@@ -177,6 +178,31 @@ static int xfrm_sp_clone(struct nl_object *_dst, struct nl_object *_src)
 	return 0;
 }
 
+static uint32_t xfrm_sp_keygen(struct nl_object *obj)
+{
+	struct xfrmnl_sp *sp = (struct xfrmnl_sp *) obj;
+	struct xfrm_sp_hash_key {
+		uint32_t	index;
+		uint8_t		dir;
+	} _nl_packed pkey;
+	uint32_t hash;
+
+	/* The selector is part of the identity as well but comparing
+	 * index and direction is selective enough */
+	memset(&pkey, 0, sizeof(pkey));
+	if (sp->ce_mask & XFRM_SP_ATTR_INDEX)
+		pkey.index = sp->index;
+	if (sp->ce_mask & XFRM_SP_ATTR_DIR)
+		pkey.dir = sp->dir;
+
+	hash = nl_hash(&pkey, sizeof(pkey), 0);
+
+	NL_DBG(5, "xfrm sp %p key (index %u dir %d) hash 0x%x\n",
+	       sp, pkey.index, pkey.dir, hash);
+
+	return hash;
+}
+
 static uint64_t xfrm_sp_compare(struct nl_object *_a, struct nl_object *_b,
 				uint64_t attrs, int flags)
 {
@@ -1157,6 +1183,7 @@ int xfrmnl_sp_set_index (struct xfrmnl_sp* sp, unsigned int index)
 {
 	sp->index       = index;
 	sp->ce_mask     |= XFRM_SP_ATTR_INDEX;
+	nl_object_invalidate_hash(sp);
 
 	return 0;
 }
@@ -1173,6 +1200,7 @@ int xfrmnl_sp_set_dir (struct xfrmnl_sp* sp, unsigned int dir)
 {
 	sp->dir         = dir;
 	sp->ce_mask     |= XFRM_SP_ATTR_DIR;
+	nl_object_invalidate_hash(sp);
 
 	return 0;
 }
@@ -1421,6 +1449,7 @@ static struct nl_object_ops xfrm_sp_obj_ops = {
 	                        [NL_DUMP_DETAILS]   =   xfrm_sp_dump_details,
 	                        [NL_DUMP_STATS]     =   xfrm_sp_dump_stats,
 	                    },
+	.oo_keygen      =   xfrm_sp_keygen,
 	.oo_compare     =   xfrm_sp_compare,
 	.oo_attrs2str   =   xfrm_sp_attrs2str,
 	.oo_id_attrs    =   (XFRM_SP_ATTR_SEL | XFRM_SP_ATTR_INDEX | XFRM_SP_ATTR_DIR),
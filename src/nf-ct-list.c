@@ -20,6 +20,7 @@ static void print_usage(void)
 	"Options\n"
 	" -f, --format=TYPE     Output format { brief | details | stats }\n"
 	" -h, --help            Show this help\n"
+	" -s, --stream          Print entries while they are dumped\n"
 	" -v, --version         Show versioning information\n"
 	"\n"
 	"Conntrack Selection\n"
@@ -43,6 +44,13 @@ static void print_usage(void)
 	exit(0);
 }
 
+static int print_ct(struct nl_object *obj, void *arg)
+{
+	nl_object_dump(obj, arg);
+
+	return NL_OK;
+}
+
 int main(int argc, char *argv[])
 {
 	struct nl_sock *sock;
@@ -52,6 +60,8 @@ int main(int argc, char *argv[])
 		.dp_type = NL_DUMP_LINE,
 		.dp_fd = stdout,
 	};
+	int stream = 0;
+	int err;
 
 	ct = nl_cli_ct_alloc();
 
@@ -75,6 +85,7 @@ int main(int argc, char *argv[])
 		static struct option long_opts[] = {
 			{ "format", 1, 0, 'f' },
 			{ "help", 0, 0, 'h' },
+			{ "stream", 0, 0, 's' },
 			{ "version", 0, 0, 'v' },
 			{ "id", 1, 0, 'i' },
 			{ "proto", 1, 0, 'p' },
@@ -94,7 +105,7 @@ int main(int argc, char *argv[])
 			{ 0, 0, 0, 0 }
 		};
 
-		c = getopt_long(argc, argv, "46f:hvi:p:F:", long_opts, &optidx);
+		c = getopt_long(argc, argv, "46f:hsvi:p:F:", long_opts, &optidx);
 		if (c == -1)
 			break;
 
@@ -104,6 +115,7 @@ int main(int argc, char *argv[])
 		case '6': nfnl_ct_set_family(ct, AF_INET6); break;
 		case 'f': params.dp_type = nl_cli_parse_dumptype(optarg); break;
 		case 'h': print_usage(); break;
+		case 's': stream = 1; break;
 		case 'v': nl_cli_print_version(); break;
 		case 'i': nl_cli_ct_parse_id(ct, optarg); break;
 		case 'p': nl_cli_ct_parse_protocol(ct, optarg); break;
@@ -126,6 +138,18 @@ int main(int argc, char *argv[])
 
 	sock = nl_cli_alloc_socket();
 	nl_cli_connect(sock, NETLINK_NETFILTER);
+
+	if (stream) {
+		if ((err = nfnl_ct_alloc_cache(NULL, &ct_cache)) < 0 ||
+		    (err = nl_cache_set_dump_filter(ct_cache, OBJ_CAST(ct))) < 0 ||
+		    (err = nl_cache_stream(sock, ct_cache, print_ct,
+					   &params)) < 0)
+			nl_cli_fatal(err, "Unable to dump conntrack entries: %s",
+				     nl_geterror(err));
+
+		return 0;
+	}
+
 	ct_cache = nl_cli_ct_alloc_cache(sock);
 
 	nl_cache_dump_filter(ct_cache, &params, OBJ_CAST(ct));
@@ -14,6 +14,7 @@
 #include <netlink/cli/link.h>
 #include <netlink/netfilter/nfnl.h>
 #include <netlink/netfilter/log.h>
+#include <netlink/netfilter/log_msg.h>
 
 static struct nfnl_log *alloc_log(void)
 {
@@ -26,7 +27,7 @@ static struct nfnl_log *alloc_log(void)
 	return log;
 }
 
-static void obj_input(struct nl_object *obj, void *arg)
+static void msg_input(struct nfnl_log_msg *msg, void *arg)
 {
 	struct nl_dump_params dp = {
 		.dp_type = NL_DUMP_STATS,
@@ -34,16 +35,7 @@ static void obj_input(struct nl_object *obj, void *arg)
 		.dp_dump_msgtype = 1,
 	};
 
-	nl_object_dump(obj, &dp);
-}
-
-static int event_input(struct nl_msg *msg, void *arg)
-{
-	if (nl_msg_parse(msg, &obj_input, NULL) < 0)
-		fprintf(stderr, "<<EVENT>> Unknown message type\n");
-
-	/* Exit nl_recvmsgs_def() and return to the main select() */
-	return NL_STOP;
+	nl_object_dump((struct nl_object *) msg, &dp);
 }
 
 int main(int argc, char *argv[])
@@ -51,14 +43,17 @@ int main(int argc, char *argv[])
 	struct nl_sock *nf_sock;
 	struct nl_sock *rt_sock;
 	struct nfnl_log *log;
+	struct nfnl_log_collector *collector;
+	uint64_t lost = 0;
 	int copy_mode;
 	uint32_t copy_range;
 	int err;
 	int family;
 
 	nf_sock = nl_cli_alloc_socket();
-	nl_socket_disable_seq_check(nf_sock);
-	nl_socket_modify_cb(nf_sock, NL_CB_VALID, NL_CB_CUSTOM, event_input, NULL);
+	collector = nfnl_log_collector_alloc(nf_sock, msg_input, NULL);
+	if (!collector)
+		nl_cli_fatal(ENOMEM, "Unable to allocate log collector");
 
 	if ((argc > 1 && !strcasecmp(argv[1], "-h")) || argc < 3) {
 		printf("Usage: nf-log family group [ copy_mode ] "
@@ -96,6 +91,9 @@ int main(int argc, char *argv[])
 		copy_range = atoi(argv[4]);
 	nfnl_log_set_copy_range(log, copy_range);
 
+	/* Sequence numbers reveal lost messages */
+	nfnl_log_set_flags(log, NFNL_LOG_FLAG_SEQ);
+
 	if ((err = nfnl_log_create(nf_sock, log)) < 0)
 		nl_cli_fatal(err, "Unable to bind instance: %s",
 			     nl_geterror(err));
@@ -133,8 +131,14 @@ int main(int argc, char *argv[])
 		retval = select(maxfd+1, &rfds, NULL, NULL, NULL);
 
 		if (retval) {
-			if (FD_ISSET(nffd, &rfds))
-				nl_recvmsgs_default(nf_sock);
+			if (FD_ISSET(nffd, &rfds)) {
+				nfnl_log_collector_recv(collector);
+				if (nfnl_log_collector_get_lost(collector) != lost) {
+					lost = nfnl_log_collector_get_lost(collector);
+					fprintf(stderr, "%" PRIu64 " messages lost\n",
+						lost);
+				}
+			}
 			if (FD_ISSET(rtfd, &rfds))
 				nl_recvmsgs_default(rt_sock);
 		}
@@ -17,6 +17,7 @@
 #include <netlink/netfilter/queue_msg.h>
 
 static struct nl_sock *nf_sock;
+static struct nfnl_queue_verdict_buf *verdicts;
 
 static struct nfnl_queue *alloc_queue(void)
 {
@@ -41,7 +42,7 @@ static void obj_input(struct nl_object *obj, void *arg)
 
 	nfnl_queue_msg_set_verdict(msg, NF_ACCEPT);
 	nl_object_dump(obj, &dp);
-	nfnl_queue_msg_send_verdict(nf_sock, msg);
+	nfnl_queue_verdict_buf_add_msg(verdicts, msg);
 }
 
 static int event_input(struct nl_msg *msg, void *arg)
@@ -53,6 +54,48 @@ static int event_input(struct nl_msg *msg, void *arg)
 	return NL_STOP;
 }
 
+static int pool_input(struct nfnl_queue_msg *msg, void *arg)
+{
+	return NF_ACCEPT;
+}
+
+static void run_pool(struct nfnl_queue *queue, unsigned int nqueues)
+{
+	struct nfnl_queue_pool *pool;
+	uint64_t last = 0;
+	unsigned int i;
+	int err;
+
+	pool = nfnl_queue_pool_alloc(queue, nqueues);
+	if (!pool)
+		nl_cli_fatal(ENOMEM, "Unable to allocate queue pool");
+
+	if ((err = nfnl_queue_pool_start(pool, pool_input, NULL)) < 0)
+		nl_cli_fatal(err, "Unable to start queue pool: %s",
+			     nl_geterror(err));
+
+	while (1) {
+		uint64_t total = 0;
+
+		sleep(1);
+
+		for (i = 0; i < nqueues; i++) {
+			uint64_t packets = nfnl_queue_pool_get_packets(pool, i);
+
+			printf("queue %u: %" PRIu64 " packets %" PRIu64
+			       " lost %" PRIu64 " overruns\n",
+			       nfnl_queue_get_group(queue) + i, packets,
+			       nfnl_queue_pool_get_lost(pool, i),
+			       nfnl_queue_pool_get_overruns(pool, i));
+			total += packets;
+		}
+
+		printf("total: %" PRIu64 " packets/s\n", total - last);
+		fflush(stdout);
+		last = total;
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	struct nl_sock *rt_sock;
@@ -71,10 +114,13 @@ int main(int argc, char *argv[])
 
 	if ((argc > 1 && !strcasecmp(argv[1], "-h")) || argc < 3) {
 		printf("Usage: nf-queue family group [ copy_mode ] "
-		       "[ copy_range ]\n");
+		       "[ copy_range ] [ nqueues ]\n");
 		printf("family: [ inet | inet6 | ... ] \n");
 		printf("group: the --queue-num arg that you gave to iptables\n");
 		printf("copy_mode: [ none | meta | packet ] \n");
+		printf("nqueues: serve queues group to group+nqueues-1 with one "
+		       "thread each,\n"
+		       "         accepting all packets and printing rates\n");
 		return 2;
 	}
 
@@ -106,9 +152,17 @@ int main(int argc, char *argv[])
 		copy_range = atoi(argv[4]);
 	nfnl_queue_set_copy_range(queue, copy_range);
 
+	if (argc > 5 && atoi(argv[5]) > 1)
+		run_pool(queue, atoi(argv[5]));
+
 	if ((err = nfnl_queue_create(nf_sock, queue)) < 0)
 		nl_cli_fatal(err, "Unable to bind queue: %s", nl_geterror(err));
 
+	verdicts = nfnl_queue_verdict_buf_alloc(nf_sock, family,
+						nfnl_queue_get_group(queue));
+	if (!verdicts)
+		nl_cli_fatal(ENOMEM, "Unable to allocate verdict buffer");
+
 	rt_sock = nl_cli_alloc_socket();
 	nl_cli_connect(rt_sock, NETLINK_ROUTE);
 	nl_cli_link_alloc_cache(rt_sock);
@@ -133,8 +187,10 @@ int main(int argc, char *argv[])
 		retval = select(maxfd+1, &rfds, NULL, NULL, NULL);
 
 		if (retval) {
-			if (FD_ISSET(nffd, &rfds))
+			if (FD_ISSET(nffd, &rfds)) {
 				nl_recvmsgs_default(nf_sock);
+				nfnl_queue_verdict_buf_flush(verdicts);
+			}
 			if (FD_ISSET(rtfd, &rfds))
 				nl_recvmsgs_default(rt_sock);
 		}
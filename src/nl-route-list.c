@@ -20,6 +20,7 @@ static void print_usage(void)
 	" -c, --cache           List the contents of the route cache\n"
 	" -f, --format=TYPE	Output format { brief | details | stats }\n"
 	" -h, --help            Show this help\n"
+	" -s, --stream          Print routes while they are dumped\n"
 	" -v, --version		Show versioning information\n"
 	"\n"
 	"Route Options\n"
@@ -45,6 +46,13 @@ static void print_usage(void)
 	exit(0);
 }
 
+static int print_route(struct nl_object *obj, void *arg)
+{
+	nl_object_dump(obj, arg);
+
+	return NL_OK;
+}
+
 int main(int argc, char *argv[])
 {
 	struct nl_sock *sock;
@@ -55,6 +63,8 @@ int main(int argc, char *argv[])
 		.dp_type = NL_DUMP_LINE,
 	};
 	int print_cache = 0;
+	int stream = 0;
+	int err;
 
 	sock = nl_cli_alloc_socket();
 	nl_cli_connect(sock, NETLINK_ROUTE);
@@ -78,6 +88,7 @@ int main(int argc, char *argv[])
 			{ "cache", 0, 0, 'c' },
 			{ "format", 1, 0, 'f' },
 			{ "help", 0, 0, 'h' },
+			{ "stream", 0, 0, 's' },
 			{ "version", 0, 0, 'v' },
 			{ "dst", 1, 0, 'd' },
 			{ "nexthop", 1, 0, 'n' },
@@ -94,7 +105,7 @@ int main(int argc, char *argv[])
 			{ 0, 0, 0, 0 }
 		};
 
-		c = getopt_long(argc, argv, "cf:hvd:n:t:", long_opts, &optidx);
+		c = getopt_long(argc, argv, "cf:hsvd:n:t:", long_opts, &optidx);
 		if (c == -1)
 			break;
 
@@ -102,6 +113,7 @@ int main(int argc, char *argv[])
 		case 'c': print_cache = 1; break;
 		case 'f': params.dp_type = nl_cli_parse_dumptype(optarg); break;
 		case 'h': print_usage(); break;
+		case 's': stream = 1; break;
 		case 'v': nl_cli_print_version(); break;
 		case 'd': nl_cli_route_parse_dst(route, optarg); break;
 		case 'n': nl_cli_route_parse_nexthop(route, optarg, link_cache); break;
@@ -118,6 +130,21 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (stream) {
+		/* Let the kernel filter and never hold the whole table */
+		if ((err = rtnl_route_alloc_cache(NULL, AF_UNSPEC,
+				print_cache ? ROUTE_CACHE_CONTENT : 0,
+				&route_cache)) < 0 ||
+		    (err = nl_cache_set_dump_filter(route_cache,
+						    OBJ_CAST(route))) < 0 ||
+		    (err = nl_cache_stream(sock, route_cache, print_route,
+					   &params)) < 0)
+			nl_cli_fatal(err, "Unable to dump routes: %s",
+				     nl_geterror(err));
+
+		return 0;
+	}
+
 	route_cache = nl_cli_route_alloc_cache(sock,
 				print_cache ? ROUTE_CACHE_CONTENT : 0);
 
@@ -24,9 +24,31 @@ int main(int argc, char *argv[])
 	runner = srunner_create(main_suite());
 
 	srunner_add_suite(runner, make_nl_addr_suite());
+	srunner_add_suite(runner, make_nl_async_suite());
 	srunner_add_suite(runner, make_nl_attr_suite());
+	srunner_add_suite(runner, make_nl_cache_dispatch_suite());
+	srunner_add_suite(runner, make_nl_cache_dump_filter_suite());
+	srunner_add_suite(runner, make_nl_cache_filter_suite());
+	srunner_add_suite(runner, make_nl_cache_hash_suite());
+	srunner_add_suite(runner, make_nl_cache_include_suite());
+	srunner_add_suite(runner, make_nl_cache_mngr_suite());
+	srunner_add_suite(runner, make_nl_cache_refill_parallel_suite());
+	srunner_add_suite(runner, make_nl_cache_resync_suite());
+	srunner_add_suite(runner, make_nl_cache_snapshot_suite());
+	srunner_add_suite(runner, make_nl_cache_stream_suite());
+	srunner_add_suite(runner, make_nl_ct_addr_suite());
 	srunner_add_suite(runner, make_nl_ematch_tree_clone_suite());
+	srunner_add_suite(runner, make_nl_link_lookup_suite());
+	srunner_add_suite(runner, make_nl_msg_zerocopy_suite());
 	srunner_add_suite(runner, make_nl_netns_suite());
+	srunner_add_suite(runner, make_nl_nf_log_collector_suite());
+	srunner_add_suite(runner, make_nl_nf_payload_suite());
+	srunner_add_suite(runner, make_nl_queue_pool_suite());
+	srunner_add_suite(runner, make_nl_queue_verdict_suite());
+	srunner_add_suite(runner, make_nl_recv_batch_suite());
+	srunner_add_suite(runner, make_nl_recv_counters_suite());
+	srunner_add_suite(runner, make_nl_route_lookup_suite());
+	srunner_add_suite(runner, make_nl_send_batch_suite());
 
 	srunner_run_all(runner, CK_ENV);
 
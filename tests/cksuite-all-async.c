@@ -0,0 +1,310 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netlink.h>
+
+#include <netlink/msg.h>
+#include <netlink/netlink.h>
+#include <netlink/socket.h>
+
+#include "cksuite-all.h"
+
+#define TEST_MSG_TYPE (NLMSG_MIN_TYPE + 1)
+#define MAX_REQS 16
+
+struct log {
+	int			n;
+	uint32_t		seq[MAX_REQS];
+	int			err[MAX_REQS];
+	unsigned int		pending[MAX_REQS];
+	struct nl_sock *	sk;
+	int			resend_err[3];
+};
+
+static void record_done(struct nl_msg *msg, int err, void *arg)
+{
+	struct log *l = arg;
+
+	ck_assert_int_lt(l->n, MAX_REQS);
+	l->seq[l->n] = nlmsg_hdr(msg)->nlmsg_seq;
+	l->err[l->n] = err;
+	l->pending[l->n] = nl_socket_get_async_pending(l->sk);
+	l->n++;
+}
+
+static struct nl_msg *build_req(int type)
+{
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc_simple(type, NLM_F_REQUEST);
+	ck_assert_ptr_nonnull(msg);
+
+	return msg;
+}
+
+/* Sends a request, returns its sequence number or a negative error */
+static int64_t send_req(struct nl_sock *sk, int type, nl_async_cb_t cb,
+			struct log *l)
+{
+	struct nl_msg *msg = build_req(type);
+	int64_t seq;
+	int err;
+
+	err = nl_send_async(sk, msg, cb, l);
+	seq = nlmsg_hdr(msg)->nlmsg_seq;
+	nlmsg_free(msg);
+
+	return err < 0 ? err : seq;
+}
+
+START_TEST(async_kernel)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	struct log l = {
+		.sk = sk,
+	};
+	uint32_t seq[10];
+	int i;
+
+	/* The window fills up and drains while sending */
+	ck_assert_int_eq(nl_socket_set_async_window(sk, 4), 0);
+	for (i = 0; i < 10; i++) {
+		int64_t r = send_req(sk, NLMSG_NOOP, record_done, &l);
+
+		ck_assert_int_ge(r, 0);
+		seq[i] = r;
+		ck_assert_uint_le(nl_socket_get_async_pending(sk), 4);
+	}
+	ck_assert_int_eq(nl_async_wait(sk), 0);
+	ck_assert_uint_eq(nl_socket_get_async_pending(sk), 0);
+
+	ck_assert_int_eq(l.n, 10);
+	for (i = 0; i < 10; i++) {
+		ck_assert_uint_eq(l.seq[i], seq[i]);
+		ck_assert_int_eq(l.err[i], 0);
+	}
+}
+END_TEST
+
+struct peers {
+	struct nl_sock *	client;
+	struct nl_sock *	server;
+};
+
+/* Requests sent on client are answered by hand on server */
+static void peers_init(struct peers *p)
+{
+	p->server = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->server);
+	ck_assert_int_eq(nl_connect(p->server, NETLINK_USERSOCK), 0);
+
+	p->client = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->client);
+	ck_assert_int_eq(nl_connect(p->client, NETLINK_USERSOCK), 0);
+	ck_assert_int_eq(nl_socket_set_nonblocking(p->client), 0);
+
+	nl_socket_set_peer_port(p->client, nl_socket_get_local_port(p->server));
+	nl_socket_set_peer_port(p->server, nl_socket_get_local_port(p->client));
+}
+
+static void peers_free(struct peers *p)
+{
+	nl_socket_free(p->client);
+	nl_socket_free(p->server);
+}
+
+static void send_ack(struct peers *p, uint32_t seq, int error, int flags)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct nlmsgerr e;
+	} ack = {
+		.nlh = {
+			.nlmsg_len = sizeof(ack),
+			.nlmsg_type = NLMSG_ERROR,
+			.nlmsg_flags = flags,
+			.nlmsg_seq = seq,
+		},
+		.e = {
+			.error = error,
+			.msg = {
+				.nlmsg_len = NLMSG_HDRLEN,
+				.nlmsg_type = TEST_MSG_TYPE,
+				.nlmsg_seq = seq,
+			},
+		},
+	};
+
+	ck_assert_int_eq(nl_sendto(p->server, &ack, sizeof(ack)), sizeof(ack));
+}
+
+static void send_reqs(struct peers *p, struct log *l, uint32_t *seq, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		int64_t r = send_req(p->client, TEST_MSG_TYPE, record_done, l);
+
+		ck_assert_int_ge(r, 0);
+		seq[i] = r;
+	}
+}
+
+START_TEST(async_out_of_order)
+{
+	struct log l = { 0 };
+	uint32_t seq[3];
+	struct peers p;
+	int i;
+
+	peers_init(&p);
+	l.sk = p.client;
+	send_reqs(&p, &l, seq, 3);
+	ck_assert_uint_eq(nl_socket_get_async_pending(p.client), 3);
+
+	/* Replies overtaking older requests are held back */
+	send_ack(&p, seq[2], 0, 0);
+	send_ack(&p, seq[1], 0, 0);
+	ck_assert_int_eq(nl_async_process(p.client), 0);
+	ck_assert_int_eq(nl_async_process(p.client), 0);
+	ck_assert_int_eq(l.n, 0);
+	ck_assert_uint_eq(nl_socket_get_async_pending(p.client), 3);
+
+	/* and complete in request order, each with its slot released */
+	send_ack(&p, seq[0], 0, 0);
+	ck_assert_int_eq(nl_async_process(p.client), 0);
+	ck_assert_int_eq(l.n, 3);
+	for (i = 0; i < 3; i++) {
+		ck_assert_uint_eq(l.seq[i], seq[i]);
+		ck_assert_int_eq(l.err[i], 0);
+		ck_assert_uint_eq(l.pending[i], 2 - i);
+	}
+	ck_assert_int_eq(nl_async_wait(p.client), 0);
+
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(async_errors)
+{
+	struct log l = { 0 };
+	uint32_t seq[4];
+	struct peers p;
+
+	peers_init(&p);
+	l.sk = p.client;
+	send_reqs(&p, &l, seq, 4);
+
+	/* The first failed request is reported, not the first failure */
+	send_ack(&p, seq[2], -EPERM, 0);
+	send_ack(&p, seq[0], 0, 0);
+	send_ack(&p, seq[1], -EINVAL, 0);
+	send_ack(&p, seq[3], 0, 0);
+	ck_assert_int_eq(nl_async_wait(p.client), -NLE_INVAL);
+	ck_assert_int_eq(nl_async_wait(p.client), 0);
+
+	ck_assert_int_eq(l.n, 4);
+	ck_assert_int_eq(l.err[0], 0);
+	ck_assert_int_eq(l.err[1], -NLE_INVAL);
+	ck_assert_int_eq(l.err[2], -NLE_PERM);
+	ck_assert_int_eq(l.err[3], 0);
+
+	peers_free(&p);
+}
+END_TEST
+
+static void resend_done(struct nl_msg *msg, int err, void *arg)
+{
+	struct log *l = arg;
+	int i;
+
+	record_done(msg, err, arg);
+
+	/* Only the released slot is available */
+	for (i = 0; i < 2; i++) {
+		int64_t r = send_req(l->sk, TEST_MSG_TYPE, record_done, l);
+
+		l->resend_err[i] = r < 0 ? r : 0;
+	}
+	l->resend_err[2] = nl_async_process(l->sk);
+}
+
+START_TEST(async_full_window)
+{
+	struct log l = { 0 };
+	uint32_t seq[2];
+	struct peers p;
+
+	peers_init(&p);
+	l.sk = p.client;
+	ck_assert_int_eq(nl_socket_set_async_window(p.client, 2), 0);
+	send_reqs(&p, &l, seq, 2);
+
+	/* Nothing to complete on a non-blocking socket */
+	ck_assert_int_eq(send_req(p.client, TEST_MSG_TYPE, record_done, &l),
+			 -NLE_AGAIN);
+	send_ack(&p, seq[1], 0, 0);
+	ck_assert_int_eq(send_req(p.client, TEST_MSG_TYPE, record_done, &l),
+			 -NLE_AGAIN);
+	ck_assert_uint_eq(nl_socket_get_async_pending(p.client), 2);
+	ck_assert_int_eq(l.n, 0);
+
+	/* Running dry after a slot has been released still sends */
+	send_ack(&p, seq[0], 0, NLM_F_MULTI);
+	ck_assert_int_ge(send_req(p.client, TEST_MSG_TYPE, record_done, &l), 0);
+	ck_assert_int_eq(l.n, 2);
+	ck_assert_uint_eq(nl_socket_get_async_pending(p.client), 1);
+
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(async_nested)
+{
+	struct log l = { 0 };
+	uint32_t seq[1];
+	struct peers p;
+	int64_t first;
+
+	peers_init(&p);
+	l.sk = p.client;
+	ck_assert_int_eq(nl_socket_set_async_window(p.client, 2), 0);
+	first = send_req(p.client, TEST_MSG_TYPE, resend_done, &l);
+	ck_assert_int_ge(first, 0);
+	send_reqs(&p, &l, seq, 1);
+
+	/* Callbacks may send into free slots but not receive */
+	send_ack(&p, first, 0, 0);
+	ck_assert_int_eq(nl_async_process(p.client), 0);
+	ck_assert_int_eq(l.n, 1);
+	ck_assert_uint_eq(l.pending[0], 1);
+	ck_assert_int_eq(l.resend_err[0], 0);
+	ck_assert_int_eq(l.resend_err[1], -NLE_BUSY);
+	ck_assert_int_eq(l.resend_err[2], -NLE_BUSY);
+	ck_assert_uint_eq(nl_socket_get_async_pending(p.client), 2);
+
+	peers_free(&p);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_async_suite(void)
+{
+	Suite *suite = suite_create("Asynchronous requests");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_test(tc, async_kernel);
+	tcase_add_test(tc, async_out_of_order);
+	tcase_add_test(tc, async_errors);
+	tcase_add_test(tc, async_full_window);
+	tcase_add_test(tc, async_nested);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
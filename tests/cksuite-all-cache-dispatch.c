@@ -0,0 +1,300 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/cache-api.h"
+#include "nl-priv-dynamic-core/object-api.h"
+
+#define TEST_MSG_TYPE 0x7ff0
+#define MAX_OPS 256
+
+struct ops_list {
+	int			n;
+	struct nl_cache_ops *	ops[MAX_OPS];
+};
+
+static void collect_ops(struct nl_cache_ops *ops, void *arg)
+{
+	struct ops_list *l = arg;
+
+	ck_assert_int_lt(l->n, MAX_OPS);
+	l->ops[l->n++] = ops;
+}
+
+/* The list walk done before the lookups were indexed */
+static struct nl_cache_ops *associate_by_list(struct ops_list *l,
+					      int protocol, int msgtype)
+{
+	int i, n;
+
+	for (i = 0; i < l->n; i++) {
+		struct nl_cache_ops *ops = l->ops[i];
+
+		if (ops->co_protocol != protocol)
+			continue;
+
+		for (n = 0; ops->co_msgtypes[n].mt_id >= 0; n++)
+			if (ops->co_msgtypes[n].mt_id == msgtype)
+				return ops;
+	}
+
+	return NULL;
+}
+
+static void assert_registry(void)
+{
+	struct ops_list l = { 0 };
+	int i, n;
+
+	nl_cache_ops_foreach(collect_ops, &l);
+	ck_assert_int_gt(l.n, 0);
+
+	for (i = 0; i < l.n; i++) {
+		struct nl_cache_ops *ops = l.ops[i];
+
+		ck_assert_ptr_eq(nl_cache_ops_lookup(ops->co_name), ops);
+
+		for (n = 0; ops->co_msgtypes[n].mt_id >= 0; n++) {
+			int type = ops->co_msgtypes[n].mt_id;
+			struct nl_cache_ops *found;
+
+			found = nl_cache_ops_associate(ops->co_protocol, type);
+			ck_assert_ptr_eq(found, associate_by_list(
+							&l, ops->co_protocol,
+							type));
+			ck_assert_ptr_nonnull(nl_msgtype_lookup(found, type));
+		}
+	}
+
+	ck_assert_ptr_eq(nl_cache_ops_associate(NETLINK_ROUTE, TEST_MSG_TYPE),
+			 associate_by_list(&l, NETLINK_ROUTE, TEST_MSG_TYPE));
+}
+
+static struct nl_object_ops test_obj_ops = {
+	.oo_name	= "test/dispatch",
+	.oo_size	= sizeof(struct nl_object),
+};
+
+static struct nl_cache_ops test_ops = {
+	.co_name	= "test/dispatch",
+	.co_protocol	= NETLINK_ROUTE,
+	.co_msgtypes	= {
+		{ TEST_MSG_TYPE, NL_ACT_NEW, "new" },
+		{ RTM_NEWLINK, NL_ACT_NEW, "newlink" },
+		END_OF_MSGTYPES_LIST,
+	},
+	.co_obj_ops	= &test_obj_ops,
+};
+
+START_TEST(cache_dispatch_registry)
+{
+	struct nl_cache_ops *link_ops = nl_cache_ops_lookup("route/link");
+
+	ck_assert_ptr_nonnull(link_ops);
+	assert_registry();
+
+	/* Unknown names and types */
+	ck_assert_ptr_null(nl_cache_ops_lookup("test/none"));
+	ck_assert_ptr_null(nl_cache_ops_associate(NETLINK_ROUTE, TEST_MSG_TYPE));
+	ck_assert_ptr_null(nl_cache_ops_associate(NETLINK_ROUTE, -1));
+	ck_assert_ptr_null(nl_cache_ops_associate(NETLINK_ROUTE, 0x10000));
+	ck_assert_ptr_null(nl_cache_ops_associate(NETLINK_USERSOCK,
+						  RTM_NEWLINK));
+
+	/* Registering indexes the new operations, which take precedence
+	 * like they did in the list */
+	ck_assert_int_eq(nl_cache_mngt_register(&test_ops), 0);
+	ck_assert_int_eq(nl_cache_mngt_register(&test_ops), -NLE_EXIST);
+	assert_registry();
+	ck_assert_ptr_eq(nl_cache_ops_lookup("test/dispatch"), &test_ops);
+	ck_assert_ptr_eq(nl_cache_ops_associate(NETLINK_ROUTE, TEST_MSG_TYPE),
+			 &test_ops);
+	ck_assert_ptr_eq(nl_cache_ops_associate(NETLINK_ROUTE, RTM_NEWLINK),
+			 &test_ops);
+
+	ck_assert_int_eq(nl_cache_mngt_unregister(&test_ops), 0);
+	assert_registry();
+	ck_assert_ptr_null(nl_cache_ops_lookup("test/dispatch"));
+	ck_assert_ptr_null(nl_cache_ops_associate(NETLINK_ROUTE, TEST_MSG_TYPE));
+	ck_assert_ptr_eq(nl_cache_ops_associate(NETLINK_ROUTE, RTM_NEWLINK),
+			 link_ops);
+}
+END_TEST
+
+#define MAX_CHANGES 8
+
+struct changes {
+	int			n;
+	struct nl_cache *	cache[MAX_CHANGES];
+	int			action[MAX_CHANGES];
+};
+
+static void record_change(struct nl_cache *cache, struct nl_object *obj,
+			  int action, void *data)
+{
+	struct changes *c = data;
+
+	ck_assert_int_lt(c->n, MAX_CHANGES);
+	c->cache[c->n] = cache;
+	c->action[c->n] = action;
+	c->n++;
+}
+
+static struct nl_msg *build_link_msg(int ifindex, const char *name)
+{
+	struct ifinfomsg ifi = {
+		.ifi_family = AF_UNSPEC,
+		.ifi_index = ifindex,
+	};
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc_simple(RTM_NEWLINK, 0);
+	ck_assert_ptr_nonnull(msg);
+	ck_assert_int_eq(nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO),
+			 0);
+	ck_assert_int_eq(nla_put_string(msg, IFLA_IFNAME, name), 0);
+
+	return msg;
+}
+
+static struct nl_msg *build_addr_msg(int ifindex)
+{
+	struct ifaddrmsg ifa = {
+		.ifa_family = AF_INET,
+		.ifa_prefixlen = 32,
+		.ifa_index = ifindex,
+	};
+	uint32_t addr = htonl(0xc0000201);
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc_simple(RTM_NEWADDR, 0);
+	ck_assert_ptr_nonnull(msg);
+	ck_assert_int_eq(nlmsg_append(msg, &ifa, sizeof(ifa), NLMSG_ALIGNTO),
+			 0);
+	ck_assert_int_eq(nla_put(msg, IFA_LOCAL, sizeof(addr), &addr), 0);
+	ck_assert_int_eq(nla_put(msg, IFA_ADDRESS, sizeof(addr), &addr), 0);
+
+	return msg;
+}
+
+static struct nl_msg *build_empty_msg(int type)
+{
+	struct rtgenmsg gen = {
+		.rtgen_family = AF_INET,
+	};
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc_simple(type, 0);
+	ck_assert_ptr_nonnull(msg);
+	ck_assert_int_eq(nlmsg_append(msg, &gen, sizeof(gen), NLMSG_ALIGNTO),
+			 0);
+
+	return msg;
+}
+
+/* First cache of the manager whose operations handle the type */
+static struct nl_cache *cache_by_list(struct nl_cache **caches, int n,
+				      int type)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (nl_msgtype_lookup(caches[i]->c_ops, type))
+			return caches[i];
+
+	return NULL;
+}
+
+START_TEST(cache_dispatch_mngr)
+{
+	struct changes c = { 0 };
+	struct nl_cache *caches[2];
+	struct nl_cache_mngr *mngr;
+	struct nl_sock *evsk, *tx;
+	struct {
+		int type;
+		struct nl_msg *msg;
+	} events[] = {
+		{ RTM_NEWLINK, build_link_msg(999, "fake0") },
+		{ RTM_NEWADDR, build_addr_msg(999) },
+		{ RTM_NEWRULE, build_empty_msg(RTM_NEWRULE) },
+		{ RTM_NEWROUTE, build_empty_msg(RTM_NEWROUTE) },
+	};
+	size_t i;
+
+	evsk = nl_socket_alloc();
+	ck_assert_ptr_nonnull(evsk);
+	ck_assert_int_eq(nl_cache_mngr_alloc(evsk, NETLINK_ROUTE, 0, &mngr), 0);
+	ck_assert_int_eq(nl_cache_mngr_add(mngr, "route/link", record_change,
+					   &c, &caches[0]),
+			 0);
+	ck_assert_int_eq(nl_cache_mngr_add(mngr, "route/addr", record_change,
+					   &c, &caches[1]),
+			 0);
+
+	/* Events sent by hand instead of by the kernel */
+	tx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(tx);
+	ck_assert_int_eq(nl_connect(tx, NETLINK_ROUTE), 0);
+	nl_socket_disable_auto_ack(tx);
+	nl_socket_set_peer_port(tx, nl_socket_get_local_port(evsk));
+
+	/* Every type goes to the first cache handling it, unknown types are
+	 * skipped */
+	for (i = 0; i < _NL_N_ELEMENTS(events); i++) {
+		struct nl_cache *expected;
+
+		expected = cache_by_list(caches, 2, events[i].type);
+		c.n = 0;
+
+		ck_assert_int_ge(nl_send_auto(tx, events[i].msg), 0);
+		nlmsg_free(events[i].msg);
+		ck_assert_int_ge(nl_cache_mngr_data_ready(mngr), 0);
+
+		if (!expected) {
+			ck_assert_int_eq(c.n, 0);
+			continue;
+		}
+
+		ck_assert_int_eq(c.n, 1);
+		ck_assert_ptr_eq(c.cache[0], expected);
+		ck_assert_int_eq(c.action[0], NL_ACT_NEW);
+	}
+
+	ck_assert_ptr_eq(cache_by_list(caches, 2, RTM_NEWLINK), caches[0]);
+	ck_assert_ptr_eq(cache_by_list(caches, 2, RTM_NEWADDR), caches[1]);
+
+	nl_socket_free(tx);
+	nl_cache_mngr_free(mngr);
+	nl_socket_free(evsk);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_dispatch_suite(void)
+{
+	Suite *suite = suite_create("Cache dispatch");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, cache_dispatch_registry);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("Manager");
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_test(tc, cache_dispatch_mngr);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/rtnetlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/object.h>
+#include <netlink/route/addr.h>
+#include <netlink/route/link.h>
+#include <netlink/route/neighbour.h>
+#include <netlink/route/route.h>
+
+#include "cksuite-all.h"
+#include "nl-aux-route/nl-route.h"
+#include "nl-priv-dynamic-core/object-api.h"
+
+static void add_blackhole(struct nl_sock *sk, const char *dst, int table)
+{
+	_nl_auto_rtnl_route struct rtnl_route *route = rtnl_route_alloc();
+	_nl_auto_nl_addr struct nl_addr *addr = NULL;
+
+	ck_assert_int_eq(nl_addr_parse(dst, AF_INET, &addr), 0);
+	rtnl_route_set_family(route, AF_INET);
+	rtnl_route_set_table(route, table);
+	rtnl_route_set_type(route, RTN_BLACKHOLE);
+	ck_assert_int_eq(rtnl_route_set_dst(route, addr), 0);
+
+	ck_assert_int_eq(rtnl_route_add(sk, route, NLM_F_CREATE), 0);
+}
+
+static void add_addr(struct nl_sock *sk, int ifindex, const char *local)
+{
+	struct rtnl_addr *addr = rtnl_addr_alloc();
+	_nl_auto_nl_addr struct nl_addr *a = NULL;
+
+	ck_assert_int_eq(nl_addr_parse(local, AF_INET, &a), 0);
+	rtnl_addr_set_ifindex(addr, ifindex);
+	ck_assert_int_eq(rtnl_addr_set_local(addr, a), 0);
+
+	ck_assert_int_eq(rtnl_addr_add(sk, addr, 0), 0);
+	rtnl_addr_put(addr);
+}
+
+static void add_neigh(struct nl_sock *sk, int ifindex, const char *dst)
+{
+	struct rtnl_neigh *neigh = rtnl_neigh_alloc();
+	_nl_auto_nl_addr struct nl_addr *a = NULL;
+	_nl_auto_nl_addr struct nl_addr *ll = NULL;
+
+	ck_assert_int_eq(nl_addr_parse(dst, AF_INET, &a), 0);
+	ck_assert_int_eq(nl_addr_parse("02:00:00:00:00:01", AF_LLC, &ll), 0);
+	rtnl_neigh_set_ifindex(neigh, ifindex);
+	ck_assert_int_eq(rtnl_neigh_set_dst(neigh, a), 0);
+	rtnl_neigh_set_lladdr(neigh, ll);
+	rtnl_neigh_set_state(neigh, NUD_PERMANENT);
+
+	ck_assert_int_eq(rtnl_neigh_add(sk, neigh, NLM_F_CREATE), 0);
+	rtnl_neigh_put(neigh);
+}
+
+START_TEST(cache_dump_filter_route)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_rtnl_route struct rtnl_route *filter = rtnl_route_alloc();
+	_nl_auto_nl_cache struct nl_cache *cache = NULL;
+	struct rtnl_route *route;
+
+	add_blackhole(sk, "10.1.0.0/16", 100);
+	add_blackhole(sk, "10.2.0.0/16", 200);
+	add_blackhole(sk, "10.3.0.0/16", RT_TABLE_MAIN);
+
+	ck_assert_int_eq(rtnl_route_alloc_cache(sk, AF_INET, 0, &cache), 0);
+	ck_assert_int_ge(nl_cache_nitems(cache), 3);
+
+	rtnl_route_set_table(filter, 100);
+	ck_assert_int_eq(nl_cache_set_dump_filter(cache, OBJ_CAST(filter)),
+			 0);
+	ck_assert_int_eq(nl_cache_refill(sk, cache), 0);
+
+	ck_assert_int_eq(nl_cache_nitems(cache), 1);
+	route = (struct rtnl_route *) nl_cache_get_first(cache);
+	ck_assert_int_eq(rtnl_route_get_table(route), 100);
+	ck_assert_int_eq(rtnl_route_get_type(route), RTN_BLACKHOLE);
+
+	/* The strict request does not affect the next unfiltered dump */
+	ck_assert_int_eq(nl_cache_set_dump_filter(cache, NULL), 0);
+	ck_assert_int_eq(nl_cache_refill(sk, cache), 0);
+	ck_assert_int_ge(nl_cache_nitems(cache), 3);
+}
+END_TEST
+
+START_TEST(cache_dump_filter_link)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_rtnl_link struct rtnl_link *filter = rtnl_link_alloc();
+	_nl_auto_nl_cache struct nl_cache *cache = NULL;
+	struct rtnl_link *link;
+	int br, v0;
+
+	_nltst_add_link(sk, "br0", "bridge", &br);
+	_nltst_add_link(sk, "v0", "veth", &v0);
+	ck_assert_int_eq(rtnl_link_enslave_ifindex(sk, br, v0), 0);
+
+	ck_assert_int_eq(rtnl_link_alloc_cache(sk, AF_UNSPEC, &cache), 0);
+	ck_assert_int_ge(nl_cache_nitems(cache), 4);
+
+	rtnl_link_set_master(filter, br);
+	ck_assert_int_eq(nl_cache_set_dump_filter(cache, OBJ_CAST(filter)),
+			 0);
+	ck_assert_int_eq(nl_cache_refill(sk, cache), 0);
+
+	ck_assert_int_eq(nl_cache_nitems(cache), 1);
+	link = (struct rtnl_link *) nl_cache_get_first(cache);
+	ck_assert_int_eq(rtnl_link_get_ifindex(link), v0);
+
+	rtnl_link_put(filter);
+	filter = rtnl_link_alloc();
+	ck_assert_int_eq(rtnl_link_set_type(filter, "bridge"), 0);
+	ck_assert_int_eq(nl_cache_set_dump_filter(cache, OBJ_CAST(filter)),
+			 0);
+	ck_assert_int_eq(nl_cache_refill(sk, cache), 0);
+
+	ck_assert_int_eq(nl_cache_nitems(cache), 1);
+	link = (struct rtnl_link *) nl_cache_get_first(cache);
+	ck_assert_int_eq(rtnl_link_get_ifindex(link), br);
+}
+END_TEST
+
+START_TEST(cache_dump_filter_addr)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	struct rtnl_addr *filter = rtnl_addr_alloc();
+	_nl_auto_nl_cache struct nl_cache *cache = NULL;
+	struct rtnl_addr *addr;
+	int v0, v1;
+
+	_nltst_add_link(sk, "v0", "veth", &v0);
+	_nltst_add_link(sk, "v1", "veth", &v1);
+	add_addr(sk, v0, "192.0.2.1/24");
+	add_addr(sk, v1, "198.51.100.1/24");
+
+	ck_assert_int_eq(rtnl_addr_alloc_cache(sk, &cache), 0);
+	ck_assert_int_ge(nl_cache_nitems(cache), 2);
+
+	rtnl_addr_set_family(filter, AF_INET);
+	rtnl_addr_set_ifindex(filter, v0);
+	ck_assert_int_eq(nl_cache_set_dump_filter(cache, OBJ_CAST(filter)),
+			 0);
+	ck_assert_int_eq(nl_cache_refill(sk, cache), 0);
+
+	ck_assert_int_eq(nl_cache_nitems(cache), 1);
+	addr = (struct rtnl_addr *) nl_cache_get_first(cache);
+	ck_assert_int_eq(rtnl_addr_get_ifindex(addr), v0);
+	ck_assert_int_eq(rtnl_addr_get_prefixlen(addr), 24);
+
+	rtnl_addr_put(filter);
+}
+END_TEST
+
+START_TEST(cache_dump_filter_neigh)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	struct rtnl_neigh *filter = rtnl_neigh_alloc();
+	_nl_auto_nl_cache struct nl_cache *cache = NULL;
+	struct rtnl_neigh *neigh;
+	int v0, v1;
+
+	_nltst_add_link(sk, "v0", "veth", &v0);
+	_nltst_add_link(sk, "v1", "veth", &v1);
+	add_neigh(sk, v0, "192.0.2.2");
+	add_neigh(sk, v1, "198.51.100.2");
+
+	ck_assert_int_eq(rtnl_neigh_alloc_cache(sk, &cache), 0);
+	ck_assert_int_ge(nl_cache_nitems(cache), 2);
+
+	rtnl_neigh_set_ifindex(filter, v1);
+	ck_assert_int_eq(nl_cache_set_dump_filter(cache, OBJ_CAST(filter)),
+			 0);
+	ck_assert_int_eq(nl_cache_refill(sk, cache), 0);
+
+	ck_assert_int_eq(nl_cache_nitems(cache), 1);
+	neigh = (struct rtnl_neigh *) nl_cache_get_first(cache);
+	ck_assert_int_eq(rtnl_neigh_get_ifindex(neigh), v1);
+	ck_assert_int_eq(rtnl_neigh_get_state(neigh), NUD_PERMANENT);
+
+	rtnl_neigh_put(filter);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_dump_filter_suite(void)
+{
+	Suite *suite = suite_create("Cache dump filters");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_test(tc, cache_dump_filter_route);
+	tcase_add_test(tc, cache_dump_filter_link);
+	tcase_add_test(tc, cache_dump_filter_addr);
+	tcase_add_test(tc, cache_dump_filter_neigh);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
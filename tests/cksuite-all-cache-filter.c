@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/route/netconf.h>
+
+#include "cksuite-all.h"
+
+struct changes {
+	int			nnew;
+	int			nchange;
+	int			ndel;
+};
+
+static void count_changes(struct nl_cache *cache, struct nl_object *obj,
+			  int action, void *data)
+{
+	struct changes *c = data;
+
+	if (action == NL_ACT_NEW)
+		c->nnew++;
+	else if (action == NL_ACT_CHANGE)
+		c->nchange++;
+	else if (action == NL_ACT_DEL)
+		c->ndel++;
+}
+
+static void write_sysctl(const char *path, const char *value)
+{
+	FILE *f;
+
+	f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	ck_assert_int_ge(fputs(value, f), 0);
+	ck_assert_int_eq(fclose(f), 0);
+}
+
+/* IPv4 interfaces with forwarding enabled */
+static int forwarding_filter(struct nl_object *obj, void *arg)
+{
+	struct rtnl_netconf *nc = (struct rtnl_netconf *) obj;
+	int family, ifindex, fwd;
+
+	return rtnl_netconf_get_family(nc, &family) == 0 &&
+	       family == AF_INET &&
+	       rtnl_netconf_get_ifindex(nc, &ifindex) == 0 && ifindex > 0 &&
+	       rtnl_netconf_get_forwarding(nc, &fwd) == 0 && fwd;
+}
+
+static struct nl_cache_mngr *filtered_mngr(struct nl_cache **cache,
+					   struct changes *c)
+{
+	struct nl_cache_mngr *mngr;
+
+	ck_assert_int_eq(nl_cache_mngr_alloc(NULL, NETLINK_ROUTE, 0, &mngr),
+			 0);
+	ck_assert_int_eq(nl_cache_alloc_name("route/netconf", cache), 0);
+	nl_cache_set_filter_func(*cache, forwarding_filter, NULL);
+	ck_assert_int_eq(nl_cache_mngr_add_cache(mngr, *cache, count_changes,
+						 c),
+			 0);
+
+	return mngr;
+}
+
+START_TEST(cache_filter_partial_event)
+{
+	struct changes c = { 0 };
+	struct rtnl_netconf *nc;
+	struct nl_cache_mngr *mngr;
+	struct nl_cache *cache;
+	int val;
+
+	write_sysctl("/proc/sys/net/ipv4/conf/lo/forwarding", "1");
+
+	mngr = filtered_mngr(&cache, &c);
+	ck_assert_int_eq(nl_cache_nitems(cache), 1);
+
+	/* The notification only carries rp_filter, the object merged with
+	 * it still matches */
+	write_sysctl("/proc/sys/net/ipv4/conf/lo/rp_filter", "2");
+	ck_assert_int_gt(nl_cache_mngr_data_ready(mngr), 0);
+	ck_assert_int_eq(c.nchange, 1);
+	ck_assert_int_eq(c.nnew + c.ndel, 0);
+
+	nc = rtnl_netconf_get_by_idx(cache, AF_INET, 1);
+	ck_assert_ptr_nonnull(nc);
+	ck_assert_int_eq(rtnl_netconf_get_rp_filter(nc, &val), 0);
+	ck_assert_int_eq(val, 2);
+	ck_assert_int_eq(rtnl_netconf_get_forwarding(nc, &val), 0);
+	ck_assert_int_eq(val, 1);
+	rtnl_netconf_put(nc);
+
+	/* No longer matching once merged, the object is removed */
+	memset(&c, 0, sizeof(c));
+	write_sysctl("/proc/sys/net/ipv4/conf/lo/forwarding", "0");
+	ck_assert_int_gt(nl_cache_mngr_data_ready(mngr), 0);
+	ck_assert_int_eq(c.ndel, 1);
+	ck_assert_int_eq(c.nnew + c.nchange, 0);
+	ck_assert_int_eq(nl_cache_nitems(cache), 0);
+
+	nl_cache_mngr_free(mngr);
+}
+END_TEST
+
+START_TEST(cache_filter_full_event)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	struct changes c = { 0 };
+	struct rtnl_netconf *nc;
+	struct nl_cache_mngr *mngr;
+	struct nl_cache *cache;
+	int ifindex, val;
+
+	mngr = filtered_mngr(&cache, &c);
+	ck_assert_int_eq(nl_cache_nitems(cache), 0);
+
+	/* New interfaces announce their full configuration */
+	write_sysctl("/proc/sys/net/ipv4/conf/default/forwarding", "1");
+	_nltst_add_link(sk, "v0", "veth", &ifindex);
+	ck_assert_int_gt(nl_cache_mngr_data_ready(mngr), 0);
+	ck_assert_int_eq(c.nnew, 2);
+	ck_assert_int_eq(c.nchange + c.ndel, 0);
+
+	nc = rtnl_netconf_get_by_idx(cache, AF_INET, ifindex);
+	ck_assert_ptr_nonnull(nc);
+	ck_assert_int_eq(rtnl_netconf_get_rp_filter(nc, &val), 0);
+	rtnl_netconf_put(nc);
+
+	memset(&c, 0, sizeof(c));
+	write_sysctl("/proc/sys/net/ipv4/conf/default/forwarding", "0");
+	_nltst_add_link(sk, "v1", "veth", NULL);
+	ck_assert_int_gt(nl_cache_mngr_data_ready(mngr), 0);
+	ck_assert_int_eq(c.nnew + c.nchange + c.ndel, 0);
+	ck_assert_int_eq(nl_cache_nitems(cache), 2);
+
+	nl_cache_mngr_free(mngr);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_filter_suite(void)
+{
+	Suite *suite = suite_create("Cache filters");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_test(tc, cache_filter_partial_event);
+	tcase_add_test(tc, cache_filter_full_event);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
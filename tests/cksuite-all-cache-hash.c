@@ -0,0 +1,439 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <netlink/cache.h>
+#include <netlink/object.h>
+#include <netlink/hashtable.h>
+#include <netlink/route/addr.h>
+#include <netlink/netfilter/ct.h>
+#include <netlink/netfilter/exp.h>
+#include <netlink/xfrm/ae.h>
+#include <netlink/xfrm/sa.h>
+#include <netlink/xfrm/sp.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/object-api.h"
+
+/* Enough objects to make the hashtable grow a few times */
+#define N_OBJS 2000
+
+typedef struct nl_object *(*build_obj_fn)(int i);
+
+static struct nl_addr *build_addr(int family, int i)
+{
+	struct nl_addr *addr;
+	char buf[64];
+
+	if (family == AF_INET)
+		snprintf(buf, sizeof(buf), "10.%d.%d.1", (i >> 8) & 0xff,
+			 i & 0xff);
+	else
+		snprintf(buf, sizeof(buf), "2001:db8::%x:1", i);
+
+	ck_assert_int_eq(nl_addr_parse(buf, family, &addr), 0);
+
+	return addr;
+}
+
+static void check_cache_search(const char *name, build_obj_fn build)
+{
+	struct nl_cache *cache;
+	struct nl_object *obj, *needle, *found;
+	int i;
+
+	ck_assert_int_eq(nl_cache_alloc_name(name, &cache), 0);
+
+	for (i = 0; i < N_OBJS; i++) {
+		obj = build(i);
+		ck_assert_int_eq(nl_cache_add(cache, obj), 0);
+		nl_object_put(obj);
+	}
+
+	ck_assert_int_eq(nl_cache_nitems(cache), N_OBJS);
+
+	for (i = 0; i < N_OBJS; i++) {
+		needle = build(i);
+		found = nl_cache_search(cache, needle);
+		ck_assert_msg(found, "%s: object %d not found", name, i);
+		ck_assert(found != needle);
+		ck_assert(nl_object_identical(found, needle));
+		nl_object_put(found);
+		nl_object_put(needle);
+	}
+
+	needle = build(N_OBJS);
+	ck_assert_ptr_null(nl_cache_search(cache, needle));
+	nl_object_put(needle);
+
+	nl_cache_free(cache);
+}
+
+static struct nl_object *build_route_addr(int i)
+{
+	struct rtnl_addr *addr = rtnl_addr_alloc();
+	struct nl_addr *local = build_addr(i % 2 ? AF_INET6 : AF_INET, i);
+
+	rtnl_addr_set_ifindex(addr, 1 + i % 7);
+	ck_assert_int_eq(rtnl_addr_set_local(addr, local), 0);
+	nl_addr_put(local);
+
+	return (struct nl_object *) addr;
+}
+
+static struct nl_object *build_ct(int i)
+{
+	struct nfnl_ct *ct = nfnl_ct_alloc();
+	struct nl_addr *src = build_addr(AF_INET, i);
+	struct nl_addr *dst = build_addr(AF_INET, i + 1);
+
+	nfnl_ct_set_family(ct, AF_INET);
+	nfnl_ct_set_proto(ct, IPPROTO_TCP);
+	ck_assert_int_eq(nfnl_ct_set_src(ct, 0, src), 0);
+	ck_assert_int_eq(nfnl_ct_set_dst(ct, 0, dst), 0);
+	nfnl_ct_set_src_port(ct, 0, 1024 + i);
+	nfnl_ct_set_dst_port(ct, 0, 80);
+	nl_addr_put(src);
+	nl_addr_put(dst);
+
+	return (struct nl_object *) ct;
+}
+
+static struct nl_object *build_exp(int i)
+{
+	struct nfnl_exp *exp = nfnl_exp_alloc();
+	struct nl_addr *src = build_addr(AF_INET6, i);
+	struct nl_addr *dst = build_addr(AF_INET6, i + 1);
+
+	nfnl_exp_set_family(exp, AF_INET6);
+	nfnl_exp_set_zone(exp, i % 3);
+	ck_assert_int_eq(nfnl_exp_set_src(exp, NFNL_EXP_TUPLE_EXPECT, src), 0);
+	ck_assert_int_eq(nfnl_exp_set_dst(exp, NFNL_EXP_TUPLE_EXPECT, dst), 0);
+	nfnl_exp_set_l4protonum(exp, NFNL_EXP_TUPLE_EXPECT, IPPROTO_UDP);
+	nfnl_exp_set_ports(exp, NFNL_EXP_TUPLE_EXPECT, 5060, 2000 + i);
+	nl_addr_put(src);
+	nl_addr_put(dst);
+
+	return (struct nl_object *) exp;
+}
+
+static struct nl_object *build_xfrm_sa(int i)
+{
+	struct xfrmnl_sa *sa = xfrmnl_sa_alloc();
+	struct nl_addr *daddr = build_addr(AF_INET, i / 4);
+
+	ck_assert_int_eq(xfrmnl_sa_set_daddr(sa, daddr), 0);
+	ck_assert_int_eq(xfrmnl_sa_set_spi(sa, 0x1000 + i), 0);
+	ck_assert_int_eq(xfrmnl_sa_set_proto(sa, IPPROTO_ESP), 0);
+	nl_addr_put(daddr);
+
+	return (struct nl_object *) sa;
+}
+
+static struct nl_object *build_xfrm_ae(int i)
+{
+	struct xfrmnl_ae *ae = xfrmnl_ae_alloc();
+	struct nl_addr *daddr = build_addr(AF_INET6, i / 4);
+
+	ck_assert_int_eq(xfrmnl_ae_set_daddr(ae, daddr), 0);
+	ck_assert_int_eq(xfrmnl_ae_set_spi(ae, 0x1000 + i % 4), 0);
+	ck_assert_int_eq(xfrmnl_ae_set_proto(ae, IPPROTO_ESP), 0);
+	nl_addr_put(daddr);
+
+	return (struct nl_object *) ae;
+}
+
+static struct nl_object *build_xfrm_sp(int i)
+{
+	struct xfrmnl_sp *sp = xfrmnl_sp_alloc();
+
+	ck_assert_int_eq(xfrmnl_sp_set_index(sp, 8 * i), 0);
+	ck_assert_int_eq(xfrmnl_sp_set_dir(sp, i % 3), 0);
+
+	return (struct nl_object *) sp;
+}
+
+START_TEST(cache_hash_route_addr)
+{
+	check_cache_search("route/addr", build_route_addr);
+}
+END_TEST
+
+START_TEST(cache_hash_ct)
+{
+	check_cache_search("netfilter/ct", build_ct);
+}
+END_TEST
+
+START_TEST(cache_hash_exp)
+{
+	check_cache_search("netfilter/exp", build_exp);
+}
+END_TEST
+
+START_TEST(cache_hash_xfrm_sa)
+{
+	check_cache_search("xfrm/sa", build_xfrm_sa);
+}
+END_TEST
+
+START_TEST(cache_hash_xfrm_ae)
+{
+	struct nl_object *objs[N_OBJS], *needle;
+	nl_hash_table_t *ht;
+	int i;
+
+	/* There are no AE cache operations, use a hashtable directly */
+	ht = nl_hash_table_alloc(4);
+	ck_assert_ptr_nonnull(ht);
+
+	for (i = 0; i < N_OBJS; i++) {
+		objs[i] = build_xfrm_ae(i);
+		ck_assert_int_eq(nl_hash_table_add(ht, objs[i]), 0);
+	}
+
+	ck_assert_ptr_nonnull(OBJ_CAST(objs[0])->ce_ops->oo_keygen);
+
+	for (i = 0; i < N_OBJS; i++) {
+		needle = build_xfrm_ae(i);
+		ck_assert_ptr_eq(nl_hash_table_lookup(ht, needle), objs[i]);
+
+		/* Attributes outside of the identity are not hashed */
+		ck_assert_int_eq(xfrmnl_ae_set_reqid((struct xfrmnl_ae *) needle,
+						     42), 0);
+		ck_assert_ptr_eq(nl_hash_table_lookup(ht, needle), objs[i]);
+
+		/* Changing an identity attribute rehashes the needle */
+		ck_assert_int_eq(xfrmnl_ae_set_spi((struct xfrmnl_ae *) needle,
+						   0x2000), 0);
+		ck_assert_ptr_null(nl_hash_table_lookup(ht, needle));
+		nl_object_put(needle);
+	}
+
+	needle = build_xfrm_ae(N_OBJS);
+	ck_assert_ptr_null(nl_hash_table_lookup(ht, needle));
+	nl_object_put(needle);
+
+	nl_hash_table_free(ht);
+	for (i = 0; i < N_OBJS; i++)
+		nl_object_put(objs[i]);
+}
+END_TEST
+
+START_TEST(cache_hash_xfrm_sp)
+{
+	check_cache_search("xfrm/sp", build_xfrm_sp);
+}
+END_TEST
+
+START_TEST(cache_hash_modified_needle)
+{
+	struct nl_cache *cache;
+	struct nl_object *obj, *found;
+	struct rtnl_addr *needle;
+	struct nl_addr *local;
+	int i;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/addr", &cache), 0);
+
+	for (i = 0; i < 4; i++) {
+		obj = build_route_addr(i);
+		ck_assert_int_eq(nl_cache_add(cache, obj), 0);
+		nl_object_put(obj);
+	}
+
+	/* Changing an identity attribute must not leave a stale hash */
+	needle = (struct rtnl_addr *) build_route_addr(0);
+	found = nl_cache_search(cache, OBJ_CAST(needle));
+	ck_assert_ptr_nonnull(found);
+	nl_object_put(found);
+
+	local = build_addr(AF_INET, 2);
+	ck_assert_int_eq(rtnl_addr_set_local(needle, local), 0);
+	nl_addr_put(local);
+	rtnl_addr_set_ifindex(needle, 1 + 2 % 7);
+
+	found = nl_cache_search(cache, OBJ_CAST(needle));
+	ck_assert_ptr_nonnull(found);
+	ck_assert(nl_object_identical(found, OBJ_CAST(needle)));
+	nl_object_put(found);
+
+	nl_object_put(OBJ_CAST(needle));
+	nl_cache_free(cache);
+}
+END_TEST
+
+static bool is_power_of_two(int n)
+{
+	return n > 0 && (n & (n - 1)) == 0;
+}
+
+START_TEST(hashtable_resize_add_del)
+{
+	struct nl_object *objs[N_OBJS];
+	bool deleted[N_OBJS] = { false };
+	nl_hash_table_t *ht;
+	int i;
+
+	ht = nl_hash_table_alloc(4);
+	ck_assert_ptr_nonnull(ht);
+	ck_assert_int_eq(ht->size, 4);
+
+	for (i = 0; i < N_OBJS; i++)
+		objs[i] = build_route_addr(i);
+
+	/* Delete every third object while the table keeps growing */
+	for (i = 0; i < N_OBJS; i++) {
+		ck_assert_int_eq(nl_hash_table_add(ht, objs[i]), 0);
+		ck_assert_int_eq(nl_hash_table_add(ht, objs[i]), -NLE_EXIST);
+		ck_assert_ptr_eq(nl_hash_table_lookup(ht, objs[i]), objs[i]);
+
+		if (i % 3 == 2) {
+			ck_assert_int_eq(nl_hash_table_del(ht, objs[i - 1]), 0);
+			ck_assert_int_eq(nl_hash_table_del(ht, objs[i - 1]),
+					 -NLE_OBJ_NOTFOUND);
+			deleted[i - 1] = true;
+		}
+
+		/* Older objects may still await migration */
+		ck_assert_ptr_eq(nl_hash_table_lookup(ht, objs[i / 2]),
+				 deleted[i / 2] ? NULL : objs[i / 2]);
+	}
+
+	ck_assert(is_power_of_two(ht->size));
+	ck_assert_int_ge(ht->size, N_OBJS * 2 / 3 / 2);
+
+	for (i = 0; i < N_OBJS; i++) {
+		if (deleted[i]) {
+			ck_assert_ptr_null(nl_hash_table_lookup(ht, objs[i]));
+			ck_assert_int_eq(nl_object_get_refcnt(objs[i]), 1);
+		} else {
+			ck_assert_ptr_eq(nl_hash_table_lookup(ht, objs[i]),
+					 objs[i]);
+			ck_assert_int_eq(nl_object_get_refcnt(objs[i]), 2);
+		}
+	}
+
+	/* Emptying the table during a migration */
+	for (i = 0; i < N_OBJS; i++) {
+		if (!deleted[i])
+			ck_assert_int_eq(nl_hash_table_del(ht, objs[i]), 0);
+	}
+
+	for (i = 0; i < N_OBJS; i++) {
+		ck_assert_ptr_null(nl_hash_table_lookup(ht, objs[i]));
+		ck_assert_int_eq(nl_object_get_refcnt(objs[i]), 1);
+	}
+
+	/* Refill, the table is freed with a migration in progress */
+	for (i = 0; i < N_OBJS; i++)
+		ck_assert_int_eq(nl_hash_table_add(ht, objs[i]), 0);
+
+	nl_hash_table_free(ht);
+
+	for (i = 0; i < N_OBJS; i++) {
+		ck_assert_int_eq(nl_object_get_refcnt(objs[i]), 1);
+		nl_object_put(objs[i]);
+	}
+}
+END_TEST
+
+START_TEST(hashtable_alloc_sizes)
+{
+	static const struct {
+		int size;
+		int expected;
+	} sizes[] = {
+		{ -1, 1 }, { 0, 1 }, { 1, 1 }, { 3, 4 }, { 4, 4 }, { 1000, 1024 },
+	};
+	struct nl_object *objs[N_OBJS];
+	size_t i;
+	int j;
+
+	for (j = 0; j < N_OBJS; j++)
+		objs[j] = build_route_addr(j);
+
+	/* Any size is a starting point only, the table grows */
+	for (i = 0; i < _NL_N_ELEMENTS(sizes); i++) {
+		nl_hash_table_t *ht = nl_hash_table_alloc(sizes[i].size);
+
+		ck_assert_ptr_nonnull(ht);
+		ck_assert_int_eq(ht->size, sizes[i].expected);
+
+		for (j = 0; j < N_OBJS; j++)
+			ck_assert_int_eq(nl_hash_table_add(ht, objs[j]), 0);
+		for (j = 0; j < N_OBJS; j++)
+			ck_assert_ptr_eq(nl_hash_table_lookup(ht, objs[j]),
+					 objs[j]);
+		nl_hash_table_free(ht);
+	}
+
+	for (j = 0; j < N_OBJS; j++)
+		nl_object_put(objs[j]);
+}
+END_TEST
+
+START_TEST(hashtable_presize)
+{
+	struct nl_object *objs[N_OBJS];
+	nl_hash_table_t *ht;
+	int i, size;
+
+	ht = nl_hash_table_alloc(4);
+	ck_assert_ptr_nonnull(ht);
+
+	ck_assert_int_eq(nl_hash_table_add(ht, objs[0] = build_route_addr(0)),
+			 0);
+
+	ck_assert_int_eq(nl_hash_table_presize(ht, N_OBJS), 0);
+	size = ht->size;
+	ck_assert(is_power_of_two(size));
+	ck_assert_int_ge(size, N_OBJS / 2);
+
+	/* Never shrinks */
+	ck_assert_int_eq(nl_hash_table_presize(ht, 1), 0);
+	ck_assert_int_eq(ht->size, size);
+
+	ck_assert_ptr_eq(nl_hash_table_lookup(ht, objs[0]), objs[0]);
+
+	for (i = 1; i < N_OBJS; i++) {
+		objs[i] = build_route_addr(i);
+		ck_assert_int_eq(nl_hash_table_add(ht, objs[i]), 0);
+	}
+
+	/* No resize was needed while adding */
+	ck_assert_int_eq(ht->size, size);
+
+	for (i = 0; i < N_OBJS; i++)
+		ck_assert_ptr_eq(nl_hash_table_lookup(ht, objs[i]), objs[i]);
+
+	nl_hash_table_free(ht);
+
+	for (i = 0; i < N_OBJS; i++)
+		nl_object_put(objs[i]);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_hash_suite(void)
+{
+	Suite *suite = suite_create("Cache hashing");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, cache_hash_route_addr);
+	tcase_add_test(tc, cache_hash_ct);
+	tcase_add_test(tc, cache_hash_exp);
+	tcase_add_test(tc, cache_hash_xfrm_sa);
+	tcase_add_test(tc, cache_hash_xfrm_ae);
+	tcase_add_test(tc, cache_hash_xfrm_sp);
+	tcase_add_test(tc, cache_hash_modified_needle);
+	tcase_add_test(tc, hashtable_resize_add_del);
+	tcase_add_test(tc, hashtable_alloc_sizes);
+	tcase_add_test(tc, hashtable_presize);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -0,0 +1,224 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+#include <pthread.h>
+
+#include <linux/rtnetlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/object.h>
+#include <netlink/route/route.h>
+#include <netlink/route/nexthop.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/object-api.h"
+
+struct change {
+	int			nchanges;
+	int			action;
+	uint64_t		diff;
+	struct nl_object *	old;
+	struct nl_object *	new;
+};
+
+static void change_cb(struct nl_cache *cache, struct nl_object *old,
+		      struct nl_object *new, uint64_t diff, int action,
+		      void *data)
+{
+	struct change *c = data;
+
+	nl_object_put(c->old);
+	nl_object_put(c->new);
+
+	c->nchanges++;
+	c->action = action;
+	c->diff = diff;
+	c->old = old;
+	c->new = new;
+	if (old)
+		nl_object_get(old);
+	if (new)
+		nl_object_get(new);
+}
+
+static void change_clear(struct change *c)
+{
+	nl_object_put(c->old);
+	nl_object_put(c->new);
+	memset(c, 0, sizeof(*c));
+}
+
+static struct nl_object *build_route(const char *dst, const char *gw)
+{
+	struct rtnl_route *route = rtnl_route_alloc();
+	struct rtnl_nexthop *nh = rtnl_route_nh_alloc();
+	struct nl_addr *addr;
+
+	ck_assert_int_eq(nl_addr_parse(dst, AF_UNSPEC, &addr), 0);
+	rtnl_route_set_family(route, nl_addr_get_family(addr));
+	rtnl_route_set_table(route, RT_TABLE_MAIN);
+	ck_assert_int_eq(rtnl_route_set_dst(route, addr), 0);
+	nl_addr_put(addr);
+
+	ck_assert_int_eq(nl_addr_parse(gw, AF_UNSPEC, &addr), 0);
+	rtnl_route_nh_set_ifindex(nh, 1);
+	rtnl_route_nh_set_gateway(nh, addr);
+	nl_addr_put(addr);
+	rtnl_route_add_nexthop(route, nh);
+
+	OBJ_CAST(route)->ce_msgtype = RTM_NEWROUTE;
+
+	return (struct nl_object *) route;
+}
+
+static void include_route(struct nl_cache *cache, const char *dst,
+			  const char *gw, struct change *c)
+{
+	struct nl_object *obj = build_route(dst, gw);
+
+	ck_assert_int_eq(nl_cache_include_v2(cache, obj, change_cb, c), 0);
+	nl_object_put(obj);
+}
+
+static int nnexthops(struct nl_object *obj)
+{
+	return rtnl_route_get_nnexthops((struct rtnl_route *) obj);
+}
+
+START_TEST(cache_include_change_clone)
+{
+	struct change c = { 0 };
+	struct nl_cache *cache;
+	int no_clone = _i;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/route", &cache), 0);
+	if (no_clone)
+		nl_cache_set_flags(cache, NL_CACHE_NO_CHANGE_CLONE);
+
+	include_route(cache, "2001:db8::/64", "fe80::1", &c);
+	ck_assert_int_eq(c.action, NL_ACT_NEW);
+	ck_assert_ptr_null(c.old);
+
+	/* The second nexthop is merged into the cached route */
+	include_route(cache, "2001:db8::/64", "fe80::2", &c);
+	ck_assert_int_eq(c.nchanges, 2);
+	ck_assert_int_eq(c.action, NL_ACT_CHANGE);
+	ck_assert_uint_ne(c.diff, 0);
+	ck_assert_ptr_eq(c.new, nl_cache_get_first(cache));
+	ck_assert_int_eq(nnexthops(c.new), 2);
+	if (no_clone)
+		ck_assert_ptr_null(c.old);
+	else {
+		ck_assert_ptr_nonnull(c.old);
+		ck_assert_ptr_ne(c.old, c.new);
+		ck_assert_int_eq(nnexthops(c.old), 1);
+	}
+
+	/* Replaced objects are passed in full either way */
+	include_route(cache, "10.0.0.0/8", "192.168.0.1", &c);
+	include_route(cache, "10.0.0.0/8", "192.168.0.2", &c);
+	ck_assert_int_eq(c.nchanges, 4);
+	ck_assert_int_eq(c.action, NL_ACT_CHANGE);
+	ck_assert_ptr_nonnull(c.old);
+	ck_assert_ptr_nonnull(c.new);
+	ck_assert_ptr_ne(c.old, c.new);
+	ck_assert_int_eq(nl_cache_nitems(cache), 2);
+
+	change_clear(&c);
+	nl_cache_free(cache);
+}
+END_TEST
+
+struct lookup {
+	pthread_t		thread;
+	struct nl_cache *	cache;
+	struct nl_object *	needle;
+	int *			stop;
+	int			nlookups;
+	int			nmisses;
+};
+
+static void *lookup_run(void *arg)
+{
+	struct lookup *l = arg;
+	struct nl_object *obj;
+
+	while (!__atomic_load_n(l->stop, __ATOMIC_ACQUIRE)) {
+		obj = nl_cache_search(l->cache, l->needle);
+		if (obj)
+			nl_object_put(obj);
+		else
+			l->nmisses++;
+		l->nlookups++;
+	}
+
+	return NULL;
+}
+
+START_TEST(cache_include_concurrent_lookup)
+{
+	static const char *const gws[2][2] = {
+		{ "192.168.0.1", "192.168.0.2" },
+		{ "fe80::1", "fe80::2" },
+	};
+	/* IPv4 routes are replaced, IPv6 routes merged into a copy */
+	const char *dst = _i ? "2001:db8::/64" : "10.0.0.0/8";
+	struct lookup readers[2];
+	struct nl_cache *cache;
+	struct nl_object *obj;
+	int stop = 0;
+	int i;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/route", &cache), 0);
+	nl_cache_set_flags(cache, NL_CACHE_THREAD_SAFE);
+
+	obj = build_route(dst, gws[_i][0]);
+	ck_assert_int_eq(nl_cache_include(cache, obj, NULL, NULL), 0);
+	nl_object_put(obj);
+
+	for (i = 0; i < 2; i++) {
+		readers[i] = (struct lookup) {
+			.cache = cache,
+			.needle = build_route(dst, gws[_i][0]),
+			.stop = &stop,
+		};
+		ck_assert_int_eq(pthread_create(&readers[i].thread, NULL,
+						lookup_run, &readers[i]), 0);
+	}
+
+	for (i = 0; i < 5000; i++) {
+		obj = build_route(dst, gws[_i][i % 2]);
+		ck_assert_int_eq(nl_cache_include(cache, obj, NULL, NULL), 0);
+		nl_object_put(obj);
+	}
+
+	__atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+
+	for (i = 0; i < 2; i++) {
+		ck_assert_int_eq(pthread_join(readers[i].thread, NULL), 0);
+		ck_assert_int_gt(readers[i].nlookups, 0);
+		ck_assert_int_eq(readers[i].nmisses, 0);
+		nl_object_put(readers[i].needle);
+	}
+
+	ck_assert_int_eq(nl_cache_nitems(cache), 1);
+
+	nl_cache_free(cache);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_include_suite(void)
+{
+	Suite *suite = suite_create("Cache include");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_loop_test(tc, cache_include_change_clone, 0, 2);
+	tcase_add_loop_test(tc, cache_include_concurrent_lookup, 0, 2);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
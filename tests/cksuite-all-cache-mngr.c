@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/route/link.h>
+
+#include "cksuite-all.h"
+
+/* Enough link notifications to overflow a minimal receive buffer */
+#define N_VETH 20
+
+static void count_change(struct nl_cache *cache, struct nl_object *obj,
+			 int action, void *data)
+{
+	(*(int *) data)++;
+}
+
+START_TEST(cache_mngr_overrun)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_nl_cache struct nl_cache *fresh = NULL;
+	struct nl_cache_mngr *mngr;
+	struct nl_sock *evsk;
+	struct nl_cache *cache;
+	struct nl_object *obj;
+	bool auto_resync = _i;
+	int nchanges = 0;
+	char name[IFNAMSIZ];
+	int i, err;
+
+	evsk = nl_socket_alloc();
+	ck_assert_ptr_nonnull(evsk);
+
+	ck_assert_int_eq(nl_cache_mngr_alloc(evsk, NETLINK_ROUTE,
+					     auto_resync ? NL_AUTO_RESYNC : 0,
+					     &mngr),
+			 0);
+	ck_assert_int_eq(nl_cache_mngr_add(mngr, "route/link", count_change,
+					   &nchanges, &cache),
+			 0);
+	ck_assert_int_eq(nl_socket_set_buffer_size(evsk, 1, 0), 0);
+
+	for (i = 0; i < N_VETH; i++) {
+		snprintf(name, sizeof(name), "xveth%d", i);
+		_nltst_add_link(sk, name, "veth", NULL);
+	}
+
+	err = nl_cache_mngr_data_ready(mngr);
+	ck_assert_uint_gt(nl_cache_mngr_get_overruns(mngr), 0);
+
+	if (!auto_resync) {
+		ck_assert_int_eq(err, -NLE_NOMEM);
+		goto out;
+	}
+
+	ck_assert_int_ge(err, 0);
+	ck_assert_int_gt(nchanges, 0);
+
+	/* The cache matches a fresh dump */
+	ck_assert_int_eq(rtnl_link_alloc_cache(sk, AF_UNSPEC, &fresh), 0);
+	ck_assert_int_eq(nl_cache_nitems(cache), nl_cache_nitems(fresh));
+	for (obj = nl_cache_get_first(fresh); obj;
+	     obj = nl_cache_get_next(obj)) {
+		struct rtnl_link *link;
+
+		link = rtnl_link_get(cache, rtnl_link_get_ifindex(
+						    (struct rtnl_link *) obj));
+		ck_assert_ptr_nonnull(link);
+		ck_assert_str_eq(rtnl_link_get_name(link),
+				 rtnl_link_get_name((struct rtnl_link *) obj));
+		rtnl_link_put(link);
+	}
+
+out:
+	nl_cache_mngr_free(mngr);
+	nl_socket_free(evsk);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_mngr_suite(void)
+{
+	Suite *suite = suite_create("Cache manager");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_loop_test(tc, cache_mngr_overrun, 0, 2);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/object.h>
+#include <netlink/route/addr.h>
+#include <netlink/route/link.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/cache-api.h"
+#include "nl-priv-dynamic-core/object-api.h"
+
+#define TEST_MSG_TYPE 0x7ff0
+#define N_VETH 8
+#define MAX_SOCKETS 4
+
+static void add_addr(struct nl_sock *sk, int ifindex, const char *local)
+{
+	struct rtnl_addr *addr = rtnl_addr_alloc();
+	_nl_auto_nl_addr struct nl_addr *a = NULL;
+
+	ck_assert_int_eq(nl_addr_parse(local, AF_INET, &a), 0);
+	rtnl_addr_set_ifindex(addr, ifindex);
+	ck_assert_int_eq(rtnl_addr_set_local(addr, a), 0);
+
+	ck_assert_int_eq(rtnl_addr_add(sk, addr, 0), 0);
+	rtnl_addr_put(addr);
+}
+
+static void add_objects(struct nl_sock *sk)
+{
+	char name[IFNAMSIZ];
+	char local[32];
+	int ifindex;
+	int i;
+
+	for (i = 0; i < N_VETH; i++) {
+		snprintf(name, sizeof(name), "xveth%d", i);
+		_nltst_add_link(sk, name, "veth", NULL);
+		_nltst_get_link(sk, name, &ifindex, NULL);
+		snprintf(local, sizeof(local), "192.0.2.%d", i + 1);
+		add_addr(sk, ifindex, local);
+	}
+}
+
+/* Both caches hold the same objects with the same attributes, the
+ * protocol info of links is never considered equal */
+static void assert_same(struct nl_cache *cache, struct nl_cache *ref)
+{
+	struct nl_object *obj;
+
+	ck_assert_int_eq(nl_cache_nitems(cache), nl_cache_nitems(ref));
+	for (obj = nl_cache_get_first(ref); obj; obj = nl_cache_get_next(obj)) {
+		struct nl_object *found = nl_cache_search(cache, obj);
+
+		ck_assert_ptr_nonnull(found);
+		ck_assert(nl_object_identical(found, obj));
+		ck_assert_uint_eq(found->ce_mask, obj->ce_mask);
+		nl_object_put(found);
+	}
+}
+
+static struct nl_cache *alloc_ref(struct nl_sock *sk, const char *name,
+				  unsigned int flags)
+{
+	struct nl_cache *cache;
+
+	ck_assert_int_eq(nl_cache_alloc_name(name, &cache), 0);
+	nl_cache_set_flags(cache, flags);
+	ck_assert_int_eq(nl_cache_refill(sk, cache), 0);
+
+	return cache;
+}
+
+static int sockets_open(struct nl_sock **sks, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		sks[i] = _nltst_socket(NETLINK_ROUTE);
+
+	return n;
+}
+
+static void sockets_free(struct nl_sock **sks, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		nl_socket_free(sks[i]);
+}
+
+START_TEST(cache_refill_parallel_contents)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_nl_cache struct nl_cache *ref_link = NULL;
+	_nl_auto_nl_cache struct nl_cache *ref_link_af = NULL;
+	_nl_auto_nl_cache struct nl_cache *ref_addr = NULL;
+	struct nl_sock *sks[MAX_SOCKETS];
+	struct nl_cache *caches[3];
+	int nsks = sockets_open(sks, _i + 1);
+	int i;
+
+	add_objects(sk);
+	ref_link = alloc_ref(sk, "route/link", 0);
+	ref_link_af = alloc_ref(sk, "route/link", NL_CACHE_AF_ITER);
+	ref_addr = alloc_ref(sk, "route/addr", 0);
+	ck_assert_int_ge(nl_cache_nitems(ref_link), 2 * N_VETH + 1);
+	ck_assert_int_ge(nl_cache_nitems(ref_addr), N_VETH);
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &caches[0]), 0);
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &caches[1]), 0);
+	nl_cache_set_flags(caches[1], NL_CACHE_AF_ITER);
+	ck_assert_int_eq(nl_cache_alloc_name("route/addr", &caches[2]), 0);
+
+	/* Refilling twice replaces the contents */
+	for (i = 0; i < 2; i++) {
+		ck_assert_int_eq(nl_cache_refill_parallel(sks, nsks, caches, 3),
+				 0);
+		assert_same(caches[0], ref_link);
+		assert_same(caches[1], ref_link_af);
+		assert_same(caches[2], ref_addr);
+	}
+
+	for (i = 0; i < 3; i++)
+		nl_cache_free(caches[i]);
+	sockets_free(sks, nsks);
+}
+END_TEST
+
+static struct nl_object_ops test_obj_ops = {
+	.oo_name	= "test/refill",
+	.oo_size	= sizeof(struct nl_object),
+};
+
+/* Requests a dump of a type rtnetlink does not know */
+static int test_request_update(struct nl_cache *cache, struct nl_sock *sk)
+{
+	return nl_send_simple(sk, TEST_MSG_TYPE, NLM_F_DUMP, NULL, 0);
+}
+
+static struct nl_cache_ops test_ops = {
+	.co_name		= "test/refill",
+	.co_protocol		= NETLINK_ROUTE,
+	.co_request_update	= test_request_update,
+	.co_msgtypes		= {
+		{ TEST_MSG_TYPE, NL_ACT_NEW, "new" },
+		END_OF_MSGTYPES_LIST,
+	},
+	.co_obj_ops		= &test_obj_ops,
+};
+
+START_TEST(cache_refill_parallel_error)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_nl_cache struct nl_cache *ref_link = NULL;
+	_nl_auto_nl_cache struct nl_cache *ref_addr = NULL;
+	struct nl_sock *sks[MAX_SOCKETS];
+	struct nl_object *obj;
+	struct nl_cache *caches[3];
+	int nsks = sockets_open(sks, _i + 1);
+	int i;
+
+	add_objects(sk);
+	ref_link = alloc_ref(sk, "route/link", NL_CACHE_AF_ITER);
+	ref_addr = alloc_ref(sk, "route/addr", 0);
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &caches[0]), 0);
+	nl_cache_set_flags(caches[0], NL_CACHE_AF_ITER);
+	caches[1] = nl_cache_alloc(&test_ops);
+	ck_assert_ptr_nonnull(caches[1]);
+	ck_assert_int_eq(nl_cache_alloc_name("route/addr", &caches[2]), 0);
+
+	obj = nl_object_alloc(&test_obj_ops);
+	ck_assert_ptr_nonnull(obj);
+	ck_assert_int_eq(nl_cache_add(caches[1], obj), 0);
+	nl_object_put(obj);
+
+	/* The failed dump leaves its cache empty and the others complete */
+	ck_assert_int_eq(nl_cache_refill_parallel(sks, nsks, caches, 3),
+			 -NLE_OPNOTSUPP);
+	assert_same(caches[0], ref_link);
+	ck_assert_int_eq(nl_cache_nitems(caches[1]), 0);
+	assert_same(caches[2], ref_addr);
+
+	/* The sockets remain usable */
+	nl_cache_clear(caches[0]);
+	ck_assert_int_eq(nl_cache_refill_parallel(sks, nsks, &caches[2], 1), 0);
+	ck_assert_int_eq(nl_cache_refill_parallel(sks, nsks, caches, 1), 0);
+	assert_same(caches[0], ref_link);
+	assert_same(caches[2], ref_addr);
+
+	for (i = 0; i < 3; i++)
+		nl_cache_free(caches[i]);
+	sockets_free(sks, nsks);
+}
+END_TEST
+
+START_TEST(cache_refill_parallel_proto)
+{
+	_nl_auto_nl_cache struct nl_cache *cache = NULL;
+	struct nl_sock *sks[2];
+
+	sks[0] = _nltst_socket(NETLINK_ROUTE);
+	sks[1] = nl_socket_alloc();
+	ck_assert_ptr_nonnull(sks[1]);
+	ck_assert_int_eq(nl_connect(sks[1], NETLINK_GENERIC), 0);
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &cache), 0);
+
+	ck_assert_int_eq(nl_cache_refill_parallel(sks, 2, &cache, 1),
+			 -NLE_PROTO_MISMATCH);
+	ck_assert_int_eq(nl_cache_refill_parallel(sks, 0, &cache, 1),
+			 -NLE_INVAL);
+	ck_assert_int_eq(nl_cache_refill_parallel(sks, 1, &cache, 0), 0);
+
+	sockets_free(sks, 2);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_refill_parallel_suite(void)
+{
+	Suite *suite = suite_create("Parallel cache refill");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_loop_test(tc, cache_refill_parallel_contents, 0,
+			    MAX_SOCKETS);
+	tcase_add_loop_test(tc, cache_refill_parallel_error, 0, MAX_SOCKETS);
+	tcase_add_test(tc, cache_refill_parallel_proto);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
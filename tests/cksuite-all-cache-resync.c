@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netconf.h>
+#include <linux/rtnetlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/msg.h>
+#include <netlink/object.h>
+#include <netlink/route/netconf.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/object-api.h"
+
+struct changes {
+	int			nnew;
+	int			nchange;
+	int			ndel;
+};
+
+static void count_changes(struct nl_cache *cache, struct nl_object *obj,
+			  int action, void *data)
+{
+	struct changes *c = data;
+
+	if (action == NL_ACT_NEW)
+		c->nnew++;
+	else if (action == NL_ACT_CHANGE)
+		c->nchange++;
+	else if (action == NL_ACT_DEL)
+		c->ndel++;
+}
+
+static void parse_obj(struct nl_object *obj, void *arg)
+{
+	struct nl_object **result = arg;
+
+	nl_object_get(obj);
+	*result = obj;
+}
+
+/* A notification carrying a single netconf attribute */
+static struct nl_object *build_netconf_event(int family, int ifindex,
+					     int forwarding)
+{
+	_nl_auto_nl_msg struct nl_msg *msg = NULL;
+	struct nl_object *obj = NULL;
+	struct netconfmsg ncm = {
+		.ncm_family = family,
+	};
+
+	msg = nlmsg_alloc_simple(RTM_NEWNETCONF, 0);
+	ck_assert_ptr_nonnull(msg);
+	nlmsg_set_proto(msg, NETLINK_ROUTE);
+	ck_assert_int_eq(nlmsg_append(msg, &ncm, sizeof(ncm), NLMSG_ALIGNTO),
+			 0);
+	ck_assert_int_eq(nla_put_s32(msg, NETCONFA_IFINDEX, ifindex), 0);
+	ck_assert_int_eq(nla_put_s32(msg, NETCONFA_FORWARDING, forwarding), 0);
+
+	ck_assert_int_eq(nl_msg_parse(msg, parse_obj, &obj), 0);
+	ck_assert_ptr_nonnull(obj);
+
+	return obj;
+}
+
+static int get_forwarding(struct nl_cache *cache)
+{
+	struct rtnl_netconf *nc;
+	int val = -1;
+
+	nc = rtnl_netconf_get_by_idx(cache, AF_INET, 1);
+	ck_assert_ptr_nonnull(nc);
+	ck_assert_int_eq(rtnl_netconf_get_forwarding(nc, &val), 0);
+	rtnl_netconf_put(nc);
+
+	return val;
+}
+
+START_TEST(cache_resync_merged_object)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	struct changes c = { 0 };
+	struct nl_cache *cache;
+	struct nl_object *obj, *cached;
+	uint32_t msg_hash;
+	int fwd;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/netconf", &cache), 0);
+
+	/* Stamps every object with the hash of its message */
+	ck_assert_int_eq(nl_cache_resync(sk, cache, count_changes, &c), 0);
+	ck_assert_int_gt(c.nnew, 0);
+	ck_assert_int_eq(c.nnew, nl_cache_nitems(cache));
+
+	memset(&c, 0, sizeof(c));
+	ck_assert_int_eq(nl_cache_resync(sk, cache, count_changes, &c), 0);
+	ck_assert_int_eq(c.nnew + c.nchange + c.ndel, 0);
+
+	cached = OBJ_CAST(rtnl_netconf_get_by_idx(cache, AF_INET, 1));
+	ck_assert_ptr_nonnull(cached);
+	msg_hash = cached->ce_msg_hash;
+	ck_assert_uint_ne(msg_hash, 0);
+
+	fwd = get_forwarding(cache);
+
+	/* The partial notification is merged into the cached object */
+	obj = build_netconf_event(AF_INET, 1, !fwd);
+	ck_assert_int_eq(nl_cache_include(cache, obj, NULL, NULL), 0);
+	nl_object_put(obj);
+
+	ck_assert_int_eq(get_forwarding(cache), !fwd);
+	ck_assert_uint_eq(cached->ce_msg_hash, 0);
+
+	/* An equal hash alone does not make the object unchanged */
+	cached->ce_msg_hash = msg_hash;
+
+	memset(&c, 0, sizeof(c));
+	ck_assert_int_eq(nl_cache_resync(sk, cache, count_changes, &c), 0);
+	ck_assert_int_eq(c.nchange, 1);
+	ck_assert_int_eq(c.nnew + c.ndel, 0);
+	ck_assert_int_eq(get_forwarding(cache), fwd);
+
+	/* Back in sync with the kernel */
+	memset(&c, 0, sizeof(c));
+	ck_assert_int_eq(nl_cache_resync(sk, cache, count_changes, &c), 0);
+	ck_assert_int_eq(c.nnew + c.nchange + c.ndel, 0);
+
+	nl_object_put(cached);
+	nl_cache_free(cache);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_resync_suite(void)
+{
+	Suite *suite = suite_create("Cache resync");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_test(tc, cache_resync_merged_object);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -0,0 +1,273 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netconf.h>
+#include <linux/rtnetlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/msg.h>
+#include <netlink/object.h>
+#include <netlink/route/addr.h>
+#include <netlink/route/netconf.h>
+#include <netlink/route/route.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/object-api.h"
+
+static struct nl_object *build_route_addr(int i)
+{
+	struct rtnl_addr *addr = rtnl_addr_alloc();
+	struct nl_addr *local;
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "10.0.%d.1", i);
+	ck_assert_int_eq(nl_addr_parse(buf, AF_INET, &local), 0);
+	rtnl_addr_set_ifindex(addr, 1);
+	ck_assert_int_eq(rtnl_addr_set_local(addr, local), 0);
+	nl_addr_put(local);
+
+	return (struct nl_object *) addr;
+}
+
+static struct nl_object *build_route6(const char *gw)
+{
+	struct rtnl_route *route = rtnl_route_alloc();
+	struct rtnl_nexthop *nh = rtnl_route_nh_alloc();
+	struct nl_addr *addr;
+
+	ck_assert_int_eq(nl_addr_parse("2001:db8::/64", AF_INET6, &addr), 0);
+	rtnl_route_set_family(route, AF_INET6);
+	rtnl_route_set_table(route, RT_TABLE_MAIN);
+	ck_assert_int_eq(rtnl_route_set_dst(route, addr), 0);
+	nl_addr_put(addr);
+
+	ck_assert_int_eq(nl_addr_parse(gw, AF_INET6, &addr), 0);
+	rtnl_route_nh_set_ifindex(nh, 1);
+	rtnl_route_nh_set_gateway(nh, addr);
+	nl_addr_put(addr);
+	rtnl_route_add_nexthop(route, nh);
+
+	OBJ_CAST(route)->ce_msgtype = RTM_NEWROUTE;
+
+	return (struct nl_object *) route;
+}
+
+static void parse_obj(struct nl_object *obj, void *arg)
+{
+	struct nl_object **result = arg;
+
+	nl_object_get(obj);
+	*result = obj;
+}
+
+/* A notification carrying a single netconf attribute */
+static struct nl_object *build_netconf_event(int family, int ifindex,
+					     int forwarding)
+{
+	_nl_auto_nl_msg struct nl_msg *msg = NULL;
+	struct nl_object *obj = NULL;
+	struct netconfmsg ncm = {
+		.ncm_family = family,
+	};
+
+	msg = nlmsg_alloc_simple(RTM_NEWNETCONF, 0);
+	ck_assert_ptr_nonnull(msg);
+	nlmsg_set_proto(msg, NETLINK_ROUTE);
+	ck_assert_int_eq(nlmsg_append(msg, &ncm, sizeof(ncm), NLMSG_ALIGNTO),
+			 0);
+	ck_assert_int_eq(nla_put_s32(msg, NETCONFA_IFINDEX, ifindex), 0);
+	ck_assert_int_eq(nla_put_s32(msg, NETCONFA_FORWARDING, forwarding), 0);
+
+	ck_assert_int_eq(nl_msg_parse(msg, parse_obj, &obj), 0);
+	ck_assert_ptr_nonnull(obj);
+
+	return obj;
+}
+
+static int get_forwarding(struct nl_object *obj)
+{
+	int val = -1;
+
+	ck_assert_int_eq(rtnl_netconf_get_forwarding((struct rtnl_netconf *)
+						     obj, &val), 0);
+
+	return val;
+}
+
+struct changes {
+	int			nnew;
+	int			nchange;
+	int			ndel;
+};
+
+static void count_changes(struct nl_cache *cache, struct nl_object *obj,
+			  int action, void *data)
+{
+	struct changes *c = data;
+
+	if (action == NL_ACT_NEW)
+		c->nnew++;
+	else if (action == NL_ACT_CHANGE)
+		c->nchange++;
+	else if (action == NL_ACT_DEL)
+		c->ndel++;
+}
+
+START_TEST(cache_snapshot_isolation)
+{
+	struct nl_cache_snapshot *snap, *snap2;
+	struct nl_cache *cache;
+	struct nl_object *obj, *first;
+	int i;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/addr", &cache), 0);
+
+	for (i = 0; i < 8; i++) {
+		obj = build_route_addr(i);
+		ck_assert_int_eq(nl_cache_add(cache, obj), 0);
+		nl_object_put(obj);
+	}
+
+	snap = nl_cache_snapshot(cache);
+	ck_assert_ptr_nonnull(snap);
+	ck_assert_int_eq(nl_cache_snapshot_nitems(snap), 8);
+	ck_assert_ptr_null(nl_cache_snapshot_item(snap, 8));
+
+	/* Unchanged cache, the snapshot is shared */
+	snap2 = nl_cache_snapshot(cache);
+	ck_assert_ptr_eq(snap, snap2);
+	nl_cache_snapshot_put(snap2);
+
+	first = nl_cache_get_first(cache);
+	ck_assert_ptr_eq(nl_cache_snapshot_item(snap, 0), first);
+
+	nl_cache_remove(first);
+	obj = build_route_addr(100);
+	ck_assert_int_eq(nl_cache_add(cache, obj), 0);
+	nl_object_put(obj);
+
+	/* The snapshot still holds the removed object */
+	ck_assert_int_eq(nl_cache_snapshot_nitems(snap), 8);
+	ck_assert_ptr_eq(nl_cache_snapshot_item(snap, 0), first);
+
+	snap2 = nl_cache_snapshot(cache);
+	ck_assert_ptr_ne(snap, snap2);
+	ck_assert_int_eq(nl_cache_snapshot_nitems(snap2), 8);
+
+	nl_cache_free(cache);
+	nl_cache_snapshot_put(snap);
+	nl_cache_snapshot_put(snap2);
+}
+END_TEST
+
+START_TEST(cache_snapshot_copy_on_write)
+{
+	struct nl_cache_snapshot *snap;
+	struct nl_cache *cache;
+	struct nl_object *obj, *cached;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/route", &cache), 0);
+
+	obj = build_route6("fe80::1");
+	ck_assert_int_eq(nl_cache_include(cache, obj, NULL, NULL), 0);
+	nl_object_put(obj);
+
+	snap = nl_cache_snapshot(cache);
+	ck_assert_ptr_nonnull(snap);
+
+	/* The second nexthop is merged into a copy of the cached route */
+	obj = build_route6("fe80::2");
+	ck_assert_int_eq(nl_cache_include(cache, obj, NULL, NULL), 0);
+	nl_object_put(obj);
+
+	ck_assert_int_eq(nl_cache_nitems(cache), 1);
+	cached = nl_cache_get_first(cache);
+	ck_assert_ptr_ne(cached, nl_cache_snapshot_item(snap, 0));
+	ck_assert_int_eq(rtnl_route_get_nnexthops((struct rtnl_route *) cached),
+			 2);
+	ck_assert_int_eq(rtnl_route_get_nnexthops((struct rtnl_route *)
+			 nl_cache_snapshot_item(snap, 0)), 1);
+
+	nl_cache_snapshot_put(snap);
+	nl_cache_free(cache);
+}
+END_TEST
+
+START_TEST(cache_snapshot_resync)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	struct nl_cache_snapshot *snap;
+	struct changes c = { 0 };
+	struct nl_cache *cache;
+	struct nl_object *obj, *cached, *copy;
+	int nitems, fwd;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/netconf", &cache), 0);
+	ck_assert_int_eq(nl_cache_resync(sk, cache, NULL, NULL), 0);
+	nitems = nl_cache_nitems(cache);
+
+	cached = OBJ_CAST(rtnl_netconf_get_by_idx(cache, AF_INET, 1));
+	ck_assert_ptr_nonnull(cached);
+	fwd = get_forwarding(cached);
+
+	/* Diverge from the kernel in a copy of the shared object */
+	snap = nl_cache_snapshot(cache);
+	obj = build_netconf_event(AF_INET, 1, !fwd);
+	ck_assert_int_eq(nl_cache_include(cache, obj, NULL, NULL), 0);
+	nl_object_put(obj);
+	nl_cache_snapshot_put(snap);
+
+	copy = OBJ_CAST(rtnl_netconf_get_by_idx(cache, AF_INET, 1));
+	ck_assert_ptr_ne(copy, cached);
+	ck_assert_int_eq(get_forwarding(copy), !fwd);
+	ck_assert_int_eq(nl_cache_nitems(cache), nitems);
+
+	/* The resync merges into yet another copy, which must survive the
+	 * sweep of objects not seen in the dump */
+	snap = nl_cache_snapshot(cache);
+	ck_assert_int_eq(nl_cache_resync(sk, cache, count_changes, &c), 0);
+	ck_assert_int_eq(c.nchange, 1);
+	ck_assert_int_eq(c.nnew + c.ndel, 0);
+	ck_assert_int_eq(nl_cache_nitems(cache), nitems);
+
+	nl_object_put(cached);
+	cached = OBJ_CAST(rtnl_netconf_get_by_idx(cache, AF_INET, 1));
+	ck_assert_ptr_nonnull(cached);
+	ck_assert_ptr_ne(cached, copy);
+	ck_assert_int_eq(get_forwarding(cached), fwd);
+	ck_assert_int_eq(get_forwarding(copy), !fwd);
+	nl_cache_snapshot_put(snap);
+
+	/* Back in sync with the kernel */
+	memset(&c, 0, sizeof(c));
+	ck_assert_int_eq(nl_cache_resync(sk, cache, count_changes, &c), 0);
+	ck_assert_int_eq(c.nnew + c.nchange + c.ndel, 0);
+
+	nl_object_put(copy);
+	nl_object_put(cached);
+	nl_cache_free(cache);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_snapshot_suite(void)
+{
+	Suite *suite = suite_create("Cache snapshots");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, cache_snapshot_isolation);
+	tcase_add_test(tc, cache_snapshot_copy_on_write);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("Resync");
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_test(tc, cache_snapshot_resync);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/route/link.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/object-api.h"
+
+#define N_VETH 10
+
+struct stream {
+	int			nobjs;
+	int			ret;
+	struct nl_object *	kept;
+};
+
+static int stream_cb(struct nl_object *obj, void *arg)
+{
+	struct stream *s = arg;
+
+	if (s->nobjs++ == 0) {
+		nl_object_get(obj);
+		s->kept = obj;
+	}
+
+	return s->ret;
+}
+
+static void add_veths(struct nl_sock *sk)
+{
+	char name[IFNAMSIZ];
+	int i;
+
+	for (i = 0; i < N_VETH; i++) {
+		snprintf(name, sizeof(name), "xveth%d", i);
+		_nltst_add_link(sk, name, "veth", NULL);
+	}
+}
+
+START_TEST(cache_stream_links)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_nl_cache struct nl_cache *cache = NULL;
+	_nl_auto_nl_cache struct nl_cache *full = NULL;
+	struct stream s = { 0 };
+
+	add_veths(sk);
+	ck_assert_int_eq(rtnl_link_alloc_cache(sk, AF_UNSPEC, &full), 0);
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &cache), 0);
+
+	ck_assert_int_eq(nl_cache_stream(sk, cache, stream_cb, &s), 0);
+	ck_assert_int_eq(s.nobjs, nl_cache_nitems(full));
+	ck_assert_int_eq(nl_cache_nitems(cache), 0);
+
+	/* Only the object the callback took a reference to is left */
+	ck_assert_ptr_nonnull(s.kept);
+	ck_assert_int_eq(nl_object_get_refcnt(s.kept), 1);
+	ck_assert_ptr_null(s.kept->ce_cache);
+	nl_object_put(s.kept);
+}
+END_TEST
+
+START_TEST(cache_stream_stop)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_nl_cache struct nl_cache *cache = NULL;
+	struct stream s = {
+		.ret = _i ? -NLE_INVAL : NL_STOP,
+	};
+	int err;
+
+	add_veths(sk);
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &cache), 0);
+
+	err = nl_cache_stream(sk, cache, stream_cb, &s);
+	ck_assert_int_eq(err, _i ? -NLE_INVAL : 0);
+	ck_assert_int_eq(s.nobjs, 1);
+	nl_object_put(s.kept);
+
+	/* The rest of the dump has been consumed, the socket is ready for
+	 * the next one */
+	memset(&s, 0, sizeof(s));
+	ck_assert_int_eq(nl_cache_stream(sk, cache, stream_cb, &s), 0);
+	ck_assert_int_ge(s.nobjs, 2 * N_VETH + 1);
+	nl_object_put(s.kept);
+}
+END_TEST
+
+START_TEST(cache_stream_filter)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_rtnl_link struct rtnl_link *filter = rtnl_link_alloc();
+	_nl_auto_nl_cache struct nl_cache *cache = NULL;
+	struct stream s = { 0 };
+	int br;
+
+	add_veths(sk);
+	_nltst_add_link(sk, "br0", "bridge", &br);
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &cache), 0);
+	ck_assert_int_eq(rtnl_link_set_type(filter, "bridge"), 0);
+	ck_assert_int_eq(nl_cache_set_dump_filter(cache, OBJ_CAST(filter)),
+			 0);
+
+	ck_assert_int_eq(nl_cache_stream(sk, cache, stream_cb, &s), 0);
+	ck_assert_int_eq(s.nobjs, 1);
+	ck_assert_int_eq(rtnl_link_get_ifindex((struct rtnl_link *) s.kept),
+			 br);
+	nl_object_put(s.kept);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_cache_stream_suite(void)
+{
+	Suite *suite = suite_create("Cache streaming");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_test(tc, cache_stream_links);
+	tcase_add_loop_test(tc, cache_stream_stop, 0, 2);
+	tcase_add_test(tc, cache_stream_filter);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
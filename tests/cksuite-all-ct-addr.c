@@ -0,0 +1,353 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+#include <pthread.h>
+
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+
+#include <netlink/addr.h>
+#include <netlink/msg.h>
+#include <netlink/object.h>
+#include <netlink/netfilter/ct.h>
+
+#include "cksuite-all.h"
+
+struct ct_addrs {
+	int			family;
+	const char *		a;
+	const char *		b;
+	const char *		c;
+	int			src_attr;
+	int			dst_attr;
+};
+
+static const struct ct_addrs ct_addrs[] = {
+	{
+		.family = AF_INET,
+		.a = "192.0.2.1",
+		.b = "192.0.2.2",
+		.c = "198.51.100.1",
+		.src_attr = CTA_IP_V4_SRC,
+		.dst_attr = CTA_IP_V4_DST,
+	},
+	{
+		.family = AF_INET6,
+		.a = "2001:db8::1",
+		.b = "2001:db8::2",
+		.c = "2001:db8:1::1",
+		.src_attr = CTA_IP_V6_SRC,
+		.dst_attr = CTA_IP_V6_DST,
+	},
+};
+
+static struct nl_addr *parse_addr(const char *str, int family)
+{
+	struct nl_addr *addr;
+
+	ck_assert_int_eq(nl_addr_parse(str, family, &addr), 0);
+
+	return addr;
+}
+
+/* A TCP connection from a:1000 to b:80 */
+static struct nfnl_ct *build_ct(const struct ct_addrs *t, int orig, int repl)
+{
+	_nl_auto_nl_addr struct nl_addr *a = parse_addr(t->a, t->family);
+	_nl_auto_nl_addr struct nl_addr *b = parse_addr(t->b, t->family);
+	struct nfnl_ct *ct = nfnl_ct_alloc();
+
+	ck_assert_ptr_nonnull(ct);
+	nfnl_ct_set_proto(ct, IPPROTO_TCP);
+
+	if (orig) {
+		ck_assert_int_eq(nfnl_ct_set_src(ct, 0, a), 0);
+		ck_assert_int_eq(nfnl_ct_set_dst(ct, 0, b), 0);
+		nfnl_ct_set_src_port(ct, 0, 1000);
+		nfnl_ct_set_dst_port(ct, 0, 80);
+	}
+
+	if (repl) {
+		ck_assert_int_eq(nfnl_ct_set_src(ct, 1, b), 0);
+		ck_assert_int_eq(nfnl_ct_set_dst(ct, 1, a), 0);
+		nfnl_ct_set_src_port(ct, 1, 80);
+		nfnl_ct_set_dst_port(ct, 1, 1000);
+	}
+
+	return ct;
+}
+
+static void assert_addr(struct nl_addr *addr, const struct ct_addrs *t,
+			const char *str)
+{
+	_nl_auto_nl_addr struct nl_addr *expected = parse_addr(str, t->family);
+
+	ck_assert_ptr_nonnull(addr);
+	ck_assert_int_eq(nl_addr_get_family(addr), t->family);
+	ck_assert_int_eq(nl_addr_get_prefixlen(addr),
+			 8 * nl_addr_get_len(expected));
+	ck_assert_int_eq(nl_addr_cmp(addr, expected), 0);
+}
+
+/* Address attribute of a tuple in a request, NULL if there is none */
+static struct nlattr *find_tuple_addr(struct nl_msg *msg, int tuple_attr,
+				      int addr_attr)
+{
+	struct nlattr *tuple, *ip;
+
+	tuple = nlmsg_find_attr(nlmsg_hdr(msg), sizeof(struct nfgenmsg),
+				tuple_attr);
+	if (!tuple)
+		return NULL;
+
+	ip = nla_find(nla_data(tuple), nla_len(tuple), CTA_TUPLE_IP);
+	ck_assert_ptr_nonnull(ip);
+
+	return nla_find(nla_data(ip), nla_len(ip), addr_attr);
+}
+
+static void assert_attr_addr(struct nlattr *attr, const struct ct_addrs *t,
+			     const char *str)
+{
+	_nl_auto_nl_addr struct nl_addr *expected = parse_addr(str, t->family);
+
+	ck_assert_ptr_nonnull(attr);
+	ck_assert_int_eq(nla_len(attr), nl_addr_get_len(expected));
+	ck_assert_mem_eq(nla_data(attr), nl_addr_get_binary_addr(expected),
+			 nl_addr_get_len(expected));
+}
+
+START_TEST(ct_addr_round_trip)
+{
+	const struct ct_addrs *t = &ct_addrs[_i];
+	_nl_auto_nl_addr struct nl_addr *c = parse_addr(t->c, t->family);
+	struct nfnl_ct *ct, *parsed, *clone;
+	struct nl_addr *addr;
+	struct nl_msg *msg;
+
+	ct = build_ct(t, 1, 1);
+	ck_assert_int_eq(nfnl_ct_get_family(ct), t->family);
+
+	ck_assert_int_eq(nfnl_ct_build_add_request(ct, 0, &msg), 0);
+	assert_attr_addr(find_tuple_addr(msg, CTA_TUPLE_ORIG, t->src_attr), t,
+			 t->a);
+	assert_attr_addr(find_tuple_addr(msg, CTA_TUPLE_ORIG, t->dst_attr), t,
+			 t->b);
+	assert_attr_addr(find_tuple_addr(msg, CTA_TUPLE_REPLY, t->src_attr),
+			 t, t->b);
+	assert_attr_addr(find_tuple_addr(msg, CTA_TUPLE_REPLY, t->dst_attr),
+			 t, t->a);
+
+	ck_assert_int_eq(nfnlmsg_ct_parse(nlmsg_hdr(msg), &parsed), 0);
+	nlmsg_free(msg);
+
+	ck_assert_int_eq(nfnl_ct_get_family(parsed), t->family);
+	assert_addr(nfnl_ct_get_src(parsed, 0), t, t->a);
+	assert_addr(nfnl_ct_get_dst(parsed, 0), t, t->b);
+	assert_addr(nfnl_ct_get_src(parsed, 1), t, t->b);
+	assert_addr(nfnl_ct_get_dst(parsed, 1), t, t->a);
+	ck_assert(nl_object_identical((struct nl_object *) ct,
+				      (struct nl_object *) parsed));
+
+	/* The object owns the address, it is created once */
+	addr = nfnl_ct_get_src(parsed, 0);
+	ck_assert_ptr_eq(nfnl_ct_get_src(parsed, 0), addr);
+
+	clone = (struct nfnl_ct *) nl_object_clone((struct nl_object *) parsed);
+	ck_assert_ptr_nonnull(clone);
+	ck_assert_ptr_ne(nfnl_ct_get_src(clone, 0), addr);
+	assert_addr(nfnl_ct_get_src(clone, 0), t, t->a);
+	ck_assert_int_eq(nl_object_diff((struct nl_object *) parsed,
+					(struct nl_object *) clone),
+			 0);
+
+	/* Setting copies the address and replaces the handle */
+	ck_assert_int_eq(nfnl_ct_set_src(clone, 0, c), 0);
+	assert_addr(nfnl_ct_get_src(clone, 0), t, t->c);
+	ck_assert_ptr_ne(nfnl_ct_get_src(clone, 0), c);
+	ck_assert(!nl_object_identical((struct nl_object *) parsed,
+				       (struct nl_object *) clone));
+	assert_addr(nfnl_ct_get_src(parsed, 0), t, t->a);
+
+	nfnl_ct_put(clone);
+	nfnl_ct_put(parsed);
+	nfnl_ct_put(ct);
+}
+END_TEST
+
+START_TEST(ct_addr_tuples)
+{
+	const struct ct_addrs *t = &ct_addrs[_i];
+	struct nfnl_ct *ct;
+	struct nl_msg *msg;
+
+	/* Only the tuples with addresses are put into requests */
+	ct = build_ct(t, 0, 1);
+	ck_assert_ptr_null(nfnl_ct_get_src(ct, 0));
+	ck_assert_ptr_null(nfnl_ct_get_dst(ct, 0));
+	ck_assert_int_eq(nfnl_ct_build_query_request(ct, 0, &msg), 0);
+	ck_assert_ptr_null(nlmsg_find_attr(nlmsg_hdr(msg),
+					   sizeof(struct nfgenmsg),
+					   CTA_TUPLE_ORIG));
+	assert_attr_addr(find_tuple_addr(msg, CTA_TUPLE_REPLY, t->src_attr),
+			 t, t->b);
+	nlmsg_free(msg);
+	nfnl_ct_put(ct);
+
+	ct = build_ct(t, 1, 0);
+	ck_assert_ptr_null(nfnl_ct_get_src(ct, 1));
+	ck_assert_int_eq(nfnl_ct_build_delete_request(ct, 0, &msg), 0);
+	ck_assert_ptr_null(nlmsg_find_attr(nlmsg_hdr(msg),
+					   sizeof(struct nfgenmsg),
+					   CTA_TUPLE_REPLY));
+	assert_attr_addr(find_tuple_addr(msg, CTA_TUPLE_ORIG, t->dst_attr), t,
+			 t->b);
+	nlmsg_free(msg);
+	nfnl_ct_put(ct);
+}
+END_TEST
+
+START_TEST(ct_addr_invalid)
+{
+	_nl_auto_nl_addr struct nl_addr *a4 = parse_addr("192.0.2.1", AF_INET);
+	_nl_auto_nl_addr struct nl_addr *a6 = parse_addr("2001:db8::1",
+							 AF_INET6);
+	_nl_auto_nl_addr struct nl_addr *large = NULL;
+	uint8_t buf[20] = { 0 };
+	struct nfnl_ct *ct;
+
+	ct = nfnl_ct_alloc();
+	ck_assert_ptr_nonnull(ct);
+	ck_assert_int_eq(nfnl_ct_set_src(ct, 0, a4), 0);
+	ck_assert_int_eq(nfnl_ct_set_dst(ct, 0, a6), -NLE_AF_MISMATCH);
+	ck_assert_ptr_null(nfnl_ct_get_dst(ct, 0));
+	nfnl_ct_put(ct);
+
+	/* Addresses are stored inline, up to 16 bytes */
+	large = nl_addr_build(AF_INET6, buf, sizeof(buf));
+	ck_assert_ptr_nonnull(large);
+	ct = nfnl_ct_alloc();
+	ck_assert_ptr_nonnull(ct);
+	ck_assert_int_eq(nfnl_ct_set_src(ct, 0, large), -NLE_RANGE);
+	ck_assert_ptr_null(nfnl_ct_get_src(ct, 0));
+	nfnl_ct_put(ct);
+}
+END_TEST
+
+START_TEST(ct_addr_dump)
+{
+	const struct ct_addrs *t = &ct_addrs[_i];
+	_nl_auto_nl_addr struct nl_addr *a = parse_addr(t->a, t->family);
+	char buf[512], addr[64], expected[80];
+	struct nfnl_ct *ct;
+
+	/* Addresses are formatted like nl_addr2str() does */
+	ct = build_ct(t, 1, 1);
+	nl_object_dump_buf((struct nl_object *) ct, buf, sizeof(buf));
+	snprintf(expected, sizeof(expected), "%s:1000 <-> ",
+		 nl_addr2str(a, addr, sizeof(addr)));
+	ck_assert_ptr_nonnull(strstr(buf, expected));
+
+	nl_addr_set_prefixlen(a, t->family == AF_INET ? 24 : 64);
+	ck_assert_int_eq(nfnl_ct_set_src(ct, 0, a), 0);
+	nl_object_dump_buf((struct nl_object *) ct, buf, sizeof(buf));
+	snprintf(expected, sizeof(expected), "%s:1000 -> ",
+		 nl_addr2str(a, addr, sizeof(addr)));
+	ck_assert_ptr_nonnull(strchr(expected, '/'));
+	ck_assert_ptr_nonnull(strstr(buf, expected));
+	nfnl_ct_put(ct);
+}
+END_TEST
+
+#define N_THREADS 8
+
+struct getter {
+	pthread_t		thread;
+	pthread_barrier_t *	barrier;
+	struct nfnl_ct *	ct;
+	struct nl_addr *	addrs[4];
+};
+
+static void *get_addrs(void *arg)
+{
+	struct getter *g = arg;
+
+	pthread_barrier_wait(g->barrier);
+	g->addrs[0] = nfnl_ct_get_src(g->ct, 0);
+	g->addrs[1] = nfnl_ct_get_dst(g->ct, 0);
+	g->addrs[2] = nfnl_ct_get_src(g->ct, 1);
+	g->addrs[3] = nfnl_ct_get_dst(g->ct, 1);
+
+	return NULL;
+}
+
+START_TEST(ct_addr_concurrent)
+{
+	const struct ct_addrs *t = &ct_addrs[_i];
+	struct getter getters[N_THREADS];
+	pthread_barrier_t barrier;
+	struct nfnl_ct *ct, *clone;
+	int round, i, j;
+
+	ct = build_ct(t, 1, 1);
+
+	/* Objects in a cache are looked up concurrently, all readers get
+	 * the same handles and the others are freed */
+	for (round = 0; round < 50; round++) {
+		clone = (struct nfnl_ct *) nl_object_clone((struct nl_object *) ct);
+		ck_assert_ptr_nonnull(clone);
+		ck_assert_int_eq(pthread_barrier_init(&barrier, NULL,
+						      N_THREADS),
+				 0);
+
+		for (i = 0; i < N_THREADS; i++) {
+			getters[i] = (struct getter) {
+				.barrier = &barrier,
+				.ct = clone,
+			};
+			ck_assert_int_eq(pthread_create(&getters[i].thread,
+							NULL, get_addrs,
+							&getters[i]),
+					 0);
+		}
+
+		for (i = 0; i < N_THREADS; i++)
+			ck_assert_int_eq(pthread_join(getters[i].thread, NULL),
+					 0);
+		pthread_barrier_destroy(&barrier);
+
+		for (i = 0; i < N_THREADS; i++)
+			for (j = 0; j < 4; j++)
+				ck_assert_ptr_eq(getters[i].addrs[j],
+						 getters[0].addrs[j]);
+
+		assert_addr(getters[0].addrs[0], t, t->a);
+		assert_addr(getters[0].addrs[1], t, t->b);
+		assert_addr(getters[0].addrs[2], t, t->b);
+		assert_addr(getters[0].addrs[3], t, t->a);
+		nfnl_ct_put(clone);
+	}
+
+	nfnl_ct_put(ct);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_ct_addr_suite(void)
+{
+	Suite *suite = suite_create("Conntrack addresses");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_loop_test(tc, ct_addr_round_trip, 0, _NL_N_ELEMENTS(ct_addrs));
+	tcase_add_loop_test(tc, ct_addr_tuples, 0, _NL_N_ELEMENTS(ct_addrs));
+	tcase_add_test(tc, ct_addr_invalid);
+	tcase_add_loop_test(tc, ct_addr_dump, 0, _NL_N_ELEMENTS(ct_addrs));
+	tcase_add_loop_test(tc, ct_addr_concurrent, 0,
+			    _NL_N_ELEMENTS(ct_addrs));
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -0,0 +1,243 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/rtnetlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/object.h>
+#include <netlink/route/link.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/object-api.h"
+
+/* Enough links to make the index grow */
+#define N_LINKS 300
+
+static struct rtnl_link *build_link(int ifindex, int family, const char *name)
+{
+	struct rtnl_link *link = rtnl_link_alloc();
+
+	rtnl_link_set_ifindex(link, ifindex);
+	rtnl_link_set_family(link, family);
+	rtnl_link_set_name(link, name);
+	OBJ_CAST(link)->ce_msgtype = RTM_NEWLINK;
+
+	return link;
+}
+
+static struct rtnl_link *add_link(struct nl_cache *cache, int ifindex,
+				  int family, const char *name)
+{
+	struct rtnl_link *link = build_link(ifindex, family, name);
+
+	ck_assert_int_eq(nl_cache_add(cache, OBJ_CAST(link)), 0);
+	rtnl_link_put(link);
+
+	return link;
+}
+
+static void assert_lookup(struct nl_cache *cache, int ifindex,
+			  const char *name, struct rtnl_link *expected)
+{
+	struct rtnl_link *link;
+
+	link = rtnl_link_get(cache, ifindex);
+	ck_assert_ptr_eq(link, expected);
+	rtnl_link_put(link);
+
+	link = rtnl_link_get_by_name(cache, name);
+	ck_assert_ptr_eq(link, expected);
+	rtnl_link_put(link);
+}
+
+static const char *link_name(char *buf, size_t len, int i)
+{
+	snprintf(buf, len, "eth%d", i);
+	return buf;
+}
+
+START_TEST(link_lookup_index)
+{
+	struct rtnl_link *links[N_LINKS];
+	struct nl_cache *cache;
+	char buf[IFNAMSIZ];
+	int round, i;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &cache), 0);
+
+	/* The index is kept and reused once the cache has been emptied */
+	for (round = 0; round < 2; round++) {
+		for (i = 0; i < N_LINKS; i++)
+			links[i] = add_link(cache, i + 1, AF_UNSPEC,
+					    link_name(buf, sizeof(buf), i));
+
+		for (i = 0; i < N_LINKS; i++)
+			assert_lookup(cache, i + 1,
+				      link_name(buf, sizeof(buf), i), links[i]);
+
+		assert_lookup(cache, N_LINKS + 1,
+			      link_name(buf, sizeof(buf), N_LINKS), NULL);
+
+		for (i = 0; i < N_LINKS; i += 2)
+			nl_cache_remove(OBJ_CAST(links[i]));
+
+		for (i = 0; i < N_LINKS; i++)
+			assert_lookup(cache, i + 1,
+				      link_name(buf, sizeof(buf), i),
+				      i % 2 ? links[i] : NULL);
+
+		nl_cache_clear(cache);
+		ck_assert_int_eq(nl_cache_nitems(cache), 0);
+		assert_lookup(cache, 2, link_name(buf, sizeof(buf), 1), NULL);
+	}
+
+	nl_cache_free(cache);
+}
+END_TEST
+
+START_TEST(link_lookup_order)
+{
+	struct rtnl_link *bridge, *generic, *bridge2, *generic2;
+	struct nl_cache *cache;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &cache), 0);
+
+	/* The first link of the list wins, like without index */
+	bridge = add_link(cache, 5, AF_BRIDGE, "br0");
+	generic = add_link(cache, 5, AF_UNSPEC, "br0");
+	generic2 = add_link(cache, 6, AF_UNSPEC, "br1");
+	bridge2 = add_link(cache, 6, AF_BRIDGE, "br1");
+
+	assert_lookup(cache, 5, "br0", bridge);
+	assert_lookup(cache, 6, "br1", generic2);
+
+	nl_cache_remove(OBJ_CAST(bridge));
+	nl_cache_remove(OBJ_CAST(generic2));
+
+	assert_lookup(cache, 5, "br0", generic);
+	assert_lookup(cache, 6, "br1", bridge2);
+
+	nl_cache_free(cache);
+}
+END_TEST
+
+START_TEST(link_lookup_rename)
+{
+	struct rtnl_link *link, *found;
+	struct nl_cache *cache;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &cache), 0);
+
+	/* A single link cache keeps its index across replacements */
+	add_link(cache, 7, AF_UNSPEC, "old");
+
+	link = build_link(7, AF_UNSPEC, "new");
+	ck_assert_int_eq(nl_cache_include(cache, OBJ_CAST(link), NULL, NULL),
+			 0);
+	rtnl_link_put(link);
+
+	ck_assert_int_eq(nl_cache_nitems(cache), 1);
+	ck_assert_ptr_null(rtnl_link_get_by_name(cache, "old"));
+
+	found = rtnl_link_get(cache, 7);
+	ck_assert_ptr_nonnull(found);
+	ck_assert_str_eq(rtnl_link_get_name(found), "new");
+	ck_assert_ptr_eq(rtnl_link_get_by_name(cache, "new"), found);
+	rtnl_link_put(found);
+	rtnl_link_put(found);
+
+	nl_cache_free(cache);
+}
+END_TEST
+
+START_TEST(link_lookup_replace_order)
+{
+	struct rtnl_link *generic, *bridge, *link;
+	struct nl_cache *cache;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &cache), 0);
+
+	generic = add_link(cache, 5, AF_UNSPEC, "br0");
+	bridge = add_link(cache, 5, AF_BRIDGE, "br0");
+	add_link(cache, 9, AF_UNSPEC, "eth0");
+
+	/* A replacement takes over the list position */
+	link = build_link(5, AF_UNSPEC, "br0");
+	ck_assert_int_eq(nl_cache_include(cache, OBJ_CAST(link), NULL, NULL),
+			 0);
+	ck_assert_ptr_eq(nl_cache_get_first(cache), OBJ_CAST(link));
+	assert_lookup(cache, 5, "br0", link);
+	rtnl_link_put(link);
+
+	nl_cache_remove(OBJ_CAST(link));
+	assert_lookup(cache, 5, "br0", bridge);
+
+	/* A link added again goes to the end of the list */
+	generic = add_link(cache, 5, AF_UNSPEC, "br0");
+	assert_lookup(cache, 5, "br0", bridge);
+	nl_cache_remove(OBJ_CAST(bridge));
+	assert_lookup(cache, 5, "br0", generic);
+
+	nl_cache_free(cache);
+}
+END_TEST
+
+START_TEST(link_lookup_set_keys)
+{
+	struct rtnl_link *links[3];
+	struct nl_cache *cache;
+	char buf[IFNAMSIZ];
+	int i;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/link", &cache), 0);
+
+	for (i = 0; i < 3; i++)
+		links[i] = add_link(cache, i + 1, AF_UNSPEC,
+				    link_name(buf, sizeof(buf), i));
+
+	/* Cached links are indexed again when their keys change */
+	rtnl_link_set_name(links[1], "wan0");
+	assert_lookup(cache, 2, "wan0", links[1]);
+	ck_assert_ptr_null(rtnl_link_get_by_name(cache, "eth1"));
+
+	rtnl_link_set_ifindex(links[2], 42);
+	assert_lookup(cache, 42, "eth2", links[2]);
+	ck_assert_ptr_null(rtnl_link_get(cache, 3));
+
+	/* Renaming the first link keeps it ahead of a later namesake */
+	rtnl_link_set_name(links[2], "eth0");
+	rtnl_link_set_name(links[0], "eth0");
+	assert_lookup(cache, 1, "eth0", links[0]);
+
+	/* Links outside the cache leave the index alone */
+	rtnl_link_get(cache, 2);
+	nl_cache_remove(OBJ_CAST(links[1]));
+	rtnl_link_set_name(links[1], "lan0");
+	ck_assert_ptr_null(rtnl_link_get_by_name(cache, "lan0"));
+	ck_assert_ptr_null(rtnl_link_get(cache, 2));
+	assert_lookup(cache, 1, "eth0", links[0]);
+	rtnl_link_put(links[1]);
+
+	nl_cache_free(cache);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_link_lookup_suite(void)
+{
+	Suite *suite = suite_create("Link lookup");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, link_lookup_index);
+	tcase_add_test(tc, link_lookup_order);
+	tcase_add_test(tc, link_lookup_rename);
+	tcase_add_test(tc, link_lookup_replace_order);
+	tcase_add_test(tc, link_lookup_set_keys);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -0,0 +1,438 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+#include <pthread.h>
+
+#include <linux/netlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/msg.h>
+#include <netlink/netlink.h>
+#include <netlink/route/link.h>
+#include <netlink/socket.h>
+
+#include "cksuite-all.h"
+
+#define TEST_MSG_TYPE (NLMSG_MIN_TYPE + 1)
+#define N_VETH 10
+
+struct datagram {
+	uint8_t			buf[8192];
+	size_t			len;
+};
+
+/* Appends a message whose payload is filled with @fill */
+static void add_msg(struct datagram *d, uint8_t fill, size_t payload)
+{
+	struct nlmsghdr *nlh = (struct nlmsghdr *) (d->buf + d->len);
+
+	ck_assert_uint_le(d->len + NLMSG_SPACE(payload), sizeof(d->buf));
+	*nlh = (struct nlmsghdr) {
+		.nlmsg_len = NLMSG_LENGTH(payload),
+		.nlmsg_type = TEST_MSG_TYPE,
+		.nlmsg_flags = NLM_F_REQUEST,
+	};
+	memset(NLMSG_DATA(nlh), fill, payload);
+	d->len += NLMSG_SPACE(payload);
+}
+
+static void assert_msg(struct nlmsghdr *nlh, uint8_t fill, size_t payload)
+{
+	const uint8_t *data = NLMSG_DATA(nlh);
+	size_t i;
+
+	ck_assert_int_eq(nlh->nlmsg_type, TEST_MSG_TYPE);
+	ck_assert_uint_eq(nlh->nlmsg_len, NLMSG_LENGTH(payload));
+	for (i = 0; i < payload; i++)
+		ck_assert_int_eq(data[i], fill);
+}
+
+struct peers {
+	struct nl_sock *	tx;
+	struct nl_sock *	rx;
+};
+
+/* Datagrams sent on tx are received on rx */
+static void peers_init(struct peers *p)
+{
+	p->rx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->rx);
+	ck_assert_int_eq(nl_connect(p->rx, NETLINK_USERSOCK), 0);
+	nl_socket_disable_seq_check(p->rx);
+	nl_socket_enable_msg_zerocopy(p->rx);
+
+	p->tx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->tx);
+	ck_assert_int_eq(nl_connect(p->tx, NETLINK_USERSOCK), 0);
+	nl_socket_set_peer_port(p->tx, nl_socket_get_local_port(p->rx));
+}
+
+static void peers_free(struct peers *p)
+{
+	nl_socket_free(p->tx);
+	nl_socket_free(p->rx);
+}
+
+static void send_datagram(struct peers *p, struct datagram *d)
+{
+	ck_assert_int_eq(nl_sendto(p->tx, d->buf, d->len), (int) d->len);
+	d->len = 0;
+}
+
+#define MAX_SEEN 8
+
+struct seen {
+	int			n;
+	int			keep;
+	struct nlmsghdr *	hdr[MAX_SEEN];
+	struct nl_msg *		msg[MAX_SEEN];
+};
+
+static int record_msg(struct nl_msg *msg, void *arg)
+{
+	struct seen *s = arg;
+
+	ck_assert_int_lt(s->n, MAX_SEEN);
+	s->hdr[s->n] = nlmsg_hdr(msg);
+	s->msg[s->n] = msg;
+	if (s->keep)
+		nlmsg_get(msg);
+	s->n++;
+
+	return NL_OK;
+}
+
+static struct nlmsghdr *recv_one(struct peers *p, int keep,
+				 struct nl_msg **msgp)
+{
+	struct seen s = {
+		.keep = keep,
+	};
+
+	ck_assert_int_eq(nl_socket_modify_cb(p->rx, NL_CB_VALID, NL_CB_CUSTOM,
+					     record_msg, &s),
+			 0);
+	ck_assert_int_eq(nl_recvmsgs_default(p->rx), 0);
+	ck_assert_int_eq(s.n, 1);
+	if (msgp)
+		*msgp = s.msg[0];
+
+	return s.hdr[0];
+}
+
+START_TEST(msg_zerocopy_borrow)
+{
+	struct datagram d = { 0 };
+	struct seen s = {
+		.keep = 1,
+	};
+	struct nlmsghdr *nlh;
+	struct nl_cb *cb;
+	struct peers p;
+	int i;
+
+	peers_init(&p);
+	ck_assert_int_eq(nl_socket_modify_cb(p.rx, NL_CB_VALID, NL_CB_CUSTOM,
+					     record_msg, &s),
+			 0);
+
+	for (i = 0; i < 3; i++)
+		add_msg(&d, i + 1, 100 + i);
+	send_datagram(&p, &d);
+	cb = nl_socket_get_cb(p.rx);
+	ck_assert_int_eq(nl_recvmsgs_report(p.rx, cb), 3);
+	nl_cb_put(cb);
+
+	/* The messages are views into one buffer, which outlives the
+	 * receive call as long as they are referenced */
+	ck_assert_int_eq(s.n, 3);
+	for (i = 0; i < 3; i++) {
+		ck_assert_ptr_eq(nlmsg_hdr(s.msg[i]), s.hdr[i]);
+		assert_msg(s.hdr[i], i + 1, 100 + i);
+		if (i > 0)
+			ck_assert_ptr_eq(s.hdr[i],
+					 (char *) s.hdr[i - 1] +
+						 NLMSG_ALIGN(s.hdr[i - 1]->nlmsg_len));
+	}
+
+	/* An explicit copy does not refer to the buffer */
+	nlh = nlmsg_hdr(s.msg[0]);
+	ck_assert_int_eq(nlmsg_expand(s.msg[0], 4096), 0);
+	ck_assert_ptr_ne(nlmsg_hdr(s.msg[0]), nlh);
+	ck_assert_ptr_nonnull(nlmsg_reserve(s.msg[0], 16, NLMSG_ALIGNTO));
+	assert_msg(nlmsg_hdr(s.msg[1]), 2, 101);
+
+	for (i = 0; i < 3; i++)
+		nlmsg_free(s.msg[i]);
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(msg_zerocopy_reuse)
+{
+	struct nlmsghdr *a, *b, *c, *e;
+	struct datagram d = { 0 };
+	struct nl_msg *kept;
+	struct peers p;
+
+	peers_init(&p);
+	nl_socket_enable_recv_buf(p.rx);
+
+	add_msg(&d, 1, 64);
+	send_datagram(&p, &d);
+	a = recv_one(&p, 0, NULL);
+
+	/* Nothing refers to the buffer, it is reused */
+	add_msg(&d, 2, 64);
+	send_datagram(&p, &d);
+	ck_assert_ptr_eq(recv_one(&p, 0, NULL), a);
+
+	add_msg(&d, 3, 64);
+	send_datagram(&p, &d);
+	ck_assert_ptr_eq(recv_one(&p, 1, &kept), a);
+
+	/* A message still held pins the buffer, the next datagram goes to a
+	 * new one */
+	add_msg(&d, 4, 64);
+	send_datagram(&p, &d);
+	b = recv_one(&p, 0, NULL);
+	ck_assert_ptr_ne(b, a);
+	assert_msg(nlmsg_hdr(kept), 3, 64);
+
+	add_msg(&d, 5, 64);
+	send_datagram(&p, &d);
+	c = recv_one(&p, 0, NULL);
+	ck_assert_ptr_eq(c, b);
+
+	/* Dropping the last reference releases the old buffer */
+	nlmsg_free(kept);
+	add_msg(&d, 6, 64);
+	send_datagram(&p, &d);
+	e = recv_one(&p, 0, NULL);
+	ck_assert_ptr_eq(e, b);
+
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(msg_zerocopy_wrapper)
+{
+	struct nl_msg *first, *msg, *kept;
+	struct datagram d = { 0 };
+	struct peers p;
+	int i;
+
+	peers_init(&p);
+	if (_i)
+		nl_socket_enable_recv_buf(p.rx);
+
+	/* Messages nobody kept are wrapped by the same object */
+	add_msg(&d, 1, 64);
+	send_datagram(&p, &d);
+	recv_one(&p, 0, &first);
+	for (i = 0; i < 3; i++) {
+		add_msg(&d, 2, 64);
+		send_datagram(&p, &d);
+		recv_one(&p, 0, &msg);
+		ck_assert_ptr_eq(msg, first);
+	}
+
+	/* A kept message is left alone */
+	add_msg(&d, 3, 64);
+	send_datagram(&p, &d);
+	recv_one(&p, 1, &kept);
+	ck_assert_ptr_eq(kept, first);
+	add_msg(&d, 4, 64);
+	send_datagram(&p, &d);
+	recv_one(&p, 0, &msg);
+	ck_assert_ptr_ne(msg, kept);
+	assert_msg(nlmsg_hdr(kept), 3, 64);
+	nlmsg_free(kept);
+
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(msg_zerocopy_truncated)
+{
+	struct datagram d = { 0 };
+	struct nl_msg *kept;
+	struct peers p;
+
+	peers_init(&p);
+
+	/* Peeking sizes the buffer for the datagram */
+	add_msg(&d, 1, 6000);
+	send_datagram(&p, &d);
+	recv_one(&p, 1, &kept);
+	assert_msg(nlmsg_hdr(kept), 1, 6000);
+	nlmsg_free(kept);
+
+	/* Without peeking, a datagram exceeding the buffer is lost and the
+	 * buffer grows for the next one */
+	nl_socket_set_msg_buf_size(p.rx, 1024);
+	nl_socket_disable_msg_peek(p.rx);
+	nl_socket_enable_recv_buf(p.rx);
+
+	add_msg(&d, 2, 3000);
+	send_datagram(&p, &d);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), -NLE_MSG_TRUNC);
+
+	add_msg(&d, 3, 3000);
+	send_datagram(&p, &d);
+	recv_one(&p, 1, &kept);
+	assert_msg(nlmsg_hdr(kept), 3, 3000);
+	nlmsg_free(kept);
+
+	peers_free(&p);
+}
+END_TEST
+
+#define RING_SIZE 64
+#define N_HANDOFF 20000
+
+/* Messages released by another thread */
+struct ring {
+	struct nl_msg *		msg[RING_SIZE];
+	uint8_t			fill[RING_SIZE];
+	unsigned int		head;
+	unsigned int		tail;
+};
+
+static void ring_push(struct ring *r, struct nl_msg *msg, uint8_t fill)
+{
+	unsigned int head = r->head;
+
+	while (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == RING_SIZE)
+		sched_yield();
+
+	r->msg[head % RING_SIZE] = msg;
+	r->fill[head % RING_SIZE] = fill;
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void *release_msgs(void *arg)
+{
+	struct ring *r = arg;
+	unsigned int tail;
+
+	for (tail = 0; tail < N_HANDOFF; tail++) {
+		while (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == tail)
+			sched_yield();
+
+		/* The buffer is not reused while the message is held */
+		assert_msg(nlmsg_hdr(r->msg[tail % RING_SIZE]),
+			   r->fill[tail % RING_SIZE], 64);
+		nlmsg_free(r->msg[tail % RING_SIZE]);
+		__atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+START_TEST(msg_zerocopy_thread)
+{
+	struct datagram d = { 0 };
+	struct ring r = { 0 };
+	struct seen s = {
+		.keep = 1,
+	};
+	pthread_t thread;
+	struct peers p;
+	int i;
+
+	peers_init(&p);
+	if (_i)
+		nl_socket_enable_recv_buf(p.rx);
+	ck_assert_int_eq(nl_socket_modify_cb(p.rx, NL_CB_VALID, NL_CB_CUSTOM,
+					     record_msg, &s),
+			 0);
+	ck_assert_int_eq(pthread_create(&thread, NULL, release_msgs, &r), 0);
+
+	/* Both messages of a datagram share a buffer, one is released here
+	 * while the other one is released by the thread */
+	for (i = 0; i < N_HANDOFF; i++) {
+		add_msg(&d, i, 64);
+		add_msg(&d, i + 1, 64);
+		send_datagram(&p, &d);
+
+		s.n = 0;
+		ck_assert_int_eq(nl_recvmsgs_default(p.rx), 0);
+		ck_assert_int_eq(s.n, 2);
+		ring_push(&r, s.msg[1], i + 1);
+		assert_msg(nlmsg_hdr(s.msg[0]), i, 64);
+		nlmsg_free(s.msg[0]);
+	}
+
+	ck_assert_int_eq(pthread_join(thread, NULL), 0);
+	peers_free(&p);
+}
+END_TEST
+
+static void add_veths(struct nl_sock *sk)
+{
+	char name[IFNAMSIZ];
+	int i;
+
+	for (i = 0; i < N_VETH; i++) {
+		snprintf(name, sizeof(name), "xveth%d", i);
+		_nltst_add_link(sk, name, "veth", NULL);
+	}
+}
+
+START_TEST(msg_zerocopy_dump)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_nl_cache struct nl_cache *copied = NULL;
+	_nl_auto_nl_cache struct nl_cache *borrowed = NULL;
+	struct nl_object *obj;
+
+	add_veths(sk);
+	ck_assert_int_eq(rtnl_link_alloc_cache(sk, AF_UNSPEC, &copied), 0);
+
+	/* A multipart dump spanning many datagrams parses the same */
+	nl_socket_enable_msg_zerocopy(sk);
+	if (_i)
+		nl_socket_enable_recv_buf(sk);
+	ck_assert_int_eq(rtnl_link_alloc_cache(sk, AF_UNSPEC, &borrowed), 0);
+
+	ck_assert_int_eq(nl_cache_nitems(borrowed), nl_cache_nitems(copied));
+	ck_assert_int_ge(nl_cache_nitems(borrowed), 2 * N_VETH + 1);
+	for (obj = nl_cache_get_first(copied); obj;
+	     obj = nl_cache_get_next(obj)) {
+		_nl_auto_rtnl_link struct rtnl_link *link = NULL;
+
+		link = rtnl_link_get(borrowed, rtnl_link_get_ifindex(
+						       (struct rtnl_link *) obj));
+		ck_assert_ptr_nonnull(link);
+		ck_assert(nl_object_identical(obj, (struct nl_object *) link));
+		ck_assert_str_eq(rtnl_link_get_name(link),
+				 rtnl_link_get_name((struct rtnl_link *) obj));
+	}
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_msg_zerocopy_suite(void)
+{
+	Suite *suite = suite_create("Zero-copy receive");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, msg_zerocopy_borrow);
+	tcase_add_test(tc, msg_zerocopy_reuse);
+	tcase_add_loop_test(tc, msg_zerocopy_wrapper, 0, 2);
+	tcase_add_test(tc, msg_zerocopy_truncated);
+	tcase_add_loop_test(tc, msg_zerocopy_thread, 0, 2);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("Dump");
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_loop_test(tc, msg_zerocopy_dump, 0, 2);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
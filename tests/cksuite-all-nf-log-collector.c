@@ -0,0 +1,287 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_log.h>
+
+#include <netlink/msg.h>
+#include <netlink/netfilter/log_msg.h>
+#include <netlink/netfilter/nfnl.h>
+
+#include "cksuite-all.h"
+
+#define NO_SEQ (-1)
+
+static const uint8_t payload[] = {
+	0x45, 0x00, 0x00, 0x14, 0x00, 0x01, 0x00, 0x00,
+	0x40, 0x06, 0x00, 0x00, 0xc0, 0x00, 0x02, 0x01,
+	0xc0, 0x00, 0x02, 0x02,
+};
+
+static const uint8_t hwheader[14] = {
+	0x02, 0x00, 0x00, 0x00, 0x00, 0x02, 0x02, 0x00,
+	0x00, 0x00, 0x00, 0x01, 0x08, 0x00,
+};
+
+struct datagram {
+	uint8_t			buf[4096];
+	size_t			len;
+};
+
+static void add_msg(struct datagram *d, struct nl_msg *msg)
+{
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+
+	ck_assert_uint_le(d->len + NLMSG_ALIGN(nlh->nlmsg_len),
+			  sizeof(d->buf));
+	memcpy(d->buf + d->len, nlh, nlh->nlmsg_len);
+	d->len += NLMSG_ALIGN(nlh->nlmsg_len);
+	nlmsg_free(msg);
+}
+
+static void add_packet(struct datagram *d, uint16_t group, int64_t seq,
+		       int64_t seq_global, const char *prefix, int with_hwheader)
+{
+	struct nfulnl_msg_packet_hdr hdr = {
+		.hw_protocol = htons(0x0800),
+		.hook = NF_INET_LOCAL_IN,
+	};
+	struct nl_msg *msg;
+
+	msg = nfnlmsg_alloc_simple(NFNL_SUBSYS_ULOG, NFULNL_MSG_PACKET, 0,
+				   AF_INET, group);
+	ck_assert_ptr_nonnull(msg);
+	ck_assert_int_eq(nla_put(msg, NFULA_PACKET_HDR, sizeof(hdr), &hdr), 0);
+	if (prefix)
+		ck_assert_int_eq(nla_put_string(msg, NFULA_PREFIX, prefix), 0);
+	if (with_hwheader)
+		ck_assert_int_eq(nla_put(msg, NFULA_HWHEADER, sizeof(hwheader),
+					 hwheader),
+				 0);
+	if (seq != NO_SEQ)
+		ck_assert_int_eq(nla_put_u32(msg, NFULA_SEQ, htonl(seq)), 0);
+	if (seq_global != NO_SEQ)
+		ck_assert_int_eq(nla_put_u32(msg, NFULA_SEQ_GLOBAL,
+					     htonl(seq_global)),
+				 0);
+	ck_assert_int_eq(nla_put(msg, NFULA_PAYLOAD, sizeof(payload), payload),
+			 0);
+
+	add_msg(d, msg);
+}
+
+struct peers {
+	struct nl_sock *	tx;
+	struct nl_sock *	rx;
+};
+
+/* Log messages sent on tx are received on rx instead of from the kernel */
+static void peers_init(struct peers *p)
+{
+	p->rx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->rx);
+	ck_assert_int_eq(nl_connect(p->rx, NETLINK_NETFILTER), 0);
+
+	p->tx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->tx);
+	ck_assert_int_eq(nl_connect(p->tx, NETLINK_NETFILTER), 0);
+	nl_socket_set_peer_port(p->tx, nl_socket_get_local_port(p->rx));
+}
+
+static void peers_free(struct peers *p)
+{
+	nl_socket_free(p->tx);
+	nl_socket_free(p->rx);
+}
+
+static void send_datagram(struct peers *p, struct datagram *d)
+{
+	ck_assert_int_eq(nl_sendto(p->tx, d->buf, d->len), (int) d->len);
+	d->len = 0;
+}
+
+#define MAX_SEEN 8
+
+struct seen {
+	int			n;
+	struct nfnl_log_msg *	msg[MAX_SEEN];
+	const char *		prefix[MAX_SEEN];
+	char			prefix_buf[MAX_SEEN][16];
+	int			hwheader_len[MAX_SEEN];
+	int			keep;
+	struct nfnl_log_msg *	kept;
+};
+
+static void record_msg(struct nfnl_log_msg *msg, void *arg)
+{
+	struct seen *s = arg;
+	const void *data;
+	int len;
+
+	ck_assert_int_lt(s->n, MAX_SEEN);
+	s->msg[s->n] = msg;
+	s->prefix[s->n] = nfnl_log_msg_get_prefix(msg);
+	if (s->prefix[s->n])
+		snprintf(s->prefix_buf[s->n], sizeof(s->prefix_buf[0]), "%s",
+			 s->prefix[s->n]);
+	nfnl_log_msg_get_hwheader(msg, &s->hwheader_len[s->n]);
+
+	data = nfnl_log_msg_get_payload(msg, &len);
+	ck_assert_int_eq(len, sizeof(payload));
+	ck_assert_mem_eq(data, payload, sizeof(payload));
+
+	if (s->keep && s->n + 1 == s->keep) {
+		nfnl_log_msg_get(msg);
+		s->kept = msg;
+	}
+
+	s->n++;
+}
+
+START_TEST(nf_log_collector_reuse)
+{
+	struct nfnl_log_collector *lc;
+	struct datagram d = { 0 };
+	struct seen s = { 0 };
+	struct nl_msg *msg;
+	struct peers p;
+
+	peers_init(&p);
+	lc = nfnl_log_collector_alloc(p.rx, record_msg, &s);
+	ck_assert_ptr_nonnull(lc);
+
+	add_packet(&d, 1, 1, NO_SEQ, "drop", 1);
+	add_packet(&d, 1, 2, NO_SEQ, "drop", 1);
+
+	/* Other messages of the subsystem are skipped */
+	msg = nfnlmsg_alloc_simple(NFNL_SUBSYS_ULOG, NFULNL_MSG_CONFIG, 0,
+				   AF_INET, 1);
+	ck_assert_ptr_nonnull(msg);
+	add_msg(&d, msg);
+
+	add_packet(&d, 1, 3, NO_SEQ, NULL, 0);
+	send_datagram(&p, &d);
+
+	ck_assert_int_ge(nfnl_log_collector_recv(lc), 0);
+	ck_assert_int_eq(s.n, 3);
+	ck_assert_uint_eq(nfnl_log_collector_get_received(lc), 3);
+
+	/* One object for all messages, the prefix buffer is kept while the
+	 * prefix does not change */
+	ck_assert_ptr_eq(s.msg[1], s.msg[0]);
+	ck_assert_ptr_eq(s.msg[2], s.msg[0]);
+	ck_assert_str_eq(s.prefix_buf[0], "drop");
+	ck_assert_ptr_eq(s.prefix[1], s.prefix[0]);
+	ck_assert_int_eq(s.hwheader_len[0], sizeof(hwheader));
+	ck_assert_int_eq(s.hwheader_len[1], sizeof(hwheader));
+
+	/* Nothing is left over from a previous message */
+	ck_assert_ptr_null(s.prefix[2]);
+	ck_assert_int_eq(s.hwheader_len[2], 0);
+
+	nfnl_log_collector_free(lc);
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(nf_log_collector_ref)
+{
+	struct nfnl_log_collector *lc;
+	struct datagram d = { 0 };
+	struct seen s = {
+		.keep = 2,
+	};
+	const void *data;
+	struct peers p;
+	int len;
+
+	peers_init(&p);
+	lc = nfnl_log_collector_alloc(p.rx, record_msg, &s);
+	ck_assert_ptr_nonnull(lc);
+
+	add_packet(&d, 1, 1, NO_SEQ, "first", 0);
+	add_packet(&d, 1, 2, NO_SEQ, "second", 1);
+	add_packet(&d, 1, 3, NO_SEQ, "third", 0);
+	send_datagram(&p, &d);
+
+	ck_assert_int_ge(nfnl_log_collector_recv(lc), 0);
+	ck_assert_int_eq(s.n, 3);
+
+	/* The referenced object is replaced by a fresh one */
+	ck_assert_ptr_eq(s.msg[1], s.msg[0]);
+	ck_assert_ptr_ne(s.msg[2], s.kept);
+
+	/* and keeps its attributes and the receive buffer */
+	nfnl_log_collector_free(lc);
+	peers_free(&p);
+
+	ck_assert_ptr_eq(s.kept, s.msg[1]);
+	ck_assert_str_eq(nfnl_log_msg_get_prefix(s.kept), "second");
+	ck_assert_uint_eq(nfnl_log_msg_get_seq(s.kept), 2);
+	ck_assert(nfnl_log_msg_test_hwheader(s.kept));
+	data = nfnl_log_msg_get_payload(s.kept, &len);
+	ck_assert_int_eq(len, sizeof(payload));
+	ck_assert_mem_eq(data, payload, sizeof(payload));
+	nfnl_log_msg_put(s.kept);
+}
+END_TEST
+
+START_TEST(nf_log_collector_lost)
+{
+	struct nfnl_log_collector *lc;
+	struct datagram d = { 0 };
+	struct seen s = { 0 };
+	struct peers p;
+
+	peers_init(&p);
+	lc = nfnl_log_collector_alloc(p.rx, record_msg, &s);
+	ck_assert_ptr_nonnull(lc);
+
+	/* Sequence numbers are tracked per group */
+	add_packet(&d, 1, 1, 1, NULL, 0);
+	add_packet(&d, 2, 10, 2, NULL, 0);
+	add_packet(&d, 1, 2, 3, NULL, 0);
+	add_packet(&d, 2, 11, 7, NULL, 0);
+	add_packet(&d, 1, 5, 8, NULL, 0);
+	send_datagram(&p, &d);
+
+	ck_assert_int_ge(nfnl_log_collector_recv(lc), 0);
+	ck_assert_uint_eq(nfnl_log_collector_get_received(lc), 5);
+	ck_assert_uint_eq(nfnl_log_collector_get_lost(lc), 2);
+	ck_assert_uint_eq(nfnl_log_collector_get_lost_global(lc), 3);
+
+	/* A restarted instance counts from the start again, messages without
+	 * sequence numbers are not accounted */
+	add_packet(&d, 2, 0, NO_SEQ, NULL, 0);
+	add_packet(&d, 2, 1, NO_SEQ, NULL, 0);
+	add_packet(&d, 1, NO_SEQ, NO_SEQ, NULL, 0);
+	send_datagram(&p, &d);
+
+	ck_assert_int_ge(nfnl_log_collector_recv(lc), 0);
+	ck_assert_uint_eq(nfnl_log_collector_get_received(lc), 8);
+	ck_assert_uint_eq(nfnl_log_collector_get_lost(lc), 2);
+	ck_assert_uint_eq(nfnl_log_collector_get_lost_global(lc), 3);
+
+	nfnl_log_collector_free(lc);
+	peers_free(&p);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_nf_log_collector_suite(void)
+{
+	Suite *suite = suite_create("NFLOG collector");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, nf_log_collector_reuse);
+	tcase_add_test(tc, nf_log_collector_ref);
+	tcase_add_test(tc, nf_log_collector_lost);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
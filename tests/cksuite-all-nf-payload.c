@@ -0,0 +1,241 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_log.h>
+#include <linux/netfilter/nfnetlink_queue.h>
+
+#include <netlink/msg.h>
+#include <netlink/object.h>
+#include <netlink/netfilter/log_msg.h>
+#include <netlink/netfilter/nfnl.h>
+#include <netlink/netfilter/queue_msg.h>
+
+#include "cksuite-all.h"
+
+#define QUEUENUM 3
+
+static const uint8_t payload[] = {
+	0x45, 0x00, 0x00, 0x1c, 0x00, 0x01, 0x00, 0x00,
+	0x40, 0x11, 0x00, 0x00, 0xc0, 0x00, 0x02, 0x01,
+	0xc0, 0x00, 0x02, 0x02, 0x04, 0xd2, 0x16, 0x2e,
+	0x00, 0x08, 0x00, 0x00,
+};
+
+static struct nl_msg *build_queue_packet(uint32_t id)
+{
+	struct nfqnl_msg_packet_hdr hdr = {
+		.packet_id = htonl(id),
+		.hw_protocol = htons(0x0800),
+		.hook = NF_INET_LOCAL_IN,
+	};
+	struct nl_msg *msg;
+
+	msg = nfnlmsg_alloc_simple(NFNL_SUBSYS_QUEUE, NFQNL_MSG_PACKET, 0,
+				   AF_INET, QUEUENUM);
+	ck_assert_ptr_nonnull(msg);
+	nlmsg_set_proto(msg, NETLINK_NETFILTER);
+	ck_assert_int_eq(nla_put(msg, NFQA_PACKET_HDR, sizeof(hdr), &hdr), 0);
+	ck_assert_int_eq(nla_put(msg, NFQA_PAYLOAD, sizeof(payload), payload),
+			 0);
+
+	return msg;
+}
+
+static struct nl_msg *build_log_packet(void)
+{
+	struct nfulnl_msg_packet_hdr hdr = {
+		.hw_protocol = htons(0x0800),
+		.hook = NF_INET_LOCAL_IN,
+	};
+	struct nl_msg *msg;
+
+	msg = nfnlmsg_alloc_simple(NFNL_SUBSYS_ULOG, NFULNL_MSG_PACKET, 0,
+				   AF_INET, QUEUENUM);
+	ck_assert_ptr_nonnull(msg);
+	nlmsg_set_proto(msg, NETLINK_NETFILTER);
+	ck_assert_int_eq(nla_put(msg, NFULA_PACKET_HDR, sizeof(hdr), &hdr), 0);
+	ck_assert_int_eq(nla_put(msg, NFULA_PAYLOAD, sizeof(payload), payload),
+			 0);
+
+	return msg;
+}
+
+static const void *msg_payload(struct nl_msg *msg, int attrtype)
+{
+	struct nlattr *attr;
+
+	attr = nlmsg_find_attr(nlmsg_hdr(msg), sizeof(struct nfgenmsg),
+			       attrtype);
+	ck_assert_ptr_nonnull(attr);
+
+	return nla_data(attr);
+}
+
+static void assert_payload(const void *data, int len)
+{
+	ck_assert_ptr_nonnull(data);
+	ck_assert_int_eq(len, sizeof(payload));
+	ck_assert_mem_eq(data, payload, sizeof(payload));
+}
+
+START_TEST(nf_payload_queue)
+{
+	struct nfnl_queue_msg *qmsg, *clone;
+	struct nl_msg *msg;
+	const void *data;
+	uint8_t other[4] = { 0 };
+	int len;
+
+	/* The copying parser owns a copy of the payload */
+	msg = build_queue_packet(1);
+	ck_assert_int_eq(nfnlmsg_queue_msg_parse(nlmsg_hdr(msg), &qmsg), 0);
+	data = nfnl_queue_msg_get_payload(qmsg, &len);
+	assert_payload(data, len);
+	ck_assert_ptr_ne(data, msg_payload(msg, NFQA_PAYLOAD));
+	nfnl_queue_msg_put(qmsg);
+	nlmsg_free(msg);
+
+	msg = build_queue_packet(2);
+	ck_assert_int_eq(nfnlmsg_queue_msg_parse_zerocopy(msg, &qmsg), 0);
+	ck_assert_uint_eq(nfnl_queue_msg_get_packetid(qmsg), 2);
+	data = nfnl_queue_msg_get_payload(qmsg, &len);
+	assert_payload(data, len);
+	ck_assert_ptr_eq(data, msg_payload(msg, NFQA_PAYLOAD));
+
+	/* Clones share the payload, which outlives the message and the
+	 * object it was parsed into */
+	clone = (struct nfnl_queue_msg *) nl_object_clone((struct nl_object *) qmsg);
+	ck_assert_ptr_nonnull(clone);
+	ck_assert_ptr_eq(nfnl_queue_msg_get_payload(clone, &len), data);
+	nlmsg_free(msg);
+	nfnl_queue_msg_put(qmsg);
+	assert_payload(nfnl_queue_msg_get_payload(clone, &len), len);
+
+	/* Replacing the payload drops the reference to the message */
+	ck_assert_int_eq(nfnl_queue_msg_set_payload(clone, other,
+						    sizeof(other)), 0);
+	ck_assert_ptr_ne(nfnl_queue_msg_get_payload(clone, &len), data);
+	ck_assert_int_eq(len, sizeof(other));
+	nfnl_queue_msg_put(clone);
+}
+END_TEST
+
+START_TEST(nf_payload_log)
+{
+	struct nfnl_log_msg *lmsg, *clone;
+	struct nl_msg *msg;
+	const void *data;
+	int len;
+
+	msg = build_log_packet();
+	ck_assert_int_eq(nfnlmsg_log_msg_parse(nlmsg_hdr(msg), &lmsg), 0);
+	data = nfnl_log_msg_get_payload(lmsg, &len);
+	assert_payload(data, len);
+	ck_assert_ptr_ne(data, msg_payload(msg, NFULA_PAYLOAD));
+	nfnl_log_msg_put(lmsg);
+
+	ck_assert_int_eq(nfnlmsg_log_msg_parse_zerocopy(msg, &lmsg), 0);
+	ck_assert_int_eq(nfnl_log_msg_get_hook(lmsg), NF_INET_LOCAL_IN);
+	data = nfnl_log_msg_get_payload(lmsg, &len);
+	assert_payload(data, len);
+	ck_assert_ptr_eq(data, msg_payload(msg, NFULA_PAYLOAD));
+
+	clone = (struct nfnl_log_msg *) nl_object_clone((struct nl_object *) lmsg);
+	ck_assert_ptr_nonnull(clone);
+	nlmsg_free(msg);
+	nfnl_log_msg_put(lmsg);
+	ck_assert_ptr_eq(nfnl_log_msg_get_payload(clone, &len), data);
+	assert_payload(data, len);
+	nfnl_log_msg_put(clone);
+}
+END_TEST
+
+struct received {
+	struct nl_object *	obj;
+	const void *		start;
+	const void *		end;
+};
+
+static void parse_obj(struct nl_object *obj, void *arg)
+{
+	struct received *r = arg;
+
+	nl_object_get(obj);
+	r->obj = obj;
+}
+
+static int recv_valid(struct nl_msg *msg, void *arg)
+{
+	struct received *r = arg;
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+
+	r->start = nlh;
+	r->end = (char *) nlh + nlh->nlmsg_len;
+	ck_assert_int_eq(nl_msg_parse(msg, parse_obj, r), 0);
+
+	return NL_OK;
+}
+
+START_TEST(nf_payload_socket)
+{
+	struct received r = { 0 };
+	struct nl_sock *tx, *rx;
+	struct nl_msg *msg;
+	const void *data;
+	int len;
+
+	rx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(rx);
+	ck_assert_int_eq(nl_connect(rx, NETLINK_NETFILTER), 0);
+	nl_socket_disable_seq_check(rx);
+	nl_socket_enable_msg_zerocopy(rx);
+	ck_assert_int_eq(nl_socket_modify_cb(rx, NL_CB_VALID, NL_CB_CUSTOM,
+					     recv_valid, &r),
+			 0);
+
+	tx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(tx);
+	ck_assert_int_eq(nl_connect(tx, NETLINK_NETFILTER), 0);
+	nl_socket_disable_auto_ack(tx);
+	nl_socket_set_peer_port(tx, nl_socket_get_local_port(rx));
+
+	msg = build_queue_packet(7);
+	ck_assert_int_ge(nl_send_auto(tx, msg), 0);
+	nlmsg_free(msg);
+
+	ck_assert_int_ge(nl_recvmsgs_default(rx), 0);
+	ck_assert_ptr_nonnull(r.obj);
+
+	/* Parsed from a message delivered without copying, the payload
+	 * stays in the receive buffer */
+	data = nfnl_queue_msg_get_payload((struct nfnl_queue_msg *) r.obj,
+					  &len);
+	assert_payload(data, len);
+	ck_assert((const char *) data > (const char *) r.start &&
+		  (const char *) data + len <= (const char *) r.end);
+
+	nl_object_put(r.obj);
+	nl_socket_free(tx);
+	nl_socket_free(rx);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_nf_payload_suite(void)
+{
+	Suite *suite = suite_create("Netfilter payloads");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, nf_payload_queue);
+	tcase_add_test(tc, nf_payload_log);
+	tcase_add_test(tc, nf_payload_socket);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
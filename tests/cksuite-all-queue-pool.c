@@ -0,0 +1,226 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+#include <pthread.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_queue.h>
+
+#include <netlink/msg.h>
+#include <netlink/netfilter/nfnl.h>
+#include <netlink/netfilter/queue.h>
+#include <netlink/netfilter/queue_msg.h>
+
+#include "cksuite-all.h"
+
+#define QUEUENUM 5
+
+struct packets {
+	pthread_t		stopper;
+	int			stopping;
+	int			nfunc;
+	int			nstopper;
+};
+
+static int count_packet(struct nfnl_queue_msg *msg, void *arg)
+{
+	struct packets *p = arg;
+
+	__atomic_add_fetch(&p->nfunc, 1, __ATOMIC_RELAXED);
+	if (__atomic_load_n(&p->stopping, __ATOMIC_ACQUIRE) &&
+	    pthread_equal(pthread_self(), p->stopper))
+		__atomic_add_fetch(&p->nstopper, 1, __ATOMIC_RELAXED);
+
+	return NF_ACCEPT;
+}
+
+static struct nfnl_queue_pool *start_pool(struct packets *p)
+{
+	struct nfnl_queue *queue = nfnl_queue_alloc();
+	struct nfnl_queue_pool *pool;
+
+	ck_assert_ptr_nonnull(queue);
+	nfnl_queue_set_group(queue, QUEUENUM);
+	nfnl_queue_set_copy_mode(queue, NFNL_QUEUE_COPY_PACKET);
+	nfnl_queue_set_copy_range(queue, 0xFFFF);
+
+	pool = nfnl_queue_pool_alloc(queue, 1);
+	nfnl_queue_put(queue);
+	ck_assert_ptr_nonnull(pool);
+	ck_assert_int_eq(nfnl_queue_pool_start(pool, count_packet, p), 0);
+
+	return pool;
+}
+
+/* Port the kernel delivers the packets of the queue to */
+static uint32_t queue_peer_port(void)
+{
+	unsigned int num, portid;
+	uint32_t port = 0;
+	char line[256];
+	FILE *f;
+
+	f = fopen("/proc/net/netfilter/nfnetlink_queue", "r");
+	ck_assert_ptr_nonnull(f);
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "%u %u", &num, &portid) == 2 &&
+		    num == QUEUENUM)
+			port = portid;
+	fclose(f);
+	ck_assert_uint_ne(port, 0);
+
+	return port;
+}
+
+/* Packet messages sent on tx are received by the pool instead of the
+ * packets of the kernel */
+static struct nl_sock *packet_sender(void)
+{
+	struct nl_sock *tx;
+
+	tx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(tx);
+	ck_assert_int_eq(nl_connect(tx, NETLINK_NETFILTER), 0);
+	nl_socket_disable_auto_ack(tx);
+	nl_socket_set_peer_port(tx, queue_peer_port());
+
+	return tx;
+}
+
+static int send_packet(struct nl_sock *tx, uint32_t id)
+{
+	struct nfqnl_msg_packet_hdr hdr = {
+		.packet_id = htonl(id),
+		.hw_protocol = htons(0x0800),
+		.hook = NF_INET_LOCAL_IN,
+	};
+	struct nl_msg *msg;
+	int err;
+
+	msg = nfnlmsg_alloc_simple(NFNL_SUBSYS_QUEUE, NFQNL_MSG_PACKET, 0,
+				   AF_INET, QUEUENUM);
+	ck_assert_ptr_nonnull(msg);
+	ck_assert_int_eq(nla_put(msg, NFQA_PACKET_HDR, sizeof(hdr), &hdr), 0);
+	err = nl_send_auto(tx, msg);
+	nlmsg_free(msg);
+
+	return err;
+}
+
+static void wait_packets(struct nfnl_queue_pool *pool, uint64_t n)
+{
+	int i;
+
+	for (i = 0; i < 5000; i++) {
+		if (nfnl_queue_pool_get_packets(pool, 0) >= n)
+			break;
+		usleep(1000);
+	}
+	ck_assert_uint_eq(nfnl_queue_pool_get_packets(pool, 0), n);
+}
+
+START_TEST(queue_pool_lost)
+{
+	struct packets p = { 0 };
+	struct nfnl_queue_pool *pool;
+	struct nl_sock *tx;
+
+	pool = start_pool(&p);
+	tx = packet_sender();
+
+	ck_assert_int_ge(send_packet(tx, 1), 0);
+	ck_assert_int_ge(send_packet(tx, 2), 0);
+	wait_packets(pool, 2);
+	ck_assert_uint_eq(nfnl_queue_pool_get_lost(pool, 0), 0);
+
+	/* Only packets the kernel failed to deliver leave a gap */
+	ck_assert_int_ge(send_packet(tx, 5), 0);
+	ck_assert_int_ge(send_packet(tx, 6), 0);
+	wait_packets(pool, 4);
+	ck_assert_uint_eq(nfnl_queue_pool_get_lost(pool, 0), 2);
+	ck_assert_uint_eq(nfnl_queue_pool_get_overruns(pool, 0), 0);
+	ck_assert_uint_eq(nfnl_queue_pool_get_verdict_errors(pool, 0), 0);
+	ck_assert_int_eq(p.nfunc, 4);
+
+	nl_socket_free(tx);
+	nfnl_queue_pool_free(pool);
+}
+END_TEST
+
+struct sender {
+	struct nl_sock *	tx;
+	int			stop;
+	int			nsent;
+};
+
+static void *send_packets(void *arg)
+{
+	struct sender *s = arg;
+	uint32_t id = 1;
+
+	/* Paced to not overrun the receive buffer, which would drop the
+	 * acknowledgement of the unbind request instead */
+	while (!__atomic_load_n(&s->stop, __ATOMIC_RELAXED)) {
+		if (send_packet(s->tx, id++) >= 0)
+			__atomic_add_fetch(&s->nsent, 1, __ATOMIC_RELAXED);
+		usleep(10);
+	}
+
+	return NULL;
+}
+
+START_TEST(queue_pool_stop)
+{
+	struct packets p = {
+		.stopper = pthread_self(),
+	};
+	struct nfnl_queue_pool *pool;
+	struct sender s;
+	pthread_t thread;
+	int i;
+
+	/* Packets keep arriving while the pool is stopped, only the workers
+	 * pass them to the function */
+	for (i = 0; i < 20; i++) {
+		pool = start_pool(&p);
+		s = (struct sender) {
+			.tx = packet_sender(),
+		};
+		ck_assert_int_eq(pthread_create(&thread, NULL, send_packets,
+						&s),
+				 0);
+		while (__atomic_load_n(&s.nsent, __ATOMIC_RELAXED) < 100)
+			sched_yield();
+
+		__atomic_store_n(&p.stopping, 1, __ATOMIC_RELEASE);
+		nfnl_queue_pool_free(pool);
+		__atomic_store_n(&p.stopping, 0, __ATOMIC_RELEASE);
+
+		__atomic_store_n(&s.stop, 1, __ATOMIC_RELAXED);
+		ck_assert_int_eq(pthread_join(thread, NULL), 0);
+		nl_socket_free(s.tx);
+	}
+
+	ck_assert_int_gt(p.nfunc, 0);
+	ck_assert_int_eq(p.nstopper, 0);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_queue_pool_suite(void)
+{
+	Suite *suite = suite_create("Queue pools");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_test(tc, queue_pool_lost);
+	tcase_add_test(tc, queue_pool_stop);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
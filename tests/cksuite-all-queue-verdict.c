@@ -0,0 +1,263 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_queue.h>
+
+#include <netlink/msg.h>
+#include <netlink/netfilter/nfnl.h>
+#include <netlink/netfilter/queue_msg.h>
+
+#include "cksuite-all.h"
+
+#define QUEUENUM 7
+
+struct verdict {
+	int			type;
+	uint32_t		id;
+	uint32_t		verdict;
+	int			has_mark;
+	uint32_t		mark;
+};
+
+struct peers {
+	struct nl_sock *	tx;
+	struct nl_sock *	rx;
+};
+
+/* Verdicts sent on tx are received on rx instead of the kernel */
+static void peers_init(struct peers *p)
+{
+	p->rx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->rx);
+	ck_assert_int_eq(nl_connect(p->rx, NETLINK_NETFILTER), 0);
+	ck_assert_int_eq(nl_socket_set_nonblocking(p->rx), 0);
+
+	p->tx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->tx);
+	ck_assert_int_eq(nl_connect(p->tx, NETLINK_NETFILTER), 0);
+	nl_socket_set_peer_port(p->tx, nl_socket_get_local_port(p->rx));
+}
+
+static void peers_free(struct peers *p)
+{
+	nl_socket_free(p->tx);
+	nl_socket_free(p->rx);
+}
+
+/* Parses the next datagram, returns the number of verdicts or 0 */
+static int recv_verdicts(struct nl_sock *sk, struct verdict *v, int max)
+{
+	_nl_auto_free unsigned char *buf = NULL;
+	struct sockaddr_nl nla;
+	struct nlattr *tb[NFQA_MAX + 1];
+	struct nfqnl_msg_verdict_hdr *hdr;
+	struct nlmsghdr *nlh;
+	int n = 0, len;
+
+	len = nl_recv(sk, &nla, &buf, NULL);
+	if (len == -NLE_AGAIN)
+		return 0;
+	ck_assert_int_gt(len, 0);
+
+	for (nlh = (struct nlmsghdr *) buf; nlmsg_ok(nlh, len);
+	     nlh = nlmsg_next(nlh, &len)) {
+		ck_assert_int_lt(n, max);
+		ck_assert_int_eq(NFNL_SUBSYS_ID(nlh->nlmsg_type),
+				 NFNL_SUBSYS_QUEUE);
+		ck_assert_int_eq(nlh->nlmsg_flags, NLM_F_REQUEST);
+		ck_assert_int_eq(ntohs(((struct nfgenmsg *) nlmsg_data(nlh))->res_id),
+				 QUEUENUM);
+		ck_assert_int_eq(nlmsg_parse(nlh, sizeof(struct nfgenmsg), tb,
+					     NFQA_MAX, NULL),
+				 0);
+		ck_assert_ptr_nonnull(tb[NFQA_VERDICT_HDR]);
+
+		hdr = nla_data(tb[NFQA_VERDICT_HDR]);
+		v[n] = (struct verdict) {
+			.type = NFNL_MSG_TYPE(nlh->nlmsg_type),
+			.id = ntohl(hdr->id),
+			.verdict = ntohl(hdr->verdict),
+			.has_mark = !!tb[NFQA_MARK],
+			.mark = tb[NFQA_MARK] ? ntohl(nla_get_u32(tb[NFQA_MARK])) : 0,
+		};
+		n++;
+	}
+	ck_assert_int_eq(len, 0);
+
+	return n;
+}
+
+static void assert_verdict(const struct verdict *v, int type, uint32_t id,
+			   uint32_t verdict)
+{
+	ck_assert_int_eq(v->type, type);
+	ck_assert_uint_eq(v->id, id);
+	ck_assert_uint_eq(v->verdict, verdict);
+}
+
+START_TEST(queue_verdict_batch)
+{
+	struct nfnl_queue_verdict_buf *vb;
+	struct nfnl_queue_msg *msg;
+	struct verdict v[16];
+	struct peers p;
+	uint32_t id;
+
+	peers_init(&p);
+	vb = nfnl_queue_verdict_buf_alloc(p.tx, AF_INET, QUEUENUM);
+	ck_assert_ptr_nonnull(vb);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_set_limits(vb, 64, 0), 0);
+
+	/* Nothing pending, nothing sent */
+	ck_assert_int_eq(nfnl_queue_verdict_buf_flush(vb), 0);
+	ck_assert_int_eq(recv_verdicts(p.rx, v, 16), 0);
+
+	for (id = 1; id <= 10; id++)
+		ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, id, NF_ACCEPT),
+				 0);
+	ck_assert_int_eq(recv_verdicts(p.rx, v, 16), 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_flush(vb), 0);
+
+	/* Consecutive accepts share one batch verdict */
+	ck_assert_int_eq(recv_verdicts(p.rx, v, 16), 1);
+	assert_verdict(&v[0], NFQNL_MSG_VERDICT_BATCH, 10, NF_ACCEPT);
+
+	msg = nfnl_queue_msg_alloc();
+	nfnl_queue_msg_set_group(msg, QUEUENUM);
+	nfnl_queue_msg_set_packetid(msg, 14);
+	nfnl_queue_msg_set_verdict(msg, NF_ACCEPT);
+	nfnl_queue_msg_set_mark(msg, 0x42);
+
+	ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, 11, NF_ACCEPT), 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, 12, NF_DROP), 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, 13, NF_DROP), 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_add_msg(vb, msg), 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, 16, NF_ACCEPT), 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, 15, NF_DROP), 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, 17, NF_ACCEPT), 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_flush(vb), 0);
+
+	ck_assert_int_eq(recv_verdicts(p.rx, v, 16), 6);
+	assert_verdict(&v[0], NFQNL_MSG_VERDICT_BATCH, 11, NF_ACCEPT);
+	assert_verdict(&v[1], NFQNL_MSG_VERDICT_BATCH, 13, NF_DROP);
+
+	/* A mark is only set for its own packet */
+	assert_verdict(&v[2], NFQNL_MSG_VERDICT, 14, NF_ACCEPT);
+	ck_assert(v[2].has_mark);
+	ck_assert_uint_eq(v[2].mark, 0x42);
+
+	/* An earlier packet must not end a batch covering it */
+	assert_verdict(&v[3], NFQNL_MSG_VERDICT_BATCH, 16, NF_ACCEPT);
+	assert_verdict(&v[4], NFQNL_MSG_VERDICT, 15, NF_DROP);
+	assert_verdict(&v[5], NFQNL_MSG_VERDICT_BATCH, 17, NF_ACCEPT);
+
+	/* Queue messages of another queue are rejected */
+	nfnl_queue_msg_set_group(msg, QUEUENUM + 1);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_add_msg(vb, msg), -NLE_INVAL);
+
+	nfnl_queue_msg_put(msg);
+	nfnl_queue_verdict_buf_free(vb);
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(queue_verdict_limits)
+{
+	struct nfnl_queue_verdict_buf *vb;
+	struct verdict v[8];
+	struct peers p;
+	uint32_t id;
+	int timeout;
+
+	peers_init(&p);
+	vb = nfnl_queue_verdict_buf_alloc(p.tx, AF_INET, QUEUENUM);
+	ck_assert_ptr_nonnull(vb);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_set_limits(vb, 0, 0),
+			 -NLE_RANGE);
+
+	/* Every fourth verdict flushes the buffer, the drops alternating
+	 * with accepts each need a message */
+	ck_assert_int_eq(nfnl_queue_verdict_buf_set_limits(vb, 4, 0), 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_timeout(vb), -1);
+
+	for (id = 1; id <= 9; id++)
+		ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, id, id % 2 ?
+							    NF_ACCEPT : NF_DROP),
+				 0);
+
+	ck_assert_int_eq(recv_verdicts(p.rx, v, 8), 4);
+	assert_verdict(&v[3], NFQNL_MSG_VERDICT_BATCH, 4, NF_DROP);
+	ck_assert_int_eq(recv_verdicts(p.rx, v, 8), 4);
+	assert_verdict(&v[3], NFQNL_MSG_VERDICT_BATCH, 8, NF_DROP);
+	ck_assert_int_eq(recv_verdicts(p.rx, v, 8), 0);
+
+	/* Resizing sends the pending verdict */
+	ck_assert_int_eq(nfnl_queue_verdict_buf_set_limits(vb, 64, 1000), 0);
+	ck_assert_int_eq(recv_verdicts(p.rx, v, 8), 1);
+	assert_verdict(&v[0], NFQNL_MSG_VERDICT_BATCH, 9, NF_ACCEPT);
+
+	ck_assert_int_eq(nfnl_queue_verdict_buf_timeout(vb), -1);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, 10, NF_ACCEPT), 0);
+	timeout = nfnl_queue_verdict_buf_timeout(vb);
+	ck_assert_int_gt(timeout, 0);
+	ck_assert_int_le(timeout, 1000);
+
+	nfnl_queue_verdict_buf_free(vb);
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(queue_verdict_sndbuf)
+{
+	struct nfnl_queue_verdict_buf *vb;
+	struct verdict v[256];
+	struct peers p;
+	uint32_t id;
+	int n, total = 0;
+
+	peers_init(&p);
+	ck_assert_int_eq(nl_socket_set_buffer_size(p.rx, 1 << 20, 0), 0);
+	ck_assert_int_eq(nl_socket_set_buffer_size(p.tx, 0, 4096), 0);
+	vb = nfnl_queue_verdict_buf_alloc(p.tx, AF_INET, QUEUENUM);
+	ck_assert_ptr_nonnull(vb);
+
+	/* The limit is reduced to what the send buffer accepts */
+	ck_assert_int_eq(nfnl_queue_verdict_buf_set_limits(vb, 65536, 0), 0);
+	for (id = 1; id <= 2000; id++)
+		ck_assert_int_eq(nfnl_queue_verdict_buf_add(vb, id, id % 2 ?
+							    NF_ACCEPT : NF_DROP),
+				 0);
+	ck_assert_int_eq(nfnl_queue_verdict_buf_flush(vb), 0);
+
+	while ((n = recv_verdicts(p.rx, v, 256)) > 0) {
+		ck_assert_int_lt(n, 256);
+		assert_verdict(&v[n - 1], NFQNL_MSG_VERDICT_BATCH, total + n,
+			       (total + n) % 2 ? NF_ACCEPT : NF_DROP);
+		total += n;
+	}
+	ck_assert_int_eq(total, 2000);
+
+	nfnl_queue_verdict_buf_free(vb);
+	peers_free(&p);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_queue_verdict_suite(void)
+{
+	Suite *suite = suite_create("Queue verdicts");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, queue_verdict_batch);
+	tcase_add_test(tc, queue_verdict_limits);
+	tcase_add_test(tc, queue_verdict_sndbuf);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -0,0 +1,258 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netlink.h>
+
+#include <netlink/msg.h>
+#include <netlink/netlink.h>
+#include <netlink/socket.h>
+
+#include "cksuite-all.h"
+
+#define TEST_MSG_TYPE (NLMSG_MIN_TYPE + 1)
+
+struct datagram {
+	uint8_t			buf[8192];
+	size_t			len;
+};
+
+/* Appends a message carrying @id, padded to @size bytes */
+static void add_msg(struct datagram *d, uint32_t id, size_t size)
+{
+	struct nlmsghdr *nlh = (struct nlmsghdr *) (d->buf + d->len);
+
+	size = _NL_MAX(size, NLMSG_LENGTH(sizeof(id)));
+	ck_assert_uint_le(d->len + NLMSG_ALIGN(size), sizeof(d->buf));
+	memset(nlh, 0, NLMSG_ALIGN(size));
+	*nlh = (struct nlmsghdr) {
+		.nlmsg_len = size,
+		.nlmsg_type = TEST_MSG_TYPE,
+		.nlmsg_flags = NLM_F_REQUEST,
+	};
+	memcpy(NLMSG_DATA(nlh), &id, sizeof(id));
+	d->len += NLMSG_ALIGN(size);
+}
+
+static void add_error(struct datagram *d, int error)
+{
+	struct nlmsghdr *nlh = (struct nlmsghdr *) (d->buf + d->len);
+	struct nlmsgerr *e = NLMSG_DATA(nlh);
+
+	memset(nlh, 0, NLMSG_SPACE(sizeof(*e)));
+	nlh->nlmsg_len = NLMSG_LENGTH(sizeof(*e));
+	nlh->nlmsg_type = NLMSG_ERROR;
+	e->error = error;
+	e->msg.nlmsg_len = NLMSG_HDRLEN;
+	d->len += NLMSG_SPACE(sizeof(*e));
+}
+
+#define MAX_IDS 32
+
+struct seen {
+	int			n;
+	uint32_t		id[MAX_IDS];
+	struct nl_msg *		kept;
+};
+
+static int record_msg(struct nl_msg *msg, void *arg)
+{
+	struct seen *s = arg;
+
+	ck_assert_int_lt(s->n, MAX_IDS);
+	memcpy(&s->id[s->n++], nlmsg_data(nlmsg_hdr(msg)), sizeof(uint32_t));
+	if (!s->kept) {
+		nlmsg_get(msg);
+		s->kept = msg;
+	}
+
+	return NL_OK;
+}
+
+struct peers {
+	struct nl_sock *	tx;
+	struct nl_sock *	rx;
+	struct datagram		d;
+	struct seen		seen;
+};
+
+/* Datagrams sent on tx are received on rx in batches of @batch */
+static void peers_init(struct peers *p, unsigned int batch)
+{
+	*p = (struct peers) { 0 };
+
+	p->rx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->rx);
+	ck_assert_int_eq(nl_connect(p->rx, NETLINK_USERSOCK), 0);
+	ck_assert_int_eq(nl_socket_set_nonblocking(p->rx), 0);
+	nl_socket_disable_seq_check(p->rx);
+	nl_socket_set_msg_buf_size(p->rx, 2048);
+	ck_assert_int_eq(nl_socket_set_recv_batch(p->rx, batch), 0);
+	ck_assert_int_eq(nl_socket_modify_cb(p->rx, NL_CB_VALID, NL_CB_CUSTOM,
+					     record_msg, &p->seen),
+			 0);
+
+	p->tx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->tx);
+	ck_assert_int_eq(nl_connect(p->tx, NETLINK_USERSOCK), 0);
+	nl_socket_set_peer_port(p->tx, nl_socket_get_local_port(p->rx));
+}
+
+static void peers_free(struct peers *p)
+{
+	nlmsg_free(p->seen.kept);
+	nl_socket_free(p->tx);
+	nl_socket_free(p->rx);
+}
+
+static void send_datagram(struct peers *p)
+{
+	ck_assert_int_eq(nl_sendto(p->tx, p->d.buf, p->d.len), (int) p->d.len);
+	p->d.len = 0;
+}
+
+static void send_ids(struct peers *p, uint32_t first, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		add_msg(&p->d, first + i, 0);
+		send_datagram(p);
+	}
+}
+
+static void assert_ids(struct peers *p, uint32_t first, int n)
+{
+	int i;
+
+	ck_assert_int_eq(p->seen.n, n);
+	for (i = 0; i < n; i++)
+		ck_assert_uint_eq(p->seen.id[i], first + i);
+	p->seen.n = 0;
+}
+
+static void recv_n(struct peers *p, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		ck_assert_int_eq(nl_recvmsgs_default(p->rx), 0);
+}
+
+START_TEST(recv_batch_many)
+{
+	struct peers p;
+	int i;
+
+	peers_init(&p, 8);
+	if (_i)
+		nl_socket_enable_msg_zerocopy(p.rx);
+
+	/* Each call returns one datagram, in order, with all its messages */
+	for (i = 0; i < 5; i++) {
+		add_msg(&p.d, 2 * i, 0);
+		add_msg(&p.d, 2 * i + 1, 0);
+		send_datagram(&p);
+	}
+	recv_n(&p, 5);
+	assert_ids(&p, 0, 10);
+	ck_assert_uint_eq(nl_socket_get_recv_batch_saved(p.rx), 4);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), -NLE_AGAIN);
+
+	/* A message of an earlier batch survives the next refill */
+	send_ids(&p, 10, 3);
+	recv_n(&p, 3);
+	assert_ids(&p, 10, 3);
+	ck_assert_uint_eq(nl_socket_get_recv_batch_saved(p.rx), 6);
+	ck_assert_uint_eq(*(uint32_t *) nlmsg_data(nlmsg_hdr(p.seen.kept)), 0);
+
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(recv_batch_partial)
+{
+	struct peers p;
+
+	peers_init(&p, 4);
+
+	/* A full batch followed by a partial one */
+	send_ids(&p, 0, 6);
+	recv_n(&p, 6);
+	assert_ids(&p, 0, 6);
+	ck_assert_uint_eq(nl_socket_get_recv_batch_saved(p.rx), 4);
+
+	/* Datagrams left in the ring are returned before newer ones */
+	send_ids(&p, 6, 2);
+	recv_n(&p, 1);
+	assert_ids(&p, 6, 1);
+	send_ids(&p, 8, 2);
+	recv_n(&p, 3);
+	assert_ids(&p, 7, 3);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), -NLE_AGAIN);
+
+	/* A single datagram saves nothing */
+	send_ids(&p, 10, 1);
+	recv_n(&p, 1);
+	assert_ids(&p, 10, 1);
+	ck_assert_uint_eq(nl_socket_get_recv_batch_saved(p.rx), 6);
+
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(recv_batch_error)
+{
+	struct peers p;
+
+	peers_init(&p, 8);
+
+	/* Errors only affect their own datagram */
+	send_ids(&p, 0, 1);
+	add_msg(&p.d, 1, 3000);
+	send_datagram(&p);
+	send_ids(&p, 2, 1);
+	add_error(&p.d, -EINVAL);
+	send_datagram(&p);
+	send_ids(&p, 4, 1);
+
+	recv_n(&p, 1);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), -NLE_MSG_TRUNC);
+	recv_n(&p, 1);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), -NLE_INVAL);
+	recv_n(&p, 1);
+	ck_assert_int_eq(p.seen.n, 3);
+	ck_assert_uint_eq(p.seen.id[0], 0);
+	ck_assert_uint_eq(p.seen.id[1], 2);
+	ck_assert_uint_eq(p.seen.id[2], 4);
+	p.seen.n = 0;
+	ck_assert_uint_eq(nl_socket_get_recv_batch_saved(p.rx), 4);
+
+	/* The buffers of the next batch fit the truncated datagram */
+	add_msg(&p.d, 5, 3000);
+	send_datagram(&p);
+	send_ids(&p, 6, 1);
+	recv_n(&p, 2);
+	assert_ids(&p, 5, 2);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_grows(p.rx), 1);
+
+	peers_free(&p);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_recv_batch_suite(void)
+{
+	Suite *suite = suite_create("Batched receive");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_loop_test(tc, recv_batch_many, 0, 2);
+	tcase_add_test(tc, recv_batch_partial);
+	tcase_add_test(tc, recv_batch_error);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -0,0 +1,198 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <netlink/msg.h>
+#include <netlink/netlink.h>
+#include <netlink/socket.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/nl-core.h"
+
+#define TEST_MSG_TYPE (NLMSG_MIN_TYPE + 1)
+
+struct peers {
+	struct nl_sock *	tx;
+	struct nl_sock *	rx;
+};
+
+/* Datagrams sent on tx are received on rx */
+static void peers_init(struct peers *p)
+{
+	p->rx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->rx);
+	ck_assert_int_eq(nl_connect(p->rx, NETLINK_USERSOCK), 0);
+	nl_socket_disable_seq_check(p->rx);
+
+	p->tx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(p->tx);
+	ck_assert_int_eq(nl_connect(p->tx, NETLINK_USERSOCK), 0);
+	nl_socket_set_peer_port(p->tx, nl_socket_get_local_port(p->rx));
+}
+
+static void peers_free(struct peers *p)
+{
+	nl_socket_free(p->tx);
+	nl_socket_free(p->rx);
+}
+
+/* Sends a datagram of exactly @size bytes holding a single message */
+static void send_size(struct peers *p, size_t size)
+{
+	_nl_auto_free void *buf = calloc(1, size);
+	struct nlmsghdr *nlh = buf;
+
+	ck_assert_ptr_nonnull(buf);
+	ck_assert_uint_ge(size, NLMSG_HDRLEN);
+	*nlh = (struct nlmsghdr) {
+		.nlmsg_len = size,
+		.nlmsg_type = TEST_MSG_TYPE,
+		.nlmsg_flags = NLM_F_REQUEST,
+	};
+	ck_assert_int_eq(nl_sendto(p->tx, buf, size), (int) size);
+}
+
+START_TEST(recv_counters_buf)
+{
+	struct peers p;
+
+	peers_init(&p);
+	nl_socket_set_msg_buf_size(p.rx, 2048);
+	nl_socket_disable_msg_peek(p.rx);
+	nl_socket_enable_recv_buf(p.rx);
+
+	ck_assert_uint_eq(nl_socket_get_recv_buf_size(p.rx), 0);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_grows(p.rx), 0);
+
+	send_size(&p, 100);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), 0);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_size(p.rx), 2048);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_grows(p.rx), 0);
+
+	/* The truncated datagram is lost, the buffer fits the next one */
+	send_size(&p, 5000);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), -NLE_MSG_TRUNC);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_size(p.rx), 5000);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_grows(p.rx), 1);
+
+	send_size(&p, 5000);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), 0);
+	send_size(&p, 300);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), 0);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_size(p.rx), 5000);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_grows(p.rx), 1);
+
+	/* Peeking grows the buffer without losing the datagram */
+	nl_socket_enable_msg_peek(p.rx);
+	send_size(&p, 8000);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), 0);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_size(p.rx), 8000);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_grows(p.rx), 2);
+
+	peers_free(&p);
+}
+END_TEST
+
+START_TEST(recv_counters_batch)
+{
+	struct peers p;
+	int i;
+
+	peers_init(&p);
+	nl_socket_set_msg_buf_size(p.rx, 2048);
+	ck_assert_int_eq(nl_socket_set_recv_batch(p.rx, 4), 0);
+	ck_assert_uint_eq(nl_socket_get_recv_batch_saved(p.rx), 0);
+
+	/* Three datagrams read with one system call save two */
+	for (i = 0; i < 3; i++)
+		send_size(&p, 100);
+	for (i = 0; i < 3; i++)
+		ck_assert_int_eq(nl_recvmsgs_default(p.rx), 0);
+	ck_assert_uint_eq(nl_socket_get_recv_batch_saved(p.rx), 2);
+
+	send_size(&p, 5000);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), -NLE_MSG_TRUNC);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_grows(p.rx), 1);
+	send_size(&p, 5000);
+	ck_assert_int_eq(nl_recvmsgs_default(p.rx), 0);
+	ck_assert_uint_eq(nl_socket_get_recv_buf_grows(p.rx), 1);
+	ck_assert_uint_eq(nl_socket_get_recv_batch_saved(p.rx), 2);
+
+	peers_free(&p);
+}
+END_TEST
+
+static int count_msg(struct nl_msg *msg, void *arg)
+{
+	(*(int *) arg)++;
+
+	return NL_OK;
+}
+
+START_TEST(recv_counters_overrun)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	_nl_auto_nl_socket struct nl_sock *rx = NULL;
+	char name[IFNAMSIZ];
+	int n = 0;
+	int err;
+	int i;
+
+	rx = nl_socket_alloc();
+	ck_assert_ptr_nonnull(rx);
+	ck_assert_int_eq(nl_connect(rx, NETLINK_ROUTE), 0);
+	ck_assert_int_eq(nl_socket_add_membership(rx, RTNLGRP_LINK), 0);
+	ck_assert_int_eq(nl_socket_set_buffer_size(rx, 1, 0), 0);
+	ck_assert_int_eq(nl_socket_set_nonblocking(rx), 0);
+	nl_socket_disable_seq_check(rx);
+	ck_assert_int_eq(nl_socket_modify_cb(rx, NL_CB_VALID, NL_CB_CUSTOM,
+					     count_msg, &n),
+			 0);
+	if (_i == 1)
+		nl_socket_enable_recv_buf(rx);
+	else if (_i == 2)
+		ck_assert_int_eq(nl_socket_set_recv_batch(rx, 8), 0);
+
+	/* Notifications the kernel cannot queue are reported once */
+	for (i = 0; i < 10; i++) {
+		snprintf(name, sizeof(name), "xveth%d", i);
+		_nltst_add_link(sk, name, "veth", NULL);
+	}
+	ck_assert_uint_eq(rx->s_overruns, 0);
+
+	ck_assert_int_eq(nl_recvmsgs_default(rx), -NLE_NOMEM);
+	ck_assert_uint_eq(rx->s_overruns, 1);
+
+	while ((err = nl_recvmsgs_default(rx)) == 0)
+		;
+	ck_assert_int_eq(err, -NLE_AGAIN);
+	ck_assert_int_gt(n, 0);
+	ck_assert_int_lt(n, 20);
+	ck_assert_uint_eq(rx->s_overruns, 1);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_recv_counters_suite(void)
+{
+	Suite *suite = suite_create("Receive counters");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, recv_counters_buf);
+	tcase_add_test(tc, recv_counters_batch);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("Overrun");
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_loop_test(tc, recv_counters_overrun, 0, 3);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
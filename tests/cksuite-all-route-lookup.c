@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/rtnetlink.h>
+
+#include <netlink/cache.h>
+#include <netlink/object.h>
+#include <netlink/route/route.h>
+#include <netlink/route/nexthop.h>
+
+#include "cksuite-all.h"
+#include "nl-priv-dynamic-core/cache-api.h"
+
+static struct rtnl_route *add_route(struct nl_cache *cache, const char *dst,
+				    uint32_t table, uint32_t prio, int ifindex)
+{
+	struct rtnl_route *route = rtnl_route_alloc();
+	struct rtnl_nexthop *nh = rtnl_route_nh_alloc();
+	struct nl_addr *addr;
+
+	ck_assert_int_eq(nl_addr_parse(dst, AF_UNSPEC, &addr), 0);
+	rtnl_route_set_family(route, nl_addr_get_family(addr));
+	rtnl_route_set_table(route, table);
+	rtnl_route_set_priority(route, prio);
+	ck_assert_int_eq(rtnl_route_set_dst(route, addr), 0);
+	nl_addr_put(addr);
+
+	rtnl_route_nh_set_ifindex(nh, ifindex);
+	rtnl_route_add_nexthop(route, nh);
+
+	ck_assert_int_eq(nl_cache_add(cache, (struct nl_object *) route), 0);
+	rtnl_route_put(route);
+
+	return route;
+}
+
+static int lookup_ifindex(struct nl_cache *cache, uint32_t table,
+			  const char *dst)
+{
+	struct rtnl_nexthop *nh;
+	struct rtnl_route *route;
+	struct nl_addr *addr;
+	int ifindex = 0;
+
+	ck_assert_int_eq(nl_addr_parse(dst, AF_UNSPEC, &addr), 0);
+	route = rtnl_route_cache_lookup(cache, table, addr, &nh);
+	nl_addr_put(addr);
+
+	if (route) {
+		ck_assert_ptr_nonnull(nh);
+		ifindex = rtnl_route_nh_get_ifindex(nh);
+		rtnl_route_put(route);
+	} else
+		ck_assert_ptr_null(nh);
+
+	return ifindex;
+}
+
+START_TEST(route_lookup_longest_prefix)
+{
+	struct nl_cache *cache;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/route", &cache), 0);
+
+	add_route(cache, "0.0.0.0/0", RT_TABLE_MAIN, 0, 1);
+	add_route(cache, "10.0.0.0/8", RT_TABLE_MAIN, 0, 2);
+	add_route(cache, "10.1.0.0/16", RT_TABLE_MAIN, 0, 3);
+	add_route(cache, "10.1.2.3/32", RT_TABLE_MAIN, 0, 4);
+	add_route(cache, "10.128.0.0/9", RT_TABLE_MAIN, 0, 5);
+	add_route(cache, "2001:db8::/32", RT_TABLE_MAIN, 0, 6);
+	add_route(cache, "10.1.0.0/16", 100, 0, 7);
+
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.1.2.3"), 4);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.1.2.4"), 3);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.2.0.1"), 2);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.200.0.1"), 5);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "192.0.2.1"), 1);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "2001:db8::1"), 6);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "2001:db9::1"), 0);
+	ck_assert_int_eq(lookup_ifindex(cache, 100, "10.1.9.9"), 7);
+	ck_assert_int_eq(lookup_ifindex(cache, 100, "10.2.9.9"), 0);
+
+	nl_cache_free(cache);
+}
+END_TEST
+
+START_TEST(route_lookup_remove)
+{
+	struct rtnl_route *r16, *r16_metric, *r32;
+	struct nl_cache *cache;
+	void *index;
+
+	ck_assert_int_eq(nl_cache_alloc_name("route/route", &cache), 0);
+
+	add_route(cache, "10.0.0.0/8", RT_TABLE_MAIN, 0, 1);
+	r16_metric = add_route(cache, "10.1.0.0/16", RT_TABLE_MAIN, 10, 2);
+	r16 = add_route(cache, "10.1.0.0/16", RT_TABLE_MAIN, 5, 3);
+	r32 = add_route(cache, "10.1.2.3/32", RT_TABLE_MAIN, 0, 4);
+
+	/* Lowest metric wins among routes to the same prefix */
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.1.2.4"), 3);
+
+	nl_cache_remove((struct nl_object *) r16);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.1.2.4"), 2);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.1.2.3"), 4);
+
+	nl_cache_remove((struct nl_object *) r16_metric);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.1.2.4"), 1);
+
+	nl_cache_remove((struct nl_object *) r32);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.1.2.3"), 1);
+
+	/* The index is kept and updated while the cache is emptied */
+	index = cache->c_index;
+	ck_assert_ptr_nonnull(index);
+	nl_cache_clear(cache);
+	ck_assert_ptr_eq(cache->c_index, index);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.1.2.3"), 0);
+
+	add_route(cache, "10.1.0.0/16", RT_TABLE_MAIN, 0, 5);
+	ck_assert_ptr_eq(cache->c_index, index);
+	ck_assert_int_eq(lookup_ifindex(cache, RT_TABLE_MAIN, "10.1.2.3"), 5);
+
+	nl_cache_free(cache);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_route_lookup_suite(void)
+{
+	Suite *suite = suite_create("Route lookup");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_test(tc, route_lookup_longest_prefix);
+	tcase_add_test(tc, route_lookup_remove);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
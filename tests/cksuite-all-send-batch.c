@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: LGPL-2.1-only */
+
+#include "nl-default.h"
+
+#include <check.h>
+
+#include <linux/netlink.h>
+
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/socket.h>
+
+#include "cksuite-all.h"
+
+static struct nl_msg *build_noop(void)
+{
+	struct nl_msg *msg;
+
+	/* The kernel acknowledges control messages without processing them */
+	msg = nlmsg_alloc_simple(NLMSG_NOOP, NLM_F_REQUEST | NLM_F_ACK);
+	ck_assert_ptr_nonnull(msg);
+
+	return msg;
+}
+
+static uint32_t add_noops(struct nl_send_batch *b, int n)
+{
+	uint32_t seq = 0;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		struct nl_msg *msg = build_noop();
+
+		ck_assert_int_eq(nl_send_batch_add(b, msg), 0);
+		seq = nlmsg_hdr(msg)->nlmsg_seq;
+		nlmsg_free(msg);
+	}
+
+	/* Sequence number of the last message added */
+	return seq;
+}
+
+static void assert_no_pending(struct nl_sock *sk)
+{
+	char buf[64];
+
+	ck_assert_int_lt(recv(nl_socket_get_fd(sk), buf, sizeof(buf),
+			      MSG_DONTWAIT), 0);
+	ck_assert_int_eq(errno, EAGAIN);
+}
+
+static int reject_out(struct nl_msg *msg, void *arg)
+{
+	return *(int *) arg;
+}
+
+START_TEST(send_batch_roundtrip)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	struct nl_send_batch *b;
+
+	/* Every ACK occupies receive buffer space until it is read */
+	ck_assert_int_eq(nl_socket_set_buffer_size(sk, 0, 1024 * 1024), 0);
+
+	b = nl_send_batch_alloc(sk);
+	ck_assert_ptr_nonnull(b);
+
+	add_noops(b, 64);
+	ck_assert_int_eq(nl_send_batch_flush(b), 64);
+	ck_assert_int_eq(nl_send_batch_wait(b, NULL, NULL), 0);
+	assert_no_pending(sk);
+
+	/* The batch can be reused */
+	add_noops(b, 3);
+	ck_assert_int_eq(nl_send_batch_flush(b), 3);
+	ck_assert_int_eq(nl_send_batch_wait(b, NULL, NULL), 0);
+	assert_no_pending(sk);
+
+	nl_send_batch_free(b);
+}
+END_TEST
+
+START_TEST(send_batch_unaligned)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	static const uint8_t odd[3] = { 1, 2, 3 };
+	struct nl_send_batch *b;
+	int i;
+
+	b = nl_send_batch_alloc(sk);
+	ck_assert_ptr_nonnull(b);
+
+	/* The kernel expects the next message at the aligned offset */
+	for (i = 0; i < 4; i++) {
+		struct nl_msg *msg = build_noop();
+
+		ck_assert_int_eq(nlmsg_append(msg, (void *) odd, sizeof(odd), 0),
+				 0);
+		ck_assert_uint_ne(nlmsg_hdr(msg)->nlmsg_len % NLMSG_ALIGNTO, 0);
+		ck_assert_int_eq(nl_send_batch_add(b, msg), 0);
+		nlmsg_free(msg);
+	}
+
+	ck_assert_int_eq(nl_send_batch_flush(b), 4);
+	ck_assert_int_eq(nl_send_batch_wait(b, NULL, NULL), 0);
+	assert_no_pending(sk);
+
+	nl_send_batch_free(b);
+}
+END_TEST
+
+START_TEST(send_batch_msg_out_rejected)
+{
+	_nl_auto_nl_socket struct nl_sock *sk = _nltst_socket(NETLINK_ROUTE);
+	struct nl_send_batch *b;
+	uint32_t seq;
+	int reject;
+
+	b = nl_send_batch_alloc(sk);
+	ck_assert_ptr_nonnull(b);
+
+	add_noops(b, 4);
+	ck_assert_int_eq(nl_send_batch_flush(b), 4);
+
+	seq = add_noops(b, 2);
+	ck_assert_ptr_nonnull(nl_send_batch_find(b, seq));
+
+	/* Errors of the callback are passed on, everything else is invalid */
+	nl_socket_modify_cb(sk, NL_CB_MSG_OUT, NL_CB_CUSTOM, reject_out,
+			    &reject);
+	reject = -NLE_PERM;
+	ck_assert_int_eq(nl_send_batch_flush(b), -NLE_PERM);
+
+	seq = add_noops(b, 2);
+	reject = NL_STOP;
+	ck_assert_int_eq(nl_send_batch_flush(b), -NLE_INVAL);
+	nl_socket_modify_cb(sk, NL_CB_MSG_OUT, NL_CB_DEFAULT, NULL, NULL);
+
+	/* Only the rejected messages are dropped */
+	ck_assert_ptr_null(nl_send_batch_find(b, seq));
+
+	/* The ACKs of the messages flushed before are still collected */
+	ck_assert_int_eq(nl_send_batch_wait(b, NULL, NULL), 0);
+	assert_no_pending(sk);
+
+	nl_send_batch_free(b);
+}
+END_TEST
+
+/*****************************************************************************/
+
+Suite *make_nl_send_batch_suite(void)
+{
+	Suite *suite = suite_create("Batched send");
+	TCase *tc = tcase_create("Core");
+
+	tcase_add_checked_fixture(tc, nltst_netns_fixture_setup,
+				  nltst_netns_fixture_teardown);
+	tcase_add_test(tc, send_batch_roundtrip);
+	tcase_add_test(tc, send_batch_unaligned);
+	tcase_add_test(tc, send_batch_msg_out_rejected);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
@@ -5,9 +5,31 @@
 
 #include "nl-test-util.h"
 
+Suite *make_nl_async_suite(void);
 Suite *make_nl_attr_suite(void);
+Suite *make_nl_cache_dispatch_suite(void);
+Suite *make_nl_cache_dump_filter_suite(void);
+Suite *make_nl_cache_filter_suite(void);
+Suite *make_nl_cache_hash_suite(void);
+Suite *make_nl_cache_include_suite(void);
+Suite *make_nl_cache_mngr_suite(void);
+Suite *make_nl_cache_refill_parallel_suite(void);
+Suite *make_nl_cache_resync_suite(void);
+Suite *make_nl_cache_snapshot_suite(void);
 Suite *make_nl_addr_suite(void);
+Suite *make_nl_cache_stream_suite(void);
+Suite *make_nl_ct_addr_suite(void);
 Suite *make_nl_ematch_tree_clone_suite(void);
+Suite *make_nl_link_lookup_suite(void);
+Suite *make_nl_msg_zerocopy_suite(void);
 Suite *make_nl_netns_suite(void);
+Suite *make_nl_nf_log_collector_suite(void);
+Suite *make_nl_nf_payload_suite(void);
+Suite *make_nl_queue_pool_suite(void);
+Suite *make_nl_queue_verdict_suite(void);
+Suite *make_nl_recv_batch_suite(void);
+Suite *make_nl_recv_counters_suite(void);
+Suite *make_nl_route_lookup_suite(void);
+Suite *make_nl_send_batch_suite(void);
 
 #endif /* __LIBNL3_TESTS_CHECK_ALL_H__ */